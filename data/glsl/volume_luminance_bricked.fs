@@ -0,0 +1,54 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Copyright (c) 2005-2011, Michele Bosi.                                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  This file is part of Visualization Library                                        */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Released under the OSI approved Simplified BSD License                            */
+/*  http://www.opensource.org/licenses/bsd-license.php                                */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+// This shader maps the value of a BrickedVolume, sampled through its page table, to the 
+// transfer function with no lighting. To be used with SlicedVolume::setBrickedVolume().
+
+uniform sampler3D page_table_texunit;
+uniform sampler3D brick_atlas_texunit;
+uniform sampler1D trfunc_texunit;
+uniform float     trfunc_delta;
+uniform vec3 volume_size;       // size in voxels of the full resolution volume
+uniform vec3 page_table_size;   // number of bricks of the finest level
+uniform vec3 brick_atlas_slots; // number of slots of the brick atlas
+uniform float brick_size;       // size in voxels of a brick, without the border
+
+float sampleVolume(vec3 pos)
+{
+	vec3 voxel = pos * volume_size;
+	vec4 entry = texture3D(page_table_texunit, (floor(voxel / brick_size) + 0.5) / page_table_size) * 255.0;
+	// no resident brick covers this position
+	if (entry.a > 254.5)
+		return 0.0;
+	float step = exp2(floor(entry.a + 0.5));
+	float span = brick_size * step;
+	vec3 local = (voxel - floor(voxel / span) * span) / step;
+	vec3 atlas_pos = floor(entry.rgb + 0.5) * (brick_size + 2.0) + 1.0 + local;
+	return texture3D(brick_atlas_texunit, atlas_pos / (brick_atlas_slots * (brick_size + 2.0))).r;
+}
+
+void main(void)
+{
+	// sample the LUMINANCE value
+	
+	float val = sampleVolume( gl_TexCoord[0].xyz );
+	
+	// sample the transfer function
+	
+	// to properly sample the texture clamp bewteen trfunc_delta...1.0-trfunc_delta
+	float clamped_val = trfunc_delta+(1.0-2.0*trfunc_delta)*val;
+	vec4 rgba = texture1D(trfunc_texunit, clamped_val );
+
+	gl_FragColor = rgba;
+}
@@ -0,0 +1,81 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Copyright (c) 2005-2011, Michele Bosi.                                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  This file is part of Visualization Library                                        */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Released under the OSI approved Simplified BSD License                            */
+/*  http://www.opensource.org/licenses/bsd-license.php                                */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+/* raycast of a BrickedVolume, the volume is sampled through the page table */
+
+// The rays are cast from the back faces of the volume box towards the eye, so the 
+// box must be rendered with front face culling enabled, see RaycastVolume::setBrickedVolume().
+
+varying vec3 frag_position;     // in object space
+uniform sampler3D page_table_texunit;
+uniform sampler3D brick_atlas_texunit;
+uniform sampler1D trfunc_texunit;
+uniform vec3 eye_position;      // camera position in object space
+uniform float sample_step;      // step used to advance the sampling ray
+uniform float val_threshold;
+uniform vec3 volume_size;       // size in voxels of the full resolution volume
+uniform vec3 page_table_size;   // number of bricks of the finest level
+uniform vec3 brick_atlas_slots; // number of slots of the brick atlas
+uniform float brick_size;       // size in voxels of a brick, without the border
+
+float sampleVolume(vec3 pos)
+{
+	vec3 voxel = pos * volume_size;
+	vec4 entry = texture3D(page_table_texunit, (floor(voxel / brick_size) + 0.5) / page_table_size) * 255.0;
+	// no resident brick covers this position
+	if (entry.a > 254.5)
+		return 0.0;
+	float step = exp2(floor(entry.a + 0.5));
+	float span = brick_size * step;
+	vec3 local = (voxel - floor(voxel / span) * span) / step;
+	vec3 atlas_pos = floor(entry.rgb + 0.5) * (brick_size + 2.0) + 1.0 + local;
+	return texture3D(brick_atlas_texunit, atlas_pos / (brick_atlas_slots * (brick_size + 2.0))).r;
+}
+
+void main(void)
+{
+	const float brightness = 50.0;
+	// NOTE: ray direction goes from frag_position to eye_position, i.e. back to front
+	vec3 ray_dir = normalize(eye_position - frag_position);
+	vec3 ray_pos = gl_TexCoord[0].xyz; // the current ray position
+	vec3 pos111 = vec3(1.0, 1.0, 1.0);
+	vec3 pos000 = vec3(0.0, 0.0, 0.0);
+
+	vec4 frag_color = vec4(0.0, 0.0, 0.0, 0.0);
+	vec4 color;
+	do
+	{
+		ray_pos += ray_dir * sample_step;
+
+		// break out if ray reached the end of the cube.
+		if (any(greaterThan(ray_pos,pos111)))
+			break;
+
+		if (any(lessThan(ray_pos,pos000)))
+			break;
+
+		float density = sampleVolume(ray_pos);
+
+		color.rgb = texture1D(trfunc_texunit, density).rgb;
+		color.a   = density * sample_step * val_threshold * brightness;
+		frag_color.rgb = frag_color.rgb * (1.0 - color.a) + color.rgb * color.a;
+	}
+	while(true);
+
+	if (frag_color == vec4(0.0,0.0,0.0,0.0))
+		discard;
+	else
+		gl_FragColor = vec4(frag_color.rgb,1.0);
+}
+// Have fun!
\ No newline at end of file
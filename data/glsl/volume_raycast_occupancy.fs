@@ -0,0 +1,80 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Copyright (c) 2005-2011, Michele Bosi.                                            */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  This file is part of Visualization Library                                        */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Released under the OSI approved Simplified BSD License                            */
+/*  http://www.opensource.org/licenses/bsd-license.php                                */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+/* transfer function raycast with empty space skipping and early ray termination, see vl::OccupancyGrid */
+
+varying vec3 frag_position;     // in object space
+uniform sampler3D volume_texunit;
+uniform sampler3D occupancy_texunit;
+uniform sampler1D trfunc_texunit;
+uniform vec3 eye_position;      // camera position in object space
+uniform float sample_step;      // step used to advance the sampling ray
+uniform vec3 occupancy_size;    // number of blocks of the occupancy grid
+uniform vec3 occupancy_block;   // size of a block in texture coordinates
+
+void main(void)
+{
+	// NOTE: ray direction goes from eye_position to frag_position, i.e. front to back
+	vec3 ray_dir = normalize(frag_position - eye_position);
+	vec3 ray_pos = gl_TexCoord[0].xyz; // the current ray position
+	vec3 pos111 = vec3(1.0, 1.0, 1.0);
+	vec3 pos000 = vec3(0.0, 0.0, 0.0);
+
+	// avoids divisions by zero when computing the block exit distance
+	vec3 safe_dir = ray_dir + vec3(equal(ray_dir, vec3(0.0))) * 0.000001;
+	vec3 exit_side = step(vec3(0.0), ray_dir);
+	float opacity_exp = sample_step * 256.0;
+
+	vec4 frag_color = vec4(0.0, 0.0, 0.0, 0.0);
+	do
+	{
+		// break out if ray reached the end of the cube.
+		if (any(greaterThan(ray_pos,pos111)))
+			break;
+
+		if (any(lessThan(ray_pos,pos000)))
+			break;
+
+		vec3 block = floor(ray_pos / occupancy_block);
+		if (texture3D(occupancy_texunit, (block + 0.5) / occupancy_size).r < 0.5)
+		{
+			// jump to the first sample past the empty block, always advancing by at least one step
+			// since rounding can put ray_pos on or past the exit side of the block
+			vec3 t = ((block + exit_side) * occupancy_block - ray_pos) / safe_dir;
+			float t_exit = min(t.x, min(t.y, t.z));
+			ray_pos += ray_dir * max(floor(t_exit / sample_step) + 1.0, 1.0) * sample_step;
+			continue;
+		}
+
+		float density = texture3D(volume_texunit, ray_pos).r;
+		vec4 color = texture1D(trfunc_texunit, density);
+		// opacity correction for the sample step, the transfer function is defined for a step of 1/256
+		color.a = 1.0 - pow(1.0 - color.a, opacity_exp);
+		frag_color.rgb += (1.0 - frag_color.a) * color.a * color.rgb;
+		frag_color.a   += (1.0 - frag_color.a) * color.a;
+
+		// early ray termination
+		if (frag_color.a > 0.99)
+			break;
+
+		ray_pos += ray_dir * sample_step;
+	}
+	while(true);
+
+	if (frag_color.a == 0.0)
+		discard;
+	else
+		gl_FragColor = vec4(frag_color.rgb,1.0);
+}
+// Have fun!
\ No newline at end of file
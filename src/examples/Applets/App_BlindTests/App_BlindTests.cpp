@@ -40,11 +40,17 @@
 namespace blind_tests
 {
   bool test_TypeInfo();
+  bool test_bricked_volume();
+  bool test_compression();
   bool test_filesystem();
   bool test_hfloat();
+  bool test_image_conversion();
   bool test_math();
+  bool test_mipmaps();
+  bool test_residency();
   bool test_signal_slot();
   bool test_UID();
+  bool test_volume_utils();
 }
 
 using namespace blind_tests;
@@ -63,8 +69,14 @@ s_Test g_Tests[] = {
   { test_math,        "Math"         },
   { test_filesystem,  "Filesystem"   },
   { test_hfloat,      "Half Float"   },
+  { test_image_conversion, "Image Conversion" },
+  { test_mipmaps,    "Mipmaps"      },
+  { test_compression, "Block Compression" },
+  { test_residency,   "Residency"    },
+  { test_bricked_volume, "Bricked Volume" },
   { test_signal_slot, "Signal Slot"  },
   { test_UID,         "UUID"         },
+  { test_volume_utils, "Volume Utils" },
   { NULL, NULL }
 };
 
@@ -0,0 +1,204 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#include <vlVolume/BrickedVolume.hpp>
+
+using namespace vl;
+
+namespace
+{
+  //! A procedural volume which counts the bricks read.
+  class FakeBrickSource: public BrickSource
+  {
+  public:
+    FakeBrickSource(int side): mReads(0) { mDimensions = ivec3(side, side, side); }
+
+    static unsigned char voxel(int x, int y, int z) { return (unsigned char)(x*7 + y*13 + z*29); }
+
+    unsigned char clampedVoxel(int x, int y, int z) const
+    {
+      x = std::max( 0, std::min( mDimensions.x()-1, x ) );
+      y = std::max( 0, std::min( mDimensions.y()-1, y ) );
+      z = std::max( 0, std::min( mDimensions.z()-1, z ) );
+      return voxel(x, y, z);
+    }
+
+    virtual bool readRegion(const ivec3& origin, const ivec3& size, int step, void* out)
+    {
+      unsigned char* px = (unsigned char*)out;
+      for(int z=0; z<size.z(); ++z)
+        for(int y=0; y<size.y(); ++y)
+          for(int x=0; x<size.x(); ++x)
+            *px++ = clampedVoxel( origin.x() + x*step, origin.y() + y*step, origin.z() + z*step );
+      ++mReads;
+      return true;
+    }
+
+    int mReads;
+  };
+
+  //! Checks that the slot of \p brick contains its voxels and border.
+  bool checkBrick(const BrickedVolume* volume, const FakeBrickSource* source, const ivec4& brick)
+  {
+    int slot = volume->brickSlot(brick);
+    if (slot < 0)
+      return false;
+    const int side = volume->brickSize() + 2;
+    const int step = 1 << brick.w();
+    const ivec3 origin = (brick.xyz() * volume->brickSize() - ivec3(1,1,1)) * step;
+    const unsigned char* data = volume->slotData(slot);
+    for(int z=0; z<side; ++z)
+      for(int y=0; y<side; ++y)
+        for(int x=0; x<side; ++x)
+          if ( data[x + side*(y + side*z)] != source->clampedVoxel( origin.x() + x*step, origin.y() + y*step, origin.z() + z*step ) )
+            return false;
+    return true;
+  }
+
+  //! Returns the page table entry of the given cell of the finest level.
+  const unsigned char* pageEntry(const BrickedVolume* volume, int x, int y, int z)
+  {
+    const ivec3& size = volume->levelSize(0);
+    return volume->pageTable()->pixels() + (x + size.x()*(y + size.y()*z)) * 4;
+  }
+
+  //! Returns true if the page table cell points to the slot holding \p brick.
+  bool pagePointsTo(const BrickedVolume* volume, int x, int y, int z, const ivec4& brick)
+  {
+    int slot = volume->brickSlot(brick);
+    if (slot < 0)
+      return false;
+    const ivec3& slots = volume->atlasSlots();
+    const unsigned char* entry = pageEntry(volume, x, y, z);
+    return entry[0] == slot % slots.x() && entry[1] == (slot / slots.x()) % slots.y() && entry[2] == slot / (slots.x() * slots.y()) && entry[3] == brick.w();
+  }
+}
+
+namespace blind_tests
+{
+  bool test_bricked_volume()
+  {
+    // 64^3 voxels in bricks of 8^3: 4 levels of detail, 8 slots of 10^3 bytes
+    ref<FakeBrickSource> source = new FakeBrickSource(64);
+    ref<BrickedVolume> volume = new BrickedVolume;
+    volume->setup( source.get(), 8, 8 * 1000 + 999 );
+    if ( volume->levelCount() != 4 || volume->levelSize(0) != ivec3(8,8,8) || volume->levelSize(3) != ivec3(1,1,1) )
+      return false;
+    if ( volume->slotCount() != 8 )
+      return false;
+
+    // brick selection: a far view keeps the coarsest brick, a close one refines up to half the slots covering the whole volume
+    AABB box( vec3(0,0,0), vec3(64,64,64) );
+    std::vector<ivec4> bricks;
+    volume->selectBricks( box, mat4(), vec3(32,32,10000), NULL, 1, bricks );
+    if ( bricks.size() != 1 || bricks[0] != ivec4(0,0,0,3) )
+      return false;
+    volume->selectBricks( box, mat4(), vec3(1,1,-1), NULL, 10000, bricks );
+    if ( bricks.empty() || (int)bricks.size() > volume->slotCount() / 2 )
+      return false;
+    long long covered = 0;
+    for(size_t i=0; i<bricks.size(); ++i)
+    {
+      long long span = 8 << bricks[i].w();
+      covered += span * span * span;
+    }
+    if ( covered != 64 * 64 * 64 )
+      return false;
+
+    // the coarsest brick
+    std::vector<ivec4> root( 1, ivec4(0,0,0,3) );
+    if ( volume->streamBricks(root) != 0 || !checkBrick(volume.get(), source.get(), root[0]) )
+      return false;
+    if ( !pagePointsTo(volume.get(), 7, 7, 7, root[0]) )
+      return false;
+
+    // the 8 bricks of level 2: the root is pinned as the ancestor of the missing ones, so only 7 fit in the cache
+    std::vector<ivec4> level2;
+    for(int z=0; z<2; ++z)
+      for(int y=0; y<2; ++y)
+        for(int x=0; x<2; ++x)
+          level2.push_back( ivec4(x,y,z,2) );
+    if ( volume->streamBricks(level2) != 1 )
+      return false;
+    if ( !volume->isResident(root[0]) || volume->isResident(level2[7]) )
+      return false;
+    for(int i=0; i<7; ++i)
+      if ( !checkBrick(volume.get(), source.get(), level2[i]) )
+        return false;
+    // the missing brick is rendered with its ancestor until it is loaded
+    if ( !pagePointsTo(volume.get(), 0, 0, 0, level2[0]) || !pagePointsTo(volume.get(), 7, 7, 7, root[0]) )
+      return false;
+    // all the slots are used by the current frame: nothing can be evicted
+    if ( volume->streamBricks(level2) != 1 || !volume->isResident(root[0]) )
+      return false;
+
+    // use the root and the first brick, then load 3 of its children: the least recently used bricks are evicted
+    std::vector<ivec4> used;
+    used.push_back( root[0] );
+    used.push_back( level2[0] );
+    if ( volume->streamBricks(used) != 0 )
+      return false;
+    std::vector<ivec4> level1;
+    level1.push_back( ivec4(0,0,0,1) );
+    level1.push_back( ivec4(1,0,0,1) );
+    level1.push_back( ivec4(0,1,0,1) );
+    if ( volume->streamBricks(level1) != 0 )
+      return false;
+    if ( !volume->isResident(root[0]) || !volume->isResident(level2[0]) )
+      return false;
+    int evicted = 0;
+    for(int i=1; i<7; ++i)
+      evicted += volume->isResident(level2[i]) ? 0 : 1;
+    if ( evicted != 3 )
+      return false;
+    for(size_t i=0; i<level1.size(); ++i)
+      if ( !checkBrick(volume.get(), source.get(), level1[i]) )
+        return false;
+
+    // maxBrickLoads() limits the bricks loaded by each call
+    int reads = source->mReads;
+    volume->setMaxBrickLoads(2);
+    std::vector<ivec4> level0;
+    level0.push_back( ivec4(4,4,4,0) );
+    level0.push_back( ivec4(5,4,4,0) );
+    level0.push_back( ivec4(4,5,4,0) );
+    if ( volume->streamBricks(level0) != 1 || source->mReads != reads + 2 )
+      return false;
+    if ( volume->streamBricks(level0) != 0 || source->mReads != reads + 3 )
+      return false;
+    for(size_t i=0; i<level0.size(); ++i)
+      if ( !checkBrick(volume.get(), source.get(), level0[i]) || !pagePointsTo(volume.get(), level0[i].x(), level0[i].y(), level0[i].z(), level0[i]) )
+        return false;
+
+    return true;
+  }
+}
@@ -0,0 +1,356 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlCore/Image.hpp>
+#include <vlCore/Say.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/plugins/ioDDS.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace vl;
+
+#define CONDITION(cond) \
+  if (!(cond)) \
+  { \
+    vl::Log::print( Say("%s %n: condition \""#cond"\" failed.\n") << __FILE__ << __LINE__); \
+    return false; \
+  }
+
+namespace
+{
+  // Reference decoders of the 4x4 blocks, written after the specifications and independent from the encoder.
+  // Each one fills 16 RGBA pixels, the components not stored by the format are left untouched.
+
+  void decodeColorBlock(const unsigned char* in, bool dxt1, unsigned char out[16][4])
+  {
+    int c[2] = { in[0] | (in[1] << 8), in[2] | (in[3] << 8) };
+    int palette[4][4];
+    for(int j=0; j<2; ++j)
+    {
+      int r = (c[j] >> 11) & 31, g = (c[j] >> 5) & 63, b = c[j] & 31;
+      palette[j][0] = (r << 3) | (r >> 2);
+      palette[j][1] = (g << 2) | (g >> 4);
+      palette[j][2] = (b << 3) | (b >> 2);
+      palette[j][3] = 255;
+    }
+    bool four = !dxt1 || c[0] > c[1];
+    for(int k=0; k<3; ++k)
+    {
+      palette[2][k] = four ? ( 2 * palette[0][k] + palette[1][k] ) / 3 : ( palette[0][k] + palette[1][k] ) / 2;
+      palette[3][k] = four ? ( palette[0][k] + 2 * palette[1][k] ) / 3 : 0;
+    }
+    palette[2][3] = 255;
+    palette[3][3] = four ? 255 : 0;
+    for(int i=0; i<16; ++i)
+    {
+      int index = ( in[4 + i/4] >> ( 2 * (i % 4) ) ) & 3;
+      for(int k=0; k<4; ++k)
+        out[i][k] = (unsigned char)palette[index][k];
+    }
+  }
+
+  void decodeAlphaBlock(const unsigned char* in, int component, unsigned char out[16][4])
+  {
+    int palette[8] = { in[0], in[1] };
+    for(int i=1; i<7; ++i)
+    {
+      if (in[0] > in[1])
+        palette[i+1] = ( (7 - i) * in[0] + i * in[1] ) / 7;
+      else
+        palette[i+1] = i < 5 ? ( (5 - i) * in[0] + i * in[1] ) / 5 : ( i == 5 ? 0 : 255 );
+    }
+    for(int i=0; i<16; ++i)
+    {
+      int bit = 16 + 3 * i;
+      int index = ( ( in[bit >> 3] | (in[(bit >> 3) + 1] << 8) ) >> (bit & 7) ) & 7;
+      out[i][component] = (unsigned char)palette[index];
+    }
+  }
+
+  int readBits(const unsigned char* in, int& pos, int bits)
+  {
+    int value = 0;
+    for(int i=0; i<bits; ++i, ++pos)
+      value |= ( ( in[pos >> 3] >> (pos & 7) ) & 1 ) << i;
+    return value;
+  }
+
+  //! Decodes a BC7 block, only mode 6 is supported: returns false for the other modes.
+  bool decodeBPTCBlock(const unsigned char* in, unsigned char out[16][4])
+  {
+    static const int weights[] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    int pos = 0;
+    if ( readBits(in, pos, 7) != (1 << 6) )
+      return false;
+    int e[2][4];
+    for(int k=0; k<4; ++k)
+    {
+      e[0][k] = readBits(in, pos, 7);
+      e[1][k] = readBits(in, pos, 7);
+    }
+    int p0 = readBits(in, pos, 1);
+    int p1 = readBits(in, pos, 1);
+    for(int i=0; i<16; ++i)
+    {
+      int index = readBits(in, pos, i == 0 ? 3 : 4);
+      for(int k=0; k<4; ++k)
+      {
+        int e0 = (e[0][k] << 1) | p0;
+        int e1 = (e[1][k] << 1) | p1;
+        out[i][k] = (unsigned char)( ( (64 - weights[index]) * e0 + weights[index] * e1 + 32 ) >> 6 );
+      }
+    }
+    return true;
+  }
+
+  //! Decodes a compressed image into an IF_RGBA / IT_UNSIGNED_BYTE one. The missing color components are 0 and the missing alpha 255.
+  ref<Image> decompress(const Image* img)
+  {
+    EImageFormat format = img->format();
+    int bytes = format == IF_COMPRESSED_RGB_S3TC_DXT1 || format == IF_COMPRESSED_RGBA_S3TC_DXT1 || format == IF_COMPRESSED_RED_RGTC1 ? 8 : 16;
+    int blocks_x = (img->width() + 3) / 4;
+    int blocks_y = (img->height() + 3) / 4;
+    if ( img->requiredMemory() != blocks_x * blocks_y * bytes )
+      return NULL;
+
+    ref<Image> rgba = new Image(img->width(), img->height(), 0, 1, IF_RGBA, IT_UNSIGNED_BYTE);
+    const unsigned char* in = img->pixels();
+    for(int by=0; by<blocks_y; ++by)
+    {
+      for(int bx=0; bx<blocks_x; ++bx, in += bytes)
+      {
+        unsigned char block[16][4];
+        memset(block, 0, sizeof(block));
+        for(int i=0; i<16; ++i)
+          block[i][3] = 255;
+        switch(format)
+        {
+        case IF_COMPRESSED_RGB_S3TC_DXT1:
+        case IF_COMPRESSED_RGBA_S3TC_DXT1:
+          decodeColorBlock(in, true, block);
+          if (format == IF_COMPRESSED_RGB_S3TC_DXT1)
+            for(int i=0; i<16; ++i)
+              block[i][3] = 255;
+          break;
+        case IF_COMPRESSED_RGBA_S3TC_DXT3:
+          decodeColorBlock(in + 8, false, block);
+          for(int i=0; i<16; ++i)
+            block[i][3] = (unsigned char)( ( ( in[i/2] >> ( 4 * (i % 2) ) ) & 15 ) * 17 );
+          break;
+        case IF_COMPRESSED_RGBA_S3TC_DXT5:
+          decodeColorBlock(in + 8, false, block);
+          decodeAlphaBlock(in, 3, block);
+          break;
+        case IF_COMPRESSED_RED_RGTC1:
+          decodeAlphaBlock(in, 0, block);
+          break;
+        case IF_COMPRESSED_RED_GREEN_RGTC2:
+          decodeAlphaBlock(in, 0, block);
+          decodeAlphaBlock(in + 8, 1, block);
+          break;
+        case IF_COMPRESSED_RGBA_BPTC_UNORM:
+          if ( !decodeBPTCBlock(in, block) )
+            return NULL;
+          break;
+        default:
+          return NULL;
+        }
+        for(int i=0; i<16; ++i)
+        {
+          int x = bx * 4 + (i & 3);
+          int y = by * 4 + (i >> 2);
+          if ( x < rgba->width() && y < rgba->height() )
+            memcpy( rgba->pixels() + y * rgba->pitch() + x * 4, block[i], 4 );
+        }
+      }
+    }
+    return rgba;
+  }
+
+  //! Smooth gradients with some noise and a sharp edge, the alpha ramps from 0 to 255.
+  ref<Image> makeSource(int w, int h)
+  {
+    ref<Image> img = new Image(w, h, 0, 1, IF_RGBA, IT_UNSIGNED_BYTE);
+    srand(1234);
+    for(int y=0; y<h; ++y)
+    {
+      for(int x=0; x<w; ++x)
+      {
+        unsigned char* px = img->pixels() + y * img->pitch() + x * 4;
+        int noise = rand() % 9 - 4;
+        px[0] = (unsigned char)std::max( 0, std::min( 255, x * 255 / (w - 1) + noise ) );
+        px[1] = (unsigned char)std::max( 0, std::min( 255, y * 255 / (h - 1) - noise ) );
+        px[2] = (unsigned char)( x > w / 2 ? 220 : 40 );
+        px[3] = (unsigned char)( (x + y) * 255 / (w + h - 2) );
+      }
+    }
+    return img;
+  }
+
+  //! Compares the components in \p mask of two IF_RGBA / IT_UNSIGNED_BYTE images, skipping the pixels of \p a with an alpha below \p min_alpha.
+  //! Returns the largest difference and the mean one.
+  void compare(const Image* a, const Image* b, const bool* mask, int min_alpha, int& max_error, double& mean_error)
+  {
+    max_error = 0;
+    mean_error = 0;
+    int count = 0;
+    for(int y=0; y<a->height(); ++y)
+    {
+      const unsigned char* pa = a->pixels() + y * a->pitch();
+      const unsigned char* pb = b->pixels() + y * b->pitch();
+      for(int x=0; x<a->width(); ++x, pa += 4, pb += 4)
+      {
+        if (pa[3] < min_alpha)
+          continue;
+        for(int k=0; k<4; ++k)
+        {
+          if (!mask[k])
+            continue;
+          int error = abs(pa[k] - pb[k]);
+          max_error = std::max(max_error, error);
+          mean_error += error;
+          ++count;
+        }
+      }
+    }
+    mean_error /= std::max(1, count);
+  }
+
+  bool sameImage(const Image* a, const Image* b)
+  {
+    return a->width() == b->width() && a->height() == b->height() && a->depth() == b->depth() &&
+           a->format() == b->format() && a->requiredMemory() == b->requiredMemory() &&
+           memcmp(a->pixels(), b->pixels(), a->requiredMemory()) == 0;
+  }
+
+  struct FormatInfo
+  {
+    EImageFormat mFormat;
+    const char* mName;
+    bool mMask[4];
+    int mMaxError;
+    double mMeanError;
+  };
+}
+
+namespace blind_tests
+{
+  bool test_compression()
+  {
+    // bounds of the errors of the base level, the alpha of BC1 is checked separately
+    const FormatInfo formats[] =
+    {
+      { IF_COMPRESSED_RGB_S3TC_DXT1,   "BC1",       { true, true, true, false },  20, 3.5 },
+      { IF_COMPRESSED_RGBA_S3TC_DXT1,  "BC1 alpha", { true, true, true, false },  20, 3.5 },
+      { IF_COMPRESSED_RGBA_S3TC_DXT3,  "BC2",       { true, true, true, true },   20, 4.0 },
+      { IF_COMPRESSED_RGBA_S3TC_DXT5,  "BC3",       { true, true, true, true },   20, 3.0 },
+      { IF_COMPRESSED_RED_RGTC1,       "BC4",       { true, false, false, false }, 4, 1.0 },
+      { IF_COMPRESSED_RED_GREEN_RGTC2, "BC5",       { true, true, false, false },  4, 1.0 },
+      { IF_COMPRESSED_RGBA_BPTC_UNORM, "BC7",       { true, true, true, true },   16, 3.0 },
+    };
+    const ECompressionQuality qualities[] = { CQ_Fast, CQ_Normal, CQ_High };
+    const char* quality_names[] = { "fast", "normal", "high" };
+
+    // not a multiple of 4 to exercise the partial blocks, with mipmaps down to 1x1
+    ref<Image> src = makeSource(62, 38);
+    CONDITION( src->generateMipmaps(RF_Box) )
+    CONDITION( src->mipmaps().size() == 5 )
+
+    for(size_t f=0; f<sizeof(formats)/sizeof(formats[0]); ++f)
+    {
+      const FormatInfo& info = formats[f];
+      int min_alpha = info.mFormat == IF_COMPRESSED_RGBA_S3TC_DXT1 ? 128 : 0;
+      for(int q=0; q<3; ++q)
+      {
+        ref<Image> img = src->compress(info.mFormat, qualities[q]);
+        CONDITION( img && img->format() == info.mFormat && img->mipmaps().size() == src->mipmaps().size() )
+
+        // the error is bounded on the base level only: the blocks of the smallest mipmaps mix unrelated
+        // colors that no single pair of endpoints can represent
+        for(size_t level=0; level<=src->mipmaps().size(); ++level)
+        {
+          const Image* original = level ? src->mipmaps()[level-1].get() : src.get();
+          const Image* compressed = level ? img->mipmaps()[level-1].get() : img.get();
+          CONDITION( compressed->width() == original->width() && compressed->height() == original->height() )
+          ref<Image> decoded = decompress(compressed);
+          CONDITION( decoded )
+
+          // BC1 with alpha keeps the pixels with an alpha of at least 128, the others are transparent black
+          if (info.mFormat == IF_COMPRESSED_RGBA_S3TC_DXT1)
+          {
+            for(int i=0; i<original->width()*original->height(); ++i)
+            {
+              const unsigned char* a = original->pixels() + i * 4;
+              const unsigned char* b = decoded->pixels() + i * 4;
+              CONDITION( b[3] == (a[3] < 128 ? 0 : 255) )
+              CONDITION( a[3] >= 128 || (b[0] == 0 && b[1] == 0 && b[2] == 0) )
+            }
+          }
+
+          if (level == 0)
+          {
+            int max_error = 0;
+            double mean_error = 0;
+            compare(original, decoded.get(), info.mMask, min_alpha, max_error, mean_error);
+            Log::print( Say("%s %s: max error %n, mean error %.2n\n") << info.mName << quality_names[q] << max_error << mean_error );
+            CONDITION( max_error <= info.mMaxError )
+            CONDITION( mean_error <= info.mMeanError )
+          }
+        }
+
+        // saveDDS() and loadDDS() round trip, the blocks are stored as they are
+        const char* path = "test_compression.dds";
+        CONDITION( saveDDS(img.get(), path) )
+        ref<Image> loaded = loadDDS(path);
+        remove(path);
+        CONDITION( loaded && sameImage(loaded.get(), img.get()) )
+        CONDITION( loaded->mipmaps().size() == img->mipmaps().size() )
+        for(size_t i=0; i<img->mipmaps().size(); ++i)
+          CONDITION( sameImage(loaded->mipmaps()[i].get(), img->mipmaps()[i].get()) )
+      }
+    }
+
+    // opaque images keep an alpha of exactly 255 in BC7
+    ref<Image> opaque = makeSource(16, 16);
+    for(int i=0; i<16*16; ++i)
+      opaque->pixels()[i*4+3] = 255;
+    ref<Image> bc7 = opaque->compress(IF_COMPRESSED_RGBA_BPTC_UNORM, CQ_High);
+    CONDITION( bc7 )
+    ref<Image> decoded = decompress(bc7.get());
+    CONDITION( decoded )
+    for(int i=0; i<16*16; ++i)
+      CONDITION( decoded->pixels()[i*4+3] == 255 )
+
+    return true;
+  }
+}
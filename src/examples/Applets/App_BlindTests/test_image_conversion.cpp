@@ -0,0 +1,349 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlCore/Image.hpp>
+#include <vlCore/Time.hpp>
+#include <vlCore/Say.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/glsl_math.hpp>
+#include <cstring>
+
+using namespace vl;
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  // per-component reference implementation, as it was before the row kernels
+  //-----------------------------------------------------------------------------
+  int componentCount(EImageFormat format)
+  {
+    switch(format)
+    {
+      case IF_RGB:   return 3;
+      case IF_RGBA:  return 4;
+      case IF_BGR:   return 3;
+      case IF_BGRA:  return 4;
+      case IF_LUMINANCE_ALPHA: return 2;
+      default:
+        return 1;
+    }
+  }
+  //-----------------------------------------------------------------------------
+  ref<Image> newImage(const Image* src, EImageFormat format, EImageType type)
+  {
+    ref<Image> img = new Image;
+    img->setFormat(format);
+    img->setType(type);
+    img->setWidth(src->width());
+    img->setHeight(src->height());
+    img->setDepth(src->depth());
+    img->setByteAlignment(1);
+    img->allocate();
+    return img;
+  }
+  //-----------------------------------------------------------------------------
+  double toUnit(const unsigned char* px, EImageType type)
+  {
+    switch(type)
+    {
+      case IT_UNSIGNED_BYTE:  return *(const unsigned char*)px / 255.0;
+      case IT_BYTE:           return *(const GLbyte*)px / 127.0;
+      case IT_UNSIGNED_SHORT: return *(const GLushort*)px / 65535.0;
+      case IT_SHORT:          return *(const GLshort*)px / 32767.0;
+      case IT_UNSIGNED_INT:   return *(const unsigned int*)px / 4294967295.0;
+      case IT_INT:            return *(const int*)px / 2147483647.0;
+      case IT_FLOAT:          return *(const float*)px;
+      default:
+        return 0;
+    }
+  }
+  //-----------------------------------------------------------------------------
+  void fromUnit(double dval, unsigned char* px, EImageType type)
+  {
+    switch(type)
+    {
+      case IT_UNSIGNED_BYTE:  *(unsigned char*)px = (unsigned char)(dval*255.0); break;
+      case IT_BYTE:           *(GLbyte*)px        = (GLbyte)(dval*127.0); break;
+      case IT_UNSIGNED_SHORT: *(GLushort*)px      = (GLushort)(dval*65535.0); break;
+      case IT_SHORT:          *(GLshort*)px       = (GLshort)(dval*32767.0); break;
+      case IT_UNSIGNED_INT:   *(unsigned int*)px  = (unsigned int)(dval*4294967295.0); break;
+      case IT_INT:            *(int*)px           = (int)(dval*2147483647.0); break;
+      case IT_FLOAT:          *(float*)px         = (float)dval; break;
+      default:
+        break;
+    }
+  }
+  //-----------------------------------------------------------------------------
+  ref<Image> refConvertType(const Image* src, EImageType new_type)
+  {
+    ref<Image> img = newImage(src, src->format(), new_type);
+    const int src_size = Image::bitsPerPixel(src->type(), IF_LUMINANCE) / 8;
+    const int dst_size = Image::bitsPerPixel(new_type, IF_LUMINANCE) / 8;
+    const int count = img->width() * componentCount(src->format());
+    for(int i=0; i<img->height(); ++i)
+    {
+      const unsigned char* src_line = src->pixels() + src->pitch()*i;
+      unsigned char* dst_line = img->pixels() + img->pitch()*i;
+      for(int j=0; j<count; ++j)
+      {
+        // clamp 0.0 >= dval >= 1.0
+        double dval = toUnit(src_line + j*src_size, src->type());
+        dval = dval < 0.0 ? 0.0 :
+               dval > 1.0 ? 1.0 :
+               dval;
+        fromUnit(dval, dst_line + j*dst_size, new_type);
+      }
+    }
+    return img;
+  }
+  //-----------------------------------------------------------------------------
+  class rgbal
+  {
+  public:
+    rgbal(): r(-1), g(-1), b(-1), a(-1), l(-1) {}
+    int r,g,b,a,l;
+  };
+  //-----------------------------------------------------------------------------
+  rgbal offsets(EImageFormat format)
+  {
+    rgbal o;
+    switch(format)
+    {
+      case IF_RGB:             o.r = 0; o.g = 1; o.b = 2; break;
+      case IF_RGBA:            o.r = 0; o.g = 1; o.b = 2; o.a = 3; break;
+      case IF_BGR:             o.r = 2; o.g = 1; o.b = 0; break;
+      case IF_BGRA:            o.r = 2; o.g = 1; o.b = 0; o.a = 3; break;
+      case IF_RED:             o.r = 0; break;
+      case IF_GREEN:           o.g = 0; break;
+      case IF_BLUE:            o.b = 0; break;
+      case IF_ALPHA:           o.a = 0; break;
+      case IF_LUMINANCE:       o.l = 0; break;
+      case IF_LUMINANCE_ALPHA: o.l = 0; o.a = 1; break;
+      default:
+        break;
+    }
+    return o;
+  }
+  //-----------------------------------------------------------------------------
+  template<typename T>
+  void refConvertPixel(const T*src_px, T*dst_px, T max_value, const rgbal& srco, const rgbal& dsto)
+  {
+    // set dst default values first
+    if (dsto.r != -1) dst_px[dsto.r] = 0;
+    if (dsto.g != -1) dst_px[dsto.g] = 0;
+    if (dsto.b != -1) dst_px[dsto.b] = 0;
+    if (dsto.a != -1) dst_px[dsto.a] = max_value;
+    if (dsto.l != -1) dst_px[dsto.l] = 0;
+
+    // try copy src -> dst
+    if (dsto.r != -1 && srco.r != -1) dst_px[dsto.r] = src_px[srco.r];
+    if (dsto.g != -1 && srco.g != -1) dst_px[dsto.g] = src_px[srco.g];
+    if (dsto.b != -1 && srco.b != -1) dst_px[dsto.b] = src_px[srco.b];
+    if (dsto.a != -1 && srco.a != -1) dst_px[dsto.a] = src_px[srco.a];
+    if (dsto.l != -1 && srco.l != -1) dst_px[dsto.l] = src_px[srco.l];
+
+    // try rgb -> gray conversion
+    if (dsto.l != -1 && srco.r != -1 && srco.g != -1 && srco.b != -1)
+    {
+      dvec3 col(src_px[srco.r], src_px[srco.g], src_px[srco.b]);
+      double gray = dot(col / dvec3(max_value,max_value,max_value), dvec3(0.299,0.587,0.114));
+      dst_px[dsto.l] = T(gray * max_value);
+    }
+    else
+    if (dsto.l != -1 && srco.r != -1 && srco.g == -1 && srco.b == -1)
+      dst_px[dsto.l] = src_px[srco.r];
+    else
+    if (dsto.l != -1 && srco.r == -1 && srco.g != -1 && srco.b == -1)
+      dst_px[dsto.l] = src_px[srco.g];
+    else
+    if (dsto.l != -1 && srco.r == -1 && srco.g == -1 && srco.b != -1)
+      dst_px[dsto.l] = src_px[srco.b];
+    else
+    // try gray -> r,g,b
+    if (srco.l != -1)
+    {
+      if (dsto.r != -1) dst_px[dsto.r] = src_px[srco.l];
+      if (dsto.g != -1) dst_px[dsto.g] = src_px[srco.l];
+      if (dsto.b != -1) dst_px[dsto.b] = src_px[srco.l];
+    }
+  }
+  //-----------------------------------------------------------------------------
+  template<typename T>
+  void refConvertFormatT(const Image* src, Image* img, T max_value)
+  {
+    rgbal srco = offsets(src->format());
+    rgbal dsto = offsets(img->format());
+    int src_comp = componentCount(src->format());
+    int dst_comp = componentCount(img->format());
+    for(int i=0; i<img->height(); ++i)
+    {
+      const T* src_px = (const T*)(src->pixels() + src->pitch()*i);
+      T* dst_px = (T*)(img->pixels() + img->pitch()*i);
+      for(int j=0; j<img->width(); ++j, src_px += src_comp, dst_px += dst_comp)
+        refConvertPixel<T>(src_px, dst_px, max_value, srco, dsto);
+    }
+  }
+  //-----------------------------------------------------------------------------
+  ref<Image> refConvertFormat(const Image* src, EImageFormat new_format)
+  {
+    ref<Image> img = newImage(src, new_format, src->type());
+    switch(src->type())
+    {
+      case IT_UNSIGNED_BYTE:  refConvertFormatT<unsigned char>(src, img.get(), 255); break;
+      case IT_BYTE:           refConvertFormatT<GLbyte>       (src, img.get(), 127); break;
+      case IT_UNSIGNED_SHORT: refConvertFormatT<GLushort>     (src, img.get(), 65535); break;
+      case IT_SHORT:          refConvertFormatT<GLshort>      (src, img.get(), 32767); break;
+      case IT_UNSIGNED_INT:   refConvertFormatT<unsigned int> (src, img.get(), 4294967295U); break;
+      case IT_INT:            refConvertFormatT<int>          (src, img.get(), 2147483647); break;
+      case IT_FLOAT:          refConvertFormatT<float>        (src, img.get(), 1.0f); break;
+      default:
+        break;
+    }
+    return img;
+  }
+  //-----------------------------------------------------------------------------
+  const EImageType gTypes[] = { IT_UNSIGNED_BYTE, IT_BYTE, IT_UNSIGNED_SHORT, IT_SHORT, IT_UNSIGNED_INT, IT_INT, IT_FLOAT };
+  const char* gTypeNames[] = { "ubyte", "byte", "ushort", "short", "uint", "int", "float" };
+  const int gTypeCount = 7;
+  const EImageFormat gFormats[] = { IF_RGB, IF_RGBA, IF_BGR, IF_BGRA, IF_RED, IF_GREEN, IF_BLUE, IF_ALPHA, IF_LUMINANCE, IF_LUMINANCE_ALPHA };
+  const char* gFormatNames[] = { "RGB", "RGBA", "BGR", "BGRA", "RED", "GREEN", "BLUE", "ALPHA", "LUMINANCE", "LUMINANCE_ALPHA" };
+  const int gFormatCount = 10;
+  //-----------------------------------------------------------------------------
+  //! Deterministic pseudo random numbers.
+  class Random
+  {
+  public:
+    Random(): mState(12345) {}
+    unsigned int next() { mState = mState * 1664525u + 1013904223u; return mState; }
+  private:
+    unsigned int mState;
+  };
+  //-----------------------------------------------------------------------------
+  //! Fills the components of \p img with every 8 and 16 bits value, with edge and random values for the 32 bits types.
+  void fillComponents(Image* img, int count, Random& rnd)
+  {
+    unsigned char* px = img->pixels();
+    for(int i=0; i<count; ++i)
+    {
+      unsigned int r = rnd.next();
+      switch(img->type())
+      {
+        case IT_UNSIGNED_BYTE:  ((unsigned char*)px)[i] = (unsigned char)i; break;
+        case IT_BYTE:           ((GLbyte*)px)[i]        = (GLbyte)i; break;
+        case IT_UNSIGNED_SHORT: ((GLushort*)px)[i]      = (GLushort)i; break;
+        case IT_SHORT:          ((GLshort*)px)[i]       = (GLshort)i; break;
+        case IT_UNSIGNED_INT:   ((unsigned int*)px)[i]  = i < 8 ? 0xFFFFFFFFu - i : ( i < 16 ? i - 8 : r ); break;
+        case IT_INT:            ((int*)px)[i]           = i < 8 ? 0x7FFFFFFF - i : ( i < 16 ? -0x7FFFFFFF - 1 + i : (int)r ); break;
+        case IT_FLOAT:
+        {
+          const float edges[] = { 0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 2.0f, 1e-30f, 1.0f - 1e-7f, 1.0f + 1e-7f, 1e30f, -1e30f };
+          // every 16 bits fraction, then random values around [0,1]
+          if (i < 11)
+            ((float*)px)[i] = edges[i];
+          else
+          if (i < 11 + 65536)
+            ((float*)px)[i] = (i - 11) / 65535.0f;
+          else
+            ((float*)px)[i] = (r / 4294967295.0f) * 1.5f - 0.25f;
+          break;
+        }
+        default:
+          break;
+      }
+    }
+  }
+  //-----------------------------------------------------------------------------
+  bool sameImage(const Image* a, const Image* b)
+  {
+    return a && b && a->requiredMemory() == b->requiredMemory() && memcmp(a->pixels(), b->pixels(), a->requiredMemory()) == 0;
+  }
+}
+
+namespace blind_tests
+{
+  bool test_image_conversion()
+  {
+    bool ok = true;
+    Random rnd;
+    Time time;
+
+    // convertType(): every source value of the 8 and 16 bits types, for every type pair
+    for(int s=0; s<gTypeCount; ++s)
+    {
+      ref<Image> src = new Image(256, 384, 0, 1, IF_LUMINANCE, gTypes[s]);
+      fillComponents(src.get(), src->width() * src->height(), rnd);
+      real t_ref = 0, t_new = 0;
+      for(int d=0; d<gTypeCount; ++d)
+      {
+        time.start();
+        ref<Image> ref_img = refConvertType(src.get(), gTypes[d]);
+        t_ref += time.elapsed();
+        time.start();
+        ref<Image> new_img = src->convertType(gTypes[d]);
+        t_new += time.elapsed();
+        if (!sameImage(ref_img.get(), new_img.get()))
+        {
+          Log::print( Say("convertType(): %s -> %s differs from the reference.\n") << gTypeNames[s] << gTypeNames[d] );
+          ok = false;
+        }
+      }
+      Log::print( Say("convertType() from %s: reference %.3ns, current %.3ns\n") << gTypeNames[s] << t_ref << t_new );
+    }
+
+    // convertFormat(): every format pair for every type, on random pixels
+    for(int t=0; t<gTypeCount; ++t)
+    {
+      real t_ref = 0, t_new = 0;
+      for(int s=0; s<gFormatCount; ++s)
+      {
+        ref<Image> src = new Image(131, 67, 0, 1, gFormats[s], gTypes[t]);
+        fillComponents(src.get(), src->width() * src->height() * componentCount(gFormats[s]), rnd);
+        for(int d=0; d<gFormatCount; ++d)
+        {
+          time.start();
+          ref<Image> ref_img = refConvertFormat(src.get(), gFormats[d]);
+          t_ref += time.elapsed();
+          time.start();
+          ref<Image> new_img = src->convertFormat(gFormats[d]);
+          t_new += time.elapsed();
+          if (!sameImage(ref_img.get(), new_img.get()))
+          {
+            Log::print( Say("convertFormat(): %s %s -> %s differs from the reference.\n") << gTypeNames[t] << gFormatNames[s] << gFormatNames[d] );
+            ok = false;
+          }
+        }
+      }
+      Log::print( Say("convertFormat() of %s images: reference %.3ns, current %.3ns\n") << gTypeNames[t] << t_ref << t_new );
+    }
+
+    return ok;
+  }
+}
@@ -0,0 +1,144 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlCore/Image.hpp>
+#include <vlCore/Say.hpp>
+#include <vlCore/Log.hpp>
+#include <cmath>
+#include <cstring>
+
+using namespace vl;
+
+#define CONDITION(cond) \
+  if (!(cond)) \
+  { \
+    vl::Log::print( Say("%s %n: condition \""#cond"\" failed.\n") << __FILE__ << __LINE__); \
+    return false; \
+  }
+
+namespace
+{
+  //! The number of levels of a full mipmap chain, base level included.
+  int levelCount(int w, int h, int d)
+  {
+    int size = std::max( w, std::max(h, d) );
+    return (int)floor( log((double)size) / log(2.0) + 1e-9 ) + 1;
+  }
+
+  //! Checks that the mipmaps() of \p img halve each dimension down to 1x1(x1).
+  bool checkChain(Image* img)
+  {
+    if ( !img->generateMipmaps(RF_Box) )
+      return false;
+    if ( 1 + (int)img->mipmaps().size() != levelCount(img->width(), img->height(), img->depth()) )
+      return false;
+    int w = img->width(), h = img->height(), d = img->depth();
+    for(size_t i=0; i<img->mipmaps().size(); ++i)
+    {
+      const Image* mip = img->mipmaps()[i].get();
+      w = std::max(1, w / 2);
+      h = h ? std::max(1, h / 2) : 0;
+      d = d ? std::max(1, d / 2) : 0;
+      if ( mip->width() != w || mip->height() != h || mip->depth() != d )
+        return false;
+      if ( mip->format() != img->format() || mip->type() != img->type() || mip->isCubemap() != img->isCubemap() )
+        return false;
+    }
+    return w == 1 && std::max(1, h) == 1 && std::max(1, d) == 1;
+  }
+}
+
+namespace blind_tests
+{
+  bool test_mipmaps()
+  {
+    // 2x2 box halving of a known 4x4 image, every block average is exact
+    const unsigned char pixels[16] =
+    {
+      10,  20,  100, 100,
+      30,  40,  100, 100,
+      0,   255, 200, 204,
+      255, 0,   196, 200
+    };
+    ref<Image> img = new Image(4, 4, 0, 1, IF_LUMINANCE, IT_UNSIGNED_BYTE);
+    memcpy(img->pixels(), pixels, sizeof(pixels));
+    CONDITION( img->generateMipmaps(RF_Box) )
+    CONDITION( img->mipmaps().size() == 2 )
+    const Image* level1 = img->mipmaps()[0].get();
+    const Image* level2 = img->mipmaps()[1].get();
+    CONDITION( level1->width() == 2 && level1->height() == 2 )
+    CONDITION( level2->width() == 1 && level2->height() == 1 )
+    CONDITION( level1->pixels()[0] == 25 )
+    CONDITION( level1->pixels()[1] == 100 )
+    CONDITION( level1->pitch() == 2 )
+    CONDITION( level1->pixels()[2] == 127 || level1->pixels()[2] == 128 ) // 127.5
+    CONDITION( level1->pixels()[3] == 200 )
+    // filtered from the unquantized level 1: (25 + 100 + 127.5 + 200) / 4
+    CONDITION( level2->pixels()[0] == 113 )
+
+    // the same image through resample()
+    ref<Image> half = img->resample(2, 2, 0, RF_Box);
+    CONDITION( half && memcmp(half->pixels(), level1->pixels(), 4) == 0 )
+
+    // float RGBA components are averaged independently
+    ref<Image> rgba = new Image(2, 2, 0, 1, IF_RGBA, IT_FLOAT);
+    float* px = (float*)rgba->pixels();
+    for(int i=0; i<4; ++i)
+    {
+      px[i*4+0] = (float)i;
+      px[i*4+1] = 1.0f;
+      px[i*4+2] = i == 0 ? 1.0f : 0.0f;
+      px[i*4+3] = 0.5f;
+    }
+    CONDITION( rgba->generateMipmaps(RF_Box) )
+    CONDITION( rgba->mipmaps().size() == 1 )
+    const float* avg = (const float*)rgba->mipmaps()[0]->pixels();
+    CONDITION( fabs(avg[0] - 1.5f) < 1e-6f && fabs(avg[1] - 1.0f) < 1e-6f && fabs(avg[2] - 0.25f) < 1e-6f && fabs(avg[3] - 0.5f) < 1e-6f )
+
+    // chain length is log2(max(w,h,d)) + 1 for 1D, 2D, 3D and cubemap images, power of two or not
+    ref<Image> chain;
+    chain = new Image(7, 0, 0, 1, IF_RGB, IT_UNSIGNED_BYTE);
+    CONDITION( checkChain(chain.get()) )
+    chain = new Image(4, 4, 0, 1, IF_RGBA, IT_UNSIGNED_BYTE);
+    CONDITION( checkChain(chain.get()) )
+    chain = new Image(5, 3, 0, 1, IF_LUMINANCE_ALPHA, IT_UNSIGNED_SHORT);
+    CONDITION( checkChain(chain.get()) )
+    chain = new Image(1, 16, 0, 1, IF_LUMINANCE, IT_FLOAT);
+    CONDITION( checkChain(chain.get()) )
+    chain = new Image(4, 2, 8, 1, IF_RGBA, IT_UNSIGNED_BYTE);
+    CONDITION( checkChain(chain.get()) )
+    chain = new Image;
+    chain->allocateCubemap(8, 8, 1, IF_RGBA, IT_UNSIGNED_BYTE);
+    CONDITION( checkChain(chain.get()) )
+
+    return true;
+  }
+}
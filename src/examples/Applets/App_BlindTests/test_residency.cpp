@@ -0,0 +1,191 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#include <vlGraphics/ResidencyManager.hpp>
+
+using namespace vl;
+
+namespace
+{
+  //! A resource which only counts bytes: downgrading halves its size, evicting frees it.
+  class FakeResource: public ResidentResource
+  {
+  public:
+    FakeResource(Object* obj, long long bytes, bool can_reload=true): mObject(obj), mFull(bytes), mBytes(bytes), mCanReload(can_reload), mReloads(0) {}
+
+    virtual Object* object() { return mObject.get(); }
+    virtual long long residentBytes() const { return mBytes; }
+    virtual bool canReload() const { return mCanReload; }
+    virtual bool evict() { mBytes = 0; return true; }
+    virtual bool downgrade()
+    {
+      if (mBytes <= 1)
+        return false;
+      mBytes /= 2;
+      return true;
+    }
+    virtual bool reload() { mBytes = mFull; ++mReloads; return true; }
+
+    int reloads() const { return mReloads; }
+
+  protected:
+    ref<Object> mObject;
+    long long mFull;
+    long long mBytes;
+    bool mCanReload;
+    int mReloads;
+  };
+}
+
+namespace blind_tests
+{
+  bool test_residency()
+  {
+    // least recently used first, the larger first among the ones used at the same tick
+    {
+      ref<ResidencyManager> manager = new ResidencyManager(250);
+      manager->setMaxDowngrades(0);
+      ref<Object> oa = new Object, ob = new Object, oc = new Object, od = new Object;
+      ref<FakeResource> a = new FakeResource(oa.get(), 100);
+      ref<FakeResource> b = new FakeResource(ob.get(), 100);
+      ref<FakeResource> c = new FakeResource(oc.get(), 50);
+      ref<FakeResource> d = new FakeResource(od.get(), 100);
+      manager->track(a.get());
+      manager->track(b.get());
+      manager->track(c.get());
+      manager->track(d.get());
+      manager->touch(a->object(), 3);
+      manager->touch(b->object(), 1);
+      manager->touch(c->object(), 1);
+      manager->touch(d->object(), 2);
+      if (manager->enforceBudget(4) != 100)
+        return false;
+      if ( !b->isEvicted() || c->isEvicted() || d->isEvicted() || a->isEvicted() )
+        return false;
+      if (manager->residentBytes() != 250)
+        return false;
+    }
+
+    // resources used in the last minIdleTicks() ticks and the ones that cannot be reloaded are kept
+    {
+      ref<ResidencyManager> manager = new ResidencyManager(100);
+      manager->setMaxDowngrades(0);
+      manager->setMinIdleTicks(2);
+      ref<Object> oa = new Object, ob = new Object, oc = new Object;
+      ref<FakeResource> a = new FakeResource(oa.get(), 100);
+      ref<FakeResource> b = new FakeResource(ob.get(), 100, false);
+      ref<FakeResource> c = new FakeResource(oc.get(), 100);
+      manager->track(a.get());
+      manager->track(b.get());
+      manager->track(c.get());
+      manager->touch(a->object(), 1);
+      manager->touch(b->object(), 1);
+      manager->touch(c->object(), 4);
+      if (manager->enforceBudget(5) != 100)
+        return false;
+      if ( !a->isEvicted() || b->isEvicted() || c->isEvicted() )
+        return false;
+      if (manager->residentBytes() != 200)
+        return false;
+    }
+
+    // downgrade up to maxDowngrades() times, then evict
+    {
+      ref<ResidencyManager> manager = new ResidencyManager(60);
+      ref<Object> oa = new Object;
+      ref<FakeResource> a = new FakeResource(oa.get(), 160);
+      manager->track(a.get());
+      manager->touch(a->object(), 1);
+      manager->enforceBudget(2);
+      if ( a->isEvicted() || a->downgrades() != 2 || a->residentBytes() != 40 )
+        return false;
+      manager->setBudget(30);
+      manager->enforceBudget(3);
+      if ( !a->isEvicted() || a->downgrades() != 0 || a->residentBytes() != 0 )
+        return false;
+    }
+
+    // touching an evicted resource reloads it
+    {
+      ref<ResidencyManager> manager = new ResidencyManager(50);
+      ref<Object> oa = new Object;
+      ref<FakeResource> a = new FakeResource(oa.get(), 100);
+      manager->track(a.get());
+      manager->touch(a->object(), 1);
+      manager->enforceBudget(2);
+      if ( a->downgrades() != 1 || a->residentBytes() != 50 )
+        return false;
+      manager->setBudget(0);
+      manager->enforceBudget(2);
+      if ( !a->isEvicted() )
+        return false;
+      if ( !manager->touch(a->object(), 3) || a->isEvicted() || a->reloads() != 1 || a->residentBytes() != 100 )
+        return false;
+      if (manager->residentBytes() != 100)
+        return false;
+    }
+
+    // a downgraded resource is reloaded only when its full size fits in the budget
+    {
+      ref<ResidencyManager> manager = new ResidencyManager(50);
+      ref<Object> oa = new Object;
+      ref<FakeResource> a = new FakeResource(oa.get(), 100);
+      manager->track(a.get());
+      manager->touch(a->object(), 1);
+      manager->enforceBudget(2);
+      if ( manager->touch(a->object(), 3) || a->downgrades() != 1 )
+        return false;
+      manager->setBudget(100);
+      if ( !manager->touch(a->object(), 4) || a->downgrades() != 0 || a->residentBytes() != 100 )
+        return false;
+    }
+
+    // objects referenced only by the manager are released
+    {
+      ref<ResidencyManager> manager = new ResidencyManager(1000);
+      ref<Object> oa = new Object, ob = new Object;
+      ref<FakeResource> a = new FakeResource(oa.get(), 100);
+      ref<FakeResource> b = new FakeResource(ob.get(), 100);
+      manager->track(a.get());
+      manager->track(b.get());
+      oa = NULL;
+      manager->enforceBudget(1);
+      if ( manager->trackedCount() != 1 || manager->residentBytes() != 100 )
+        return false;
+      manager->untrack(b->object());
+      if ( manager->trackedCount() != 0 || manager->residentBytes() != 0 )
+        return false;
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,274 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#include <vlVolume/VolumeUtils.hpp>
+#include <vlCore/Time.hpp>
+#include <vlCore/Say.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/glsl_math.hpp>
+#include <cstring>
+
+using namespace vl;
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  // serial reference implementation, as it was before the parallel rewrite
+  //-----------------------------------------------------------------------------
+  template<typename data_type>
+  ref<Image> refRGBAVolume(const Image* data, const Image* trfunc, const fvec3* light_dir, bool alpha_from_data)
+  {
+    float normalizer_num = 0;
+    switch(data->type())
+    {
+      case IT_UNSIGNED_BYTE:  normalizer_num = 1.0f/255.0f;   break;
+      case IT_UNSIGNED_SHORT: normalizer_num = 1.0f/65535.0f; break;
+      case IT_FLOAT:          normalizer_num = 1.0f;          break;
+      default:
+        break;
+    }
+
+    fvec3 L = light_dir ? *light_dir : fvec3();
+    L.normalize();
+    int w = data->width();
+    int h = data->height();
+    int d = data->depth();
+    int pitch = data->pitch();
+    const unsigned char* lum_px = data->pixels();
+    ref<Image> volume = new Image( w, h, d, 1, IF_RGBA, IT_UNSIGNED_BYTE );
+    ubvec4* rgba_px = (ubvec4*)volume->pixels();
+    for(int z=0; z<d; ++z)
+    {
+      int z1 = clamp(z-1, 0, d-1);
+      int z2 = clamp(z+1, 0, d-1);
+      for(int y=0; y<h; ++y)
+      {
+        int y1 = clamp(y-1, 0, h-1);
+        int y2 = clamp(y+1, 0, h-1);
+        for(int x=0; x<w; ++x, ++rgba_px)
+        {
+          // value
+          float lum = (*(data_type*)(lum_px + x*sizeof(data_type) + y*pitch + z*pitch*h)) * normalizer_num;
+          // value -> transfer function
+          float xval = lum*trfunc->width();
+          if (xval > trfunc->width()-1.001f)
+            xval = trfunc->width()-1.001f;
+          int ix1 = (int)xval;
+          int ix2 = ix1+1;
+          float w21  = (float)fract(xval);
+          float w11  = 1.0f - w21;
+          fvec4 c11  = (fvec4)((ubvec4*)trfunc->pixels())[ix1];
+          fvec4 c21  = (fvec4)((ubvec4*)trfunc->pixels())[ix2];
+          fvec4 rgba = (c11*w11 + c21*w21)*(1.0f/255.0f);
+
+          if (light_dir)
+          {
+            // bake the lighting
+            int x1 = clamp(x-1, 0, w-1);
+            int x2 = clamp(x+1, 0, w-1);
+            data_type vx1 = (*(data_type*)(lum_px + x1*sizeof(data_type) + y *pitch + z *pitch*h));
+            data_type vx2 = (*(data_type*)(lum_px + x2*sizeof(data_type) + y *pitch + z *pitch*h));
+            data_type vy1 = (*(data_type*)(lum_px + x *sizeof(data_type) + y1*pitch + z *pitch*h));
+            data_type vy2 = (*(data_type*)(lum_px + x *sizeof(data_type) + y2*pitch + z *pitch*h));
+            data_type vz1 = (*(data_type*)(lum_px + x *sizeof(data_type) + y *pitch + z1*pitch*h));
+            data_type vz2 = (*(data_type*)(lum_px + x *sizeof(data_type) + y *pitch + z2*pitch*h));
+            fvec3 N1(float(vx1-vx2), float(vy1-vy2), float(vz1-vz2));
+            N1.normalize();
+            fvec3 N2 = -N1 * 0.15f;
+            float l1 = max(dot(N1,L),0.0f);
+            float l2 = max(dot(N2,L),0.0f);
+            rgba.r() = rgba.r()*l1 + rgba.r()*l2+0.2f;
+            rgba.g() = rgba.g()*l1 + rgba.g()*l2+0.2f;
+            rgba.b() = rgba.b()*l1 + rgba.b()*l2+0.2f;
+            rgba.r() = clamp(rgba.r(), 0.0f, 1.0f);
+            rgba.g() = clamp(rgba.g(), 0.0f, 1.0f);
+            rgba.b() = clamp(rgba.b(), 0.0f, 1.0f);
+          }
+
+          // map pixel
+          rgba_px->r() = (unsigned char)(rgba.r()*255.0f);
+          rgba_px->g() = (unsigned char)(rgba.g()*255.0f);
+          rgba_px->b() = (unsigned char)(rgba.b()*255.0f);
+          if (alpha_from_data)
+            rgba_px->a() = (unsigned char)(lum*255.0f);
+          else
+            rgba_px->a() = (unsigned char)(rgba.a()*255.0f);
+        }
+      }
+    }
+
+    return volume;
+  }
+  //-----------------------------------------------------------------------------
+  ref<Image> refGradientNormals(const Image* img)
+  {
+    ref<Image> gradient = new Image;
+    gradient->allocate3D(img->width(), img->height(), img->depth(), 1, IF_RGB, IT_FLOAT);
+    fvec3* px = (fvec3*)gradient->pixels();
+    fvec3 A, B;
+    for(int z=0; z<gradient->depth(); ++z)
+    {
+      for(int y=0; y<gradient->height(); ++y)
+      {
+        for(int x=0; x<gradient->width(); ++x)
+        {
+          // clamped coordinates
+          int xp = x+1, xn = x-1;
+          int yp = y+1, yn = y-1;
+          int zp = z+1, zn = z-1;
+          if (xn<0) xn = 0;
+          if (yn<0) yn = 0;
+          if (zn<0) zn = 0;
+          if (xp>img->width() -1) xp = img->width() -1;
+          if (yp>img->height()-1) yp = img->height()-1;
+          if (zp>img->depth() -1) zp = img->depth() -1;
+
+          A.x() = img->sample(xn,y,z).r();
+          B.x() = img->sample(xp,y,z).r();
+          A.y() = img->sample(x,yn,z).r();
+          B.y() = img->sample(x,yp,z).r();
+          A.z() = img->sample(x,y,zn).r();
+          B.z() = img->sample(x,y,zp).r();
+
+          px[x + img->width()*y + img->width()*img->height()*z] = normalize(A - B) * 0.5f + 0.5f;
+        }
+      }
+    }
+    return gradient;
+  }
+  //-----------------------------------------------------------------------------
+  //! A smooth blob plus a ramp, so that the volume has both flat areas and gradients in every direction.
+  template<typename data_type>
+  ref<Image> makeVolume(int side, EImageFormat format, EImageType type, float scale)
+  {
+    ref<Image> img = new Image( side, side, side, 1, format, type );
+    const int comp = img->pitch() / side / (int)sizeof(data_type);
+    for(int z=0; z<side; ++z)
+    {
+      for(int y=0; y<side; ++y)
+      {
+        data_type* px = (data_type*)(img->pixels() + y*img->pitch() + z*img->pitch()*side);
+        for(int x=0; x<side; ++x)
+        {
+          float dx = x - side*0.5f, dy = y - side*0.4f, dz = z - side*0.6f;
+          float v = exp( -(dx*dx + dy*dy + dz*dz) / (side*side*0.08f) ) * 0.8f + (x+y)*0.1f/side;
+          // some flat plateaus to exercise the zero-length normals
+          if (z < 2)
+            v = 0;
+          for(int c=0; c<comp; ++c)
+            px[x*comp + c] = (data_type)(v * scale * (c+1) / comp);
+        }
+      }
+    }
+    return img;
+  }
+  //-----------------------------------------------------------------------------
+  ref<Image> makeTransferFunction()
+  {
+    ref<Image> trfunc = new Image( 128, 0, 0, 1, IF_RGBA, IT_UNSIGNED_BYTE );
+    ubvec4* px = (ubvec4*)trfunc->pixels();
+    for(int i=0; i<trfunc->width(); ++i)
+      px[i] = ubvec4( (unsigned char)(i*2), (unsigned char)(255-i*2), (unsigned char)(i*i % 256), (unsigned char)(i < 10 ? 0 : i*2) );
+    return trfunc;
+  }
+  //-----------------------------------------------------------------------------
+  bool sameImage(const Image* a, const Image* b)
+  {
+    return a && b && a->requiredMemory() == b->requiredMemory() && memcmp(a->pixels(), b->pixels(), a->requiredMemory()) == 0;
+  }
+  //-----------------------------------------------------------------------------
+  template<typename data_type>
+  bool checkRGBAVolume(const char* name, const Image* data, const Image* trfunc)
+  {
+    const fvec3 light_dir(1,2,3);
+    Time time;
+    bool ok = true;
+    for(int alpha_from_data=0; alpha_from_data<2; ++alpha_from_data)
+    {
+      for(int lit=0; lit<2; ++lit)
+      {
+        time.start();
+        ref<Image> ref_img = refRGBAVolume<data_type>(data, trfunc, lit ? &light_dir : NULL, alpha_from_data != 0);
+        real t_ref = time.elapsed();
+        time.start();
+        ref<Image> new_img = lit ? genRGBAVolume(data, trfunc, light_dir, alpha_from_data != 0) : genRGBAVolume(data, trfunc, alpha_from_data != 0);
+        real t_new = time.elapsed();
+        bool same = sameImage(ref_img.get(), new_img.get());
+        ok &= same;
+        Log::print( Say("genRGBAVolume(%s, %s, %s): serial %.3ns, parallel %.3ns%s\n")
+          << name << (lit ? "lit" : "unlit") << (alpha_from_data ? "alpha from data" : "alpha from trfunc")
+          << t_ref << t_new << (same ? "" : " MISMATCH") );
+      }
+    }
+    return ok;
+  }
+  //-----------------------------------------------------------------------------
+  bool checkGradientNormals(const char* name, const Image* data)
+  {
+    Time time;
+    time.start();
+    ref<Image> ref_img = refGradientNormals(data);
+    real t_ref = time.elapsed();
+    time.start();
+    ref<Image> new_img = genGradientNormals(data);
+    real t_new = time.elapsed();
+    bool same = sameImage(ref_img.get(), new_img.get());
+    Log::print( Say("genGradientNormals(%s): serial %.3ns, parallel %.3ns%s\n") << name << t_ref << t_new << (same ? "" : " MISMATCH") );
+    return same;
+  }
+}
+
+namespace blind_tests
+{
+  bool test_volume_utils()
+  {
+    const int side = 64;
+    ref<Image> trfunc = makeTransferFunction();
+    ref<Image> lum_ub = makeVolume<unsigned char> (side, IF_LUMINANCE, IT_UNSIGNED_BYTE,  255.0f);
+    ref<Image> lum_us = makeVolume<unsigned short>(side, IF_LUMINANCE, IT_UNSIGNED_SHORT, 65535.0f);
+    ref<Image> lum_f  = makeVolume<float>         (side, IF_LUMINANCE, IT_FLOAT,          1.0f);
+
+    bool ok = true;
+    ok &= checkRGBAVolume<unsigned char> ("IT_UNSIGNED_BYTE",  lum_ub.get(), trfunc.get());
+    ok &= checkRGBAVolume<unsigned short>("IT_UNSIGNED_SHORT", lum_us.get(), trfunc.get());
+    ok &= checkRGBAVolume<float>         ("IT_FLOAT",          lum_f.get(),  trfunc.get());
+
+    ok &= checkGradientNormals("IF_LUMINANCE IT_UNSIGNED_BYTE",  lum_ub.get());
+    ok &= checkGradientNormals("IF_LUMINANCE IT_UNSIGNED_SHORT", lum_us.get());
+    ok &= checkGradientNormals("IF_LUMINANCE IT_FLOAT",          lum_f.get());
+    ok &= checkGradientNormals("IF_RGB IT_SHORT",  makeVolume<short>         (side, IF_RGB,  IT_SHORT,        32767.0f).get());
+    ok &= checkGradientNormals("IF_BGRA IT_UNSIGNED_BYTE", makeVolume<unsigned char>(side, IF_BGRA, IT_UNSIGNED_BYTE, 255.0f).get());
+    ok &= checkGradientNormals("IF_LUMINANCE_ALPHA IT_UNSIGNED_INT", makeVolume<unsigned int>(side, IF_LUMINANCE_ALPHA, IT_UNSIGNED_INT, 4294967295.0f).get());
+
+    return ok;
+  }
+}
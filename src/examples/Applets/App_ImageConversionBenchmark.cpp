@@ -0,0 +1,164 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include "BaseDemo.hpp"
+#include <vlGraphics/Text.hpp>
+#include <vlGraphics/FontManager.hpp>
+#include <vlCore/Image.hpp>
+
+namespace
+{
+  const vl::EImageType gTypes[] = { vl::IT_UNSIGNED_BYTE, vl::IT_BYTE, vl::IT_UNSIGNED_SHORT, vl::IT_SHORT, vl::IT_UNSIGNED_INT, vl::IT_INT, vl::IT_FLOAT };
+  const char* gTypeNames[] = { "ubyte", "byte", "ushort", "short", "uint", "int", "float" };
+  const int gTypeCount = 7;
+  const vl::EImageFormat gFormats[] = { vl::IF_RGB, vl::IF_RGBA, vl::IF_BGR, vl::IF_BGRA, vl::IF_RED, vl::IF_GREEN, vl::IF_BLUE, vl::IF_ALPHA, vl::IF_LUMINANCE, vl::IF_LUMINANCE_ALPHA };
+  const char* gFormatNames[] = { "RGB", "RGBA", "BGR", "BGRA", "RED", "GREEN", "BLUE", "ALPHA", "LUM", "LUM_A" };
+  const int gFormatCount = 10;
+
+  //! Left aligns \p text in a column of \p width characters.
+  vl::String column(const vl::String& text, int width)
+  {
+    vl::String str = text;
+    while( str.length() < width )
+      str += ' ';
+    return str;
+  }
+}
+
+/**
+ * Measures Image::convertType() and Image::convertFormat() for every type and format pair.
+ * The results are printed in milliseconds, source in the rows and destination in the columns.
+ * The blind test "Image Conversion" checks the results against the per-component reference implementation.
+ */
+class App_ImageConversionBenchmark: public BaseDemo
+{
+public:
+  App_ImageConversionBenchmark(): mSize(1024), mRuns(2) {}
+
+  virtual void initEvent()
+  {
+    vl::Log::notify(appletInfo());
+
+    vl::String msg = benchmarkConvertType();
+    for(int t=0; t<gTypeCount; ++t)
+      msg += benchmarkConvertFormat(t);
+
+    vl::ref<vl::Text> text = new vl::Text;
+    text->setText( msg );
+    text->setFont( vl::defFontManager()->acquireFont("/font/bitstream-vera/VeraMono.ttf", 8) );
+    text->setAlignment( vl::AlignLeft | vl::AlignTop );
+    text->setViewportAlignment( vl::AlignLeft | vl::AlignTop );
+    vl::ref<vl::Effect> effect = new vl::Effect;
+    effect->shader()->enable(vl::EN_BLEND);
+    sceneManager()->tree()->addActor(text.get(), effect.get());
+  }
+
+  //! An image filled with a gradient, so that no conversion takes a shortcut.
+  vl::ref<vl::Image> makeImage(vl::EImageFormat format, vl::EImageType type)
+  {
+    vl::ref<vl::Image> img = new vl::Image(mSize, mSize, 0, 1, vl::IF_RGBA, vl::IT_FLOAT);
+    float* px = (float*)img->pixels();
+    for(int y=0; y<mSize; ++y)
+      for(int x=0; x<mSize; ++x, px+=4)
+      {
+        px[0] = (float)x / mSize;
+        px[1] = (float)y / mSize;
+        px[2] = (float)(x+y) / (2*mSize);
+        px[3] = 1.0f - (float)x / mSize;
+      }
+    return img->convertType(type)->convertFormat(format);
+  }
+
+  //! The best time of mRuns conversions, in milliseconds.
+  template<typename T>
+  double best(const vl::Image* img, T target, vl::ref<vl::Image> (vl::Image::*convert)(T) const)
+  {
+    double best_time = 0;
+    vl::Time time;
+    for(int i=0; i<mRuns; ++i)
+    {
+      time.start();
+      vl::ref<vl::Image> converted = (img->*convert)(target);
+      double elapsed = time.elapsed() * 1000.0;
+      if (i == 0 || elapsed < best_time)
+        best_time = elapsed;
+    }
+    return best_time;
+  }
+
+  vl::String benchmarkConvertType()
+  {
+    vl::String msg = vl::Say("convertType() of %nx%n RGBA images (ms)\n") << mSize << mSize;
+    msg += column("", 8);
+    for(int d=0; d<gTypeCount; ++d)
+      msg += column(gTypeNames[d], 8);
+    msg += "\n";
+    for(int s=0; s<gTypeCount; ++s)
+    {
+      vl::ref<vl::Image> img = makeImage(vl::IF_RGBA, gTypes[s]);
+      msg += column(gTypeNames[s], 8);
+      for(int d=0; d<gTypeCount; ++d)
+        msg += column( vl::Say("%.1n") << best(img.get(), gTypes[d], &vl::Image::convertType), 8 );
+      msg += "\n";
+    }
+    msg += "\n";
+    vl::Log::print(msg);
+    return msg;
+  }
+
+  vl::String benchmarkConvertFormat(int t)
+  {
+    vl::String msg = vl::Say("convertFormat() of %nx%n %s images (ms)\n") << mSize << mSize << gTypeNames[t];
+    msg += column("", 7);
+    for(int d=0; d<gFormatCount; ++d)
+      msg += column(gFormatNames[d], 7);
+    msg += "\n";
+    for(int s=0; s<gFormatCount; ++s)
+    {
+      vl::ref<vl::Image> img = makeImage(gFormats[s], gTypes[t]);
+      msg += column(gFormatNames[s], 7);
+      for(int d=0; d<gFormatCount; ++d)
+        msg += column( vl::Say("%.1n") << best(img.get(), gFormats[d], &vl::Image::convertFormat), 7 );
+      msg += "\n";
+    }
+    msg += "\n";
+    vl::Log::print(msg);
+    return msg;
+  }
+
+protected:
+  int mSize;
+  int mRuns;
+};
+
+// Have fun!
+
+BaseDemo* Create_App_ImageConversionBenchmark() { return new App_ImageConversionBenchmark; }
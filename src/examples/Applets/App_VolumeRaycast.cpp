@@ -32,6 +32,7 @@
 #include "BaseDemo.hpp"
 #include <vlVolume/RaycastVolume.hpp>
 #include <vlVolume/VolumeUtils.hpp>
+#include <vlVolume/OccupancyGrid.hpp>
 #include <vlGraphics/Light.hpp>
 #include <vlGraphics/Text.hpp>
 #include <vlGraphics/FontManager.hpp>
@@ -52,6 +53,7 @@ using namespace vl;
   - RaycastBrightnessControl_Mode
   - RaycastDensityControl_Mode
   - RaycastColorControl_Mode
+  - RaycastTransferFunction_Mode
 
   Mouse wheel:
   - In Isosurface_Mode controls the iso-value of the isosurface
@@ -60,6 +62,7 @@ using namespace vl;
   - In RaycastBrightnessControl_Mode controls the brightness of the voxels
   - In RaycastDensityControl_Mode controls the density of the voxels
   - In RaycastColorControl_Mode controls the color-bias of the voxels
+  - In RaycastTransferFunction_Mode the volume values less than this are transparent, the empty space is skipped
 
   The Up/Down arrow keys are used to higher/lower the ray-advancement precision.
 
@@ -80,7 +83,8 @@ class App_VolumeRaycast: public BaseDemo
     MIP_Mode, 
     RaycastBrightnessControl_Mode,
     RaycastDensityControl_Mode,
-    RaycastColorControl_Mode
+    RaycastColorControl_Mode,
+    RaycastTransferFunction_Mode
   } MODE;
 
   /* If enabled, renders the volume using 3 animated lights. */
@@ -148,6 +152,7 @@ public:
     // - In RaycastBrightnessControl_Mode controls the brightness of the voxels
     // - In RaycastDensityControl_Mode controls the density of the voxels
     // - In RaycastColorControl_Mode controls the color-bias of the voxels
+    // - In RaycastTransferFunction_Mode the volume values less than this are transparent
     mValThreshold = new Uniform( "val_threshold" );
     mValThreshold->setUniformF( 0.5f );
 
@@ -240,6 +245,9 @@ public:
     else
     if ( MODE == RaycastColorControl_Mode )
       mGLSL->attachShader( new GLSLFragmentShader( "/glsl/volume_raycast03.fs" ) );
+    else
+    if ( MODE == RaycastTransferFunction_Mode )
+      mGLSL->attachShader( new GLSLFragmentShader( "/glsl/volume_raycast_occupancy.fs" ) );
 
     // manipulate volume transform with the trackball
     trackball()->setTransform( mVolumeTr.get() );
@@ -307,6 +315,22 @@ public:
     // installs the transfer function as texture #1
     volume_fx->shader()->gocTextureSampler( 1 )->setTexture( new Texture( trfunc.get() ) );
     volume_fx->shader()->gocUniform( "trfunc_texunit" )->setUniformI( 1 );
+
+    // empty space skipping: the occupancy grid is installed as texture #2 and reclassified when val_threshold changes
+    mOccupancyGrid = NULL;
+    if ( MODE == RaycastTransferFunction_Mode )
+    {
+      mOccupancyGrid = new OccupancyGrid;
+      if ( mOccupancyGrid->setup( mVolumeImage.get() ) )
+      {
+        volume_fx->shader()->gocTextureSampler( 2 )->setTexture( mOccupancyGrid->texture() );
+        volume_fx->shader()->gocUniform( "occupancy_texunit" )->setUniformI( 2 );
+        updateTransferFunction();
+      }
+      else
+        mOccupancyGrid = NULL;
+    }
+    mRaycastVolume->setOccupancyGrid( mOccupancyGrid.get() );
     
     // gradient computation, only use for isosurface methods
     if ( MODE == Isosurface_Mode || MODE == Isosurface_Transp_Mode )
@@ -370,6 +394,28 @@ public:
       Log::error("Error loading volume data!\n");
   }
 
+  /* makes the volume values less than val_threshold transparent and updates the occupancy grid accordingly */
+  void updateTransferFunction()
+  {
+    float val_threshold = 0;
+    mValThreshold->getUniform( &val_threshold );
+
+    ref<Image> trfunc = vl::makeColorSpectrum( 128, vl::blue, vl::royalblue, vl::green, vl::yellow, vl::crimson );
+    ubvec4* rgba = (ubvec4*)trfunc->pixels();
+    for( int i=0; i<trfunc->width(); ++i )
+    {
+      float x = (i + 0.5f) / trfunc->width();
+      rgba[i].a() = x < val_threshold ? 0 : (unsigned char)( clamp( ( x - val_threshold ) * 4.0f, 0.0f, 1.0f ) * 64.0f );
+    }
+
+    ref<Texture> texture = new Texture( trfunc.get(), TF_RGBA, false, false );
+    texture->getTexParameter()->setWrapS( TPW_CLAMP_TO_EDGE );
+    mVolumeAct->effect()->shader()->gocTextureSampler( 1 )->setTexture( texture.get() );
+
+    int occupied = mOccupancyGrid->classify( trfunc.get() );
+    Log::print( Say("occupied blocks: %n of %n\n") << occupied << mOccupancyGrid->blockCount().x() * mOccupancyGrid->blockCount().y() * mOccupancyGrid->blockCount().z() );
+  }
+
   void updateText()
   {
     // update the val_threshold value and the raycast technique name
@@ -381,7 +427,8 @@ public:
       case MIP_Mode: technique_name                      = "< raycast maximum intensity projection >"; break;
       case RaycastBrightnessControl_Mode: technique_name = "< raycast brightness control >"; break;
       case RaycastDensityControl_Mode: technique_name    = "< raycast density control >"; break;
-      case RaycastColorControl_Mode: technique_name      = "< raycast color control"; break;
+      case RaycastColorControl_Mode: technique_name      = "< raycast color control >"; break;
+      case RaycastTransferFunction_Mode: technique_name  = "< raycast transfer function with empty space skipping >"; break;
     };
 
     float val_threshold = 0;
@@ -397,6 +444,9 @@ public:
     val_threshold = clamp( val_threshold, 0.0f, 1.0f );
     mValThreshold->setUniformF( val_threshold );
 
+    if ( mOccupancyGrid )
+      updateTransferFunction();
+
     updateText();
     openglContext()->update();
   }
@@ -427,14 +477,14 @@ public:
   virtual void keyPressEvent(unsigned short, EKey key)
   {
     // left/right arrows change raycast technique
-    RaycastMode modes[] = { Isosurface_Mode, Isosurface_Transp_Mode, MIP_Mode, RaycastBrightnessControl_Mode, RaycastDensityControl_Mode, RaycastColorControl_Mode };
+    RaycastMode modes[] = { Isosurface_Mode, Isosurface_Transp_Mode, MIP_Mode, RaycastBrightnessControl_Mode, RaycastDensityControl_Mode, RaycastColorControl_Mode, RaycastTransferFunction_Mode };
     int mode = MODE;
     if (key == vl::Key_Right)
       mode++;
     else
     if (key == vl::Key_Left)
       mode--;
-    MODE = modes[ vl::clamp(mode, 0, 5) ];
+    MODE = modes[ vl::clamp(mode, 0, 6) ];
 
     // up/down changes SAMPLE_STEP
     if (key == vl::Key_Up)
@@ -484,6 +534,7 @@ public:
     ref<GLSLProgram> mGLSL;
     ref<Actor> mVolumeAct;
     ref<vl::RaycastVolume> mRaycastVolume;
+    ref<vl::OccupancyGrid> mOccupancyGrid;
     ref<Image> mVolumeImage;
 };
 // Have fun!
@@ -72,6 +72,7 @@ BaseDemo* Create_App_VolumeSliced();
 BaseDemo* Create_App_VectorGraphics();
 BaseDemo* Create_App_KdTreeView();
 BaseDemo* Create_App_CullingBenchmark();
+BaseDemo* Create_App_ImageConversionBenchmark();
 BaseDemo* Create_App_MarchingCubes();
 BaseDemo* Create_App_Interpolators();
 BaseDemo* Create_App_Extrusion();
@@ -179,6 +180,7 @@ public:
       { "simple_terrain", Create_App_Terrain(), 10,10, 512, 512, vl::black, vl::vec3(0,5,0), vl::vec3(0,2,-10) }, 
       { "vector_graphics", Create_App_VectorGraphics(), 10,10, 512, 512, vl::lightgray, vl::vec3(0,0,10), vl::vec3(0,0,0) }, 
       { "culling", Create_App_CullingBenchmark(), 10,10, 512, 512, vl::black, vl::vec3(0,500,-250), vl::vec3(0,500,-250-1) }, 
+      { "image_conversion", Create_App_ImageConversionBenchmark(), 10,10, 512, 512, vl::black, vl::vec3(0,0,1), vl::vec3(0,0,0) }, 
       { "kdtree", Create_App_KdTreeView(), 10,10, 512, 512, vl::black, vl::vec3(10,10,-10), vl::vec3(0,0,0) }, 
       { "model_profiler", Create_App_ModelProfiler(), 10,10, 512, 512, vl::black, vl::vec3(0,0,0), vl::vec3(0,0,-1) }, 
       { "deformer", Create_App_Deformer(), 10,10, 512, 512, vl::black, vl::vec3(0,0,35), vl::vec3(0,0,0) }, 
@@ -31,6 +31,7 @@
 
 #include <vlCore/DiskDirectory.hpp>
 #include <vlCore/DiskFile.hpp>
+#include <vlCore/MappedFile.hpp>
 #include <algorithm>
 
 #if defined(__GNUG__)
@@ -303,6 +304,16 @@ ref<DiskFile> DiskDirectory::diskFile(const String& name) const
     return NULL;
 }
 //-----------------------------------------------------------------------------
+ref<MappedFile> DiskDirectory::mappedFile(const String& name) const
+{
+  String p = translatePath(name);
+  ref<MappedFile> file = new MappedFile(p);
+  if (file->exists())
+    return file;
+  else
+    return NULL;
+}
+//-----------------------------------------------------------------------------
 void DiskDirectory::listFilesRecursive_internal(std::vector<String>& file_list) const
 {
   // add local child
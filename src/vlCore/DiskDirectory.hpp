@@ -37,6 +37,7 @@
 namespace vl
 {
   class DiskFile;
+  class MappedFile;
 //---------------------------------------------------------------------------
 // DiskDirectory
 //---------------------------------------------------------------------------
@@ -78,6 +79,9 @@ namespace vl
 
     virtual ref<DiskFile> diskFile(const String& name) const;
 
+    //! Same as diskFile() but returns a read-only MappedFile whose content can be accessed without copies.
+    virtual ref<MappedFile> mappedFile(const String& name) const;
+
     bool exists() const;
 
   protected:
@@ -31,6 +31,7 @@
 
 #include <vlCore/FileSystem.hpp>
 #include <vlCore/DiskDirectory.hpp>
+#include <vlCore/MappedFile.hpp>
 #include <vlCore/GlobalSettings.hpp>
 
 using namespace vl;
@@ -93,6 +94,28 @@ ref<VirtualFile> FileSystem::locateFile(const String& full_path, const String& a
   return NULL;
 }
 //-----------------------------------------------------------------------------
+/**
+The file is searched exactly like locateFile() does. Files living in a DiskDirectory or in the "." directory
+are returned as MappedFile objects, files coming from other kinds of VirtualDirectory are returned as they are.
+If a file cannot be mapped, for example because of address space or file system limitations, the DiskFile is returned.
+*/
+ref<VirtualFile> FileSystem::locateMappedFile(const String& full_path, const String& alternate_path) const
+{
+  ref<VirtualFile> file = locateFile(full_path, alternate_path);
+  if (file && file->classType() == DiskFile::Type())
+  {
+    // make sure the file can actually be mapped, mapping is cheap since no data is read
+    ref<MappedFile> mapped_file = new MappedFile(file->path());
+    if (mapped_file->open(OM_ReadOnly))
+    {
+      mapped_file->close();
+      return mapped_file;
+    }
+    Log::warning( Say("FileSystem::locateMappedFile(): '%s' will be read without memory mapping.\n") << file->path() );
+  }
+  return file;
+}
+//-----------------------------------------------------------------------------
 ref<VirtualDirectory> FileSystem::locateDirectory(const String& name) const
 {
   // first look in the "." directory
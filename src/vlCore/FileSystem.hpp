@@ -68,6 +68,9 @@ namespace vl
     /** Looks for a VirtualFile on the disk and in the currently active FileSystem. */
     virtual ref<VirtualFile> locateFile(const String& full_path, const String& alternate_path=String()) const;
 
+    /** Same as locateFile() but files found on the disk are returned as read-only MappedFile objects. */
+    virtual ref<VirtualFile> locateMappedFile(const String& full_path, const String& alternate_path=String()) const;
+
     virtual ref<VirtualDirectory> locateDirectory(const String& name) const;
 
     //! Returns the names of all the files contained in the previously added Directories.
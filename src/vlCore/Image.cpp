@@ -39,6 +39,7 @@
 #include <vlCore/glsl_math.hpp>
 #include <vlCore/ResourceDatabase.hpp>
 #include <vlCore/LoadWriterManager.hpp>
+#include <vlCore/Thread.hpp>
 
 #include <map>
 #include <cmath>
@@ -157,6 +158,9 @@ bool Image::isValid() const
         case IF_COMPRESSED_RGBA_S3TC_DXT1:
         case IF_COMPRESSED_RGBA_S3TC_DXT3:
         case IF_COMPRESSED_RGBA_S3TC_DXT5:
+        case IF_COMPRESSED_RED_RGTC1:
+        case IF_COMPRESSED_RED_GREEN_RGTC2:
+        case IF_COMPRESSED_RGBA_BPTC_UNORM:
         {
           break;
         }
@@ -184,6 +188,9 @@ bool Image::isValid() const
         case IF_COMPRESSED_RGBA_S3TC_DXT1:
         case IF_COMPRESSED_RGBA_S3TC_DXT3:
         case IF_COMPRESSED_RGBA_S3TC_DXT5:
+        case IF_COMPRESSED_RED_RGTC1:
+        case IF_COMPRESSED_RED_GREEN_RGTC2:
+        case IF_COMPRESSED_RGBA_BPTC_UNORM:
         {
           okformat = true;
           break;
@@ -333,6 +340,9 @@ String Image::printFormat() const
   fo[IF_COMPRESSED_RGBA_S3TC_DXT1] = "IF_COMPRESSED_RGBA_S3TC_DXT1";
   fo[IF_COMPRESSED_RGBA_S3TC_DXT3] = "IF_COMPRESSED_RGBA_S3TC_DXT3";
   fo[IF_COMPRESSED_RGBA_S3TC_DXT5] = "IF_COMPRESSED_RGBA_S3TC_DXT5";
+  fo[IF_COMPRESSED_RED_RGTC1] = "IF_COMPRESSED_RED_RGTC1";
+  fo[IF_COMPRESSED_RED_GREEN_RGTC2] = "IF_COMPRESSED_RED_GREEN_RGTC2";
+  fo[IF_COMPRESSED_RGBA_BPTC_UNORM] = "IF_COMPRESSED_RGBA_BPTC_UNORM";
 
   VL_CHECK( fo[format()] != NULL );
 
@@ -428,6 +438,9 @@ int Image::bitsPerPixel(EImageType type, EImageFormat format)
     case IF_COMPRESSED_RGBA_S3TC_DXT1: return 4; // 8 bytes (64 bits) per block per 16 pixels
     case IF_COMPRESSED_RGBA_S3TC_DXT3: return 8; // 16 bytes (128 bits) per block per 16 pixels
     case IF_COMPRESSED_RGBA_S3TC_DXT5: return 8; // 16 bytes (128 bits) per block per 16 pixels
+    case IF_COMPRESSED_RED_RGTC1:       return 4; // 8 bytes (64 bits) per block per 16 pixels
+    case IF_COMPRESSED_RED_GREEN_RGTC2: return 8; // 16 bytes (128 bits) per block per 16 pixels
+    case IF_COMPRESSED_RGBA_BPTC_UNORM: return 8; // 16 bytes (128 bits) per block per 16 pixels
     default:
       break;
   }
@@ -463,6 +476,9 @@ int Image::alphaBits() const
     case IF_COMPRESSED_RGBA_S3TC_DXT1: return 1; // 8 bytes (64 bits) per block per 16 pixels
     case IF_COMPRESSED_RGBA_S3TC_DXT3: return 4; // 16 bytes (64 bits for uncompressed alpha + 64 bits for RGB) per block per 16 pixels
     case IF_COMPRESSED_RGBA_S3TC_DXT5: return 4; // 16 bytes (64 bits for   compressed alpha + 64 bits for RGB) per block per 16 pixels
+    case IF_COMPRESSED_RED_RGTC1:       return 0;
+    case IF_COMPRESSED_RED_GREEN_RGTC2: return 0;
+    case IF_COMPRESSED_RGBA_BPTC_UNORM: return 8; // up to 8 bits of alpha depending on the mode of each block
     default:
       break;
   }
@@ -511,6 +527,9 @@ int Image::isCompressedFormat(EImageFormat fmt)
   case IF_COMPRESSED_RGBA_S3TC_DXT1:
   case IF_COMPRESSED_RGBA_S3TC_DXT3:
   case IF_COMPRESSED_RGBA_S3TC_DXT5:
+  case IF_COMPRESSED_RED_RGTC1:
+  case IF_COMPRESSED_RED_GREEN_RGTC2:
+  case IF_COMPRESSED_RGBA_BPTC_UNORM:
     return true;
 
   default:
@@ -981,6 +1000,9 @@ int Image::requiredMemory(int width, int height, int depth, int bytealign, EImag
     case IF_COMPRESSED_RGBA_S3TC_DXT1:
     case IF_COMPRESSED_RGBA_S3TC_DXT3:
     case IF_COMPRESSED_RGBA_S3TC_DXT5:
+    case IF_COMPRESSED_RED_RGTC1:
+    case IF_COMPRESSED_RED_GREEN_RGTC2:
+    case IF_COMPRESSED_RGBA_BPTC_UNORM:
       if (width % 4)
         width = width - width % 4 + 4;
       if (height % 4)
@@ -1014,8 +1036,14 @@ int Image::requiredMemory(int width, int height, int depth, int bytealign, EImag
   if (req_mem < 16 && format == IF_COMPRESSED_RGBA_S3TC_DXT5)
     req_mem = 16;
 
-  // todo: add other compression schemes
-  // ...
+  if (req_mem < 8 && format == IF_COMPRESSED_RED_RGTC1)
+    req_mem = 8;
+
+  if (req_mem < 16 && format == IF_COMPRESSED_RED_GREEN_RGTC2)
+    req_mem = 16;
+
+  if (req_mem < 16 && format == IF_COMPRESSED_RGBA_BPTC_UNORM)
+    req_mem = 16;
 
   // cubemap
   if (is_cubemap)
@@ -1266,6 +1294,130 @@ ref<Image> vl::loadRAW(VirtualFile* file, long long file_offset, int width, int
   }
 }
 //-----------------------------------------------------------------------------
+namespace
+{
+  //! Converts a row of \p count components, or pixels, from \p src to \p dst.
+  typedef void (*ConvertRowFunc)(const void* src, void* dst, int count, const void* params);
+
+  //! Fills a 256 entries lookup table used to convert 8 bit components.
+  typedef void (*ConvertLUTFunc)(void* lut);
+
+  //! Runs a ConvertRowFunc on every row of an image, see Image::convertType() and Image::convertFormat().
+  class ConvertRowsTask: public ParallelForTask
+  {
+  public:
+    ConvertRowsTask(const Image* src, Image* dst, int count, ConvertRowFunc convert_row, const void* params):
+      mSrc(src), mDst(dst), mCount(count), mConvertRow(convert_row), mParams(params) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      for(int i=begin; i<end; ++i)
+        mConvertRow( mSrc->pixels() + mSrc->pitch()*i, mDst->pixels() + mDst->pitch()*i, mCount, mParams );
+    }
+
+  protected:
+    const Image* mSrc;
+    Image* mDst;
+    int mCount;
+    ConvertRowFunc mConvertRow;
+    const void* mParams;
+  };
+
+  //! Rows are processed in blocks of at least 16K components.
+  inline int rowGrain(int components_per_row)
+  {
+    return std::max( 1, 16384 / std::max(1, components_per_row) );
+  }
+
+  inline double toUnit(unsigned char v)  { return v/255.0; }
+  inline double toUnit(GLbyte v)         { return v/127.0; }
+  inline double toUnit(GLushort v)       { return v/65535.0; }
+  inline double toUnit(GLshort v)        { return v/32767.0; }
+  inline double toUnit(unsigned int v)   { return v/4294967295.0; }
+  inline double toUnit(int v)            { return v/2147483647.0; }
+  inline double toUnit(float v)          { return v; }
+
+  inline void fromUnit(double v, unsigned char& out)  { out = (unsigned char)(v*255.0); }
+  inline void fromUnit(double v, GLbyte& out)         { out = (GLbyte)(v*127.0); }
+  inline void fromUnit(double v, GLushort& out)       { out = (GLushort)(v*65535.0); }
+  inline void fromUnit(double v, GLshort& out)        { out = (GLshort)(v*32767.0); }
+  inline void fromUnit(double v, unsigned int& out)   { out = (unsigned int)(v*4294967295.0); }
+  inline void fromUnit(double v, int& out)            { out = (int)(v*2147483647.0); }
+  inline void fromUnit(double v, float& out)          { out = (float)v; }
+
+  template<typename S, typename D>
+  inline D convertComponent(S v)
+  {
+    // clamp 0.0 >= dval >= 1.0
+    double dval = toUnit(v);
+    dval = dval < 0.0 ? 0.0 :
+           dval > 1.0 ? 1.0 :
+           dval;
+    D out;
+    fromUnit(dval, out);
+    return out;
+  }
+
+  template<typename S, typename D>
+  void convertTypeRow(const void* src, void* dst, int count, const void* lut)
+  {
+    const S* s = (const S*)src;
+    D* d = (D*)dst;
+    if (lut)
+    {
+      const D* table = (const D*)lut;
+      for(int i=0; i<count; ++i)
+        d[i] = table[ (unsigned char)s[i] ];
+    }
+    else
+    {
+      for(int i=0; i<count; ++i)
+        d[i] = convertComponent<S,D>(s[i]);
+    }
+  }
+
+  template<typename S, typename D>
+  void convertTypeLUT(void* lut)
+  {
+    D* table = (D*)lut;
+    for(int i=0; i<256; ++i)
+      table[i] = convertComponent<S,D>( (S)i );
+  }
+
+  template<typename S>
+  void selectConvertType(EImageType dst_type, ConvertRowFunc& convert_row, ConvertLUTFunc& convert_lut)
+  {
+    switch(dst_type)
+    {
+      case IT_UNSIGNED_BYTE:  convert_row = convertTypeRow<S, unsigned char>; convert_lut = convertTypeLUT<S, unsigned char>; break;
+      case IT_BYTE:           convert_row = convertTypeRow<S, GLbyte>;        convert_lut = convertTypeLUT<S, GLbyte>;        break;
+      case IT_UNSIGNED_SHORT: convert_row = convertTypeRow<S, GLushort>;      convert_lut = convertTypeLUT<S, GLushort>;      break;
+      case IT_SHORT:          convert_row = convertTypeRow<S, GLshort>;       convert_lut = convertTypeLUT<S, GLshort>;       break;
+      case IT_UNSIGNED_INT:   convert_row = convertTypeRow<S, unsigned int>;  convert_lut = convertTypeLUT<S, unsigned int>;  break;
+      case IT_INT:            convert_row = convertTypeRow<S, int>;           convert_lut = convertTypeLUT<S, int>;           break;
+      case IT_FLOAT:          convert_row = convertTypeRow<S, float>;         convert_lut = convertTypeLUT<S, float>;         break;
+      default:
+        break;
+    }
+  }
+
+  void selectConvertType(EImageType src_type, EImageType dst_type, ConvertRowFunc& convert_row, ConvertLUTFunc& convert_lut)
+  {
+    switch(src_type)
+    {
+      case IT_UNSIGNED_BYTE:  selectConvertType<unsigned char>(dst_type, convert_row, convert_lut); break;
+      case IT_BYTE:           selectConvertType<GLbyte>       (dst_type, convert_row, convert_lut); break;
+      case IT_UNSIGNED_SHORT: selectConvertType<GLushort>     (dst_type, convert_row, convert_lut); break;
+      case IT_SHORT:          selectConvertType<GLshort>      (dst_type, convert_row, convert_lut); break;
+      case IT_UNSIGNED_INT:   selectConvertType<unsigned int> (dst_type, convert_row, convert_lut); break;
+      case IT_INT:            selectConvertType<int>          (dst_type, convert_row, convert_lut); break;
+      case IT_FLOAT:          selectConvertType<float>        (dst_type, convert_row, convert_lut); break;
+      default:
+        break;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
 ref<Image> vl::Image::convertType(EImageType new_type) const
 {
   switch(type())
@@ -1355,71 +1507,20 @@ ref<Image> vl::Image::convertType(EImageType new_type) const
   if (img->isCubemap())
     line_count *= 6;
 
-  for(int i=0; i<line_count; ++i)
-  {
-    const void* srcLine = pixels()      + pitch()*i;
-    void* dstLine = img->pixels() + img->pitch()*i;
-
-    const unsigned char* srcUByte  = (const unsigned char*)srcLine;
-    const GLbyte*        srcSByte  = (const GLbyte*)srcLine;
-    const GLushort*      srcUShort = (const GLushort*)srcLine;
-    const GLshort*       srcSShort = (const GLshort*)srcLine;
-    const unsigned int*  srcUInt   = (const unsigned int*)srcLine;
-    const int*           srcSInt   = (const int*)srcLine;
-    const float*         srcFloat  = (const float*)srcLine;
-
-    unsigned char* dstUByte  = (unsigned char*)dstLine;
-    GLbyte*        dstSByte  = (GLbyte*)dstLine;
-    GLushort*      dstUShort = (GLushort*)dstLine;
-    GLshort*       dstSShort = (GLshort*)dstLine;
-    unsigned int*  dstUInt   = (unsigned int*)dstLine;
-    int*           dstSInt   = (int*)dstLine;
-    float*         dstFloat  = (float*)dstLine;
-
-    for(int j=0; j<img->width(); ++j)
-    {
-      for(int c=0; c<components; ++c)
-      {
-        double dval = 0;
-        long long qint = 0;
-
-        // convert dst format to double
-
-        switch(type())
-        {
-          case IT_UNSIGNED_BYTE:  qint = *srcUByte;  dval = qint/255.0; ++srcUByte; break;
-          case IT_BYTE:           qint = *srcSByte;  dval = qint/127.0; ++srcSByte; break;
-          case IT_UNSIGNED_SHORT: qint = *srcUShort; dval = qint/65535.0; ++srcUShort; break;
-          case IT_SHORT:          qint = *srcSShort; dval = qint/32767.0; ++srcSShort; break;
-          case IT_UNSIGNED_INT:   qint = *srcUInt;   dval = qint/4294967295.0; ++srcUInt; break;
-          case IT_INT:            qint = *srcSInt;   dval = qint/2147483647.0; ++srcSInt; break;
-          case IT_FLOAT:          dval = *srcFloat;  ++srcFloat; break;
-          default:
-            return NULL;
-        }
-
-        // clamp 0.0 >= dval >= 1.0
-        dval = dval < 0.0 ? 0.0 :
-               dval > 1.0 ? 1.0 :
-               dval;
+  ConvertRowFunc convert_row = NULL;
+  ConvertLUTFunc convert_lut = NULL;
+  selectConvertType(type(), new_type, convert_row, convert_lut);
+  VL_CHECK(convert_row && convert_lut)
 
-        // convert double to dst format
+  // 8 bit components are converted with a lookup table, large enough for any destination type
+  double lut[256];
+  bool use_lut = type() == IT_UNSIGNED_BYTE || type() == IT_BYTE;
+  if (use_lut)
+    convert_lut(lut);
 
-        switch(img->type())
-        {
-          case IT_UNSIGNED_BYTE:  *dstUByte  = (unsigned char) (dval*255.0); ++dstUByte; break;
-          case IT_BYTE:           *dstSByte  = (GLbyte)  (dval*127.0); ++dstSByte; break;
-          case IT_UNSIGNED_SHORT: *dstUShort = (GLushort)(dval*65535.0); ++dstUShort; break;
-          case IT_SHORT:          *dstSShort = (GLshort) (dval*32767.0); ++dstSShort; break;
-          case IT_UNSIGNED_INT:   *dstUInt   = (unsigned int)  (dval*4294967295.0); ++dstUInt; break;
-          case IT_INT:            *dstSInt   = (int)   (dval*2147483647.0); ++dstSInt; break;
-          case IT_FLOAT:          *dstFloat  = (float)dval; ++dstFloat; break;
-          default:
-            return NULL;
-        }
-      }
-    }
-  }
+  int row_components = img->width() * components;
+  ConvertRowsTask task( this, img.get(), row_components, convert_row, use_lut ? lut : NULL );
+  parallelFor( 0, line_count, &task, rowGrain(row_components) );
 
   return img;
 }
@@ -1623,62 +1724,151 @@ namespace
     int r,g,b,a,l;
   };
 
+  //! The source of each destination component, see Image::convertFormat().
+  class FormatMap
+  {
+  public:
+    // values of mSource besides the source component offsets
+    enum { Zero = 4, Max = 5, Gray = 6 };
+
+    FormatMap(const rgbal& srco, const rgbal& dsto, int src_comp, int dst_comp): mSrcOffsets(srco), mSrcComp(src_comp), mDstComp(dst_comp)
+    {
+      // color components are copied or replicate the source luminance, alpha defaults to the maximum value
+      int dst[] = { dsto.r, dsto.g, dsto.b, dsto.a, dsto.l };
+      int src[] = { srco.r, srco.g, srco.b, srco.a, srco.l };
+      for(int c=0; c<5; ++c)
+      {
+        if (dst[c] == -1)
+          continue;
+        if (src[c] != -1)
+          mSource[dst[c]] = src[c];
+        else
+        if (c == 3)
+          mSource[dst[c]] = Max;
+        else
+        if (c < 3 && srco.l != -1)
+          mSource[dst[c]] = srco.l;
+        else
+          mSource[dst[c]] = Zero;
+      }
+
+      // luminance from color: rgb -> gray or a single r, g or b component
+      if (dsto.l != -1 && srco.l == -1)
+      {
+        if (srco.r != -1 && srco.g != -1 && srco.b != -1)
+          mSource[dsto.l] = Gray;
+        else
+        if (srco.r != -1 && srco.g == -1 && srco.b == -1)
+          mSource[dsto.l] = srco.r;
+        else
+        if (srco.r == -1 && srco.g != -1 && srco.b == -1)
+          mSource[dsto.l] = srco.g;
+        else
+        if (srco.r == -1 && srco.g == -1 && srco.b != -1)
+          mSource[dsto.l] = srco.b;
+      }
+
+      mGray = dsto.l != -1 && mSource[dsto.l] == Gray;
+    }
+
+    rgbal mSrcOffsets;
+    int mSrcComp;
+    int mDstComp;
+    int mSource[4];
+    bool mGray;
+  };
+
+  inline unsigned char maxValue(unsigned char) { return 255; }
+  inline GLbyte        maxValue(GLbyte)        { return 127; }
+  inline GLushort      maxValue(GLushort)      { return 65535; }
+  inline GLshort       maxValue(GLshort)       { return 32767; }
+  inline unsigned int  maxValue(unsigned int)  { return 4294967295U; }
+  inline int           maxValue(int)           { return 2147483647; }
+  inline float         maxValue(float)         { return 1.0f; }
+
   template<typename T>
-  void convert(const T*src_px, T*dst_px, T max_value, const rgbal& srco, const rgbal& dsto)
-  {
-    // set dst default values first
-    if (dsto.r != -1)
-      dst_px[dsto.r] = 0;
-    if (dsto.g != -1)
-      dst_px[dsto.g] = 0;
-    if (dsto.b != -1)
-      dst_px[dsto.b] = 0;
-    if (dsto.a != -1)
-      dst_px[dsto.a] = max_value;
-    if (dsto.l != -1)
-      dst_px[dsto.l] = 0;
-
-    // try copy src -> dst
-    if (dsto.r != -1 && srco.r != -1 )
-      dst_px[dsto.r] = src_px[srco.r];
-    if (dsto.g != -1 && srco.g != -1)
-      dst_px[dsto.g] = src_px[srco.g];
-    if (dsto.b != -1 && srco.b != -1)
-      dst_px[dsto.b] = src_px[srco.b];
-    if (dsto.a != -1 && srco.a != -1)
-      dst_px[dsto.a] = src_px[srco.a];
-    if (dsto.l != -1 && srco.l != -1)
-      dst_px[dsto.l] = src_px[srco.l];
-
-    // try rgb -> gray conversion
-    if (dsto.l != -1 && srco.r != -1 && srco.g != -1 && srco.b != -1)
-    {
-      dvec3 col(src_px[srco.r], src_px[srco.g], src_px[srco.b]);
-      double gray = dot(col / dvec3(max_value,max_value,max_value), dvec3(0.299,0.587,0.114));
-      dst_px[dsto.l] = T(gray * max_value);
+  void convertFormatRow(const void* src, void* dst, int count, const void* params)
+  {
+    const FormatMap& map = *(const FormatMap*)params;
+    const T* src_px = (const T*)src;
+    T* dst_px = (T*)dst;
+    T max_value = maxValue(T());
+
+    // the source pixel followed by the values addressed by FormatMap::Zero, Max and Gray
+    T px[7];
+    px[FormatMap::Zero] = 0;
+    px[FormatMap::Max]  = max_value;
+    px[FormatMap::Gray] = 0;
+
+    for(int i=0; i<count; ++i, src_px += map.mSrcComp, dst_px += map.mDstComp)
+    {
+      for(int c=0; c<map.mSrcComp; ++c)
+        px[c] = src_px[c];
+
+      // rgb -> gray conversion
+      if (map.mGray)
+      {
+        const rgbal& srco = map.mSrcOffsets;
+        dvec3 col(src_px[srco.r], src_px[srco.g], src_px[srco.b]);
+        double gray = dot(col / dvec3(max_value,max_value,max_value), dvec3(0.299,0.587,0.114));
+        px[FormatMap::Gray] = T(gray * max_value);
+      }
+
+      for(int c=0; c<map.mDstComp; ++c)
+        dst_px[c] = px[ map.mSource[c] ];
     }
-    else
-    // try r -> gray conversion
-    if (dsto.l != -1 && srco.r != -1 && srco.g == -1 && srco.b == -1)
-      dst_px[dsto.l] = src_px[srco.r];
-    else
-    // try g -> gray conversion
-    if (dsto.l != -1 && srco.r == -1 && srco.g != -1 && srco.b == -1)
-      dst_px[dsto.l] = src_px[srco.g];
-    else
-    // try b -> gray conversion
-    if (dsto.l != -1 && srco.r == -1 && srco.g == -1 && srco.b != -1)
-      dst_px[dsto.l] = src_px[srco.b];
-    else
-    // try gray -> r,g,b
-    if (srco.l != -1)
+  }
+
+  //! Straight-line convertFormatRow() between RGB, RGBA, BGR and BGRA: \p Swap exchanges the red and blue components.
+  template<typename T, int SrcComp, int DstComp, bool Swap>
+  void swizzleRow(const void* src, void* dst, int count, const void*)
+  {
+    const T* src_px = (const T*)src;
+    T* dst_px = (T*)dst;
+    const T max_value = maxValue(T());
+    for(int i=0; i<count; ++i, src_px += SrcComp, dst_px += DstComp)
+    {
+      dst_px[0] = src_px[Swap ? 2 : 0];
+      dst_px[1] = src_px[1];
+      dst_px[2] = src_px[Swap ? 0 : 2];
+      if (DstComp == 4)
+        dst_px[3] = SrcComp == 4 ? src_px[3] : max_value;
+    }
+  }
+
+  template<typename T>
+  ConvertRowFunc selectConvertFormat(const FormatMap& map)
+  {
+    // the red component is either first or third
+    if (map.mSrcComp >= 3 && map.mDstComp >= 3)
+    {
+      bool swap = map.mSource[0] != 0;
+      switch( map.mSrcComp * 10 + map.mDstComp )
+      {
+        case 33: return swap ? swizzleRow<T,3,3,true> : swizzleRow<T,3,3,false>;
+        case 34: return swap ? swizzleRow<T,3,4,true> : swizzleRow<T,3,4,false>;
+        case 43: return swap ? swizzleRow<T,4,3,true> : swizzleRow<T,4,3,false>;
+        case 44: return swap ? swizzleRow<T,4,4,true> : swizzleRow<T,4,4,false>;
+        default:
+          break;
+      }
+    }
+    return convertFormatRow<T>;
+  }
+
+  ConvertRowFunc selectConvertFormat(EImageType type, const FormatMap& map)
+  {
+    switch(type)
     {
-      if (dsto.r != -1)
-        dst_px[dsto.r] = src_px[srco.l];
-      if (dsto.g != -1)
-        dst_px[dsto.g] = src_px[srco.l];
-      if (dsto.b != -1)
-        dst_px[dsto.b] = src_px[srco.l];
+      case IT_UNSIGNED_BYTE:  return selectConvertFormat<unsigned char>(map);
+      case IT_BYTE:           return selectConvertFormat<GLbyte>(map);
+      case IT_UNSIGNED_SHORT: return selectConvertFormat<GLushort>(map);
+      case IT_SHORT:          return selectConvertFormat<GLshort>(map);
+      case IT_UNSIGNED_INT:   return selectConvertFormat<unsigned int>(map);
+      case IT_INT:            return selectConvertFormat<int>(map);
+      case IT_FLOAT:          return selectConvertFormat<float>(map);
+      default:
+        return NULL;
     }
   }
 }
@@ -1827,42 +2017,1366 @@ ref<Image> vl::Image::convertFormat(EImageFormat new_format) const
   if (img->isCubemap())
     line_count *= 6;
 
-  for(int i=0; i<line_count; ++i)
+  FormatMap map(srco, dsto, src_comp, dst_comp);
+  ConvertRowFunc convert_row = selectConvertFormat(type(), map);
+  VL_CHECK(convert_row)
+
+  ConvertRowsTask task( this, img.get(), img->width(), convert_row, &map );
+  parallelFor( 0, line_count, &task, rowGrain(img->width() * dst_comp) );
+
+  return img;
+}
+//-----------------------------------------------------------------------------
+namespace
+{
+  inline unsigned char premultiply(unsigned char c, unsigned char a) { return (unsigned char)( ((unsigned int)c * a + 127) / 255 ); }
+  inline GLushort      premultiply(GLushort c, GLushort a)           { return (GLushort)( ((unsigned int)c * a + 32767) / 65535 ); }
+  inline float         premultiply(float c, float a)                 { return c * a; }
+
+  template<typename T>
+  void premultiplyRow(const void*, void* dst, int count, const void* params)
+  {
+    // the alpha is the last component
+    int comps = *(const int*)params;
+    T* px = (T*)dst;
+    for(int i=0; i<count; ++i, px += comps)
+      for(int c=0; c<comps-1; ++c)
+        px[c] = premultiply(px[c], px[comps-1]);
+  }
+}
+//! Multiplies the color components by the alpha component, as required by the GL_ONE, GL_ONE_MINUS_SRC_ALPHA blending.
+//! This function supports IF_RGBA, IF_BGRA and IF_LUMINANCE_ALPHA images of type IT_UNSIGNED_BYTE, IT_UNSIGNED_SHORT and IT_FLOAT.
+bool Image::premultiplyAlpha()
+{
+  int comps = 0;
+  switch(format())
+  {
+    case IF_RGBA:
+    case IF_BGRA:            comps = 4; break;
+    case IF_LUMINANCE_ALPHA: comps = 2; break;
+    default:
+      Log::error("Image::premultiplyAlpha(): unsupported image format().\n");
+      return false;
+  }
+
+  ConvertRowFunc premultiply_row = NULL;
+  switch(type())
+  {
+    case IT_UNSIGNED_BYTE:  premultiply_row = premultiplyRow<unsigned char>; break;
+    case IT_UNSIGNED_SHORT: premultiply_row = premultiplyRow<GLushort>;      break;
+    case IT_FLOAT:          premultiply_row = premultiplyRow<float>;         break;
+    default:
+      Log::error("Image::premultiplyAlpha(): unsupported image type(). Types supported are IT_UNSIGNED_BYTE, IT_UNSIGNED_SHORT, IT_FLOAT.\n");
+      return false;
+  }
+
+  int line_count = height()?height():1;
+  if (depth())
+    line_count *= depth();
+  else
+  if (isCubemap())
+    line_count *= 6;
+
+  ConvertRowsTask task( this, this, width(), premultiply_row, &comps );
+  parallelFor( 0, line_count, &task, rowGrain(width() * comps) );
+  return true;
+}
+//-----------------------------------------------------------------------------
+// resampling
+//-----------------------------------------------------------------------------
+namespace
+{
+  double sinc(double x)
+  {
+    if (fabs(x) < 1e-8)
+      return 1.0;
+    x *= dPi;
+    return sin(x) / x;
+  }
+
+  //! Zero order modified Bessel function of the first kind.
+  double bessel0(double x)
   {
-    const void* srcLine = pixels()      + pitch()*i;
-    void* dstLine = img->pixels() + img->pitch()*i;
+    double sum = 1.0, term = 1.0;
+    for(int k=1; k<32 && term > sum * 1e-12; ++k)
+    {
+      term *= (x * 0.5 / k) * (x * 0.5 / k);
+      sum += term;
+    }
+    return sum;
+  }
 
-    const unsigned char* srcUByte  = (const unsigned char*)srcLine;
-    const GLbyte*        srcSByte  = (const GLbyte*)srcLine;
-    const GLushort*      srcUShort = (const GLushort*)srcLine;
-    const GLshort*       srcSShort = (const GLshort*)srcLine;
-    const unsigned int*  srcUInt   = (const unsigned int*)srcLine;
-    const int*           srcSInt   = (const int*)srcLine;
-    const float*         srcFloat  = (const float*)srcLine;
+  //! The radius of the filter in source samples, when not downsampling.
+  double filterSupport(EResampleFilter filter)
+  {
+    return filter == RF_Box ? 0.5 : 3.0;
+  }
 
-    unsigned char* dstUByte  = (unsigned char*)dstLine;
-    GLbyte*        dstSByte  = (GLbyte*)dstLine;
-    GLushort*      dstUShort = (GLushort*)dstLine;
-    GLshort*       dstSShort = (GLshort*)dstLine;
-    unsigned int*  dstUInt   = (unsigned int*)dstLine;
-    int*           dstSInt   = (int*)dstLine;
-    float*         dstFloat  = (float*)dstLine;
+  double filterWeight(EResampleFilter filter, double x)
+  {
+    switch(filter)
+    {
+      case RF_Box:
+        return x >= -0.5 && x < 0.5 ? 1.0 : 0.0;
+      case RF_Kaiser:
+      {
+        // alpha = 4, width = 3
+        double t = x / 3.0;
+        if (fabs(t) >= 1.0)
+          return 0.0;
+        return sinc(x) * bessel0( 4.0 * sqrt(1.0 - t*t) ) / bessel0(4.0);
+      }
+      case RF_Lanczos:
+        return fabs(x) < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+      default:
+        return 0.0;
+    }
+  }
 
-    for(int j=0; j<img->width(); ++j)
+  //! The source samples and weights contributing to each destination sample along one axis, out of range samples are clamped to the edge.
+  class ResampleWeights
+  {
+  public:
+    ResampleWeights(int src_size, int dst_size, EResampleFilter filter)
     {
-      switch(type())
+      double scale = (double)src_size / dst_size;
+      // the filter is stretched when downsampling
+      double stretch = std::max(1.0, scale);
+      double radius = filterSupport(filter) * stretch;
+      std::vector<double> acc;
+      for(int i=0; i<dst_size; ++i)
       {
-        case IT_UNSIGNED_BYTE:  convert<unsigned char> (srcUByte,  dstUByte,  255,         srco, dsto); srcUByte+=src_comp;  dstUByte+=dst_comp;  break;
-        case IT_BYTE:           convert<GLbyte>        (srcSByte,  dstSByte,  127,         srco, dsto); srcSByte+=src_comp;  dstSByte+=dst_comp;  break;
-        case IT_UNSIGNED_SHORT: convert<GLushort>      (srcUShort, dstUShort, 65535,       srco, dsto); srcUShort+=src_comp; dstUShort+=dst_comp; break;
-        case IT_SHORT:          convert<GLshort>       (srcSShort, dstSShort, 32767,       srco, dsto); srcSShort+=src_comp; dstSShort+=dst_comp; break;
-        case IT_UNSIGNED_INT:   convert<unsigned int>  (srcUInt,   dstUInt,   4294967295U, srco, dsto); srcUInt+=src_comp;   dstUInt+=dst_comp;   break;
-        case IT_INT:            convert<int>           (srcSInt,   dstSInt,   2147483647,  srco, dsto); srcSInt+=src_comp;   dstSInt+=dst_comp;   break;
-        case IT_FLOAT:          convert<float>         (srcFloat,  dstFloat,  1.0f,        srco, dsto); srcFloat+=src_comp;  dstFloat+=dst_comp;  break;
-        default:
-          return NULL;
+        double center = (i + 0.5) * scale;
+        int first = (int)floor(center - radius);
+        int last  = (int)ceil(center + radius);
+        int clamped_first = std::max(0, first);
+        int clamped_last  = std::min(src_size - 1, last);
+        acc.assign( clamped_last - clamped_first + 1, 0.0 );
+        double sum = 0;
+        for(int j=first; j<=last; ++j)
+        {
+          double w = filterWeight( filter, (j + 0.5 - center) / stretch );
+          acc[ clamp(j, clamped_first, clamped_last) - clamped_first ] += w;
+          sum += w;
+        }
+        // shouldn't happen, take the nearest sample
+        if (sum == 0)
+        {
+          acc.assign( acc.size(), 0.0 );
+          acc[ clamp((int)center, clamped_first, clamped_last) - clamped_first ] = 1.0;
+          sum = 1.0;
+        }
+        mFirst.push_back(clamped_first);
+        mCount.push_back( (int)acc.size() );
+        mOffset.push_back( (int)mWeights.size() );
+        for(size_t k=0; k<acc.size(); ++k)
+          mWeights.push_back( (float)(acc[k] / sum) );
+      }
+    }
+
+    std::vector<int> mFirst;
+    std::vector<int> mCount;
+    std::vector<int> mOffset;
+    std::vector<float> mWeights;
+  };
+
+  //! Floating point pixels used while resampling: \p mLayers layers of \p mHeight rows of \p mWidth pixels.
+  class FloatPixels
+  {
+  public:
+    FloatPixels(): mWidth(0), mHeight(0), mLayers(0), mComponents(0) {}
+
+    void allocate(int w, int h, int layers, int components)
+    {
+      mWidth = w;
+      mHeight = h;
+      mLayers = layers;
+      mComponents = components;
+      mData.resize( (size_t)w * h * layers * components );
+    }
+
+    void swap(FloatPixels& other)
+    {
+      std::swap(mWidth, other.mWidth);
+      std::swap(mHeight, other.mHeight);
+      std::swap(mLayers, other.mLayers);
+      std::swap(mComponents, other.mComponents);
+      mData.swap(other.mData);
+    }
+
+    float* row(int i) { return &mData[ (size_t)i * mWidth * mComponents ]; }
+    const float* row(int i) const { return &mData[ (size_t)i * mWidth * mComponents ]; }
+
+    int mWidth;
+    int mHeight;
+    int mLayers;
+    int mComponents;
+    std::vector<float> mData;
+  };
+
+  inline float srgbToLinear(float v)
+  {
+    return v <= 0.04045f ? v / 12.92f : (float)pow( (v + 0.055) / 1.055, 2.4 );
+  }
+
+  inline float linearToSrgb(float v)
+  {
+    return v <= 0.0031308f ? v * 12.92f : (float)( 1.055 * pow( (double)v, 1.0 / 2.4 ) - 0.055 );
+  }
+
+  //! The component not affected by the sRGB conversion, -1 if none.
+  int alphaComponent(EImageFormat format)
+  {
+    switch(format)
+    {
+      case IF_RGBA:
+      case IF_BGRA:            return 3;
+      case IF_LUMINANCE_ALPHA: return 1;
+      case IF_ALPHA:           return 0;
+      default:                 return -1;
+    }
+  }
+
+  //! The number of components of an image supported by Image::resample(), 0 if not supported.
+  int resampleComponents(const Image* img)
+  {
+    int component_bits = 0;
+    switch(img->type())
+    {
+      case IT_UNSIGNED_BYTE:  component_bits = 8;  break;
+      case IT_UNSIGNED_SHORT: component_bits = 16; break;
+      case IT_FLOAT:          component_bits = 32; break;
+      default:
+        return 0;
+    }
+    int components = img->bitsPerPixel() / component_bits;
+    return img->bitsPerPixel() % component_bits == 0 && components >= 1 && components <= 4 ? components : 0;
+  }
+
+  //! Converts the rows of an image to normalized floats, linearizing the sRGB color components.
+  class ImageToFloatTask: public ParallelForTask
+  {
+  public:
+    ImageToFloatTask(const Image* img, FloatPixels& out, bool srgb): mImage(img), mOut(out), mAlpha(-1)
+    {
+      if (srgb)
+      {
+        mAlpha = alphaComponent(img->format());
+        mLUT.resize(256);
+        for(int i=0; i<256; ++i)
+          mLUT[i] = srgbToLinear(i / 255.0f);
+      }
+      mSRGB = srgb && !( mOut.mComponents == 1 && mAlpha == 0 );
+    }
+
+    virtual void runRange(int begin, int end)
+    {
+      int count = mOut.mWidth * mOut.mComponents;
+      for(int i=begin; i<end; ++i)
+      {
+        const unsigned char* src = mImage->pixels() + mImage->pitch() * i;
+        float* dst = mOut.row(i);
+        switch(mImage->type())
+        {
+          case IT_UNSIGNED_BYTE:
+            for(int k=0; k<count; ++k)
+              dst[k] = mSRGB && k % mOut.mComponents != mAlpha ? mLUT[src[k]] : src[k] / 255.0f;
+            break;
+          case IT_UNSIGNED_SHORT:
+            for(int k=0; k<count; ++k)
+              dst[k] = ((const GLushort*)src)[k] / 65535.0f;
+            break;
+          default:
+            memcpy( dst, src, count * sizeof(float) );
+            break;
+        }
+        if ( mSRGB && mImage->type() != IT_UNSIGNED_BYTE )
+        {
+          for(int k=0; k<count; ++k)
+            if (k % mOut.mComponents != mAlpha)
+              dst[k] = srgbToLinear(dst[k]);
+        }
       }
     }
+
+  protected:
+    const Image* mImage;
+    FloatPixels& mOut;
+    std::vector<float> mLUT;
+    int mAlpha;
+    bool mSRGB;
+  };
+
+  //! Writes normalized floats to the rows of an image, rounding and clamping integer components.
+  class FloatToImageTask: public ParallelForTask
+  {
+  public:
+    FloatToImageTask(const FloatPixels& in, Image* img, bool srgb): mIn(in), mImage(img)
+    {
+      mAlpha = srgb ? alphaComponent(img->format()) : -1;
+      mSRGB = srgb && !( mIn.mComponents == 1 && mAlpha == 0 );
+    }
+
+    virtual void runRange(int begin, int end)
+    {
+      int count = mIn.mWidth * mIn.mComponents;
+      std::vector<float> tmp;
+      for(int i=begin; i<end; ++i)
+      {
+        const float* src = mIn.row(i);
+        if (mSRGB)
+        {
+          tmp.assign(src, src + count);
+          for(int k=0; k<count; ++k)
+            if (k % mIn.mComponents != mAlpha)
+              tmp[k] = linearToSrgb(tmp[k]);
+          src = &tmp[0];
+        }
+        unsigned char* dst = mImage->pixels() + mImage->pitch() * i;
+        switch(mImage->type())
+        {
+          case IT_UNSIGNED_BYTE:
+            for(int k=0; k<count; ++k)
+              dst[k] = (unsigned char)( clamp(src[k], 0.0f, 1.0f) * 255.0f + 0.5f );
+            break;
+          case IT_UNSIGNED_SHORT:
+            for(int k=0; k<count; ++k)
+              ((GLushort*)dst)[k] = (GLushort)( clamp(src[k], 0.0f, 1.0f) * 65535.0f + 0.5f );
+            break;
+          default:
+            memcpy( dst, src, count * sizeof(float) );
+            break;
+        }
+      }
+    }
+
+  protected:
+    const FloatPixels& mIn;
+    Image* mImage;
+    int mAlpha;
+    bool mSRGB;
+  };
+
+  //! Resamples every row along x.
+  class ResampleXTask: public ParallelForTask
+  {
+  public:
+    ResampleXTask(const FloatPixels& in, FloatPixels& out, const ResampleWeights& weights): mIn(in), mOut(out), mWeights(weights) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      int comps = mIn.mComponents;
+      for(int i=begin; i<end; ++i)
+      {
+        const float* src = mIn.row(i);
+        float* dst = mOut.row(i);
+        for(int x=0; x<mOut.mWidth; ++x, dst += comps)
+        {
+          const float* w = &mWeights.mWeights[ mWeights.mOffset[x] ];
+          const float* s = src + mWeights.mFirst[x] * comps;
+          float acc[] = { 0, 0, 0, 0 };
+          for(int k=0; k<mWeights.mCount[x]; ++k, s += comps)
+            for(int c=0; c<comps; ++c)
+              acc[c] += w[k] * s[c];
+          for(int c=0; c<comps; ++c)
+            dst[c] = acc[c];
+        }
+      }
+    }
+
+  protected:
+    const FloatPixels& mIn;
+    FloatPixels& mOut;
+    const ResampleWeights& mWeights;
+  };
+
+  //! Resamples along y, or along z if \p along_layers is true, computing each destination row as a weighted sum of source rows.
+  class ResampleRowsTask: public ParallelForTask
+  {
+  public:
+    ResampleRowsTask(const FloatPixels& in, FloatPixels& out, const ResampleWeights& weights, bool along_layers):
+      mIn(in), mOut(out), mWeights(weights), mAlongLayers(along_layers) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      int count = mOut.mWidth * mOut.mComponents;
+      for(int i=begin; i<end; ++i)
+      {
+        int layer = i / mOut.mHeight;
+        int y = i % mOut.mHeight;
+        int t = mAlongLayers ? layer : y;
+        const float* w = &mWeights.mWeights[ mWeights.mOffset[t] ];
+        float* dst = mOut.row(i);
+        for(int k=0; k<count; ++k)
+          dst[k] = 0;
+        for(int j=0; j<mWeights.mCount[t]; ++j)
+        {
+          int src_row = mAlongLayers ? ( mWeights.mFirst[t] + j ) * mIn.mHeight + y : layer * mIn.mHeight + mWeights.mFirst[t] + j;
+          const float* src = mIn.row(src_row);
+          for(int k=0; k<count; ++k)
+            dst[k] += w[j] * src[k];
+        }
+      }
+    }
+
+  protected:
+    const FloatPixels& mIn;
+    FloatPixels& mOut;
+    const ResampleWeights& mWeights;
+    bool mAlongLayers;
+  };
+
+  //! Resamples \p pixels to \p w x \p h x \p layers, layers are resampled only if \p is_3d is true.
+  void resamplePixels(FloatPixels& pixels, int w, int h, int layers, bool is_3d, EResampleFilter filter)
+  {
+    int grain = std::max( 1, 16384 / std::max(1, w * pixels.mComponents) );
+    FloatPixels tmp;
+    if (w != pixels.mWidth)
+    {
+      ResampleWeights weights(pixels.mWidth, w, filter);
+      tmp.allocate(w, pixels.mHeight, pixels.mLayers, pixels.mComponents);
+      ResampleXTask task(pixels, tmp, weights);
+      parallelFor(0, pixels.mHeight * pixels.mLayers, &task, grain);
+      pixels.swap(tmp);
+    }
+    if (h != pixels.mHeight)
+    {
+      ResampleWeights weights(pixels.mHeight, h, filter);
+      tmp.allocate(w, h, pixels.mLayers, pixels.mComponents);
+      ResampleRowsTask task(pixels, tmp, weights, false);
+      parallelFor(0, h * pixels.mLayers, &task, grain);
+      pixels.swap(tmp);
+    }
+    if (is_3d && layers != pixels.mLayers)
+    {
+      ResampleWeights weights(pixels.mLayers, layers, filter);
+      tmp.allocate(w, h, layers, pixels.mComponents);
+      ResampleRowsTask task(pixels, tmp, weights, true);
+      parallelFor(0, h * layers, &task, grain);
+      pixels.swap(tmp);
+    }
+  }
+
+  //! Allocates an image like \p img with the given size, format, type and byte alignment.
+  ref<Image> allocateLike(const Image* img, int w, int h, int d, EImageFormat format, EImageType type, int bytealign)
+  {
+    ref<Image> out = new Image;
+    out->setObjectName( img->objectName().c_str() );
+    if (img->isCubemap())
+      out->allocateCubemap( w, h, bytealign, format, type );
+    else
+    if (d)
+      out->allocate3D( w, h, d, bytealign, format, type );
+    else
+    if (h)
+      out->allocate2D( w, h, bytealign, format, type );
+    else
+      out->allocate1D( w, format, type );
+    out->setHasAlpha( img->hasAlpha() );
+    out->setIsNormalMap( img->isNormalMap() );
+    return out;
+  }
+
+  //! Allocates an image like \p img with the given size.
+  ref<Image> allocateLike(const Image* img, int w, int h, int d)
+  {
+    return allocateLike( img, w, h, d, img->format(), img->type(), img->byteAlignment() );
+  }
+}
+//-----------------------------------------------------------------------------
+ref<Image> Image::resample(int new_width, int new_height, int new_depth, EResampleFilter filter, bool srgb) const
+{
+  int components = resampleComponents(this);
+  if (!components)
+  {
+    Log::error("Image::resample(): unsupported image format() or type(). Types supported are IT_UNSIGNED_BYTE, IT_UNSIGNED_SHORT, IT_FLOAT.\n");
+    return NULL;
+  }
+
+  if ( new_width < 1 || (new_height < 1) != (height() < 1) || (new_depth < 1) != (depth() < 1) )
+  {
+    Log::error("Image::resample(): the new size must be positive and keep the dimension() of the image.\n");
+    return NULL;
+  }
+
+  int layers = isCubemap() ? 6 : std::max(1, depth());
+  FloatPixels float_pixels;
+  float_pixels.allocate( width(), std::max(1, height()), layers, components );
+  ImageToFloatTask to_float(this, float_pixels, srgb);
+  parallelFor( 0, float_pixels.mHeight * layers, &to_float, rowGrain(width() * components) );
+
+  resamplePixels( float_pixels, new_width, std::max(1, new_height), isCubemap() ? 6 : std::max(1, new_depth), depth() > 0, filter );
+
+  ref<Image> img = allocateLike(this, new_width, new_height, new_depth);
+  FloatToImageTask to_image(float_pixels, img.get(), srgb);
+  parallelFor( 0, float_pixels.mHeight * float_pixels.mLayers, &to_image, rowGrain(new_width * components) );
+  return img;
+}
+//-----------------------------------------------------------------------------
+bool Image::generateMipmaps(EResampleFilter filter, bool srgb)
+{
+  int components = resampleComponents(this);
+  if (!components)
+  {
+    Log::error("Image::generateMipmaps(): unsupported image format() or type(). Types supported are IT_UNSIGNED_BYTE, IT_UNSIGNED_SHORT, IT_FLOAT.\n");
+    return false;
+  }
+
+  mMipmaps.clear();
+
+  int w = width();
+  int h = height();
+  int d = depth();
+  int layers = isCubemap() ? 6 : std::max(1, d);
+  FloatPixels float_pixels;
+  float_pixels.allocate( w, std::max(1, h), layers, components );
+  ImageToFloatTask to_float(this, float_pixels, srgb);
+  parallelFor( 0, float_pixels.mHeight * layers, &to_float, rowGrain(w * components) );
+
+  // each level is filtered from the unquantized previous one
+  while( w > 1 || h > 1 || d > 1 )
+  {
+    w = std::max(1, w / 2);
+    h = h ? std::max(1, h / 2) : 0;
+    d = d ? std::max(1, d / 2) : 0;
+    resamplePixels( float_pixels, w, std::max(1, h), isCubemap() ? 6 : std::max(1, d), d > 0, filter );
+
+    ref<Image> mip = allocateLike(this, w, h, d);
+    FloatToImageTask to_image(float_pixels, mip.get(), srgb);
+    parallelFor( 0, float_pixels.mHeight * float_pixels.mLayers, &to_image, rowGrain(w * components) );
+    mMipmaps.push_back(mip);
+  }
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+// block compression
+//-----------------------------------------------------------------------------
+namespace
+{
+  //! The RGBA pixels of a 4x4 block, the pixels outside the image replicate the last column and row.
+  struct PixelBlock
+  {
+    int mPixels[16][4];
+  };
+
+  inline float clampByte(float v)
+  {
+    return v < 0.0f ? 0.0f : ( v > 255.0f ? 255.0f : v );
+  }
+
+  inline int squaredDistance(const int* a, const int* b, int channels)
+  {
+    int d = 0;
+    for(int k=0; k<channels; ++k)
+      d += (a[k] - b[k]) * (a[k] - b[k]);
+    return d;
+  }
+
+  //! The initial guess of the endpoints of a block: the bounding box for CQ_Fast, the extremes of the principal axis otherwise.
+  //! The pixels for which \p skip is true are not considered.
+  void initialEndpoints(const PixelBlock& block, const bool* skip, int channels, ECompressionQuality quality, float* e0, float* e1)
+  {
+    float mean[4] = { 0, 0, 0, 0 };
+    float lo[4] = { 255, 255, 255, 255 };
+    float hi[4] = { 0, 0, 0, 0 };
+    int count = 0;
+    for(int i=0; i<16; ++i)
+    {
+      if (skip[i])
+        continue;
+      ++count;
+      for(int k=0; k<channels; ++k)
+      {
+        mean[k] += (float)block.mPixels[i][k];
+        lo[k] = std::min( lo[k], (float)block.mPixels[i][k] );
+        hi[k] = std::max( hi[k], (float)block.mPixels[i][k] );
+      }
+    }
+
+    if (!count)
+    {
+      memset(e0, 0, sizeof(float) * channels);
+      memset(e1, 0, sizeof(float) * channels);
+      return;
+    }
+    for(int k=0; k<channels; ++k)
+      mean[k] /= count;
+
+    if (quality == CQ_Fast || count < 2)
+    {
+      // the diagonal of the box follows the channel with the largest range, the channels decreasing along it are flipped
+      int main_channel = 0;
+      for(int k=1; k<channels; ++k)
+        if (hi[k] - lo[k] > hi[main_channel] - lo[main_channel])
+          main_channel = k;
+      for(int k=0; k<channels; ++k)
+      {
+        // inset the box by 1/16 of its size, the endpoints are rarely hit exactly
+        float inset = (hi[k] - lo[k]) / 16.0f;
+        e0[k] = hi[k] - inset;
+        e1[k] = lo[k] + inset;
+        float cov = 0;
+        for(int i=0; i<16; ++i)
+          if (!skip[i])
+            cov += ( block.mPixels[i][main_channel] - mean[main_channel] ) * ( block.mPixels[i][k] - mean[k] );
+        if (cov < 0)
+          std::swap(e0[k], e1[k]);
+      }
+      return;
+    }
+
+    float cov[4][4] = { { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 } };
+    for(int i=0; i<16; ++i)
+    {
+      if (skip[i])
+        continue;
+      for(int j=0; j<channels; ++j)
+        for(int k=0; k<channels; ++k)
+          cov[j][k] += ( block.mPixels[i][j] - mean[j] ) * ( block.mPixels[i][k] - mean[k] );
+    }
+
+    // power iteration starting from the channel with the largest variance
+    int start = 0;
+    for(int k=1; k<channels; ++k)
+      if (cov[k][k] > cov[start][start])
+        start = k;
+    float axis[4] = { 0, 0, 0, 0 };
+    axis[start] = 1.0f;
+    for(int iter=0; iter<8; ++iter)
+    {
+      float v[4] = { 0, 0, 0, 0 };
+      float norm = 0;
+      for(int j=0; j<channels; ++j)
+      {
+        for(int k=0; k<channels; ++k)
+          v[j] += cov[j][k] * axis[k];
+        norm = std::max( norm, (float)fabs(v[j]) );
+      }
+      if (norm < 1e-6f)
+        break;
+      for(int k=0; k<channels; ++k)
+        axis[k] = v[k] / norm;
+    }
+    float len = 0;
+    for(int k=0; k<channels; ++k)
+      len += axis[k] * axis[k];
+    len = sqrt(len);
+    for(int k=0; k<channels; ++k)
+      axis[k] /= len;
+
+    float tmin = 0, tmax = 0;
+    for(int i=0; i<16; ++i)
+    {
+      if (skip[i])
+        continue;
+      float t = 0;
+      for(int k=0; k<channels; ++k)
+        t += ( block.mPixels[i][k] - mean[k] ) * axis[k];
+      tmin = std::min(tmin, t);
+      tmax = std::max(tmax, t);
+    }
+    for(int k=0; k<channels; ++k)
+    {
+      e0[k] = clampByte( mean[k] + axis[k] * tmax );
+      e1[k] = clampByte( mean[k] + axis[k] * tmin );
+    }
+  }
+
+  //! Least squares fit of the endpoints given the position \p t of each pixel between them (0 = \p e0, 1 = \p e1).
+  //! Pixels with negative \p t are ignored. Returns false if the system is singular.
+  bool fitEndpoints(const PixelBlock& block, const float* t, int channels, float* e0, float* e1)
+  {
+    float aa = 0, ab = 0, bb = 0;
+    float ax[4] = { 0, 0, 0, 0 };
+    float bx[4] = { 0, 0, 0, 0 };
+    for(int i=0; i<16; ++i)
+    {
+      if (t[i] < 0)
+        continue;
+      float a = 1.0f - t[i];
+      float b = t[i];
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      for(int k=0; k<channels; ++k)
+      {
+        ax[k] += a * block.mPixels[i][k];
+        bx[k] += b * block.mPixels[i][k];
+      }
+    }
+    float det = aa * bb - ab * ab;
+    if (fabs(det) < 1e-4f)
+      return false;
+    for(int k=0; k<channels; ++k)
+    {
+      e0[k] = clampByte( ( ax[k] * bb - bx[k] * ab ) / det );
+      e1[k] = clampByte( ( bx[k] * aa - ax[k] * ab ) / det );
+    }
+    return true;
+  }
+
+  //------------------------------------------------------------------------------
+  // BC1 color block, also used by BC2 and BC3
+
+  inline unsigned short packRGB565(int r, int g, int b)
+  {
+    return (unsigned short)( (r << 11) | (g << 5) | b );
+  }
+
+  inline unsigned short packRGB565(const float* c)
+  {
+    return packRGB565( (int)( c[0] * 31.0f / 255.0f + 0.5f ), (int)( c[1] * 63.0f / 255.0f + 0.5f ), (int)( c[2] * 31.0f / 255.0f + 0.5f ) );
+  }
+
+  inline void unpackRGB565(unsigned short c, int* rgb)
+  {
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+  }
+
+  //! A candidate encoding of a color block.
+  struct ColorBlock
+  {
+    unsigned short mColor0;
+    unsigned short mColor1;
+    unsigned char mIndices[16];
+    int mError;
+  };
+
+  //! Computes the indices and the error of the endpoints of \p cb: four colors if mColor0 > mColor1, three colors otherwise.
+  //! The transparent pixels get index 3.
+  void evaluateColorBlock(const PixelBlock& block, const bool* transparent, ColorBlock& cb)
+  {
+    int palette[4][3];
+    unpackRGB565(cb.mColor0, palette[0]);
+    unpackRGB565(cb.mColor1, palette[1]);
+    bool four = cb.mColor0 > cb.mColor1;
+    for(int k=0; k<3; ++k)
+    {
+      if (four)
+      {
+        palette[2][k] = ( 2 * palette[0][k] + palette[1][k] ) / 3;
+        palette[3][k] = ( palette[0][k] + 2 * palette[1][k] ) / 3;
+      }
+      else
+        palette[2][k] = ( palette[0][k] + palette[1][k] ) / 2;
+    }
+    // in the three colors mode index 3 is black or transparent
+    int colors = four ? 4 : 3;
+
+    cb.mError = 0;
+    for(int i=0; i<16; ++i)
+    {
+      if (transparent[i])
+      {
+        cb.mIndices[i] = 3;
+        continue;
+      }
+      int best = 0;
+      int best_dist = squaredDistance(block.mPixels[i], palette[0], 3);
+      for(int j=1; j<colors; ++j)
+      {
+        int dist = squaredDistance(block.mPixels[i], palette[j], 3);
+        if (dist < best_dist)
+        {
+          best = j;
+          best_dist = dist;
+        }
+      }
+      cb.mIndices[i] = (unsigned char)best;
+      cb.mError += best_dist;
+    }
+  }
+
+  //! Orders the endpoints for the four or three colors mode and evaluates them.
+  void makeColorBlock(const PixelBlock& block, const bool* transparent, unsigned short c0, unsigned short c1, bool four, ColorBlock& cb)
+  {
+    if ( four ? c0 < c1 : c0 > c1 )
+      std::swap(c0, c1);
+    cb.mColor0 = c0;
+    cb.mColor1 = c1;
+    evaluateColorBlock(block, transparent, cb);
+  }
+
+  //! Refits the endpoints to the current indices by least squares while the error decreases.
+  void refineColorBlock(const PixelBlock& block, const bool* transparent, bool four, int iterations, ColorBlock& best)
+  {
+    static const float t4[] = { 0.0f, 1.0f, 1.0f/3.0f, 2.0f/3.0f };
+    static const float t3[] = { 0.0f, 1.0f, 0.5f, -1.0f };
+    for(int iter=0; iter<iterations; ++iter)
+    {
+      float t[16];
+      for(int i=0; i<16; ++i)
+        t[i] = transparent[i] ? -1.0f : ( four ? t4 : t3 )[ best.mIndices[i] ];
+      float e0[3], e1[3];
+      if ( !fitEndpoints(block, t, 3, e0, e1) )
+        return;
+      ColorBlock cb;
+      makeColorBlock(block, transparent, packRGB565(e0), packRGB565(e1), four, cb);
+      if (cb.mError >= best.mError)
+        return;
+      best = cb;
+    }
+  }
+
+  //! Greedy search of the 5:6:5 endpoints one step away from the current ones.
+  void searchColorBlock(const PixelBlock& block, const bool* transparent, bool four, ColorBlock& best)
+  {
+    static const int max_value[] = { 31, 63, 31 };
+    for(int round=0; round<8 && best.mError; ++round)
+    {
+      bool improved = false;
+      for(int e=0; e<2; ++e)
+      {
+        for(int k=0; k<3; ++k)
+        {
+          for(int step=-1; step<=1; step+=2)
+          {
+            int c[2][3];
+            for(int j=0; j<2; ++j)
+            {
+              unsigned short color = j ? best.mColor1 : best.mColor0;
+              c[j][0] = (color >> 11) & 31;
+              c[j][1] = (color >> 5) & 63;
+              c[j][2] = color & 31;
+            }
+            c[e][k] += step;
+            if (c[e][k] < 0 || c[e][k] > max_value[k])
+              continue;
+            ColorBlock cb;
+            makeColorBlock(block, transparent, packRGB565(c[0][0], c[0][1], c[0][2]), packRGB565(c[1][0], c[1][1], c[1][2]), four, cb);
+            if (cb.mError < best.mError)
+            {
+              best = cb;
+              improved = true;
+            }
+          }
+        }
+      }
+      if (!improved)
+        return;
+    }
+  }
+
+  //! Encodes the 8 bytes of a color block. The three colors mode is considered only if \p dxt1 is true,
+  //! and is always used when a pixel is transparent.
+  void encodeColorBlock(const PixelBlock& block, const bool* transparent, bool dxt1, ECompressionQuality quality, unsigned char* out)
+  {
+    int opaque = 0;
+    for(int i=0; i<16; ++i)
+      opaque += transparent[i] ? 0 : 1;
+
+    ColorBlock best;
+    if (!opaque)
+    {
+      best.mColor0 = best.mColor1 = 0;
+      memset(best.mIndices, 3, sizeof(best.mIndices));
+    }
+    else
+    {
+      bool four = opaque == 16;
+      int iterations = quality == CQ_High ? 4 : 1;
+      float e0[3], e1[3];
+      initialEndpoints(block, transparent, 3, quality, e0, e1);
+      unsigned short c0 = packRGB565(e0);
+      unsigned short c1 = packRGB565(e1);
+      makeColorBlock(block, transparent, c0, c1, four, best);
+      if (quality != CQ_Fast)
+        refineColorBlock(block, transparent, four, iterations, best);
+      if (quality == CQ_High)
+      {
+        searchColorBlock(block, transparent, four, best);
+        if (four && dxt1)
+        {
+          ColorBlock three;
+          makeColorBlock(block, transparent, c0, c1, false, three);
+          refineColorBlock(block, transparent, false, iterations, three);
+          searchColorBlock(block, transparent, false, three);
+          if (three.mError < best.mError)
+            best = three;
+        }
+      }
+    }
+
+    out[0] = (unsigned char)( best.mColor0 & 0xFF );
+    out[1] = (unsigned char)( best.mColor0 >> 8 );
+    out[2] = (unsigned char)( best.mColor1 & 0xFF );
+    out[3] = (unsigned char)( best.mColor1 >> 8 );
+    for(int i=0; i<4; ++i)
+      out[4+i] = (unsigned char)( best.mIndices[i*4] | (best.mIndices[i*4+1] << 2) | (best.mIndices[i*4+2] << 4) | (best.mIndices[i*4+3] << 6) );
+  }
+
+  //------------------------------------------------------------------------------
+  // BC4 block, also used for the alpha of BC3 and for the two channels of BC5
+
+  //! Computes the indices and the error of a single channel block: eight values if \p a0 > \p a1, six values plus 0 and 255 otherwise.
+  int evaluateAlphaBlock(const int* values, int a0, int a1, unsigned char* indices)
+  {
+    int palette[8];
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+      for(int i=1; i<7; ++i)
+        palette[i+1] = ( (7 - i) * a0 + i * a1 + 3 ) / 7;
+    }
+    else
+    {
+      for(int i=1; i<5; ++i)
+        palette[i+1] = ( (5 - i) * a0 + i * a1 + 2 ) / 5;
+      palette[6] = 0;
+      palette[7] = 255;
+    }
+
+    int error = 0;
+    for(int i=0; i<16; ++i)
+    {
+      int best = 0;
+      int best_dist = (values[i] - palette[0]) * (values[i] - palette[0]);
+      for(int j=1; j<8; ++j)
+      {
+        int dist = (values[i] - palette[j]) * (values[i] - palette[j]);
+        if (dist < best_dist)
+        {
+          best = j;
+          best_dist = dist;
+        }
+      }
+      indices[i] = (unsigned char)best;
+      error += best_dist;
+    }
+    return error;
+  }
+
+  //! Encodes the 8 bytes of a single channel block.
+  void encodeAlphaBlock(const int* values, ECompressionQuality quality, unsigned char* out)
+  {
+    int lo = 255, hi = 0;
+    int inner_lo = 255, inner_hi = 0;
+    for(int i=0; i<16; ++i)
+    {
+      lo = std::min(lo, values[i]);
+      hi = std::max(hi, values[i]);
+      if (values[i] != 0 && values[i] != 255)
+      {
+        inner_lo = std::min(inner_lo, values[i]);
+        inner_hi = std::max(inner_hi, values[i]);
+      }
+    }
+    // without inner values 0 and 255 are the endpoints themselves
+    if (inner_lo > inner_hi)
+    {
+      inner_lo = 0;
+      inner_hi = 255;
+    }
+
+    unsigned char indices[16];
+    unsigned char best_indices[16];
+    int best_a0 = hi;
+    int best_a1 = lo;
+    int best = evaluateAlphaBlock(values, hi, lo, best_indices);
+
+    if (quality != CQ_Fast && best)
+    {
+      // six values mode: 0 and 255 are represented exactly
+      int error = evaluateAlphaBlock(values, inner_lo, inner_hi, indices);
+      if (error < best)
+      {
+        best = error;
+        best_a0 = inner_lo;
+        best_a1 = inner_hi;
+        memcpy(best_indices, indices, sizeof(indices));
+      }
+    }
+
+    if (quality == CQ_High && best)
+    {
+      // shrink the ranges of both modes, the extremes often fall between two values
+      int steps[] = { std::min(8, (hi - lo) / 2), std::min(8, (inner_hi - inner_lo) / 2) };
+      for(int mode=0; mode<2; ++mode)
+      {
+        for(int d0=0; d0<=steps[mode]; ++d0)
+        {
+          for(int d1=0; d1<=steps[mode]; ++d1)
+          {
+            int a0 = mode == 0 ? hi - d0 : inner_lo + d0;
+            int a1 = mode == 0 ? lo + d1 : inner_hi - d1;
+            if ( mode == 0 ? a0 <= a1 : a0 > a1 )
+              continue;
+            int error = evaluateAlphaBlock(values, a0, a1, indices);
+            if (error < best)
+            {
+              best = error;
+              best_a0 = a0;
+              best_a1 = a1;
+              memcpy(best_indices, indices, sizeof(indices));
+            }
+          }
+        }
+      }
+    }
+
+    out[0] = (unsigned char)best_a0;
+    out[1] = (unsigned char)best_a1;
+    for(int i=0; i<2; ++i)
+    {
+      unsigned int bits = 0;
+      for(int j=0; j<8; ++j)
+        bits |= best_indices[i*8+j] << (3*j);
+      out[2+i*3] = (unsigned char)( bits & 0xFF );
+      out[3+i*3] = (unsigned char)( (bits >> 8) & 0xFF );
+      out[4+i*3] = (unsigned char)( (bits >> 16) & 0xFF );
+    }
+  }
+
+  //------------------------------------------------------------------------------
+  // BC7 mode 6 block: one subset, 7 bit RGBA endpoints with a p bit each, 4 bit indices
+
+  //! A candidate encoding of a BC7 mode 6 block.
+  struct BPTCBlock
+  {
+    int mEndpoints[2][4];
+    int mPBits[2];
+    unsigned char mIndices[16];
+    int mError;
+  };
+
+  //! Computes the indices and the error of the endpoints of \p b.
+  void evaluateBPTCBlock(const PixelBlock& block, BPTCBlock& b)
+  {
+    static const int weights[] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    int palette[16][4];
+    for(int k=0; k<4; ++k)
+    {
+      int e0 = (b.mEndpoints[0][k] << 1) | b.mPBits[0];
+      int e1 = (b.mEndpoints[1][k] << 1) | b.mPBits[1];
+      for(int i=0; i<16; ++i)
+        palette[i][k] = ( (64 - weights[i]) * e0 + weights[i] * e1 + 32 ) >> 6;
+    }
+
+    b.mError = 0;
+    for(int i=0; i<16; ++i)
+    {
+      int best = 0;
+      int best_dist = squaredDistance(block.mPixels[i], palette[0], 4);
+      for(int j=1; j<16; ++j)
+      {
+        int dist = squaredDistance(block.mPixels[i], palette[j], 4);
+        if (dist < best_dist)
+        {
+          best = j;
+          best_dist = dist;
+        }
+      }
+      b.mIndices[i] = (unsigned char)best;
+      b.mError += best_dist;
+    }
+  }
+
+  //! Quantizes an endpoint to 7 bits plus the p bit \p pbit, or plus the p bit closest to the endpoint if \p pbit is negative.
+  void quantizeBPTCEndpoint(const float* e, int pbit, int* q, int& p)
+  {
+    int best_dist = -1;
+    for(int bit=0; bit<2; ++bit)
+    {
+      if (pbit >= 0 && bit != pbit)
+        continue;
+      int c[4];
+      int dist = 0;
+      for(int k=0; k<4; ++k)
+      {
+        c[k] = std::max( 0, std::min( 127, (int)floor( ( e[k] - bit ) / 2.0f + 0.5f ) ) );
+        float d = e[k] - (float)( (c[k] << 1) | bit );
+        dist += (int)( d * d );
+      }
+      if (best_dist < 0 || dist < best_dist)
+      {
+        best_dist = dist;
+        p = bit;
+        memcpy(q, c, sizeof(c));
+      }
+    }
+  }
+
+  void makeBPTCBlock(const PixelBlock& block, const float* e0, const float* e1, int pbit, BPTCBlock& b)
+  {
+    quantizeBPTCEndpoint(e0, pbit, b.mEndpoints[0], b.mPBits[0]);
+    quantizeBPTCEndpoint(e1, pbit, b.mEndpoints[1], b.mPBits[1]);
+    evaluateBPTCBlock(block, b);
+  }
+
+  inline void writeBits(unsigned char* out, int& pos, int value, int bits)
+  {
+    for(int i=0; i<bits; ++i, ++pos)
+      if ( value & (1 << i) )
+        out[pos >> 3] |= (unsigned char)( 1 << (pos & 7) );
+  }
+
+  //! Encodes the 16 bytes of a BC7 block using mode 6.
+  void encodeBPTCBlock(const PixelBlock& block, ECompressionQuality quality, unsigned char* out)
+  {
+    static const bool skip[16] = { false };
+    // opaque blocks keep an alpha of exactly 255 using p bits equal to 1
+    int pbit = 1;
+    for(int i=0; i<16; ++i)
+      if (block.mPixels[i][3] != 255)
+        pbit = -1;
+
+    float e0[4], e1[4];
+    initialEndpoints(block, skip, 4, quality, e0, e1);
+    BPTCBlock best;
+    makeBPTCBlock(block, e0, e1, pbit, best);
+
+    if (quality != CQ_Fast)
+    {
+      for(int iter=0, iterations = quality == CQ_High ? 4 : 1; iter<iterations && best.mError; ++iter)
+      {
+        float t[16];
+        for(int i=0; i<16; ++i)
+          t[i] = best.mIndices[i] / 15.0f;
+        if ( !fitEndpoints(block, t, 4, e0, e1) )
+          break;
+        BPTCBlock b;
+        makeBPTCBlock(block, e0, e1, pbit, b);
+        if (b.mError >= best.mError)
+          break;
+        best = b;
+      }
+    }
+
+    if (quality == CQ_High)
+    {
+      // greedy search of the endpoints and of the p bits one step away from the current ones
+      for(int round=0; round<8 && best.mError; ++round)
+      {
+        bool improved = false;
+        for(int e=0; e<2; ++e)
+        {
+          for(int k=0; k<5; ++k)
+          {
+            for(int step=-1; step<=1; step+=2)
+            {
+              BPTCBlock b = best;
+              if (k == 4)
+              {
+                if (pbit >= 0 || step > 0)
+                  continue;
+                b.mPBits[e] ^= 1;
+              }
+              else
+              {
+                b.mEndpoints[e][k] += step;
+                if (b.mEndpoints[e][k] < 0 || b.mEndpoints[e][k] > 127)
+                  continue;
+              }
+              evaluateBPTCBlock(block, b);
+              if (b.mError < best.mError)
+              {
+                best = b;
+                improved = true;
+              }
+            }
+          }
+        }
+        if (!improved)
+          break;
+      }
+    }
+
+    // the most significant bit of the first index is implicitly 0
+    if (best.mIndices[0] & 8)
+    {
+      for(int k=0; k<4; ++k)
+        std::swap(best.mEndpoints[0][k], best.mEndpoints[1][k]);
+      std::swap(best.mPBits[0], best.mPBits[1]);
+      for(int i=0; i<16; ++i)
+        best.mIndices[i] = (unsigned char)( 15 - best.mIndices[i] );
+    }
+
+    memset(out, 0, 16);
+    int pos = 0;
+    writeBits(out, pos, 1 << 6, 7);
+    for(int k=0; k<4; ++k)
+    {
+      writeBits(out, pos, best.mEndpoints[0][k], 7);
+      writeBits(out, pos, best.mEndpoints[1][k], 7);
+    }
+    writeBits(out, pos, best.mPBits[0], 1);
+    writeBits(out, pos, best.mPBits[1], 1);
+    writeBits(out, pos, best.mIndices[0], 3);
+    for(int i=1; i<16; ++i)
+      writeBits(out, pos, best.mIndices[i], 4);
+  }
+
+  //------------------------------------------------------------------------------
+
+  inline int blockBytes(EImageFormat format)
+  {
+    return format == IF_COMPRESSED_RGB_S3TC_DXT1 || format == IF_COMPRESSED_RGBA_S3TC_DXT1 || format == IF_COMPRESSED_RED_RGTC1 ? 8 : 16;
+  }
+
+  void encodeBlock(const PixelBlock& block, EImageFormat format, ECompressionQuality quality, unsigned char* out)
+  {
+    bool transparent[16];
+    int values[16];
+    switch(format)
+    {
+    case IF_COMPRESSED_RGB_S3TC_DXT1:
+    case IF_COMPRESSED_RGBA_S3TC_DXT1:
+      for(int i=0; i<16; ++i)
+        transparent[i] = format == IF_COMPRESSED_RGBA_S3TC_DXT1 && block.mPixels[i][3] < 128;
+      encodeColorBlock(block, transparent, true, quality, out);
+      break;
+
+    case IF_COMPRESSED_RGBA_S3TC_DXT3:
+      for(int i=0; i<8; ++i)
+        out[i] = (unsigned char)( ( block.mPixels[i*2][3] * 15 + 127 ) / 255 | ( ( block.mPixels[i*2+1][3] * 15 + 127 ) / 255 ) << 4 );
+      memset(transparent, 0, sizeof(transparent));
+      encodeColorBlock(block, transparent, false, quality, out + 8);
+      break;
+
+    case IF_COMPRESSED_RGBA_S3TC_DXT5:
+      for(int i=0; i<16; ++i)
+        values[i] = block.mPixels[i][3];
+      encodeAlphaBlock(values, quality, out);
+      memset(transparent, 0, sizeof(transparent));
+      encodeColorBlock(block, transparent, false, quality, out + 8);
+      break;
+
+    case IF_COMPRESSED_RED_RGTC1:
+    case IF_COMPRESSED_RED_GREEN_RGTC2:
+      for(int c=0, channels = format == IF_COMPRESSED_RED_RGTC1 ? 1 : 2; c<channels; ++c)
+      {
+        for(int i=0; i<16; ++i)
+          values[i] = block.mPixels[i][c];
+        encodeAlphaBlock(values, quality, out + c * 8);
+      }
+      break;
+
+    case IF_COMPRESSED_RGBA_BPTC_UNORM:
+      encodeBPTCBlock(block, quality, out);
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  //! Encodes the rows of 4x4 blocks of an IF_RGBA / IT_UNSIGNED_BYTE image, one row of blocks of one slice or face per item.
+  class CompressBlocksTask: public ParallelForTask
+  {
+  public:
+    CompressBlocksTask(const Image* src, Image* dst, ECompressionQuality quality): mSource(src), mDest(dst), mQuality(quality)
+    {
+      mWidth = src->width();
+      mHeight = std::max(1, src->height());
+      mBlocksX = (mWidth + 3) / 4;
+      mBlocksY = (mHeight + 3) / 4;
+      mBlockBytes = blockBytes(dst->format());
+    }
+
+    int rowCount() const { return mBlocksY * ( mSource->isCubemap() ? 6 : std::max(1, mSource->depth()) ); }
+
+    void runRange(int begin, int end)
+    {
+      PixelBlock block;
+      for(int row=begin; row<end; ++row)
+      {
+        int layer = row / mBlocksY;
+        int by = row % mBlocksY;
+        const unsigned char* src = mSource->pixels() + (size_t)layer * mSource->pitch() * mHeight;
+        unsigned char* dst = mDest->pixels() + (size_t)row * mBlocksX * mBlockBytes;
+        for(int bx=0; bx<mBlocksX; ++bx, dst += mBlockBytes)
+        {
+          for(int i=0; i<16; ++i)
+          {
+            int x = std::min( bx * 4 + (i & 3), mWidth - 1 );
+            int y = std::min( by * 4 + (i >> 2), mHeight - 1 );
+            const unsigned char* px = src + y * mSource->pitch() + x * 4;
+            for(int k=0; k<4; ++k)
+              block.mPixels[i][k] = px[k];
+          }
+          encodeBlock(block, mDest->format(), mQuality, dst);
+        }
+      }
+    }
+
+  protected:
+    const Image* mSource;
+    Image* mDest;
+    ECompressionQuality mQuality;
+    int mWidth;
+    int mHeight;
+    int mBlocksX;
+    int mBlocksY;
+    int mBlockBytes;
+  };
+
+  //! Compresses a single image, its mipmaps are ignored.
+  ref<Image> compressLevel(const Image* img, EImageFormat format, ECompressionQuality quality)
+  {
+    const Image* rgba = img;
+    ref<Image> converted;
+    if (rgba->type() != IT_UNSIGNED_BYTE)
+    {
+      converted = rgba->convertType(IT_UNSIGNED_BYTE);
+      rgba = converted.get();
+      if (!rgba)
+        return NULL;
+    }
+    if (rgba->format() != IF_RGBA)
+    {
+      converted = rgba->convertFormat(IF_RGBA);
+      rgba = converted.get();
+      if (!rgba)
+        return NULL;
+    }
+
+    ref<Image> out = allocateLike(img, img->width(), img->height(), img->depth(), format, IT_IMPLICIT_TYPE, 1);
+    if (format == IF_COMPRESSED_RGB_S3TC_DXT1 || format == IF_COMPRESSED_RED_RGTC1 || format == IF_COMPRESSED_RED_GREEN_RGTC2)
+      out->setHasAlpha(false);
+
+    CompressBlocksTask task(rgba, out.get(), quality);
+    parallelFor( 0, task.rowCount(), &task, 1 );
+    return out;
+  }
+}
+//-----------------------------------------------------------------------------
+ref<Image> Image::compress(EImageFormat format, ECompressionQuality quality) const
+{
+  if ( !isCompressedFormat(format) )
+  {
+    Log::error("Image::compress(): unsupported format. Formats supported are the S3TC (BC1-BC3), RGTC (BC4-BC5) and BPTC (BC7) ones.\n");
+    return NULL;
+  }
+
+  if ( isCompressedFormat(this->format()) )
+  {
+    Log::error("Image::compress(): the image is already compressed.\n");
+    return NULL;
+  }
+
+  if ( dimension() == ID_1D )
+  {
+    Log::error("Image::compress(): 1D images cannot be block-compressed.\n");
+    return NULL;
+  }
+
+  ref<Image> img = compressLevel(this, format, quality);
+  if (!img)
+    return NULL;
+
+  for(size_t i=0; i<mipmaps().size(); ++i)
+  {
+    ref<Image> mip = compressLevel(mipmaps()[i].get(), format, quality);
+    if (!mip)
+      return NULL;
+    img->mipmaps().push_back(mip);
   }
 
   return img;
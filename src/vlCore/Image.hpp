@@ -201,7 +201,7 @@ namespace vl
     
     EImageType type() const { return mType; }
     
-    int isCompressedFormat(EImageFormat fmt);
+    static int isCompressedFormat(EImageFormat fmt);
 
     void flipVertically();
 
@@ -229,6 +229,8 @@ namespace vl
      * - IF_LUMINANCE
      * - IF_LUMINANCE_ALPHA
      * - IF_DEPTH_COMPONENT
+     *
+     * The rows of the image are converted in parallel, see parallelFor().
     */
     ref<Image> convertType(EImageType new_type) const;
 
@@ -255,9 +257,49 @@ namespace vl
      * - IF_ALPHA
      * - IF_LUMINANCE
      * - IF_LUMINANCE_ALPHA
+     *
+     * The rows of the image are converted in parallel, see parallelFor().
      */
     ref<Image> convertFormat(EImageFormat new_format) const;
 
+    //! Multiplies the color components by the alpha component. Returns false if the image format() or type() is not supported. This function supports both 3D images and cubemaps.
+    bool premultiplyAlpha();
+
+    /**
+     * Returns a copy of the image resized with a separable \p filter, or NULL if the image format() or type() is not supported.
+     *
+     * The new size must keep the dimension() of the image: \p new_height must be 0 for 1D images and \p new_depth must be 0
+     * for 1D, 2D and cubemap images. The faces of a cubemap are resized independently.
+     * If \p srgb is true the color components are filtered in linear space, which avoids the darkening of the sRGB encoded images.
+     * Types supported are IT_UNSIGNED_BYTE, IT_UNSIGNED_SHORT and IT_FLOAT with up to 4 components. The rows are processed in parallel, see parallelFor().
+     */
+    ref<Image> resample(int new_width, int new_height, int new_depth, EResampleFilter filter=RF_Lanczos, bool srgb=false) const;
+
+    /**
+     * Replaces the mipmaps() of the image with the full mipmap chain down to 1x1(x1), each level being filtered from the previous one.
+     * Supports 1D, 2D, 3D and cubemap images, see resample() for the supported formats and the meaning of \p srgb.
+     * Returns false if the image format() or type() is not supported.
+     */
+    bool generateMipmaps(EResampleFilter filter=RF_Box, bool srgb=false);
+
+    /**
+     * Returns a copy of the image and of its mipmaps() encoded in the block-compressed \p format, or NULL if the conversion is not possible.
+     *
+     * \p format must be one of the following:
+     * - IF_COMPRESSED_RGB_S3TC_DXT1 (BC1)
+     * - IF_COMPRESSED_RGBA_S3TC_DXT1 (BC1 with 1 bit alpha, the pixels with alpha below 0.5 become transparent)
+     * - IF_COMPRESSED_RGBA_S3TC_DXT3 (BC2)
+     * - IF_COMPRESSED_RGBA_S3TC_DXT5 (BC3)
+     * - IF_COMPRESSED_RED_RGTC1 (BC4, encodes the red or luminance component)
+     * - IF_COMPRESSED_RED_GREEN_RGTC2 (BC5, encodes the red and green components, for example of a normal map)
+     * - IF_COMPRESSED_RGBA_BPTC_UNORM (BC7, only mode 6 blocks are generated)
+     *
+     * The image must not be compressed and must be convertible to IF_RGBA and IT_UNSIGNED_BYTE with convertFormat() and convertType().
+     * 2D, 3D and cubemap images are supported, 3D images are encoded slice by slice.
+     * The 4x4 blocks are encoded in parallel, see parallelFor(). Use saveDDS() to store the result on disk.
+     */
+    ref<Image> compress(EImageFormat format, ECompressionQuality quality=CQ_Normal) const;
+
     //! Equalizes the image. Returns false if the image format() or type() is not supported. This function supports both 3D images and cubemaps.
     bool equalize();
 
@@ -117,6 +117,25 @@ ref<ResourceDatabase> LoadWriterManager::loadResource(VirtualFile* file, bool qu
   }
 }
 //-----------------------------------------------------------------------------
+ref<ResourceLoadJob> LoadWriterManager::loadResourcesAsync(const std::vector<String>& paths, bool quick, int thread_count) const
+{
+  return new ResourceLoadJob(this, paths, quick, thread_count);
+}
+//-----------------------------------------------------------------------------
+ref<ResourceLoadJob> LoadWriterManager::loadResourcesAsync(const std::vector< ref<VirtualFile> >& files, bool quick, int thread_count) const
+{
+  return new ResourceLoadJob(this, files, quick, thread_count);
+}
+//-----------------------------------------------------------------------------
+void LoadWriterManager::loadResources(const std::vector<String>& paths, std::vector< ref<ResourceDatabase> >& dbs, bool quick, int thread_count) const
+{
+  ref<ResourceLoadJob> job = loadResourcesAsync(paths, quick, thread_count);
+  job->wait();
+  dbs.resize(paths.size());
+  for(size_t i=0; i<paths.size(); ++i)
+    dbs[i] = job->result((int)i);
+}
+//-----------------------------------------------------------------------------
 bool LoadWriterManager::writeResource(const String& path, ResourceDatabase* resource) const
 {
   const ResourceLoadWriter* loadwriter = findWriter(path);
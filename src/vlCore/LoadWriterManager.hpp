@@ -34,6 +34,7 @@
 
 #include <vlCore/ResourceLoadWriter.hpp>
 #include <vlCore/ResourceDatabase.hpp>
+#include <vlCore/ResourceLoadJob.hpp>
 #include <vlCore/VirtualFile.hpp>
 #include <vlCore/MemoryFile.hpp>
 #include <vlCore/VisualizationLibrary.hpp>
@@ -118,6 +119,17 @@ namespace vl
     //! Loads the resource specified by the given file using the appropriate ResourceLoadWriter.
     ref<ResourceDatabase> loadResource(VirtualFile* file, bool quick=true) const;
 
+    //! Starts loading the given resources on up to \p thread_count threads (parallelThreadCount() if <= 0) and returns immediately.
+    //! See ResourceLoadJob for how to collect the results and for the thread-safety requirements.
+    ref<ResourceLoadJob> loadResourcesAsync(const std::vector<String>& paths, bool quick=true, int thread_count=0) const;
+
+    //! Starts loading the given files on up to \p thread_count threads (parallelThreadCount() if <= 0) and returns immediately.
+    //! See ResourceLoadJob for how to collect the results and for the thread-safety requirements.
+    ref<ResourceLoadJob> loadResourcesAsync(const std::vector< ref<VirtualFile> >& files, bool quick=true, int thread_count=0) const;
+
+    //! Loads the given resources concurrently and waits for them: \p dbs[i] is the resource loaded from \p paths[i], NULL on failure.
+    void loadResources(const std::vector<String>& paths, std::vector< ref<ResourceDatabase> >& dbs, bool quick=true, int thread_count=0) const;
+
     //! Writes the resource specified by the given file using the appropriate ResourceLoadWriter.
     bool writeResource(const String& path, ResourceDatabase* resource) const;
 
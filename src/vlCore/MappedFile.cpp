@@ -0,0 +1,253 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlCore/MappedFile.hpp>
+#include <vlCore/DiskFile.hpp>
+#include <string.h>
+#include <limits>
+
+#if defined(__GNUG__) && !defined(VL_PLATFORM_WINDOWS)
+  #include <sys/types.h>
+  #include <sys/stat.h>
+  #include <sys/mman.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+// MappedFile
+//-----------------------------------------------------------------------------
+MappedFile::MappedFile(const String& path)
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    mHandle  = INVALID_HANDLE_VALUE;
+    mMapping = NULL;
+  #endif
+  mData     = NULL;
+  mSize     = 0;
+  mPosition = 0;
+  mIsOpen   = false;
+  setPath(path);
+}
+//-----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+  close();
+}
+//-----------------------------------------------------------------------------
+bool MappedFile::open(EOpenMode mode)
+{
+  if ( isOpen() )
+  {
+    Log::error("MappedFile::open(): file already open.\n");
+    return false;
+  }
+
+  if (mode != OM_ReadOnly)
+  {
+    Log::error( Say("MappedFile::open(): file '%s' can only be opened in read-only mode.\n") << path() );
+    return false;
+  }
+
+#if defined(VL_PLATFORM_WINDOWS)
+  mHandle = CreateFile( (const wchar_t*)path().ptr(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+  if (mHandle == INVALID_HANDLE_VALUE)
+  {
+    Log::error( Say("MappedFile::open(): error opening input file '%s'\n") << path() );
+    return false;
+  }
+  LARGE_INTEGER file_size;
+  if ( !GetFileSizeEx(mHandle, &file_size) )
+  {
+    Log::error( Say("MappedFile::open(): could not query the size of '%s'\n") << path() );
+    CloseHandle(mHandle);
+    mHandle = INVALID_HANDLE_VALUE;
+    return false;
+  }
+  mSize = file_size.QuadPart;
+  // files larger than the address space cannot be mapped as a whole
+  if ( (unsigned long long)mSize > (unsigned long long)std::numeric_limits<size_t>::max() )
+  {
+    Log::error( Say("MappedFile::open(): file '%s' is too large to be mapped\n") << path() );
+    CloseHandle(mHandle);
+    mHandle = INVALID_HANDLE_VALUE;
+    mSize = 0;
+    return false;
+  }
+  // empty files cannot be mapped
+  if (mSize)
+  {
+    mMapping = CreateFileMapping( mHandle, NULL, PAGE_READONLY, 0, 0, NULL );
+    mData = mMapping ? (const unsigned char*)MapViewOfFile( mMapping, FILE_MAP_READ, 0, 0, 0 ) : NULL;
+    if (!mData)
+    {
+      Log::error( Say("MappedFile::open(): could not map file '%s'\n") << path() );
+      if (mMapping)
+        CloseHandle(mMapping);
+      CloseHandle(mHandle);
+      mMapping = NULL;
+      mHandle = INVALID_HANDLE_VALUE;
+      return false;
+    }
+  }
+#elif defined(__GNUG__)
+  // encode to utf8 for linux
+  std::vector<unsigned char> utf8;
+  path().toUTF8( utf8, false );
+  int fd = utf8.empty() ? -1 : ::open( (char*)&utf8[0], O_RDONLY );
+  if (fd == -1)
+  {
+    Log::error( Say("MappedFile::open(): error opening input file '%s'\n") << path() );
+    return false;
+  }
+  struct stat mybuf;
+  memset(&mybuf, 0, sizeof(struct stat));
+  if (fstat(fd, &mybuf) == -1)
+  {
+    Log::error( Say("MappedFile::open(): could not query the size of '%s'\n") << path() );
+    ::close(fd);
+    return false;
+  }
+  mSize = (long long)mybuf.st_size;
+  // files larger than the address space cannot be mapped as a whole
+  if ( (unsigned long long)mSize > (unsigned long long)std::numeric_limits<size_t>::max() )
+  {
+    Log::error( Say("MappedFile::open(): file '%s' is too large to be mapped\n") << path() );
+    ::close(fd);
+    mSize = 0;
+    return false;
+  }
+  // empty files cannot be mapped
+  if (mSize)
+  {
+    void* ptr = mmap( NULL, (size_t)mSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if (ptr == MAP_FAILED)
+    {
+      Log::error( Say("MappedFile::open(): could not map file '%s'\n") << path() );
+      ::close(fd);
+      mSize = 0;
+      return false;
+    }
+    mData = (const unsigned char*)ptr;
+  }
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+#endif
+
+  mPosition = 0;
+  mIsOpen = true;
+  return true;
+}
+//-----------------------------------------------------------------------------
+void MappedFile::close()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    if (mData)
+      UnmapViewOfFile(mData);
+    if (mMapping)
+      CloseHandle(mMapping);
+    if (mHandle != INVALID_HANDLE_VALUE)
+      CloseHandle(mHandle);
+    mMapping = NULL;
+    mHandle  = INVALID_HANDLE_VALUE;
+  #elif defined(__GNUG__)
+    if (mData)
+      munmap( (void*)mData, (size_t)mSize );
+  #endif
+  mData     = NULL;
+  mSize     = 0;
+  mPosition = 0;
+  mIsOpen   = false;
+}
+//-----------------------------------------------------------------------------
+long long MappedFile::size() const
+{
+  if (isOpen())
+    return mSize;
+  else
+    return DiskFile(path()).size();
+}
+//-----------------------------------------------------------------------------
+bool MappedFile::exists() const
+{
+  return DiskFile(path()).exists();
+}
+//-----------------------------------------------------------------------------
+long long MappedFile::read_Implementation(void* buffer, long long byte_count)
+{
+  if (!isOpen())
+  {
+    Log::error("MappedFile::read_Implementation() called on closed file!\n");
+    return 0;
+  }
+
+  long long bytes = mSize - mPosition;
+  bytes = byte_count < bytes ? byte_count : bytes;
+  if (bytes <= 0)
+    return 0;
+  memcpy( buffer, mData + mPosition, (size_t)bytes );
+  mPosition += bytes;
+  return bytes;
+}
+//-----------------------------------------------------------------------------
+long long MappedFile::position_Implementation() const
+{
+  if (!isOpen())
+  {
+    Log::error("MappedFile::position_Implementation() called on closed file!\n");
+    return -1;
+  }
+  return mPosition;
+}
+//-----------------------------------------------------------------------------
+bool MappedFile::seekSet_Implementation(long long offset)
+{
+  if (!isOpen())
+  {
+    Log::error("MappedFile::seekSet_Implementation() called on closed file!\n");
+    return false;
+  }
+
+  if (offset < 0 || offset > mSize)
+    return false;
+  mPosition = offset;
+  return true;
+}
+//-----------------------------------------------------------------------------
+ref<VirtualFile> MappedFile::clone() const
+{
+  ref<MappedFile> file = new MappedFile;
+  file->operator=(*this);
+  return file;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,125 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef MappedFile_INCLUDE_ONCE
+#define MappedFile_INCLUDE_ONCE
+
+#include <vlCore/VirtualFile.hpp>
+
+namespace vl
+{
+//---------------------------------------------------------------------------
+// MappedFile
+//---------------------------------------------------------------------------
+  /**
+   * A read-only VirtualFile that maps a regular disk file in memory.
+   *
+   * Once the file is open its whole content is accessible via mappedData() without copying
+   * it into user buffers: loaders can parse it straight from the mapping. The mapping is valid until the
+   * file is closed. The usual read() and seek functions are also available and operate on the mapped memory.
+   * Use DiskDirectory::mappedFile() and FileSystem::locateMappedFile() to obtain a MappedFile.
+   *
+   * \sa
+   * - VirtualDirectory
+   * - DiskDirectory
+   * - MemoryDirectory
+   * - ZippedDirectory
+   * - FileSystem
+   * - VirtualFile
+   * - DiskFile
+   * - MemoryFile
+   * - ZippedFile
+  */
+  class VLCORE_EXPORT MappedFile: public VirtualFile
+  {
+    VL_INSTRUMENT_CLASS(vl::MappedFile, VirtualFile)
+
+  protected:
+    //! Copies the path, the copy is not open.
+    MappedFile(const MappedFile& other): VirtualFile(other)
+    {
+      #if defined(VL_PLATFORM_WINDOWS)
+        mHandle  = INVALID_HANDLE_VALUE;
+        mMapping = NULL;
+      #endif
+      mData     = NULL;
+      mSize     = 0;
+      mPosition = 0;
+      mIsOpen   = false;
+    }
+
+  public:
+    MappedFile(const String& path = String());
+
+    ~MappedFile();
+
+    //! Only OM_ReadOnly is supported.
+    virtual bool open(EOpenMode mode);
+
+    virtual bool isOpen() const { return mIsOpen; }
+
+    virtual void close();
+
+    //! Returns the file size in bytes or -1 on error.
+    virtual long long size() const;
+
+    virtual bool exists() const;
+
+    //! Returns the mapped content of the file, NULL if the file is not open or is empty.
+    virtual const unsigned char* mappedData() const { return mData; }
+
+    MappedFile& operator=(const MappedFile& other) { close(); super::operator=(other); return *this; }
+
+    virtual ref<VirtualFile> clone() const;
+
+  protected:
+    virtual long long read_Implementation(void* buffer, long long byte_count);
+
+    //! Writing is not supported.
+    virtual long long write_Implementation(const void* /*buffer*/, long long /*byte_count*/) { return 0; }
+
+    virtual long long position_Implementation() const;
+
+    virtual bool seekSet_Implementation(long long offset);
+
+  protected:
+    #if defined(VL_PLATFORM_WINDOWS)
+      HANDLE mHandle;
+      HANDLE mMapping;
+    #endif
+    const unsigned char* mData;
+    long long mSize;
+    long long mPosition;
+    bool mIsOpen;
+  };
+}
+
+#endif
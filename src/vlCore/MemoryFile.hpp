@@ -82,6 +82,9 @@ namespace vl
 
     virtual long long size() const { return mBuffer->bytesUsed(); }
 
+    //! Returns the content of the buffer while the file is open.
+    virtual const unsigned char* mappedData() const { return mIsOpen && mBuffer->bytesUsed() ? mBuffer->ptr() : NULL; }
+
     //! Copies the data of any kind of VirtualFile
     void copy(VirtualFile* file);
 
@@ -0,0 +1,239 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlCore/ResourceLoadJob.hpp>
+#include <vlCore/LoadWriterManager.hpp>
+#include <vlCore/FileSystem.hpp>
+#include <vlCore/DiskDirectory.hpp>
+#include <vlCore/MappedFile.hpp>
+#include <vlCore/ScopedMutex.hpp>
+#include <vlCore/VLXRegistry.hpp>
+#include <vlCore/Log.hpp>
+
+using namespace vl;
+
+namespace
+{
+  //! Installed as Log::logMutex() if the user did not install one.
+  Mutex gLogMutex;
+
+  //! Installed as the refCountMutex() of defVLXRegistry() if the user did not install one.
+  Mutex gVLXRegistryMutex;
+
+  //! Returns a String which does not share its data with \p str, see String copy-on-write.
+  String deepCopy(const String& str) { return String(str.ptr()); }
+}
+//-----------------------------------------------------------------------------
+// ResourceLoadJob::Worker
+//-----------------------------------------------------------------------------
+class ResourceLoadJob::Worker: public Thread
+{
+public:
+  Worker(ResourceLoadJob* job): mJob(job) {}
+  virtual void run() { mJob->work(false); }
+
+private:
+  ResourceLoadJob* mJob;
+};
+//-----------------------------------------------------------------------------
+// ResourceLoadJob
+//-----------------------------------------------------------------------------
+ResourceLoadJob::ResourceLoadJob(const LoadWriterManager* manager, const std::vector<String>& paths, bool quick, int thread_count)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mManager = manager;
+  // the paths must not share their data with the caller's strings
+  mPaths.resize(paths.size());
+  for(size_t i=0; i<paths.size(); ++i)
+    mPaths[i] = deepCopy(paths[i]);
+  mQuick = quick;
+  start(thread_count);
+}
+//-----------------------------------------------------------------------------
+ResourceLoadJob::ResourceLoadJob(const LoadWriterManager* manager, const std::vector< ref<VirtualFile> >& files, bool quick, int thread_count)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mManager = manager;
+  mFiles = files;
+  mPaths.resize(files.size());
+  for(size_t i=0; i<files.size(); ++i)
+  {
+    // the files are read by the loading threads: their paths must not share data with the caller's strings
+    if (mFiles[i])
+      mFiles[i]->setPath( deepCopy(mFiles[i]->path()) );
+    mPaths[i] = deepCopy( files[i] ? files[i]->path() : String() );
+    // files sharing data with other files are not loaded concurrently
+    if ( files[i] && !files[i]->as<DiskFile>() && !files[i]->as<MappedFile>() && !files[i]->as<MemoryFile>() )
+      thread_count = 1;
+  }
+  mQuick = quick;
+  start(thread_count);
+}
+//-----------------------------------------------------------------------------
+ResourceLoadJob::~ResourceLoadJob()
+{
+  wait();
+}
+//-----------------------------------------------------------------------------
+void ResourceLoadJob::start(int thread_count)
+{
+  mResults.resize(mPaths.size());
+  mDone.resize(mPaths.size(), 0);
+  mCompleted.reserve(mPaths.size());
+  mNext = 0;
+  mDispatched = 0;
+
+  if (!Log::logMutex())
+    Log::setLogMutex(&gLogMutex);
+
+  // every VLXSerializer takes a reference to the default registry
+  if (defVLXRegistry() && !defVLXRegistry()->refCountMutex())
+    defVLXRegistry()->setRefCountMutex(&gVLXRegistryMutex);
+
+  // the files handed out by non-disk directories share their data: load one resource at a time
+  const std::vector< ref<VirtualDirectory> >& dirs = defFileSystem()->directories();
+  for(size_t i=0; i<dirs.size(); ++i)
+    if (!dirs[i]->as<DiskDirectory>())
+      thread_count = 1;
+
+  if (thread_count <= 0)
+    thread_count = parallelThreadCount();
+  thread_count = std::min( thread_count, count() );
+  for(int i=0; i<thread_count; ++i)
+  {
+    ref<Worker> worker = new Worker(this);
+    if (worker->start())
+      mWorkers.push_back(worker);
+  }
+  // load on the calling thread if no thread could be started
+  if (mWorkers.empty())
+    work(false);
+}
+//-----------------------------------------------------------------------------
+bool ResourceLoadJob::work(bool only_one)
+{
+  bool loaded = false;
+  for(;;)
+  {
+    int i;
+    {
+      ScopedMutex lock(&mMutex);
+      if (mNext >= count())
+        return loaded;
+      i = mNext++;
+    }
+    load(i);
+    loaded = true;
+    if (only_one)
+      return loaded;
+  }
+}
+//-----------------------------------------------------------------------------
+void ResourceLoadJob::load(int i)
+{
+  // mPaths[i] is also read by the calling thread, the loaders work on a private copy
+  const String path = deepCopy(mPaths[i]);
+  ref<ResourceDatabase> db;
+  if (mFiles.empty())
+    db = mManager->loadResource(path, mQuick);
+  else
+  if (mFiles[i])
+    db = mManager->loadResource(mFiles[i].get(), mQuick);
+  if (!db)
+    Log::error( Say("ResourceLoadJob: could not load '%s'.\n") << path );
+
+  ScopedMutex lock(&mMutex);
+  mResults[i] = db;
+  db = NULL;
+  mDone[i] = 1;
+  mCompleted.push_back(i);
+  mCompletedCondition.notifyAll();
+}
+//-----------------------------------------------------------------------------
+bool ResourceLoadJob::isDone(int i) const
+{
+  ScopedMutex lock(&mMutex);
+  return mDone[i] != 0;
+}
+//-----------------------------------------------------------------------------
+int ResourceLoadJob::doneCount() const
+{
+  ScopedMutex lock(&mMutex);
+  return (int)mCompleted.size();
+}
+//-----------------------------------------------------------------------------
+ResourceDatabase* ResourceLoadJob::result(int i)
+{
+  // help loading the pending resources while waiting
+  while( !isDone(i) )
+  {
+    if ( threadCount() > 1 && work(true) )
+      continue;
+    ScopedMutex lock(&mMutex);
+    while( !mDone[i] )
+      mCompletedCondition.wait(&mMutex);
+  }
+  return mResults[i].get();
+}
+//-----------------------------------------------------------------------------
+void ResourceLoadJob::wait()
+{
+  if (threadCount() > 1)
+    work(false);
+  for(size_t i=0; i<mWorkers.size(); ++i)
+    mWorkers[i]->join();
+}
+//-----------------------------------------------------------------------------
+int ResourceLoadJob::dispatch(LoadCompletedCallback* callback, bool wait_all)
+{
+  int dispatched = 0;
+  for(;;)
+  {
+    int end;
+    {
+      ScopedMutex lock(&mMutex);
+      end = (int)mCompleted.size();
+    }
+    for( ; mDispatched < end; ++mDispatched, ++dispatched )
+    {
+      int i = mCompleted[mDispatched];
+      callback->operator()(i, mPaths[i], mResults[i].get());
+    }
+    if ( !wait_all || mDispatched == count() )
+      return dispatched;
+    if ( threadCount() > 1 && work(true) )
+      continue;
+    ScopedMutex lock(&mMutex);
+    while( (int)mCompleted.size() == mDispatched )
+      mCompletedCondition.wait(&mMutex);
+  }
+}
+//-----------------------------------------------------------------------------
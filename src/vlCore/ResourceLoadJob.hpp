@@ -0,0 +1,156 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef ResourceLoadJob_INCLUDE_ONCE
+#define ResourceLoadJob_INCLUDE_ONCE
+
+#include <vlCore/ResourceDatabase.hpp>
+#include <vlCore/VirtualFile.hpp>
+#include <vlCore/Thread.hpp>
+#include <vector>
+
+namespace vl
+{
+  class LoadWriterManager;
+
+  /** Receives the resources loaded by a ResourceLoadJob, see ResourceLoadJob::dispatch(). */
+  class LoadCompletedCallback: public Object
+  {
+  public:
+    //! \p db is NULL if the resource \p index of the job could not be loaded.
+    virtual void operator()(int index, const String& path, ResourceDatabase* db) = 0;
+  };
+
+//-----------------------------------------------------------------------------
+// ResourceLoadJob
+//-----------------------------------------------------------------------------
+  /**
+   * Loads a batch of resources concurrently on a pool of threads, see LoadWriterManager::loadResourcesAsync().
+   *
+   * The resources are loaded by LoadWriterManager::loadResource() as usual, and loading starts as soon as the job
+   * is created. The results can be collected in two ways:
+   * - result() waits for a given resource and returns it, like a future.
+   * - dispatch() calls a LoadCompletedCallback for every resource completed since the previous call. The callback
+   *   runs on the thread calling dispatch(), so it can safely touch the scene or the OpenGL context.
+   *
+   * The returned ResourceDatabase objects must not be used before their loading is complete.
+   * Destroying a job waits for all of its resources to be loaded. The LoadWriterManager must outlive the job.
+   *
+   * \par Thread safety of the loaders
+   * Visualization Library is not thread-safe in general: reference counting is not atomic. The loaders work
+   * concurrently because each load only creates and touches its own objects:
+   * - The file lookups through defFileSystem() create a new VirtualFile for each request. This is safe for
+   *   DiskDirectory. ZippedDirectory and MemoryDirectory hand out files that share the zip stream or the Buffer
+   *   of the directory. If defFileSystem() contains such directories, or a job is given files that are neither
+   *   DiskFile, MappedFile nor MemoryFile, the resources are loaded one at a time on a single thread.
+   * - The image loaders (BMP, DDS, DICOM, JPG, PNG, TGA, TIFF, DAT) and the geometry loaders (3DS, AC3D, MD2, OBJ,
+   *   PLY, STL) keep no static state. libjpeg and libpng report errors through a jmp_buf owned by each call.
+   *   The TIFF loader installs the same error handlers on every call.
+   * - The VLT/VLB loaders share defVLXRegistry(): every VLXSerializer keeps a reference to it. If the registry has
+   *   no refCountMutex() the first job installs one. The registry itself must not be modified while a job runs.
+   * - The text parsers rely on sscanf() and therefore on the C locale: do not call setlocale() while a job runs.
+   * - Log output is serialized: if no Log::logMutex() is installed, the first job installs one.
+   * - LoadWriterManager::loadCallbacks() are executed on the loading threads, they must not access shared data.
+   * - The LoadWriterManager, its ResourceLoadWriter objects and defFileSystem() must not be modified while a job runs.
+   * - String is copy-on-write and its reference count is not atomic: the job stores private copies of the paths
+   *   and of the paths of the given files, and each loading thread works on its own copy. The given files must not
+   *   be accessed while the job runs.
+   * - VL_DEBUG_LIVING_OBJECTS must be disabled, the set of living objects is not synchronized.
+   */
+  class VLCORE_EXPORT ResourceLoadJob: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::ResourceLoadJob, Object)
+
+  public:
+    //! Starts loading \p paths with up to \p thread_count threads, parallelThreadCount() if \p thread_count <= 0.
+    ResourceLoadJob(const LoadWriterManager* manager, const std::vector<String>& paths, bool quick=true, int thread_count=0);
+
+    //! Starts loading \p files with up to \p thread_count threads, parallelThreadCount() if \p thread_count <= 0.
+    //! The files must not be accessed until the job is complete.
+    ResourceLoadJob(const LoadWriterManager* manager, const std::vector< ref<VirtualFile> >& files, bool quick=true, int thread_count=0);
+
+    //! Waits for all the resources to be loaded.
+    ~ResourceLoadJob();
+
+    //! The number of resources of the job.
+    int count() const { return (int)mPaths.size(); }
+
+    //! The path of the \p i-th resource.
+    const String& path(int i) const { return mPaths[i]; }
+
+    //! Returns true if the \p i-th resource has been loaded.
+    bool isDone(int i) const;
+
+    //! Returns true if all the resources have been loaded.
+    bool isDone() const { return doneCount() == count(); }
+
+    //! The number of resources loaded so far.
+    int doneCount() const;
+
+    //! The number of threads loading the resources.
+    int threadCount() const { return (int)mWorkers.size(); }
+
+    //! Waits for the \p i-th resource and returns it, NULL if it could not be loaded.
+    //! While waiting the calling thread helps loading the pending resources.
+    ResourceDatabase* result(int i);
+
+    //! Waits for all the resources to be loaded. While waiting the calling thread helps loading the pending resources.
+    void wait();
+
+    //! Calls \p callback on the calling thread for each resource loaded since the previous call, in order of completion.
+    //! If \p wait_all is true waits until all the resources have been dispatched. Returns the number of callbacks made.
+    int dispatch(LoadCompletedCallback* callback, bool wait_all=false);
+
+  protected:
+    class Worker;
+    friend class Worker;
+
+    void start(int thread_count);
+    bool work(bool only_one);
+    void load(int i);
+
+  protected:
+    const LoadWriterManager* mManager;
+    std::vector<String> mPaths;
+    std::vector< ref<VirtualFile> > mFiles;
+    std::vector< ref<ResourceDatabase> > mResults;
+    std::vector<int> mCompleted;
+    std::vector<unsigned char> mDone;
+    std::vector< ref<Worker> > mWorkers;
+    mutable Mutex mMutex;
+    Condition mCompletedCondition;
+    int mNext;
+    int mDispatched;
+    bool mQuick;
+  };
+}
+
+#endif
@@ -0,0 +1,303 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlCore/Thread.hpp>
+#include <vlCore/ScopedMutex.hpp>
+#include <vector>
+#include <algorithm>
+
+#if defined(VL_PLATFORM_WINDOWS)
+  #include <process.h>
+#else
+  #include <pthread.h>
+  #include <unistd.h>
+#endif
+
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+// Mutex
+//-----------------------------------------------------------------------------
+Mutex::Mutex(): mLockCount(0)
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    CRITICAL_SECTION* cs = new CRITICAL_SECTION;
+    InitializeCriticalSection(cs);
+    mHandle = cs;
+  #else
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_t* mutex = new pthread_mutex_t;
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    mHandle = mutex;
+  #endif
+}
+//-----------------------------------------------------------------------------
+Mutex::~Mutex()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    DeleteCriticalSection((CRITICAL_SECTION*)mHandle);
+    delete (CRITICAL_SECTION*)mHandle;
+  #else
+    pthread_mutex_destroy((pthread_mutex_t*)mHandle);
+    delete (pthread_mutex_t*)mHandle;
+  #endif
+}
+//-----------------------------------------------------------------------------
+void Mutex::lock()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    EnterCriticalSection((CRITICAL_SECTION*)mHandle);
+  #else
+    pthread_mutex_lock((pthread_mutex_t*)mHandle);
+  #endif
+  ++mLockCount;
+}
+//-----------------------------------------------------------------------------
+void Mutex::unlock()
+{
+  --mLockCount;
+  #if defined(VL_PLATFORM_WINDOWS)
+    LeaveCriticalSection((CRITICAL_SECTION*)mHandle);
+  #else
+    pthread_mutex_unlock((pthread_mutex_t*)mHandle);
+  #endif
+}
+//-----------------------------------------------------------------------------
+// Condition
+//-----------------------------------------------------------------------------
+Condition::Condition()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    CONDITION_VARIABLE* cv = new CONDITION_VARIABLE;
+    InitializeConditionVariable(cv);
+    mHandle = cv;
+  #else
+    pthread_cond_t* cond = new pthread_cond_t;
+    pthread_cond_init(cond, NULL);
+    mHandle = cond;
+  #endif
+}
+//-----------------------------------------------------------------------------
+Condition::~Condition()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    delete (CONDITION_VARIABLE*)mHandle;
+  #else
+    pthread_cond_destroy((pthread_cond_t*)mHandle);
+    delete (pthread_cond_t*)mHandle;
+  #endif
+}
+//-----------------------------------------------------------------------------
+void Condition::wait(Mutex* mutex)
+{
+  // the mutex is released while waiting
+  --mutex->mLockCount;
+  #if defined(VL_PLATFORM_WINDOWS)
+    SleepConditionVariableCS((CONDITION_VARIABLE*)mHandle, (CRITICAL_SECTION*)mutex->mHandle, INFINITE);
+  #else
+    pthread_cond_wait((pthread_cond_t*)mHandle, (pthread_mutex_t*)mutex->mHandle);
+  #endif
+  ++mutex->mLockCount;
+}
+//-----------------------------------------------------------------------------
+void Condition::notifyAll()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    WakeAllConditionVariable((CONDITION_VARIABLE*)mHandle);
+  #else
+    pthread_cond_broadcast((pthread_cond_t*)mHandle);
+  #endif
+}
+//-----------------------------------------------------------------------------
+// Thread
+//-----------------------------------------------------------------------------
+namespace
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    unsigned __stdcall threadEntry(void* thread)
+    {
+      ((Thread*)thread)->run();
+      return 0;
+    }
+  #else
+    void* threadEntry(void* thread)
+    {
+      ((Thread*)thread)->run();
+      return NULL;
+    }
+  #endif
+}
+//-----------------------------------------------------------------------------
+Thread::Thread(): mHandle(NULL)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+}
+//-----------------------------------------------------------------------------
+Thread::~Thread()
+{
+  join();
+}
+//-----------------------------------------------------------------------------
+bool Thread::start()
+{
+  if (mHandle)
+    return false;
+  #if defined(VL_PLATFORM_WINDOWS)
+    mHandle = (void*)_beginthreadex(NULL, 0, threadEntry, this, 0, NULL);
+    return mHandle != NULL;
+  #else
+    pthread_t* thread = new pthread_t;
+    if (pthread_create(thread, NULL, threadEntry, this) != 0)
+    {
+      delete thread;
+      return false;
+    }
+    mHandle = thread;
+    return true;
+  #endif
+}
+//-----------------------------------------------------------------------------
+void Thread::join()
+{
+  if (!mHandle)
+    return;
+  #if defined(VL_PLATFORM_WINDOWS)
+    WaitForSingleObject((HANDLE)mHandle, INFINITE);
+    CloseHandle((HANDLE)mHandle);
+  #else
+    pthread_join(*(pthread_t*)mHandle, NULL);
+    delete (pthread_t*)mHandle;
+  #endif
+  mHandle = NULL;
+}
+//-----------------------------------------------------------------------------
+int Thread::hardwareConcurrency()
+{
+  #if defined(VL_PLATFORM_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+  #else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+  #endif
+}
+//-----------------------------------------------------------------------------
+// parallelFor
+//-----------------------------------------------------------------------------
+namespace
+{
+  int gParallelThreadCount = 0;
+
+  //! Shared state: the workers grab blocks until the range is exhausted.
+  class ParallelForJob
+  {
+  public:
+    ParallelForJob(int begin, int end, int grain, ParallelForTask* task): mNext(begin), mEnd(end), mGrain(grain), mTask(task) {}
+
+    void work()
+    {
+      for(;;)
+      {
+        int block_begin, block_end;
+        {
+          ScopedMutex lock(&mMutex);
+          if (mNext >= mEnd)
+            return;
+          block_begin = mNext;
+          block_end = mEnd - mNext > mGrain ? mNext + mGrain : mEnd;
+          mNext = block_end;
+        }
+        mTask->runRange(block_begin, block_end);
+      }
+    }
+
+  private:
+    Mutex mMutex;
+    int mNext;
+    int mEnd;
+    int mGrain;
+    ParallelForTask* mTask;
+  };
+
+  class ParallelForWorker: public Thread
+  {
+  public:
+    ParallelForWorker(ParallelForJob* job): mJob(job) {}
+    virtual void run() { mJob->work(); }
+
+  private:
+    ParallelForJob* mJob;
+  };
+}
+//-----------------------------------------------------------------------------
+void vl::setParallelThreadCount(int count)
+{
+  gParallelThreadCount = count;
+}
+//-----------------------------------------------------------------------------
+int vl::parallelThreadCount()
+{
+  return gParallelThreadCount > 0 ? gParallelThreadCount : Thread::hardwareConcurrency();
+}
+//-----------------------------------------------------------------------------
+void vl::parallelFor(int begin, int end, ParallelForTask* task, int grain)
+{
+  if (end <= begin)
+    return;
+  if (grain < 1)
+    grain = 1;
+
+  int block_count = (end - begin + grain - 1) / grain;
+  int thread_count = std::min(parallelThreadCount(), block_count);
+  if (thread_count <= 1)
+  {
+    task->runRange(begin, end);
+    return;
+  }
+
+  ParallelForJob job(begin, end, grain, task);
+  std::vector< ref<ParallelForWorker> > workers;
+  for(int i=1; i<thread_count; ++i)
+  {
+    ref<ParallelForWorker> worker = new ParallelForWorker(&job);
+    if (worker->start())
+      workers.push_back(worker);
+  }
+  // the calling thread works too
+  job.work();
+  for(size_t i=0; i<workers.size(); ++i)
+    workers[i]->join();
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,221 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef Thread_INCLUDE_ONCE
+#define Thread_INCLUDE_ONCE
+
+#include <vlCore/Object.hpp>
+#include <vlCore/IMutex.hpp>
+#include <vector>
+#include <algorithm>
+
+namespace vl
+{
+  //------------------------------------------------------------------------------
+  // Mutex
+  //------------------------------------------------------------------------------
+  /**
+   * A simple platform-independent recursive mutex based on Win32 critical sections or pthreads.
+   * \sa ScopedMutex
+  */
+  class VLCORE_EXPORT Mutex: public IMutex
+  {
+  public:
+    Mutex();
+
+    ~Mutex();
+
+    virtual void lock();
+
+    virtual void unlock();
+
+    virtual int isLocked() const { return mLockCount ? 1 : 0; }
+
+  private:
+    Mutex(const Mutex&): IMutex() {}
+    void operator=(const Mutex&) {}
+
+  private:
+    friend class Condition;
+    void* mHandle;
+    volatile int mLockCount;
+  };
+
+  //------------------------------------------------------------------------------
+  // Condition
+  //------------------------------------------------------------------------------
+  /**
+   * A platform-independent condition variable based on Win32 condition variables or pthreads.
+   * Threads wait() on it until another thread calls notifyAll().
+  */
+  class VLCORE_EXPORT Condition
+  {
+  public:
+    Condition();
+
+    ~Condition();
+
+    //! Unlocks \p mutex, waits for notifyAll() and locks \p mutex again.
+    //! The \p mutex must be locked exactly once by the calling thread. Spurious wake-ups are possible:
+    //! always wait in a loop testing the awaited state.
+    void wait(Mutex* mutex);
+
+    //! Wakes up all the threads waiting on the condition.
+    void notifyAll();
+
+  private:
+    Condition(const Condition&) {}
+    void operator=(const Condition&) {}
+
+  private:
+    void* mHandle;
+  };
+
+  //------------------------------------------------------------------------------
+  // Thread
+  //------------------------------------------------------------------------------
+  /**
+   * A minimal platform-independent thread: reimplement run() and call start() and join().
+  */
+  class VLCORE_EXPORT Thread: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::Thread, Object)
+
+  public:
+    Thread();
+
+    ~Thread();
+
+    //! The function executed by the thread.
+    virtual void run() = 0;
+
+    //! Starts the thread, returns false if the thread could not be created or is already running.
+    bool start();
+
+    //! Waits for the thread to finish.
+    void join();
+
+    //! Returns true if the thread has been started and not yet joined.
+    bool isRunning() const { return mHandle != NULL; }
+
+    //! Returns the number of hardware threads available on the machine (at least 1).
+    static int hardwareConcurrency();
+
+  private:
+    void* mHandle;
+  };
+
+  //------------------------------------------------------------------------------
+  // ParallelForTask
+  //------------------------------------------------------------------------------
+  /**
+   * The work executed by parallelFor(): runRange() is called concurrently on disjoint ranges
+   * and must only write data which is not touched by other ranges.
+  */
+  class ParallelForTask
+  {
+  public:
+    virtual ~ParallelForTask() {}
+
+    //! Processes the items in the range [begin, end).
+    virtual void runRange(int begin, int end) = 0;
+  };
+
+  /**
+   * Calls task->runRange() on blocks of at most \p grain items covering [begin, end) using up to
+   * parallelThreadCount() threads, the calling thread included. Returns when all the blocks are processed.
+  */
+  VLCORE_EXPORT void parallelFor(int begin, int end, ParallelForTask* task, int grain=1024);
+
+  //! The maximum number of threads used by parallelFor(), defaults to Thread::hardwareConcurrency().
+  //! Set it to 1 to run everything on the calling thread.
+  VLCORE_EXPORT void setParallelThreadCount(int count);
+
+  //! The maximum number of threads used by parallelFor(), defaults to Thread::hardwareConcurrency().
+  VLCORE_EXPORT int parallelThreadCount();
+
+  //------------------------------------------------------------------------------
+  // parallelSort
+  //------------------------------------------------------------------------------
+  //! For internal use only.
+  template<class T>
+  class ParallelSortTask: public ParallelForTask
+  {
+  public:
+    ParallelSortTask(std::vector<T>& data, int run_size, bool merge): mData(data), mRunSize(run_size), mMerge(merge) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      for(int i=begin; i<end; ++i)
+      {
+        // sort a run or merge two adjacent sorted runs
+        size_t first  = std::min( (size_t)i * mRunSize * (mMerge ? 2 : 1), mData.size() );
+        size_t middle = std::min( first + mRunSize, mData.size() );
+        size_t last   = std::min( first + mRunSize * (mMerge ? 2 : 1), mData.size() );
+        if (mMerge)
+          std::inplace_merge(mData.begin() + first, mData.begin() + middle, mData.begin() + last);
+        else
+          std::sort(mData.begin() + first, mData.begin() + last);
+      }
+    }
+
+  private:
+    std::vector<T>& mData;
+    size_t mRunSize;
+    bool mMerge;
+  };
+
+  //! Sorts \p data using operator< splitting the work among parallelThreadCount() threads.
+  //! The result is the same as std::sort() but equivalent elements may appear in any order.
+  template<class T>
+  void parallelSort(std::vector<T>& data)
+  {
+    const int min_run_size = 1<<14;
+    int runs = std::min( parallelThreadCount(), (int)(data.size() / min_run_size) );
+    if (runs <= 1)
+    {
+      std::sort(data.begin(), data.end());
+      return;
+    }
+
+    int run_size = (int)((data.size() + runs - 1) / runs);
+    ParallelSortTask<T> sort_task(data, run_size, false);
+    parallelFor(0, runs, &sort_task, 1);
+
+    for(; runs > 1; runs = (runs + 1) / 2, run_size *= 2)
+    {
+      ParallelSortTask<T> merge_task(data, run_size, true);
+      parallelFor(0, runs / 2, &merge_task, 1);
+    }
+  }
+}
+
+#endif
@@ -51,7 +51,8 @@ namespace vl
     VLB_ChunkID,
     VLB_ChunkRealDouble,
     VLB_ChunkInteger,
-    VLB_ChunkBool
+    VLB_ChunkBool,
+    VLB_ChunkArrayIntegerDelta
   } EVLBChunkType;
 }
 
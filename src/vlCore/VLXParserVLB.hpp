@@ -303,6 +303,7 @@ namespace vl
         return parseList( val.getList() );
 
       case VLB_ChunkArrayInteger:
+      case VLB_ChunkArrayIntegerDelta:
         {
           // tag
           if (!readString(str))
@@ -329,6 +330,11 @@ namespace vl
               encoded.resize((size_t)encode_count);
               inputFile()->readUInt8(&encoded[0], encode_count);
               decodeIntegers(encoded, arr.value());
+              if (chunk == VLB_ChunkArrayIntegerDelta)
+              {
+                for(size_t i=1; i<arr.value().size(); ++i)
+                  arr.value()[i] += arr.value()[i-1];
+              }
             }
           }
           VL_CHECK((size_t)count == arr.value().size())
@@ -323,6 +323,7 @@ bool VLXSerializer::saveVLB(VirtualFile* file, const Object* obj, bool start_fre
 
     VLXVisitorExportToVLB bin_export_visitor(file);
     bin_export_visitor.setIDSet(&uid_set);
+    bin_export_visitor.setIntegerDeltaEncoding(vlbIntegerDeltaEncoding());
     bin_export_visitor.writeHeader();
     meta->acceptVisitor(&bin_export_visitor);
     st->acceptVisitor(&bin_export_visitor);
@@ -50,7 +50,7 @@ namespace vl
     typedef enum { NoError, ImportError, ExportError, ReadError, WriteError } EError;
 
   public:
-    VLXSerializer(): mError(NoError), mIDCounter(0)
+    VLXSerializer(): mError(NoError), mIDCounter(0), mVLBIntegerDeltaEncoding(false)
     {
       setRegistry( defVLXRegistry() );
     }
@@ -177,11 +177,19 @@ namespace vl
     //! Erases all previously set directives
     void eraseAllDirectives() { mDirectives.clear(); }
 
+    //! If enabled saveVLB() stores integer arrays, such as index buffers, as deltas whenever this makes them smaller. Disabled by default.
+    //! \sa VLXVisitorExportToVLB::setIntegerDeltaEncoding()
+    void setVLBIntegerDeltaEncoding(bool enable) { mVLBIntegerDeltaEncoding = enable; }
+
+    //! If enabled saveVLB() stores integer arrays, such as index buffers, as deltas whenever this makes them smaller.
+    bool vlbIntegerDeltaEncoding() const { return mVLBIntegerDeltaEncoding; }
+
   private:
     String mDocumentURL;
     std::map<std::string, std::string> mDirectives;
     EError mError;
     int mIDCounter;
+    bool mVLBIntegerDeltaEncoding;
     std::map< ref<VLXStructure>, ref<Object> > mImportedStructures; // structure --> object
     std::map< ref<Object>, ref<VLXStructure> > mExportedObjects;    // object --> structure
     std::map< std::string, VLXValue > mMetadata; // metadata to import or to export
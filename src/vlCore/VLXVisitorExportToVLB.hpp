@@ -48,6 +48,7 @@ namespace vl
     VLXVisitorExportToVLB(VirtualFile* file = NULL)
     {
       mIDSet = NULL;
+      mIntegerDeltaEncoding = false;
       setOutputFile(file);
     }
 
@@ -214,8 +215,31 @@ namespace vl
 
     virtual void visitArray(VLXArrayInteger* arr)
     {
+      std::vector<unsigned char> encoded;
+      bool delta = false;
+      if (arr->value().size() > 0)
+      {
+        encodeIntegers(&arr->value()[0], (int)arr->value().size(), encoded); VL_CHECK(encoded.size())
+        // index buffers and other slowly varying sequences compress much better as deltas
+        if (integerDeltaEncoding() && arr->value().size() > 1)
+        {
+          std::vector<long long> deltas;
+          deltas.resize(arr->value().size());
+          deltas[0] = arr->value()[0];
+          for(size_t i=1; i<deltas.size(); ++i)
+            deltas[i] = arr->value()[i] - arr->value()[i-1];
+          std::vector<unsigned char> encoded_delta;
+          encodeIntegers(&deltas[0], (int)deltas.size(), encoded_delta);
+          if (encoded_delta.size() < encoded.size())
+          {
+            encoded.swap(encoded_delta);
+            delta = true;
+          }
+        }
+      }
+
       // header
-      mOutputFile->writeUInt8( VLB_ChunkArrayInteger );
+      mOutputFile->writeUInt8( (unsigned char)(delta ? VLB_ChunkArrayIntegerDelta : VLB_ChunkArrayInteger) );
 
       // tag
       writeString(arr->tag().c_str());
@@ -226,8 +250,6 @@ namespace vl
       // value
       if (arr->value().size() > 0)
       {
-        std::vector<unsigned char> encoded;
-        encodeIntegers(&arr->value()[0], (int)arr->value().size(), encoded); VL_CHECK(encoded.size())
         writeInteger(encoded.size());
         mOutputFile->writeUInt8(&encoded[0], encoded.size());
       }
@@ -387,8 +409,16 @@ namespace vl
 
     const VirtualFile* outputFile() const { return mOutputFile.get(); }
 
+    //! If enabled integer arrays are stored as deltas whenever this makes them smaller, which typically halves the size of index buffers.
+    //! Files written with this option cannot be read by VL versions prior to the VLB_ChunkArrayIntegerDelta chunk. Disabled by default.
+    void setIntegerDeltaEncoding(bool enable) { mIntegerDeltaEncoding = enable; }
+
+    //! If enabled integer arrays are stored as deltas whenever this makes them smaller.
+    bool integerDeltaEncoding() const { return mIntegerDeltaEncoding; }
+
   private:
     std::map< std::string, int >* mIDSet;
+    bool mIntegerDeltaEncoding;
     ref<VirtualFile> mOutputFile;
   };
 }
@@ -89,6 +89,11 @@ namespace vl
     //! Returns the size of the file in bytes.
     virtual long long size() const = 0;
 
+    //! Returns a pointer to the whole content of the file if the file is open and directly addressable in memory, NULL otherwise.
+    //! Loaders can use it to parse the data in place instead of reading it. The pointer is valid until the file is closed.
+    //! See MappedFile and MemoryFile.
+    virtual const unsigned char* mappedData() const { return NULL; }
+
     //! Creates a clone of this class instance.
     virtual ref<VirtualFile> clone() const = 0;
 
@@ -35,6 +35,7 @@
 #include <vlCore/VisualizationLibrary.hpp>
 #include <vlCore/FileSystem.hpp>
 #include <vlCore/VirtualFile.hpp>
+#include <vlCore/DiskFile.hpp>
 #include <vlCore/Image.hpp>
 
 // mic fixme: 
@@ -161,6 +162,12 @@ namespace
 
   #define IS_DXT5(pf) isFourCC("DXT5", pf.dwFourCC)
 
+  #define IS_ATI1(pf) (isFourCC("ATI1", pf.dwFourCC) || isFourCC("BC4U", pf.dwFourCC))
+
+  #define IS_ATI2(pf) (isFourCC("ATI2", pf.dwFourCC) || isFourCC("BC5U", pf.dwFourCC))
+
+  #define IS_DX10(pf) isFourCC("DX10", pf.dwFourCC)
+
   typedef struct
   {
     unsigned int dwSize;
@@ -197,6 +204,31 @@ namespace
 
   } DDSURFACEDESC2;
 
+  // DirectX 10 header extension, follows DDSURFACEDESC2 when the fourcc is "DX10"
+  typedef struct
+  {
+    unsigned int dxgiFormat;
+    unsigned int resourceDimension;
+    unsigned int miscFlag;
+    unsigned int arraySize;
+    unsigned int miscFlags2;
+  } DDS_HEADER_DXT10;
+
+  // DDS_HEADER_DXT10.dxgiFormat
+  const unsigned int DXGI_FORMAT_BC1_UNORM = 71;
+  const unsigned int DXGI_FORMAT_BC2_UNORM = 74;
+  const unsigned int DXGI_FORMAT_BC3_UNORM = 77;
+  const unsigned int DXGI_FORMAT_BC4_UNORM = 80;
+  const unsigned int DXGI_FORMAT_BC5_UNORM = 83;
+  const unsigned int DXGI_FORMAT_BC7_UNORM = 98;
+
+  // DDS_HEADER_DXT10.resourceDimension
+  const unsigned int DDS_DIMENSION_TEXTURE2D = 3;
+  const unsigned int DDS_DIMENSION_TEXTURE3D = 4;
+
+  // DDS_HEADER_DXT10.miscFlag
+  const unsigned int DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
   enum
   {
     DDS_IMAGE_NULL = 0,
@@ -219,6 +251,8 @@ namespace
 //! - Grayscale + Alpha, 8 + 8 bit
 //! - 8 bit palettized (8 bit palette compression)
 //! - DXT1, DXT3, DXT5
+//! - ATI1 and ATI2 (BC4 and BC5)
+//! - BC1, BC2, BC3, BC4, BC5 and BC7 using the DirectX 10 header extension
 //!
 //! \remarks
 //! DDS images and cubemaps will look flipped if created according to the DirectX conventions. \n
@@ -278,7 +312,7 @@ ref<Image> vl::loadDDS(VirtualFile* file)
 
   if (header.ddsCaps.dwCaps2 & DDSCAPS2_CUBEMAP)
   {
-    bool allfaces = (header.ddsCaps.dwCaps2 & DDSCAPS2_CUBEMAP_FACES) != DDSCAPS2_CUBEMAP_FACES;
+    bool allfaces = (header.ddsCaps.dwCaps2 & DDSCAPS2_CUBEMAP_FACES) == DDSCAPS2_CUBEMAP_FACES;
 
     if (!allfaces)
     {
@@ -290,6 +324,36 @@ ref<Image> vl::loadDDS(VirtualFile* file)
       image_type = DDS_IMAGE_CUBEMAP;
   }
 
+  int dx10_format = 0;
+  if (IS_DX10(header.ddpfPixelFormat))
+  {
+    DDS_HEADER_DXT10 header10;
+    memset(&header10, 0, sizeof(header10));
+    file->read(&header10, sizeof(header10));
+
+    switch(header10.dxgiFormat)
+    {
+    case DXGI_FORMAT_BC1_UNORM: dx10_format = IF_COMPRESSED_RGBA_S3TC_DXT1;  break;
+    case DXGI_FORMAT_BC2_UNORM: dx10_format = IF_COMPRESSED_RGBA_S3TC_DXT3;  break;
+    case DXGI_FORMAT_BC3_UNORM: dx10_format = IF_COMPRESSED_RGBA_S3TC_DXT5;  break;
+    case DXGI_FORMAT_BC4_UNORM: dx10_format = IF_COMPRESSED_RED_RGTC1;       break;
+    case DXGI_FORMAT_BC5_UNORM: dx10_format = IF_COMPRESSED_RED_GREEN_RGTC2; break;
+    case DXGI_FORMAT_BC7_UNORM: dx10_format = IF_COMPRESSED_RGBA_BPTC_UNORM; break;
+    default:
+      break;
+    }
+
+    if (!dx10_format || header10.arraySize > 1)
+    {
+      Log::error( Say("DDS: not supported DirectX 10 format or texture array in '%s'.\n") << file->path() );
+      file->close();
+      return NULL;
+    }
+
+    if (header10.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+      image_type = DDS_IMAGE_CUBEMAP;
+  }
+
   bool reverse_rgba_bgra = false;
   if (header.ddpfPixelFormat.dwRBitMask != 0xFF)
     reverse_rgba_bgra = true;
@@ -618,6 +682,46 @@ ref<Image> vl::loadDDS(VirtualFile* file)
     }
   }
   else
+  if ( IS_ATI1(header.ddpfPixelFormat) || IS_ATI2(header.ddpfPixelFormat) || dx10_format )
+  {
+    EImageFormat format = (EImageFormat)dx10_format;
+    if (IS_ATI1(header.ddpfPixelFormat))
+      format = IF_COMPRESSED_RED_RGTC1;
+    else
+    if (IS_ATI2(header.ddpfPixelFormat))
+      format = IF_COMPRESSED_RED_GREEN_RGTC2;
+
+    for(int i=0, w = header.dwWidth, h = header.dwHeight, d = header.dwDepth; i<mipmaps; ++i, w/=2, h/=2, d/=2)
+    {
+      w = w == 0 ? 1 : w;
+      h = h == 0 ? 1 : h;
+      d = d == 0 ? 1 : d;
+
+      if (image_type == DDS_IMAGE_2D)
+        image[i]->allocate2D(w, h, 1, format, IT_IMPLICIT_TYPE);
+      else
+      if (image_type == DDS_IMAGE_CUBEMAP)
+        image[i]->allocateCubemap(w, h, 1, format, IT_IMPLICIT_TYPE);
+      else
+      if (image_type == DDS_IMAGE_3D)
+        image[i]->allocate3D(w, h, d, 1, format, IT_IMPLICIT_TYPE);
+    }
+
+    for(int face=0; face<max_face; ++face)
+    {
+      for(int i=0, w = header.dwWidth, h = header.dwHeight, d = header.dwDepth; i<mipmaps; ++i, w/=2, h/=2, d/=2)
+      {
+        w = w == 0 ? 1 : w;
+        h = h == 0 ? 1 : h;
+        d = d == 0 ? 1 : d;
+
+        int req_mem = Image::requiredMemory( w, h, d, 1, format, IT_IMPLICIT_TYPE, false );
+        int offset = req_mem*face;
+        file->read(image[i]->pixels() + offset, req_mem);
+      }
+    }
+  }
+  else
   {
     Log::error( Say("DDS: not supported format for '%s'.\n") << file->path() );
     file->close();
@@ -723,3 +827,203 @@ bool vl::isDDS(VirtualFile* file)
   return true;
 }
 //-----------------------------------------------------------------------------
+bool vl::saveDDS(const Image* src, const String& path)
+{
+  ref<DiskFile> file = new DiskFile(path);
+  return saveDDS(src, file.get());
+}
+//-----------------------------------------------------------------------------
+//! Saves an image and its mipmaps to a DDS file.
+//! Can save 2D and 3D images and cubemaps, 1D images are saved as 2D images of height 1.
+//!
+//! The compressed formats are saved as they are: DXT1, DXT3, DXT5, ATI1 (BC4), ATI2 (BC5) and BC7,
+//! the latter using the DirectX 10 header extension. Use Image::compress() to obtain them.
+//! The other formats are saved as 8 bit RGBA, BGRA, RGB, BGR, luminance or luminance + alpha,
+//! the images of a different type() or format() are converted to IT_UNSIGNED_BYTE and IF_RGBA.
+//!
+//! As for loadDDS() the images are not flipped.
+bool vl::saveDDS(const Image* src, VirtualFile* fout)
+{
+  // the top level followed by the mipmaps, converted to a format supported by DDS
+  std::vector< ref<Image> > converted;
+  std::vector<const Image*> levels;
+  levels.push_back(src);
+  for(size_t i=0; i<src->mipmaps().size(); ++i)
+    levels.push_back( src->mipmaps()[i].get() );
+
+  bool compressed = Image::isCompressedFormat(src->format()) != 0;
+  if (!compressed)
+  {
+    for(size_t i=0; i<levels.size(); ++i)
+    {
+      if (levels[i]->type() != IT_UNSIGNED_BYTE)
+      {
+        converted.push_back( levels[i]->convertType(IT_UNSIGNED_BYTE) );
+        levels[i] = converted.back().get();
+        if (!levels[i])
+        {
+          Log::error( Say("saveDDS('%s'): could not convert image to IT_UNSIGNED_BYTE.\n") << fout->path() );
+          return false;
+        }
+      }
+      switch(levels[i]->format())
+      {
+        case IF_RGBA:
+        case IF_BGRA:
+        case IF_RGB:
+        case IF_BGR:
+        case IF_LUMINANCE:
+        case IF_LUMINANCE_ALPHA:
+          break;
+        default:
+          converted.push_back( levels[i]->convertFormat(IF_RGBA) );
+          levels[i] = converted.back().get();
+          if (!levels[i])
+          {
+            Log::error( Say("saveDDS('%s'): could not convert image to IF_RGBA.\n") << fout->path() );
+            return false;
+          }
+      }
+    }
+  }
+
+  const Image* img = levels[0];
+  bool is_3d = img->dimension() == ID_3D;
+  int faces = img->isCubemap() ? 6 : 1;
+
+  DDSURFACEDESC2 header;
+  memset(&header, 0, sizeof(header));
+  header.dwSize = sizeof(header);
+  header.dwFlags = DDS_REQUIRED_FLAGS;
+  header.dwWidth = img->width();
+  header.dwHeight = img->height() ? img->height() : 1;
+  if (is_3d)
+  {
+    header.dwFlags |= DDS_DEPTH;
+    header.dwDepth = img->depth();
+  }
+  if (levels.size() > 1)
+  {
+    header.dwFlags |= DDS_MIPMAPCOUNT;
+    header.dwMipMapCount = (unsigned int)levels.size();
+  }
+
+  header.ddpfPixelFormat.dwSize = sizeof(header.ddpfPixelFormat);
+  DDS_HEADER_DXT10 header10;
+  memset(&header10, 0, sizeof(header10));
+  if (compressed)
+  {
+    header.dwFlags |= DDS_LINEARSIZE;
+    header.dwPitchOrLinearSize = img->requiredMemory() / faces;
+    header.ddpfPixelFormat.dwFlags = DDPF_FOURCC;
+    switch(img->format())
+    {
+      case IF_COMPRESSED_RGB_S3TC_DXT1:   header.ddpfPixelFormat.dwFourCC = makeFourCC('D','X','T','1'); break;
+      case IF_COMPRESSED_RGBA_S3TC_DXT1:  header.ddpfPixelFormat.dwFourCC = makeFourCC('D','X','T','1');
+                                          header.ddpfPixelFormat.dwFlags |= DDPF_ALPHAPIXELS; break;
+      case IF_COMPRESSED_RGBA_S3TC_DXT3:  header.ddpfPixelFormat.dwFourCC = makeFourCC('D','X','T','3'); break;
+      case IF_COMPRESSED_RGBA_S3TC_DXT5:  header.ddpfPixelFormat.dwFourCC = makeFourCC('D','X','T','5'); break;
+      case IF_COMPRESSED_RED_RGTC1:       header.ddpfPixelFormat.dwFourCC = makeFourCC('A','T','I','1'); break;
+      case IF_COMPRESSED_RED_GREEN_RGTC2: header.ddpfPixelFormat.dwFourCC = makeFourCC('A','T','I','2'); break;
+      case IF_COMPRESSED_RGBA_BPTC_UNORM:
+        header.ddpfPixelFormat.dwFourCC = makeFourCC('D','X','1','0');
+        header10.dxgiFormat = DXGI_FORMAT_BC7_UNORM;
+        header10.resourceDimension = is_3d ? DDS_DIMENSION_TEXTURE3D : DDS_DIMENSION_TEXTURE2D;
+        header10.miscFlag = img->isCubemap() ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+        header10.arraySize = 1;
+        break;
+      default:
+        break;
+    }
+  }
+  else
+  {
+    header.dwFlags |= DDS_PITCH;
+    header.dwPitchOrLinearSize = img->width() * img->bitsPerPixel() / 8;
+    header.ddpfPixelFormat.dwRGBBitCount = img->bitsPerPixel();
+    switch(img->format())
+    {
+      case IF_RGB:
+      case IF_RGBA:
+        header.ddpfPixelFormat.dwFlags = DDPF_RGB;
+        header.ddpfPixelFormat.dwRBitMask = 0x000000FF;
+        header.ddpfPixelFormat.dwGBitMask = 0x0000FF00;
+        header.ddpfPixelFormat.dwBBitMask = 0x00FF0000;
+        break;
+      case IF_BGR:
+      case IF_BGRA:
+        header.ddpfPixelFormat.dwFlags = DDPF_RGB;
+        header.ddpfPixelFormat.dwRBitMask = 0x00FF0000;
+        header.ddpfPixelFormat.dwGBitMask = 0x0000FF00;
+        header.ddpfPixelFormat.dwBBitMask = 0x000000FF;
+        break;
+      case IF_LUMINANCE:
+      case IF_LUMINANCE_ALPHA:
+        header.ddpfPixelFormat.dwFlags = DDPF_LUMINANCE;
+        header.ddpfPixelFormat.dwRBitMask = 0x000000FF;
+        break;
+      default:
+        break;
+    }
+    if (img->format() == IF_RGBA || img->format() == IF_BGRA)
+      header.ddpfPixelFormat.dwAlphaBitMask = 0xFF000000;
+    if (img->format() == IF_LUMINANCE_ALPHA)
+      header.ddpfPixelFormat.dwAlphaBitMask = 0x0000FF00;
+    if (header.ddpfPixelFormat.dwAlphaBitMask)
+      header.ddpfPixelFormat.dwFlags |= DDPF_ALPHAPIXELS;
+  }
+
+  header.ddsCaps.dwCaps1 = DDSCAPS_TEXTURE;
+  if (levels.size() > 1)
+    header.ddsCaps.dwCaps1 |= DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+  if (img->isCubemap())
+  {
+    header.ddsCaps.dwCaps1 |= DDSCAPS_COMPLEX;
+    header.ddsCaps.dwCaps2 = DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_FACES;
+  }
+  if (is_3d)
+  {
+    header.ddsCaps.dwCaps1 |= DDSCAPS_COMPLEX;
+    header.ddsCaps.dwCaps2 = DDSCAPS2_VOLUME;
+  }
+
+  if(!fout->open(OM_WriteOnly))
+  {
+    Log::error( Say("DDS: could not write to '%s'.\n") << fout->path() );
+    return false;
+  }
+
+  fout->write("DDS ", 4);
+  fout->write(&header, sizeof(header));
+  if (header10.dxgiFormat)
+    fout->write(&header10, sizeof(header10));
+
+  // the faces of a cubemap are stored one after the other, each with its own mipmaps
+  std::vector<unsigned char> packed;
+  for(int face=0; face<faces; ++face)
+  {
+    for(size_t i=0; i<levels.size(); ++i)
+    {
+      const Image* level = levels[i];
+      int face_bytes = level->requiredMemory() / faces;
+      const unsigned char* pixels = level->pixels() + face_bytes * face;
+      if (compressed)
+      {
+        fout->write(pixels, face_bytes);
+        continue;
+      }
+
+      // DDS rows are not padded
+      int row_bytes = level->width() * level->bitsPerPixel() / 8;
+      int rows = std::max(1, level->height()) * std::max(1, level->depth());
+      packed.resize( (size_t)row_bytes * rows );
+      for(int y=0; y<rows; ++y)
+        memcpy( &packed[0] + (size_t)y * row_bytes, pixels + (size_t)y * level->pitch(), row_bytes );
+      fout->write(&packed[0], packed.size());
+    }
+  }
+
+  fout->close();
+  return true;
+}
+//-----------------------------------------------------------------------------
@@ -45,12 +45,14 @@ namespace vl
   VLCORE_EXPORT ref<Image> loadDDS(VirtualFile* file);
   VLCORE_EXPORT ref<Image> loadDDS(const String& path);
   VLCORE_EXPORT bool isDDS(VirtualFile* file);
+  VLCORE_EXPORT bool saveDDS(const Image* src, const String& path);
+  VLCORE_EXPORT bool saveDDS(const Image* src, VirtualFile* file);
 
   //---------------------------------------------------------------------------
   // LoadWriterDDS
   //---------------------------------------------------------------------------
   /**
-   * The LoadWriterDDS class is a ResourceLoadWriter capable of reading DDS files.
+   * The LoadWriterDDS class is a ResourceLoadWriter capable of reading and writing DDS files.
    */
   class LoadWriterDDS: public ResourceLoadWriter
   {
@@ -80,16 +82,20 @@ namespace vl
       return res_db;
     }
 
-    bool writeResource(const String&, ResourceDatabase*) const
+    bool writeResource(const String& path, ResourceDatabase* resource) const
     {
-      // mic fixme
-      return false;
+      bool ok = true;
+      for(unsigned i=0; i<resource->count<Image>(); ++i)
+        ok &= saveDDS(resource->get<Image>(i), path);
+      return ok;
     }
 
-    bool writeResource(VirtualFile*, ResourceDatabase*) const
+    bool writeResource(VirtualFile* file, ResourceDatabase* resource) const
     {
-      // mic fixme
-      return false;
+      bool ok = true;
+      for(unsigned i=0; i<resource->count<Image>(); ++i)
+        ok &= saveDDS(resource->get<Image>(i), file);
+      return ok;
     }
   };
 }
@@ -164,6 +164,9 @@ namespace vl
     TF_COMPRESSED_RED_GREEN_RGTC2_EXT        = GL_COMPRESSED_RED_GREEN_RGTC2_EXT,                 
     TF_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT = GL_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT,
 
+    // ARB_texture_compression_bptc
+    TF_COMPRESSED_RGBA_BPTC_UNORM = GL_COMPRESSED_RGBA_BPTC_UNORM_ARB,
+
     // EXT_texture_integer
     TF_RGBA32UI_EXT = GL_RGBA32UI_EXT,           
     TF_RGB32UI_EXT = GL_RGB32UI_EXT,            
@@ -308,6 +311,9 @@ namespace vl
     IF_COMPRESSED_RGBA_S3TC_DXT1 = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
     IF_COMPRESSED_RGBA_S3TC_DXT3 = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
     IF_COMPRESSED_RGBA_S3TC_DXT5 = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+    IF_COMPRESSED_RED_RGTC1       = GL_COMPRESSED_RED_RGTC1,           // BC4
+    IF_COMPRESSED_RED_GREEN_RGTC2 = GL_COMPRESSED_RG_RGTC2,            // BC5
+    IF_COMPRESSED_RGBA_BPTC_UNORM = GL_COMPRESSED_RGBA_BPTC_UNORM_ARB, // BC7
 
     // GL 3.0 (EXT_texture_integer)
     IF_RED_INTEGER   = GL_RED_INTEGER,
@@ -948,6 +954,22 @@ namespace vl
     ID_Error
   } EImageDimension;
 
+  //! The filter used by Image::resample() and Image::generateMipmaps().
+  typedef enum
+  {
+    RF_Box,    //!< Averages the covered texels, i.e. the 2x2 box filter when halving an image.
+    RF_Kaiser, //!< Kaiser windowed sinc: sharp with little ringing.
+    RF_Lanczos //!< Lanczos 3 windowed sinc: the sharpest, may ring along hard edges.
+  } EResampleFilter;
+
+  //! The speed/quality trade-off of Image::compress().
+  typedef enum
+  {
+    CQ_Fast,   //!< Bounding box endpoints, suitable for compressing at load time.
+    CQ_Normal, //!< Principal axis endpoints refined by least squares.
+    CQ_High    //!< Also searches the neighbourhood of the endpoints, for baking assets offline.
+  } ECompressionQuality;
+
   typedef enum
   {
     ST_RenderStates = 1,
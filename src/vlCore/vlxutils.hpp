@@ -529,6 +529,9 @@ namespace vl
     case TF_COMPRESSED_RED_GREEN_RGTC2_EXT       : return "TF_COMPRESSED_RED_GREEN_RGTC2_EXT";
     case TF_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT: return "TF_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT";
 
+    // ARB_texture_compression_bptc
+    case TF_COMPRESSED_RGBA_BPTC_UNORM: return "TF_COMPRESSED_RGBA_BPTC_UNORM";
+
     // EXT_texture_integer
     // case TF_RGBA32UI_EXT: return "TF_RGBA32UI_EXT";
     // case TF_RGB32UI_EXT: return "TF_RGB32UI_EXT";
@@ -768,6 +771,9 @@ namespace vl
     if( value.getIdentifier() == "TF_COMPRESSED_RED_GREEN_RGTC2_EXT") return TF_COMPRESSED_RED_GREEN_RGTC2_EXT;
     if( value.getIdentifier() == "TF_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT") return TF_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT;
 
+    // ARB_texture_compression_bptc
+    if( value.getIdentifier() == "TF_COMPRESSED_RGBA_BPTC_UNORM") return TF_COMPRESSED_RGBA_BPTC_UNORM;
+
     // EXT_texture_integer
     if( value.getIdentifier() == "TF_RGBA32UI_EXT") return TF_RGBA32UI_EXT;
     if( value.getIdentifier() == "TF_RGB32UI_EXT") return TF_RGB32UI_EXT;
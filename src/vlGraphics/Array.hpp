@@ -34,6 +34,8 @@
 
 #include <vlGraphics/BufferObject.hpp>
 #include <vlCore/half.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
 #include <vector>
 
 namespace vl
@@ -67,6 +69,8 @@ namespace vl
       mBufferObject = new BufferObject;
       mBufferObjectDirty = true;
       mBufferObjectUsage = vl::BU_STATIC_DRAW;
+      mOffset = 0;
+      mStride = 0;
     }
 
     //! Copies only the local data and not the BufferObject related fields
@@ -76,12 +80,19 @@ namespace vl
       mBufferObject = new BufferObject;
       mBufferObjectDirty = true;
       mBufferObjectUsage = vl::BU_STATIC_DRAW;
+      mOffset = 0;
+      mStride = 0;
       operator=(other);
     }
 
     //! Copies only the local data and not the BufferObject related fields
     void operator=(const ArrayAbstract& other) 
     {
+      if (isInterleaved() || other.isInterleaved())
+      {
+        Log::error("ArrayAbstract::operator=(): interleaved arrays cannot be copied, use clone() or Geometry::deinterleaveArrays() instead.\n");
+        return;
+      }
       bufferObject()->resize( other.bufferObject()->bytesUsed() );
       memcpy( ptr(), other.ptr(), bytesUsed() );
     }
@@ -91,7 +102,40 @@ namespace vl
     const BufferObject* bufferObject() const { return mBufferObject.get(); }
     BufferObject* bufferObject() { return mBufferObject.get(); }
 
-    void clear() { if (bufferObject()) bufferObject()->clear(); }
+    //! Makes the array read its elements from the given BufferObject, usually shared with other arrays to implement interleaved vertex buffers.
+    //! @param buffer The BufferObject containing the data, it must contain exactly size() * \p stride bytes if \p stride is not 0.
+    //! @param offset The offset in bytes of the first element of the array in \p buffer.
+    //! @param stride The distance in bytes between two consecutive elements, 0 means that the elements are tightly packed and \p offset must be 0.
+    //! \note Interleaved arrays (i.e. with a non zero stride) cannot be resized and their elements must be accessed via at() and not begin()/end().
+    //! \sa Geometry::interleaveArrays(), Geometry::deinterleaveArrays()
+    void setBufferObject(BufferObject* buffer, size_t offset=0, size_t stride=0)
+    {
+      VL_CHECK(buffer)
+      VL_CHECK(stride || !offset)
+      mBufferObject = buffer;
+      mOffset = offset;
+      mStride = stride;
+      mBufferObjectDirty = true;
+    }
+
+    //! The offset in bytes of the first element of the array in its BufferObject, always 0 for non interleaved arrays.
+    size_t offset() const { return mOffset; }
+
+    //! The distance in bytes between two consecutive elements of the array as passed to gl*Pointer(), 0 for non interleaved arrays.
+    size_t stride() const { return mStride; }
+
+    //! Returns true if the array shares an interleaved BufferObject with other arrays, i.e. if stride() is not 0.
+    bool isInterleaved() const { return mStride != 0; }
+
+    //! Clears the array. Interleaved arrays are detached from the shared BufferObject, which is left untouched.
+    void clear() 
+    { 
+      if (isInterleaved())
+        setBufferObject(new BufferObject);
+      else
+      if (bufferObject()) 
+        bufferObject()->clear(); 
+    }
 
     //! Returns the pointer to the first element of the local buffer. Equivalent to bufferObject()->ptr()
     const unsigned char* ptr() const { return bufferObject() ? bufferObject()->ptr() : NULL; }
@@ -159,6 +203,8 @@ namespace vl
     ref<BufferObject> mBufferObject;
     EBufferObjectUsage mBufferObjectUsage;
     bool mBufferObjectDirty;
+    size_t mOffset;
+    size_t mStride;
   };
 //-----------------------------------------------------------------------------
 // Array
@@ -200,13 +246,30 @@ namespace vl
 
     // ---
 
-    void clear() { resize(0); bufferObject()->deleteBufferObject(); }
+    void clear() 
+    { 
+      if (isInterleaved())
+      {
+        ArrayAbstract::clear();
+        return;
+      }
+      resize(0); 
+      bufferObject()->deleteBufferObject(); 
+    }
     
-    void resize(size_t dim) { bufferObject()->resize(dim*bytesPerVector()); }
+    void resize(size_t dim) 
+    { 
+      if (isInterleaved())
+      {
+        Log::error("Array::resize(): interleaved arrays cannot be resized, call Geometry::deinterleaveArrays() first.\n");
+        return;
+      }
+      bufferObject()->resize(dim*bytesPerVector()); 
+    }
     
-    size_t size() const { return bytesUsed() / bytesPerVector(); }
+    size_t size() const { return bytesUsed() / elementStride(); }
     
-    size_t sizeBufferObject() const { return bufferObject() ? bufferObject()->byteCountBufferObject() / bytesPerVector() : 0; }
+    size_t sizeBufferObject() const { return bufferObject() ? bufferObject()->byteCountBufferObject() / elementStride() : 0; }
     
     size_t scalarCount() const { return size() * T_GL_Size; }
     
@@ -214,19 +277,21 @@ namespace vl
 
     // ---
 
-    const T_VectorType* begin() const { return reinterpret_cast<const T_VectorType*>(ptr()); }
+    // begin() and end() return NULL for interleaved arrays, i.e. an empty range, since their elements are not contiguous: use at() instead.
+
+    const T_VectorType* begin() const { return checkContiguous("begin") ? reinterpret_cast<const T_VectorType*>(ptr()) : NULL; }
 
-    T_VectorType* begin() { return reinterpret_cast<T_VectorType*>(ptr()); }
+    T_VectorType* begin() { return checkContiguous("begin") ? reinterpret_cast<T_VectorType*>(ptr()) : NULL; }
     
-    const T_VectorType* end() const { return (reinterpret_cast<const T_VectorType*>(ptr()))+size(); }
+    const T_VectorType* end() const { return checkContiguous("end") ? (reinterpret_cast<const T_VectorType*>(ptr()))+size() : NULL; }
 
-    T_VectorType* end() { return (reinterpret_cast<T_VectorType*>(ptr()))+size(); }
+    T_VectorType* end() { return checkContiguous("end") ? (reinterpret_cast<T_VectorType*>(ptr()))+size() : NULL; }
 
     // ---
 
-    T_VectorType& at(size_t i) { VL_CHECK(i<size()); return *(reinterpret_cast<T_VectorType*>(ptr())+i); }
+    T_VectorType& at(size_t i) { VL_CHECK(i<size()); return *reinterpret_cast<T_VectorType*>(ptr() + mOffset + i*elementStride()); }
 
-    const T_VectorType& at(size_t i) const { VL_CHECK(i<size()); return *(reinterpret_cast<const T_VectorType*>(ptr())+i); }
+    const T_VectorType& at(size_t i) const { VL_CHECK(i<size()); return *reinterpret_cast<const T_VectorType*>(ptr() + mOffset + i*elementStride()); }
 
     T_VectorType& operator[](size_t i) { return at(i); }
 
@@ -242,7 +307,13 @@ namespace vl
       if (size())
       {
         arr->resize(size());
-        memcpy(arr->ptr(), ptr(), bytesUsed());
+        if (isInterleaved())
+        {
+          for(size_t i=0; i<size(); ++i)
+            arr->at(i) = at(i);
+        }
+        else
+          memcpy(arr->ptr(), ptr(), bytesUsed());
       }
       return arr;
     }
@@ -366,12 +437,27 @@ namespace vl
 
     void initFrom(const std::vector<T_VectorType>& vector)
     {
+      if (!checkContiguous("initFrom"))
+        return;
       resize(vector.size());
       if (vector.empty())
         return;
       else
         memcpy(ptr(),&vector[0],sizeof(vector[0])*vector.size());
     }
+
+  protected:
+    size_t elementStride() const { return mStride ? mStride : sizeof(T_VectorType); }
+
+    bool checkContiguous(const char* func) const
+    {
+      if (isInterleaved())
+      {
+        Log::error( Say("Array::%s(): the elements of interleaved arrays are not contiguous, use at() or call Geometry::deinterleaveArrays() first.\n") << func );
+        return false;
+      }
+      return true;
+    }
   };
 //-----------------------------------------------------------------------------
 // Array typedefs
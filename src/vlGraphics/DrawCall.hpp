@@ -121,6 +121,9 @@ namespace vl
     /** Deletes the index buffer's BufferObject. */
     virtual void deleteBufferObject() = 0;
 
+    /** The index buffer's BufferObject, NULL if the draw call does not use an index buffer. */
+    virtual BufferObject* indexBufferObject() { return NULL; }
+
     /** Enables/disables the draw call. */
     void setEnabled(bool enable) { mEnabled = enable; }
 
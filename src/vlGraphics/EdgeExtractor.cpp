@@ -36,30 +36,61 @@
 #include <vlCore/Log.hpp>
 #include <vlGraphics/Array.hpp>
 #include <vlGraphics/Geometry.hpp>
+#include <cstring>
 
 using namespace vl;
 
 //-----------------------------------------------------------------------------
-void EdgeExtractor::addEdge(std::set<EdgeExtractor::Edge>& edges, const EdgeExtractor::Edge& e, const fvec3& n)
+namespace
 {
-  std::set<EdgeExtractor::Edge>::iterator it = edges.find(e);
-  if (it != edges.end())
+  inline u32 floatBits(float f)
   {
-    VL_CHECK(!it->normal1().isNull())
-    if (mWarnNonManifold && !it->normal2().isNull())
-      vl::Log::error("EdgeExtractor: non-manifold mesh detected!\n");
-      EdgeExtractor::Edge edge = e;
-      edge.setNormal1(it->normal1());
-      edge.setNormal2(n);
-      edges.erase( it );
-      edges.insert(edge);
+    // +0 and -0 must hash the same
+    if (f == 0)
+      f = 0;
+    u32 bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
   }
+
+  inline u32 hashPosition(const fvec3& v)
+  {
+    return (floatBits(v.x()) * 73856093u) ^ (floatBits(v.y()) * 19349663u) ^ (floatBits(v.z()) * 83492791u);
+  }
+
+  inline u32 hashEdge(u32 a, u32 b)
+  {
+    u32 h = a * 0x9E3779B1u + b;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h;
+  }
+
+  //! Returns the smallest power of two >= 2*count.
+  inline size_t hashCapacity(size_t count)
+  {
+    size_t capacity = 16;
+    while(capacity < count*2)
+      capacity <<= 1;
+    return capacity;
+  }
+}
+//-----------------------------------------------------------------------------
+void EdgeExtractor::classifyEdge(Edge& e) const
+{
+  // boundary edge
+  if (e.normal2().isNull())
+    e.setIsCrease(true);
   else
+  // crease edge
   {
-    VL_CHECK(!n.isNull());
-    EdgeExtractor::Edge edge = e;
-    edge.setNormal1(n);
-    edges.insert(edge);
+    float cos1 = dot(e.normal1(), e.normal2());
+    cos1 = vl::clamp(cos1,-1.0f,+1.0f);
+    // return value in the interval [0,pi] radians
+    float a1 = acos(cos1) / fPi * 180.0f;
+    if( a1 > creaseAngle() )
+      e.setIsCrease(true);
   }
 }
 //-----------------------------------------------------------------------------
@@ -68,59 +99,95 @@ void EdgeExtractor::extractEdges(Geometry* geom)
 {
   ArrayAbstract* verts = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
 
-  // mic fixme:
-  // here the bottle-neck seems to be the continuous allocation/deallocation and insertion/search time,
-  // maybe a memory-pool-managed hash table would help?
   if (!verts)
   {
     vl::Log::error("EdgeExtractor::extractEdges(geom): 'geom' must have a vertex array of type ArrayFloat3.\n");
     return;
   }
 
-  std::set<Edge> edges;
+  // weld the vertices with the same position so that the edges are shared across attribute seams
+
+  std::vector<fvec3> positions( verts->size() );
+  for(size_t i=0; i<verts->size(); ++i)
+    positions[i] = (fvec3)verts->getAsVec3(i);
+
+  std::vector<u32> vertex_ids( positions.size() );
+  {
+    const size_t mask = hashCapacity( positions.size() ) - 1;
+    std::vector<u32> slots( mask + 1, (u32)-1 );
+    for(u32 i=0; i<positions.size(); ++i)
+    {
+      size_t slot = hashPosition(positions[i]) & mask;
+      for(; slots[slot] != (u32)-1 && positions[ slots[slot] ] != positions[i]; slot = (slot + 1) & mask) {}
+      if (slots[slot] == (u32)-1)
+        slots[slot] = i;
+      vertex_ids[i] = slots[slot];
+    }
+  }
+
+  // collect the edges in an open addressing hash table indexed by welded vertex pair
+
+  // a closed triangle mesh has about three times as many edges as vertices, the table grows if needed
+  size_t expected_edges = positions.size() * 3;
+  size_t mask = hashCapacity( expected_edges ) - 1;
+  std::vector<u32> slots( mask + 1, (u32)-1 );
+  std::vector<u32> edge_keys;
+  std::vector<Edge> edges;
+  edges.reserve( expected_edges );
 
-  // iterate all primitives
   for(int iprim=0; iprim<geom->drawCalls().size(); ++iprim)
   {
-    DrawCall* prim = geom->drawCalls().at(iprim);
-    // iterate triangles (if present)
-    for(TriangleIterator trit = prim->triangleIterator(); trit.hasNext(); trit.next())
+    for(TriangleIterator trit = geom->drawCalls().at(iprim)->triangleIterator(); trit.hasNext(); trit.next())
     {
-      size_t a = trit.a();
-      size_t b = trit.b();
-      size_t c = trit.c();
-      if (a == b || b == c || c == a)
+      const u32 idx[] = { vertex_ids[trit.a()], vertex_ids[trit.b()], vertex_ids[trit.c()] };
+      if (idx[0] == idx[1] || idx[1] == idx[2] || idx[2] == idx[0])
         continue;
       // compute normal
-      fvec3 v0 = (fvec3)verts->getAsVec3(a);
-      fvec3 v1 = (fvec3)verts->getAsVec3(b) - v0;
-      fvec3 v2 = (fvec3)verts->getAsVec3(c) - v0;
-      fvec3 n = cross(v1,v2).normalize();
+      fvec3 n = cross(positions[idx[1]] - positions[idx[0]], positions[idx[2]] - positions[idx[0]]).normalize();
       if (n.isNull())
         continue;
-      addEdge(edges, Edge( (fvec3)verts->getAsVec3(a), (fvec3)verts->getAsVec3(b) ), n );
-      addEdge(edges, Edge( (fvec3)verts->getAsVec3(b), (fvec3)verts->getAsVec3(c) ), n );
-      addEdge(edges, Edge( (fvec3)verts->getAsVec3(c), (fvec3)verts->getAsVec3(a) ), n );
+      for(int side=0; side<3; ++side)
+      {
+        u32 a = std::min( idx[side], idx[(side+1)%3] );
+        u32 b = std::max( idx[side], idx[(side+1)%3] );
+        size_t slot = hashEdge(a, b) & mask;
+        for(; slots[slot] != (u32)-1 && (edge_keys[slots[slot]*2] != a || edge_keys[slots[slot]*2+1] != b); slot = (slot + 1) & mask) {}
+        if (slots[slot] == (u32)-1)
+        {
+          slots[slot] = (u32)edges.size();
+          edge_keys.push_back(a);
+          edge_keys.push_back(b);
+          edges.push_back( Edge(positions[a], positions[b]) );
+          edges.back().setNormal1(n);
+          // keep the load factor below 1/2
+          if (edges.size()*2 > slots.size())
+          {
+            mask = (mask << 1) | 1;
+            slots.assign( mask + 1, (u32)-1 );
+            for(u32 e=0; e<edges.size(); ++e)
+            {
+              size_t s = hashEdge( edge_keys[e*2], edge_keys[e*2+1] ) & mask;
+              for(; slots[s] != (u32)-1; s = (s + 1) & mask) {}
+              slots[s] = e;
+            }
+          }
+        }
+        else
+        {
+          Edge& edge = edges[ slots[slot] ];
+          if (mWarnNonManifold && !edge.normal2().isNull())
+            vl::Log::error("EdgeExtractor: non-manifold mesh detected!\n");
+          edge.setNormal2(n);
+        }
+      }
     }
   }
 
-  for(std::set<Edge>::iterator it = edges.begin(); it != edges.end(); ++it)
+  mEdges.reserve( mEdges.size() + edges.size() );
+  for(size_t i=0; i<edges.size(); ++i)
   {
-    Edge e = *it;
-    // boundary edge
-    if (e.normal2().isNull())
-      e.setIsCrease(true);
-    else
-    // crease edge
-    {
-      float cos1 = dot(e.normal1(), e.normal2());
-      cos1 = vl::clamp(cos1,-1.0f,+1.0f);
-      // return value in the interval [0,pi] radians
-      float a1 = acos(cos1) / fPi * 180.0f;
-      if( a1 > creaseAngle() )
-        e.setIsCrease(true);
-    }
-    mEdges.push_back(e);
+    classifyEdge( edges[i] );
+    mEdges.push_back( edges[i] );
   }
 }
 //-----------------------------------------------------------------------------
@@ -36,7 +36,6 @@
 #include <vlCore/Vector3.hpp>
 #include <vlGraphics/link_config.hpp>
 #include <vector>
-#include <set>
 
 namespace vl
 {
@@ -45,6 +44,7 @@ namespace vl
   class Actor;
   class ActorCollection;
   class Geometry;
+  class ArrayAbstract;
 
   /** The EdgeExtractor class extracts the edges from one or more Geometry objects.
 
@@ -160,7 +160,7 @@ namespace vl
     void setWarnNonManifold(bool warn_on) { mWarnNonManifold = warn_on; }
 
   protected:
-    void addEdge(std::set<EdgeExtractor::Edge>& edges, const EdgeExtractor::Edge& e, const fvec3& n);
+    void classifyEdge(Edge& e) const;
 
   protected:
     std::vector<Edge> mEdges;
@@ -0,0 +1,223 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/EdgeUpdateCallback.hpp>
+#include <vlCore/Thread.hpp>
+#include <algorithm>
+
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+namespace
+{
+  struct SlackKey
+  {
+    float mSlack;
+    int mEdge;
+
+    bool operator<(const SlackKey& other) const
+    {
+      if (mSlack != other.mSlack)
+        return mSlack < other.mSlack;
+      else
+        return mEdge < other.mEdge;
+    }
+  };
+}
+//-----------------------------------------------------------------------------
+void EdgeUpdateCallback::setupEdgeData()
+{
+  size_t count = mEdges.size();
+  mN1X.resize(count); mN1Y.resize(count); mN1Z.resize(count); mD1.resize(count);
+  mN2X.resize(count); mN2Y.resize(count); mN2Z.resize(count); mD2.resize(count);
+  mCrease.resize(count);
+  mVisible.assign(count, 0);
+  for(size_t i=0; i<count; ++i)
+  {
+    const EdgeExtractor::Edge& e = mEdges[i];
+    // both planes pass through the edge
+    fvec3 mid = (e.vertex1() + e.vertex2()) * 0.5f;
+    mN1X[i] = e.normal1().x(); mN1Y[i] = e.normal1().y(); mN1Z[i] = e.normal1().z(); mD1[i] = dot(e.normal1(), mid);
+    mN2X[i] = e.normal2().x(); mN2Y[i] = e.normal2().y(); mN2Z[i] = e.normal2().z(); mD2[i] = dot(e.normal2(), mid);
+    mCrease[i] = e.isCrease() ? 1 : 0;
+  }
+  mEdgesDirty = false;
+  mVerticesValid = false;
+  mReferenceValid = false;
+}
+//-----------------------------------------------------------------------------
+bool EdgeUpdateCallback::updateEdge(int i, const fvec4& eye, ArrayFloat3* vert_array)
+{
+  float side1 = mN1X[i]*eye.x() + mN1Y[i]*eye.y() + mN1Z[i]*eye.z() - mD1[i]*eye.w();
+  float side2 = mN2X[i]*eye.x() + mN2Y[i]*eye.y() + mN2Z[i]*eye.z() - mD2[i]*eye.w();
+  unsigned char visible = (mCrease[i] && mShowCreases) || side1 * side2 < 0 ? 1 : 0;
+  if (visible == mVisible[i])
+    return false;
+  mVisible[i] = visible;
+  if ( visible )
+  {
+    vert_array->at(i*2+0) = mEdges[i].vertex1();
+    vert_array->at(i*2+1) = mEdges[i].vertex2();
+  }
+  else
+  {
+    // degenerate
+    vert_array->at(i*2+0) = vert_array->at(i*2+1);
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+void EdgeUpdateCallback::fullUpdate(const fvec4& eye, ArrayFloat3* vert_array)
+{
+  const int count = (int)mEdges.size();
+
+  // plane distances, written as a plain loop over the SoA arrays so that it can be vectorized
+  std::vector<float> side1(count), side2(count);
+  const float ex = eye.x(), ey = eye.y(), ez = eye.z(), ew = eye.w();
+  const float* n1x = count ? &mN1X[0] : NULL; const float* n1y = count ? &mN1Y[0] : NULL; 
+  const float* n1z = count ? &mN1Z[0] : NULL; const float* d1  = count ? &mD1[0]  : NULL;
+  const float* n2x = count ? &mN2X[0] : NULL; const float* n2y = count ? &mN2Y[0] : NULL; 
+  const float* n2z = count ? &mN2Z[0] : NULL; const float* d2  = count ? &mD2[0]  : NULL;
+  for(int i=0; i<count; ++i)
+  {
+    side1[i] = n1x[i]*ex + n1y[i]*ey + n1z[i]*ez - d1[i]*ew;
+    side2[i] = n2x[i]*ex + n2y[i]*ey + n2z[i]*ez - d2[i]*ew;
+  }
+
+  bool changed = false;
+  for(int i=0; i<count; ++i)
+  {
+    unsigned char visible = (mCrease[i] && mShowCreases) || side1[i] * side2[i] < 0 ? 1 : 0;
+    if (visible == mVisible[i] && mVerticesValid)
+      continue;
+    mVisible[i] = visible;
+    changed = true;
+    if ( visible )
+    {
+      vert_array->at(i*2+0) = mEdges[i].vertex1();
+      vert_array->at(i*2+1) = mEdges[i].vertex2();
+    }
+    else
+    {
+      // degenerate
+      vert_array->at(i*2+0) = vert_array->at(i*2+1);
+    }
+  }
+  if (changed)
+    vert_array->setBufferObjectDirty(true);
+  mVerticesValid = true;
+
+  // orthographic views have no eye position to move
+  if (ew == 0)
+  {
+    mReferenceValid = false;
+    return;
+  }
+
+  // the plane distances change at most by the distance travelled by the eye:
+  // edges always shown or without a second triangle never change status.
+  std::vector<SlackKey> keys;
+  keys.reserve(count);
+  for(int i=0; i<count; ++i)
+  {
+    if ( (mCrease[i] && mShowCreases) || (mN2X[i] == 0 && mN2Y[i] == 0 && mN2Z[i] == 0) )
+      continue;
+    SlackKey key;
+    key.mSlack = std::min( fabs(side1[i]), fabs(side2[i]) );
+    key.mEdge = i;
+    keys.push_back(key);
+  }
+  parallelSort(keys);
+  mSortedSlack.resize( keys.size() );
+  mSlackOrder.resize( keys.size() );
+  for(size_t i=0; i<keys.size(); ++i)
+  {
+    mSortedSlack[i] = keys[i].mSlack;
+    mSlackOrder[i] = keys[i].mEdge;
+  }
+  mReferenceEye = fvec3(ex, ey, ez);
+  mReferenceValid = true;
+  mLastShowCreases = mShowCreases;
+}
+//-----------------------------------------------------------------------------
+void EdgeUpdateCallback::onActorRenderStarted(Actor* act, real /*frame_clock*/, const Camera* cam, Renderable* renderable, const Shader*, int pass)
+{
+  if (pass != 0)
+    return;
+
+  ref<Geometry> geom = cast<Geometry>(renderable);
+  ArrayFloat3* vert_array = geom ? cast<ArrayFloat3>(geom->vertexArray()) : NULL;
+  if (!vert_array)
+    return;
+  VL_CHECK(vert_array->size() >= edges().size()*2);
+
+  if (mEdgesDirty)
+    setupEdgeData();
+
+  if (vert_array != mVertArray)
+  {
+    mVertArray = vert_array;
+    mVerticesValid = false;
+    mReferenceValid = false;
+  }
+
+  // bring the eye in object space, the edge planes are tested against it
+  fmat4 world_inv;
+  if (act->transform())
+    world_inv = (fmat4)act->transform()->worldMatrix().getInverse();
+  fvec4 eye;
+  if (cam->projectionMatrixType() == PMT_OrthographicProjection)
+    eye = fvec4( world_inv.as3x3() * (fvec3)cam->modelingMatrix().getZ(), 0 );
+  else
+    eye = fvec4( world_inv * (fvec3)cam->modelingMatrix().getT(), 1 );
+
+  if (!mReferenceValid || eye.w() == 0 || mLastShowCreases != mShowCreases)
+  {
+    fullUpdate(eye, vert_array);
+    return;
+  }
+
+  // re-test only the edges whose planes may have been crossed by the eye
+  float travel = (eye.xyz() - mReferenceEye).length();
+  int retest = (int)(std::upper_bound(mSortedSlack.begin(), mSortedSlack.end(), travel) - mSortedSlack.begin());
+  if (retest > (int)mSortedSlack.size() / 4)
+  {
+    fullUpdate(eye, vert_array);
+    return;
+  }
+
+  bool changed = false;
+  for(int i=0; i<retest; ++i)
+    changed |= updateEdge(mSlackOrder[i], eye, vert_array);
+  if (changed)
+    vert_array->setBufferObjectDirty(true);
+}
+//-----------------------------------------------------------------------------
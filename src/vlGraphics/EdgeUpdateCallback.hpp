@@ -40,18 +40,22 @@
 namespace vl
 {
   //! The EdgeUpdateCallback class updates at every frame the edges of an Actor for the purpose of edge-enhancement.
+  //!
+  //! The edges are stored in SoA form together with the planes of their two adjacent triangles. With a perspective camera
+  //! an edge can change its silhouette status only when the eye crosses one of its planes, so after a full update only the edges
+  //! whose planes are closer to the eye than the distance it has moved since then are re-tested.
   //! \sa EdgeExtractor
-  class EdgeUpdateCallback: public ActorEventCallback
+  class VLGRAPHICS_EXPORT EdgeUpdateCallback: public ActorEventCallback
   {
     VL_INSTRUMENT_CLASS(vl::EdgeUpdateCallback, ActorEventCallback)
 
   public:
-    EdgeUpdateCallback(): mShowCreases(true) 
+    EdgeUpdateCallback(): mShowCreases(true), mLastShowCreases(true), mEdgesDirty(true), mVerticesValid(false), mReferenceValid(false)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
 
-    EdgeUpdateCallback(const std::vector<EdgeExtractor::Edge>& edge): mEdges(edge), mShowCreases(false) 
+    EdgeUpdateCallback(const std::vector<EdgeExtractor::Edge>& edge): mEdges(edge), mShowCreases(false), mLastShowCreases(false), mEdgesDirty(true), mVerticesValid(false), mReferenceValid(false)
     {
       VL_DEBUG_SET_OBJECT_NAME()
     }
@@ -63,51 +67,37 @@ namespace vl
 
     virtual void onActorDelete(Actor*) {}
 
-    virtual void onActorRenderStarted(Actor* act, real /*frame_clock*/, const Camera* cam, Renderable* renderable, const Shader*, int pass)
-    {
-      if (pass != 0)
-        return;
+    virtual void onActorRenderStarted(Actor* act, real frame_clock, const Camera* cam, Renderable* renderable, const Shader*, int pass);
 
-      fmat4 vmat = (fmat4)cam->viewMatrix();
-      if (act->transform())
-        vmat = vmat * (fmat4)act->transform()->worldMatrix();
-      fmat4 nmat = vmat.as3x3();
-      nmat = nmat.getInverse().transpose();
+    const std::vector<EdgeExtractor::Edge>& edges() const { return mEdges; }
+    //! Returns the edges for modification, all of them will be re-tested at the next update.
+    std::vector<EdgeExtractor::Edge>& edges() { invalidate(); return mEdges; }
 
-      ref<Geometry> geom = cast<Geometry>(renderable);
-      ref<ArrayFloat3> vert_array = cast<ArrayFloat3>(geom->vertexArray());
-      // VL_CHECK(vert_array->size() == edges().size()*2);
-      for(unsigned i=0; i<edges().size(); ++i)
-      {
-        bool insert_edge = edges()[i].isCrease() && showCreases();
-        if (!insert_edge)
-        {
-          fvec3 v1 = vmat * edges()[i].vertex1();
-          fvec3 v2 = vmat * edges()[i].vertex2();
-          fvec3 v  = ((v1+v2) * 0.5f).normalize();
-          fvec3 n1 = nmat * edges()[i].normal1();
-          fvec3 n2 = nmat * edges()[i].normal2();
-          insert_edge = dot(n1, v) * dot(n2, v) < 0;
-        }
-        if ( insert_edge )
-        {
-          vert_array->at(i*2+0) = edges()[i].vertex1();
-          vert_array->at(i*2+1) = edges()[i].vertex2();
-        }
-        else
-        {
-          // degenerate
-          vert_array->at(i*2+0) = vert_array->at(i*2+1);
-        }
-      }
-    }
+    //! Forces the next update to re-test all the edges.
+    void invalidate() { mEdgesDirty = true; }
 
-    const std::vector<EdgeExtractor::Edge>& edges() const { return mEdges; }
-    std::vector<EdgeExtractor::Edge>& edges() { return mEdges; }
+  protected:
+    void setupEdgeData();
+    bool updateEdge(int i, const fvec4& eye, ArrayFloat3* vert_array);
+    void fullUpdate(const fvec4& eye, ArrayFloat3* vert_array);
 
   private:
     std::vector<EdgeExtractor::Edge> mEdges;
+    // SoA copy of the edges: the planes of the two adjacent triangles
+    std::vector<float> mN1X, mN1Y, mN1Z, mD1;
+    std::vector<float> mN2X, mN2Y, mN2Z, mD2;
+    std::vector<unsigned char> mCrease;
+    std::vector<unsigned char> mVisible;
+    // edges sorted by the distance of their closest plane from mReferenceEye
+    std::vector<float> mSortedSlack;
+    std::vector<int> mSlackOrder;
+    fvec3 mReferenceEye;
+    ref<ArrayFloat3> mVertArray;
     bool mShowCreases;
+    bool mLastShowCreases;
+    bool mEdgesDirty;
+    bool mVerticesValid;
+    bool mReferenceValid;
   };
 
 }
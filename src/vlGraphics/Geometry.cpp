@@ -34,6 +34,7 @@
 #include <vlGraphics/DoubleVertexRemover.hpp>
 #include <vlGraphics/MultiDrawElements.hpp>
 #include <vlGraphics/DrawRangeElements.hpp>
+#include <vlCore/Thread.hpp>
 #include <cmath>
 #include <algorithm>
 
@@ -104,6 +105,8 @@ ref<Geometry> Geometry::deepCopy() const
 //-----------------------------------------------------------------------------
 Geometry& Geometry::deepCopyFrom(const Geometry& other)
 {
+  invalidateMeshAdjacency();
+
   // copy the base class Renderable
   super::operator=(other);
 
@@ -146,6 +149,8 @@ ref<Geometry> Geometry::shallowCopy() const
 //-----------------------------------------------------------------------------
 Geometry& Geometry::shallowCopyFrom(const Geometry& other)
 {
+  invalidateMeshAdjacency();
+
   // copy the base class Renderable
   super::operator=(other);
 
@@ -175,10 +180,12 @@ void Geometry::setNormalArray(ArrayAbstract* data)
 {
   // if one of this checks fail read the OpenGL Programmers Guide or the Reference Manual 
   // to see what "size" and "type" are allowed for glNormalPointer
-  VL_CHECK( !data || data->glSize() == 3 )
+  VL_CHECK( !data || data->glSize() == 3 || (data->glSize() == 1 && data->glType() == GL_INT_2_10_10_10_REV) )
   VL_CHECK( !data || (data->glType() == GL_BYTE||
                       data->glType() == GL_SHORT ||
                       data->glType() == GL_INT ||
+                      data->glType() == GL_HALF_FLOAT ||
+                      data->glType() == GL_INT_2_10_10_10_REV ||
                       data->glType() == GL_FLOAT ||
                       data->glType() == GL_DOUBLE) );
 
@@ -196,6 +203,7 @@ void Geometry::setColorArray(ArrayAbstract* data)
                       data->glType() == GL_UNSIGNED_BYTE ||
                       data->glType() == GL_UNSIGNED_SHORT ||
                       data->glType() == GL_UNSIGNED_INT ||
+                      data->glType() == GL_HALF_FLOAT ||
                       data->glType() == GL_FLOAT ||
                       data->glType() == GL_DOUBLE) );
 
@@ -236,6 +244,7 @@ void Geometry::setTexCoordArray(int tex_unit, ArrayAbstract* data)
   VL_CHECK( !data || (data->glSize() == 1 || data->glSize() == 2 || data->glSize() == 3 || data->glSize() == 4) )
   VL_CHECK( !data || (data->glType() == GL_FLOAT  || 
                       data->glType() == GL_DOUBLE ||
+                      data->glType() == GL_HALF_FLOAT ||
                       data->glType() == GL_SHORT  ||
                       data->glType() == GL_INT) );
 
@@ -258,6 +267,8 @@ void Geometry::setTexCoordArray(int tex_unit, ArrayAbstract* data)
 //-----------------------------------------------------------------------------
 void Geometry::clearArrays(bool clear_draw_calls)
 {
+  invalidateMeshAdjacency();
+
   setBufferObjectDirty(true);
   mVertexArray = NULL;
   mNormalArray = NULL;
@@ -343,6 +354,33 @@ void Geometry::convertToVertexAttribs()
 
 }
 //-----------------------------------------------------------------------------
+namespace
+{
+  //! Averages the normals of the triangles sharing each vertex.
+  class VertexNormalsTask: public ParallelForTask
+  {
+  public:
+    VertexNormalsTask(const MeshAdjacency* adjacency, const std::vector<fvec3>& tri_normals, ArrayFloat3* normals):
+      mAdjacency(adjacency), mTriangleNormals(tri_normals), mNormals(normals) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      for(int v=begin; v<end; ++v)
+      {
+        fvec3 n;
+        for(int i=0; i<mAdjacency->vertexTriangleCount(v); ++i)
+          n += mTriangleNormals[ mAdjacency->vertexTriangle(v, i) ];
+        mNormals->at(v) = n.normalize();
+      }
+    }
+
+  private:
+    const MeshAdjacency* mAdjacency;
+    const std::vector<fvec3>& mTriangleNormals;
+    ArrayFloat3* mNormals;
+  };
+}
+//-----------------------------------------------------------------------------
 void Geometry::computeNormals(bool verbose)
 {
   // Retrieve vertex position array
@@ -353,6 +391,11 @@ void Geometry::computeNormals(bool verbose)
     return;
   }
 
+  // the normals are shared by the triangles using the same vertex index
+  MeshAdjacency adjacency;
+  adjacency.build(this, false);
+  VL_CHECK( adjacency.vertexCount() == (int)posarr->size() )
+
   ref<ArrayFloat3> norm3f = new ArrayFloat3;
   norm3f->resize( posarr->size() );
 
@@ -362,132 +405,172 @@ void Geometry::computeNormals(bool verbose)
   else
     setVertexAttribArray(VA_Normal, norm3f.get());
 
-  // zero the normals
-  for(u32 i=0; i<norm3f->size(); ++i)
-    (*norm3f)[i] = 0;
+  // degenerate triangles get a null normal and don't contribute to the vertex normals
+  std::vector<fvec3> tri_normals;
+  adjacency.triangleNormals(posarr, tri_normals);
 
-  // iterate all draw calls
-  for(int prim=0; prim<(int)drawCalls().size(); prim++)
+  if (verbose)
   {
-    // iterate all triangles, if present
-    for(TriangleIterator trit = mDrawCalls[prim]->triangleIterator(); trit.hasNext(); trit.next())
+    for(int tri=0; tri<adjacency.triangleCount(); ++tri)
     {
-      u32 a = trit.a();
-      u32 b = trit.b();
-      u32 c = trit.c();
-
-      if (verbose)
+      u32 a = adjacency.triangles()[tri*3+0];
+      u32 b = adjacency.triangles()[tri*3+1];
+      u32 c = adjacency.triangles()[tri*3+2];
       if (a == b || b == c || c == a)
-      {
         Log::warning( Say("Geometry::computeNormals(): skipping degenerate triangle %n %n %n\n") << a << b << c );
-        continue;
-      }
+      else
+      if (posarr->getAsVec3(a) == posarr->getAsVec3(b) || posarr->getAsVec3(b) == posarr->getAsVec3(c) || posarr->getAsVec3(c) == posarr->getAsVec3(a))
+        Log::warning("Geometry::computeNormals(): skipping degenerate triangle (same vertex coodinate).\n");
+      else
+      if ( fabs(1.0f - tri_normals[tri].length()) > 0.1f )
+        Log::warning("Geometry::computeNormals(): skipping degenerate triangle (normalization failed).\n");
+    }
+  }
 
-      VL_CHECK( a < posarr->size() )
-      VL_CHECK( b < posarr->size() )
-      VL_CHECK( c < posarr->size() )
+  VertexNormalsTask vert_task(&adjacency, tri_normals, norm3f.get());
+  parallelFor(0, (int)norm3f->size(), &vert_task);
+}
+//-----------------------------------------------------------------------------
+void Geometry::deleteBufferObject()
+{
+  if (!Has_BufferObject)
+    return;
 
-      vec3 n, v0, v1, v2;
+  for(int i=0; i<(int)drawCalls().size(); ++i)
+    drawCalls().at(i)->deleteBufferObject();
 
-      v0 = posarr->getAsVec3(a);
-      v1 = posarr->getAsVec3(b);
-      v2 = posarr->getAsVec3(c);
+  std::vector<ArrayAbstract*> arrays;
+  collectArrays(arrays);
+  for(size_t i=0; i<arrays.size(); ++i)
+    arrays[i]->bufferObject()->deleteBufferObject();
+}
+//-----------------------------------------------------------------------------
+void Geometry::updateDirtyBufferObject(EBufferObjectUpdateMode mode)
+{
+  if (!Has_BufferObject)
+    return;
 
-      if (verbose)
-      if (v0 == v1 || v1 == v2 || v2 == v0)
-      {
-        Log::warning("Geometry::computeNormals(): skipping degenerate triangle (same vertex coodinate).\n");
-        continue;
-      }
+  bool force_update = (mode & BUF_ForceUpdate) != 0;
 
-      v1 -= v0;
-      v2 -= v0;
+  std::vector<ArrayAbstract*> arrays;
+  collectArrays(arrays);
 
-      n = cross(v1, v2);
-      n.normalize();
-      if (verbose)
-      if ( fabs(1.0f - n.length()) > 0.1f )
+  // interleaved arrays share the same BufferObject which must be updated only once
+  std::vector<const BufferObject*> updated;
+  for(size_t i=0; i<arrays.size(); ++i)
+  {
+    ArrayAbstract* arr = arrays[i];
+    if ( !arr->isBufferObjectDirty() && !force_update )
+      continue;
+    if ( arr->isInterleaved() )
+    {
+      if ( std::find(updated.begin(), updated.end(), arr->bufferObject()) != updated.end() )
       {
-        Log::warning("Geometry::computeNormals(): skipping degenerate triangle (normalization failed).\n");
+        arr->setBufferObjectDirty(false);
         continue;
       }
-
-      (*norm3f)[a] += (fvec3)n;
-      (*norm3f)[b] += (fvec3)n;
-      (*norm3f)[c] += (fvec3)n;
+      updated.push_back( arr->bufferObject() );
     }
+    arr->updateBufferObject(mode);
   }
 
-  // normalize the normals
-  for(int i=0; i<(int)norm3f->size(); ++i)
-    (*norm3f)[i].normalize();
+  for(int i=0; i<drawCalls().size(); ++i)
+    drawCalls().at(i)->updateDirtyBufferObject(mode);
 }
 //-----------------------------------------------------------------------------
-void Geometry::deleteBufferObject()
+void Geometry::collectArrays(std::vector<ArrayAbstract*>& arrays) const
 {
-  if (!Has_BufferObject)
-    return;
-
-  for(int i=0; i<(int)drawCalls().size(); ++i)
-    drawCalls().at(i)->deleteBufferObject();
+  arrays.clear();
 
   if (mVertexArray)
-    mVertexArray->bufferObject()->deleteBufferObject();
-  
+    arrays.push_back( mVertexArray.get_writable() );
+
   if (mNormalArray)
-    mNormalArray->bufferObject()->deleteBufferObject();
-  
+    arrays.push_back( mNormalArray.get_writable() );
+
   if (mColorArray)
-    mColorArray->bufferObject()->deleteBufferObject();
-  
+    arrays.push_back( mColorArray.get_writable() );
+
   if (mSecondaryColorArray)
-    mSecondaryColorArray->bufferObject()->deleteBufferObject();
-  
+    arrays.push_back( mSecondaryColorArray.get_writable() );
+
   if (mFogCoordArray)
-    mFogCoordArray->bufferObject()->deleteBufferObject();
-  
-  for (int i=0; i<mTexCoordArrays.size(); ++i)
-    mTexCoordArrays[i]->mTexCoordArray->bufferObject()->deleteBufferObject();
+    arrays.push_back( mFogCoordArray.get_writable() );
 
-  for(int i=0; i<vertexAttribArrays().size(); ++i)
-    if ( vertexAttribArrays().at(i)->data() )
-      vertexAttribArrays().at(i)->data()->bufferObject()->deleteBufferObject();
+  for(int i=0; i<mTexCoordArrays.size(); ++i)
+    arrays.push_back( mTexCoordArrays[i]->mTexCoordArray.get_writable() );
+
+  for(int i=0; i<mVertexAttribArrays.size(); ++i)
+    if ( mVertexAttribArrays[i]->data() )
+      arrays.push_back( const_cast<ArrayAbstract*>(mVertexAttribArrays.at(i)->data()) );
 }
 //-----------------------------------------------------------------------------
-void Geometry::updateDirtyBufferObject(EBufferObjectUpdateMode mode)
+bool Geometry::interleaveArrays()
 {
-  if (!Has_BufferObject)
-    return;
+  std::vector<ArrayAbstract*> arrays;
+  collectArrays(arrays);
+  if (arrays.empty())
+    return false;
 
-  bool force_update = (mode & BUF_ForceUpdate) != 0;
+  // interleaved arrays are first converted back to independent arrays
+  deinterleaveArrays();
+  collectArrays(arrays);
 
-  if ( mVertexArray && (mVertexArray->isBufferObjectDirty() || force_update) )
-    mVertexArray->updateBufferObject(mode);
-  
-  if ( mNormalArray && (mNormalArray->isBufferObjectDirty() || force_update) )
-    mNormalArray->updateBufferObject(mode);
-  
-  if ( mColorArray && (mColorArray->isBufferObjectDirty() || force_update) )
-    mColorArray->updateBufferObject(mode);
-  
-  if ( mSecondaryColorArray && (mSecondaryColorArray->isBufferObjectDirty() || force_update) )
-    mSecondaryColorArray->updateBufferObject(mode);
-  
-  if ( mFogCoordArray && (mFogCoordArray->isBufferObjectDirty() || force_update) )
-    mFogCoordArray->updateBufferObject(mode);
-  
-  for(int i=0; i<mTexCoordArrays.size(); ++i)
+  // compute the layout
+  size_t vert_count = arrays[0]->size();
+  std::vector<size_t> offsets;
+  std::vector<size_t> elem_sizes;
+  size_t stride = 0;
+  for(size_t i=0; i<arrays.size(); ++i)
   {
-    if ( mTexCoordArrays[i]->mTexCoordArray->isBufferObjectDirty() || force_update )
-      mTexCoordArrays[i]->mTexCoordArray->updateBufferObject(mode);
+    if (arrays[i]->size() != vert_count)
+    {
+      Log::error("Geometry::interleaveArrays() failed: vertex arrays have different sizes.\n");
+      return false;
+    }
+    size_t elem_size = vert_count ? arrays[i]->bytesUsed() / vert_count : 0;
+    offsets.push_back(stride);
+    elem_sizes.push_back(elem_size);
+    stride += (elem_size + 3) & ~(size_t)3;
   }
-  
-  for(int i=0; i<vertexAttribArrays().size(); ++i)
-    if ( vertexAttribArrays().at(i)->data() && (vertexAttribArrays().at(i)->data()->isBufferObjectDirty() || force_update) )
-      vertexAttribArrays().at(i)->data()->updateBufferObject(mode);
+  if (!vert_count || !stride)
+    return false;
 
-  for(int i=0; i<drawCalls().size(); ++i)
-    drawCalls().at(i)->updateDirtyBufferObject(mode);
+  // fill the interleaved buffer
+  ref<BufferObject> buffer = new BufferObject;
+  buffer->resize( vert_count * stride );
+  memset( buffer->ptr(), 0, buffer->bytesUsed() );
+  for(size_t i=0; i<arrays.size(); ++i)
+  {
+    unsigned char* dst = buffer->ptr() + offsets[i];
+    const unsigned char* src = arrays[i]->ptr();
+    for(size_t v=0; v<vert_count; ++v, dst += stride, src += elem_sizes[i])
+      memcpy(dst, src, elem_sizes[i]);
+  }
+
+  // the arrays now share the interleaved buffer
+  for(size_t i=0; i<arrays.size(); ++i)
+  {
+    arrays[i]->bufferObject()->deleteBufferObject();
+    arrays[i]->setBufferObject( buffer.get(), offsets[i], stride );
+  }
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+void Geometry::deinterleaveArrays()
+{
+  std::vector<ArrayAbstract*> arrays;
+  collectArrays(arrays);
+  for(size_t i=0; i<arrays.size(); ++i)
+  {
+    if (!arrays[i]->isInterleaved())
+      continue;
+    // clone() always generates a tightly packed array
+    ref<ArrayAbstract> packed = arrays[i]->clone();
+    arrays[i]->bufferObject()->deleteBufferObject();
+    arrays[i]->setBufferObject( packed->bufferObject() );
+  }
 }
 //-----------------------------------------------------------------------------
 void Geometry::render_Implementation(const Actor*, const Shader*, const Camera*, OpenGLContext* gl_context) const
@@ -510,6 +593,8 @@ void Geometry::render_Implementation(const Actor*, const Shader*, const Camera*,
 //-----------------------------------------------------------------------------
 void Geometry::transform(const mat4& m, bool normalize)
 {
+  invalidateMeshAdjacency();
+
   ArrayAbstract* posarr = vertexArray() ? vertexArray() : vertexAttribArray(vl::VA_Position) ? vertexAttribArray(vl::VA_Position)->data() : NULL;
   if (posarr)
     posarr->transform(m);
@@ -556,6 +641,8 @@ VertexAttribInfo* Geometry::vertexAttribArray(unsigned int attrib_location)
 //-----------------------------------------------------------------------------
 DrawCall* Geometry::mergeTriangleStrips()
 {
+  invalidateMeshAdjacency();
+
   ArrayAbstract* posarr = vertexArray() ? vertexArray() : vertexAttribArray(vl::VA_Position) ? vertexAttribArray(vl::VA_Position)->data() : NULL;
 
   if (!posarr)
@@ -626,6 +713,8 @@ DrawCall* Geometry::mergeTriangleStrips()
 //-----------------------------------------------------------------------------
 void Geometry::mergeDrawCallsWithPrimitiveRestart(EPrimitiveType primitive_type)
 {
+  invalidateMeshAdjacency();
+
   u32 total_index_count = 0;
   std::vector< ref<DrawCall> > mergendo_calls;
   for( u32 i=drawCalls().size(); i--; )
@@ -680,6 +769,8 @@ void Geometry::mergeDrawCallsWithPrimitiveRestart(EPrimitiveType primitive_type)
 //-----------------------------------------------------------------------------
 void Geometry::mergeDrawCallsWithMultiDrawElements(EPrimitiveType primitive_type)
 {
+  invalidateMeshAdjacency();
+
   u32 total_index_count = 0;
   std::vector< ref<DrawCall> > mergendo_calls;
   std::vector<GLsizei> count_vector;
@@ -731,6 +822,8 @@ void Geometry::mergeDrawCallsWithMultiDrawElements(EPrimitiveType primitive_type
 //-----------------------------------------------------------------------------
 void Geometry::mergeDrawCallsWithTriangles(EPrimitiveType primitive_type)
 {
+  invalidateMeshAdjacency();
+
   u32 triangle_count = 0;
   std::vector< ref<DrawCall> > mergendo_calls;
   for( u32 i=drawCalls().size(); i--; )
@@ -805,10 +898,11 @@ void Geometry::fixTriangleWinding()
 
   ArrayAbstract* normarr = normalArray() ? normalArray() : vertexAttribArray(vl::VA_Normal) ? vertexAttribArray(vl::VA_Normal)->data() : NULL;
 
-  // fixing the triangle winding requires normals
-  if ( normarr == NULL || posarr == NULL )
+  if ( posarr == NULL )
     return;
 
+  invalidateMeshAdjacency();
+
   u32 triangle_count = 0;
   std::vector< ref<DrawCall> > mergendo_calls;
   for( u32 i=drawCalls().size(); i--; )
@@ -837,52 +931,113 @@ void Geometry::fixTriangleWinding()
   // preseve rendering order
   std::reverse(mergendo_calls.begin(), mergendo_calls.end());
 
-  ref<DrawElementsUInt> de = new DrawElementsUInt;
-  ArrayUInt1& index_buffer = *de->indexBuffer();
-  index_buffer.resize( triangle_count * 3 );
-  u32 idx = 0;
+  std::vector<u32> triangles;
+  triangles.reserve( triangle_count * 3 );
   for(u32 i=0; i<mergendo_calls.size(); ++i)
   {
-    for(TriangleIterator it = mergendo_calls[i]->triangleIterator(); it.hasNext(); it.next(), idx+=3)
+    for(TriangleIterator it = mergendo_calls[i]->triangleIterator(); it.hasNext(); it.next())
     {
-      VL_CHECK( idx+2 < index_buffer.size() );
-
-      vec3 p0 = posarr->getAsVec3(it.a());
-      vec3 p1 = posarr->getAsVec3(it.b());
-      vec3 p2 = posarr->getAsVec3(it.c());
-      p1 = (p1 - p0).normalize();
-      p2 = (p2 - p0).normalize();
-      vec3 n1 = vl::cross(p1, p2);
-
-      vec3 v0 = normarr->getAsVec3(it.a());
-      vec3 v1 = normarr->getAsVec3(it.b());
-      vec3 v2 = normarr->getAsVec3(it.c());
-      vec3 n2 = (v0+v1+v2).normalize();
+      // some sanity checks since we are here...
+      VL_CHECK( it.a() < (int)posarr->size() && it.b() < (int)posarr->size() && it.c() < (int)posarr->size() );
+      VL_CHECK( it.a() >= 0 && it.b() >= 0 && it.c() >= 0 );
+      triangles.push_back( it.a() );
+      triangles.push_back( it.b() );
+      triangles.push_back( it.c() );
+    }
+  }
+  VL_CHECK( triangles.size() == triangle_count * 3 );
+
+  // propagate a consistent orientation across the manifold edges shared by two triangles
+  MeshAdjacency adjacency;
+  adjacency.build( posarr, triangles, true );
+  std::vector<int> flip( adjacency.triangleCount(), -1 );
+  std::vector<int> component;
+  for(int seed=0; seed<adjacency.triangleCount(); ++seed)
+  {
+    if (flip[seed] != -1)
+      continue;
 
-      if (dot(n1, n2) > 0)
-      {
-        index_buffer[idx+0] = it.a();
-        index_buffer[idx+1] = it.b();
-        index_buffer[idx+2] = it.c();
-      }
-      else
+    component.clear();
+    component.push_back(seed);
+    flip[seed] = 0;
+    for(size_t icomp=0; icomp<component.size(); ++icomp)
+    {
+      int tri = component[icomp];
+      for(int side=0; side<3; ++side)
       {
-        index_buffer[idx+0] = it.a();
-        index_buffer[idx+1] = it.c();
-        index_buffer[idx+2] = it.b();
+        int neighbor = adjacency.triangleNeighbor(tri, side);
+        if (neighbor == -1 || flip[neighbor] != -1)
+          continue;
+        int e = adjacency.triangleEdge(tri, side);
+        int h = adjacency.edgeHalfEdge(e, 0) == tri*3+side ? adjacency.edgeHalfEdge(e, 1) : adjacency.edgeHalfEdge(e, 0);
+        // two neighbors are consistent when they walk the shared edge in opposite directions
+        bool same_direction = adjacency.triangleVertex(tri, side) == adjacency.triangleVertex(h/3, h%3);
+        flip[neighbor] = flip[tri] ^ (same_direction ? 1 : 0);
+        component.push_back(neighbor);
       }
+    }
 
-      // some sanity checks since we are here...
-      VL_CHECK( it.a() < (int)posarr->size() && it.b() < (int)posarr->size() && it.c() < (int)posarr->size() );
-      VL_CHECK( it.a() >= 0 && it.b() >= 0 && it.c() >= 0 );
+    // orient the component according to the normals or outwards if there are no normals
+    vec3 center;
+    if (!normarr)
+    {
+      for(size_t i=0; i<component.size(); ++i)
+        center += posarr->getAsVec3( triangles[component[i]*3] );
+      center /= (real)component.size();
     }
+    real vote = 0;
+    for(size_t i=0; i<component.size(); ++i)
+    {
+      int tri = component[i];
+      vec3 n = (vec3)adjacency.triangleNormal(posarr, tri);
+      if (flip[tri])
+        n = -n;
+      if (normarr)
+        vote += dot( n, normarr->getAsVec3(triangles[tri*3+0]) + normarr->getAsVec3(triangles[tri*3+1]) + normarr->getAsVec3(triangles[tri*3+2]) );
+      else
+        vote += dot( n, posarr->getAsVec3(triangles[tri*3]) - center );
+    }
+    if (vote < 0)
+      for(size_t i=0; i<component.size(); ++i)
+        flip[component[i]] ^= 1;
+  }
+
+  ref<DrawElementsUInt> de = new DrawElementsUInt;
+  ArrayUInt1& index_buffer = *de->indexBuffer();
+  index_buffer.resize( triangles.size() );
+  for(int tri=0; tri<adjacency.triangleCount(); ++tri)
+  {
+    index_buffer[tri*3+0] = triangles[tri*3+0];
+    index_buffer[tri*3+1] = triangles[tri*3 + (flip[tri] ? 2 : 1)];
+    index_buffer[tri*3+2] = triangles[tri*3 + (flip[tri] ? 1 : 2)];
   }
-  VL_CHECK( idx == index_buffer.size() );
   drawCalls().push_back(de.get());
 }
 //-----------------------------------------------------------------------------
+const MeshAdjacency* Geometry::meshAdjacency(bool weld_vertices) const
+{
+  const ArrayAbstract* posarr = vertexArray() ? vertexArray() : vertexAttribArray(vl::VA_Position) ? vertexAttribArray(vl::VA_Position)->data() : NULL;
+  if (!posarr)
+    return NULL;
+
+  if ( !mMeshAdjacency || !mMeshAdjacency->isUpToDate(this, weld_vertices) )
+  {
+    mMeshAdjacency = new MeshAdjacency;
+    mMeshAdjacency->build(this, weld_vertices);
+  }
+
+  return mMeshAdjacency.get();
+}
+//-----------------------------------------------------------------------------
 void Geometry::regenerateVertices(const std::vector<u32>& map_new_to_old)
 {
+  invalidateMeshAdjacency();
+
+  // the regenerated arrays are tightly packed, interleave them again if needed
+  std::vector<ArrayAbstract*> arrays;
+  collectArrays(arrays);
+  bool interleaved = !arrays.empty() && arrays[0]->isInterleaved();
+
   VertexMapper mapper;
 
   if (vertexArray())
@@ -906,10 +1061,15 @@ void Geometry::regenerateVertices(const std::vector<u32>& map_new_to_old)
 
   for(int i=0; i<vertexAttribArrays().size(); ++i)
     vertexAttribArrays().at(i)->setData( mapper.regenerate(vertexAttribArrays().at(i)->data(), map_new_to_old ).get() );
+
+  if (interleaved)
+    interleaveArrays();
 }
 //-----------------------------------------------------------------------------
 void Geometry::convertDrawCallToDrawArrays()
 {
+  invalidateMeshAdjacency();
+
   ArrayAbstract* posarr = vertexArray() ? vertexArray() : vertexAttribArray(vl::VA_Position) ? vertexAttribArray(vl::VA_Position)->data() : NULL;
 
   // generate mapping 
@@ -934,6 +1094,8 @@ void Geometry::convertDrawCallToDrawArrays()
 //-----------------------------------------------------------------------------
 void Geometry::triangulateDrawCalls()
 {
+  invalidateMeshAdjacency();
+
   // converts PT_QUADS, PT_QUADS_STRIP and PT_POLYGON into PT_TRIANGLES
   for( int idraw=this->drawCalls().size(); idraw--; )
   {
@@ -1156,6 +1318,145 @@ void Geometry::shrinkDrawCalls()
   } // for()
 }
 //-----------------------------------------------------------------------------
+namespace
+{
+  // Marks the primitive restart indices independently from the index type.
+  const u32 RestartMarker = 0xFFFFFFFF;
+
+  // Collects the indices of a DrawElements* baking the base vertex. Custom count and offset are not supported.
+  template<class TDrawElements>
+  bool collectIndices(const DrawCall* dc, std::vector<u32>& indices)
+  {
+    const TDrawElements* de = dc->as<TDrawElements>();
+    if (!de || de->count() >= 0 || de->offset())
+      return false;
+    indices.resize( de->indexBuffer()->size() );
+    for(size_t i=0; i<indices.size(); ++i)
+    {
+      u32 idx = de->indexBuffer()->at(i);
+      if (de->primitiveRestartEnabled() && idx == TDrawElements::primitive_restart_index)
+        indices[i] = RestartMarker;
+      else
+        indices[i] = idx + de->baseVertex();
+    }
+    return true;
+  }
+
+  // Generates a DrawElements* containing the indices [start,end) rebased to 'base'.
+  template<class TDrawElements>
+  ref<DrawCall> rebasedDrawElements(const DrawElementsBase* src, const std::vector<u32>& indices, size_t start, size_t end, u32 base)
+  {
+    ref<TDrawElements> de = new TDrawElements( src->primitiveType(), src->instances() );
+    de->setPrimitiveRestartEnabled( src->primitiveRestartEnabled() );
+    de->setBaseVertex( base );
+    de->setEnabled( src->isEnabled() );
+    de->setPatchParameter( const_cast<PatchParameter*>(src->patchParameter()) );
+    de->indexBuffer()->resize( end - start );
+    typename TDrawElements::index_type* ptr = de->indexBuffer()->begin();
+    for(size_t i=start; i<end; ++i, ++ptr)
+    {
+      if (indices[i] == RestartMarker)
+        *ptr = TDrawElements::primitive_restart_index;
+      else
+      {
+        VL_CHECK(indices[i] >= base)
+        *ptr = (typename TDrawElements::index_type)(indices[i] - base);
+      }
+    }
+    return de;
+  }
+}
+//-----------------------------------------------------------------------------
+void Geometry::splitDrawCalls(u32 max_vertex_span)
+{
+  VL_CHECK(max_vertex_span >= 6)
+
+  std::vector<u32> indices;
+  for( int idraw=this->drawCalls().size(); idraw--; )
+  {
+    ref<DrawCall> dc = this->drawCalls().at(idraw);
+    DrawElementsBase* deb = dc->as<DrawElementsBase>();
+    if (!deb)
+      continue;
+
+    bool ok = collectIndices<DrawElementsUInt>(dc.get(), indices) ||
+              collectIndices<DrawElementsUShort>(dc.get(), indices) ||
+              collectIndices<DrawElementsUByte>(dc.get(), indices);
+    if ( !ok || indices.empty() )
+      continue;
+
+    bool restart_on = deb->primitiveRestartEnabled();
+
+    // number of indices of a single primitive, 0 if the draw call cannot be split
+    size_t prim_size = 0;
+    if (!restart_on)
+    {
+      switch(dc->primitiveType())
+      {
+      case PT_POINTS:              prim_size = 1; break;
+      case PT_LINES:               prim_size = 2; break;
+      case PT_TRIANGLES:           prim_size = 3; break;
+      case PT_QUADS:               prim_size = 4; break;
+      case PT_LINES_ADJACENCY:     prim_size = 4; break;
+      case PT_TRIANGLES_ADJACENCY: prim_size = 6; break;
+      case PT_PATCHES:             prim_size = deb->patchParameter() ? deb->patchParameter()->patchVertices() : 0; break;
+      default:
+        break;
+      }
+    }
+    if (prim_size == 0 || prim_size > max_vertex_span || indices.size() % prim_size)
+      prim_size = indices.size();
+
+    // generate the ranges
+    std::vector< ref<DrawCall> > ranges;
+    size_t start = 0;
+    while( start < indices.size() )
+    {
+      u32 min_idx = 0xFFFFFFFF;
+      u32 max_idx = 0;
+      size_t end = start;
+      while( end < indices.size() )
+      {
+        u32 prim_min = min_idx;
+        u32 prim_max = max_idx;
+        for(size_t i=end; i<end+prim_size; ++i)
+        {
+          if (indices[i] == RestartMarker)
+            continue;
+          prim_min = indices[i] < prim_min ? indices[i] : prim_min;
+          prim_max = indices[i] > prim_max ? indices[i] : prim_max;
+        }
+        // the first primitive is always accepted
+        if ( end > start && prim_max - prim_min >= max_vertex_span )
+          break;
+        min_idx = prim_min;
+        max_idx = prim_max;
+        end += prim_size;
+      }
+
+      // all restart indices
+      if (min_idx > max_idx)
+        min_idx = max_idx = 0;
+
+      u32 span = max_idx - min_idx;
+      if ( span < 0xFF || (span == 0xFF && !restart_on) )
+        ranges.push_back( rebasedDrawElements<DrawElementsUByte>(deb, indices, start, end, min_idx) );
+      else
+      if ( span < 0xFFFF || (span == 0xFFFF && !restart_on) )
+        ranges.push_back( rebasedDrawElements<DrawElementsUShort>(deb, indices, start, end, min_idx) );
+      else
+        ranges.push_back( rebasedDrawElements<DrawElementsUInt>(deb, indices, start, end, min_idx) );
+
+      start = end;
+    }
+
+    // substitute the draw call with its ranges preserving the rendering order
+    drawCalls().eraseAt(idraw);
+    for(size_t i=0; i<ranges.size(); ++i)
+      drawCalls().insert(idraw + (int)i, ranges[i].get());
+  }
+}
+//-----------------------------------------------------------------------------
 void Geometry::makeGLESFriendly()
 {
   // converts legacy vertex arrays into generic vertex attributes
@@ -1206,6 +1507,8 @@ void Geometry::makeGLESFriendly()
 //-----------------------------------------------------------------------------
 bool Geometry::sortVertices()
 {
+  invalidateMeshAdjacency();
+
   ArrayAbstract* posarr = vertexArray() ? vertexArray() : vertexAttribArray(vl::VA_Position) ? vertexAttribArray(vl::VA_Position)->data() : NULL;
 
   if (!posarr)
@@ -45,6 +45,7 @@
 #include <vlGraphics/DrawArrays.hpp>
 #include <vlCore/Collection.hpp>
 #include <vlGraphics/VertexAttribInfo.hpp>
+#include <vlGraphics/MeshAdjacency.hpp>
 
 namespace vl
 {
@@ -181,7 +182,8 @@ namespace vl
      *  are defined in a format other than ArrayFloat3. */
     bool flipNormals();
 
-    //! Converts all draw calls to triangles and fixes their winding according to the Geometry's normals.
+    //! Converts all draw calls to triangles and fixes their winding: the triangles sharing an edge are oriented consistently
+    //! and each connected set of triangles is then oriented according to the Geometry's normals or, if there are no normals, outwards.
     void fixTriangleWinding();
 
     /** 
@@ -222,6 +224,15 @@ namespace vl
     //! @note Primitive type can be any.
     void shrinkDrawCalls();
 
+    //! Splits the DrawElements* draw calls into ranges referencing at most \p max_vertex_span consecutive vertices, rebases the
+    //! indices of each range using the base vertex and converts them to the best fitting of DrawElementsUByte/UShort/UInt.
+    //! For example a DrawElementsUInt referencing 200.000 vertices becomes 4 DrawElementsUShort with \p max_vertex_span = 0x10000.
+    //! Only separable primitive types are split (points, lines, triangles, their adjacency versions and patches), strips, fans,
+    //! loops, polygons and primitive restart enabled draw calls are only rebased. Draw calls using a custom count or offset are left untouched.
+    //! @note Ranges with a non-zero base vertex require OpenGL 3.2 or GL_ARB_draw_elements_base_vertex.
+    //! @note Call sortVertices() first to maximize the locality of the indices and thus minimize the number of generated ranges.
+    void splitDrawCalls(u32 max_vertex_span = 0x10000);
+
     //! Calls triangulateDrawCalls(), shrinkDrawCalls() and convertToVertexAttribs().
     //! @note At the moment this method does support MultiDrawElements nor DrawRangeElements but only DrawElements.
     void makeGLESFriendly();
@@ -236,6 +247,26 @@ namespace vl
     //! Where 'map_new_to_old[i] == j' means that the i-th new vertex attribute should take it's value from the old j-th vertex attribute.
     void regenerateVertices(const std::vector<u32>& map_new_to_old);
 
+    //! Stores all the vertex arrays of the Geometry in a single BufferObject in interleaved form, that is, the attributes of each vertex are stored contiguously.
+    //! Every array is then bound with the appropriate offset and stride, see ArrayAbstract::setBufferObject(). Each attribute is aligned to 4 bytes.
+    //! Interleaving improves the vertex fetch locality and reduces the number of buffer binds per draw call.
+    //! \returns false if the arrays have a different number of elements or if there are no arrays to interleave.
+    //! \note After this function the arrays cannot be resized anymore, use deinterleaveArrays() to convert them back.
+    bool interleaveArrays();
+
+    //! Converts the interleaved vertex arrays generated by interleaveArrays() back into independent tightly packed arrays.
+    void deinterleaveArrays();
+
+    //! Returns the MeshAdjacency of the triangles of the Geometry, building it on first use and keeping it until invalidateMeshAdjacency().
+    //! Only this function creates the cache, the Geometry tools such as computeNormals() build their own temporary MeshAdjacency.
+    //! The cached structure is rebuilt when the position array, its size, the draw calls or \p weld_vertices change. The Geometry tools
+    //! that modify the triangles invalidate it, call invalidateMeshAdjacency() after editing the indices or the positions in place.
+    //! Returns NULL if the Geometry has no position array.
+    const MeshAdjacency* meshAdjacency(bool weld_vertices=true) const;
+
+    //! Discards the MeshAdjacency cached by meshAdjacency().
+    void invalidateMeshAdjacency() { mMeshAdjacency = NULL; }
+
     //! Assigns a random color to each vertex of each DrawCall object. If a vertex is shared among more than one DrawCall object its color is undefined.
     void colorizePrimitives();
 
@@ -332,6 +363,9 @@ namespace vl
 
     const Collection<VertexAttribInfo>& vertexAttribArrays() const { return mVertexAttribArrays; }
 
+    //! Collects all the non NULL vertex arrays and generic vertex attribute arrays.
+    void collectArrays(std::vector<ArrayAbstract*>& arrays) const;
+
   protected:
     virtual void computeBounds_Implementation();
     
@@ -351,6 +385,8 @@ namespace vl
     Collection<TextureArray> mTexCoordArrays;
     // generic vertex attributes
     Collection<VertexAttribInfo> mVertexAttribArrays;
+    // cached connectivity, see meshAdjacency()
+    mutable ref<MeshAdjacency> mMeshAdjacency;
   };
   //------------------------------------------------------------------------------
 }
@@ -0,0 +1,384 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/MeshAdjacency.hpp>
+#include <vlGraphics/Geometry.hpp>
+#include <vlCore/Thread.hpp>
+#include <vlCore/Log.hpp>
+
+using namespace vl;
+
+//-----------------------------------------------------------------------------
+namespace
+{
+  //! A half-edge sorted by its undirected edge.
+  struct HalfEdgeKey
+  {
+    unsigned long long mKey;
+    int mHalfEdge;
+
+    bool operator<(const HalfEdgeKey& other) const
+    {
+      if (mKey != other.mKey)
+        return mKey < other.mKey;
+      else
+        return mHalfEdge < other.mHalfEdge;
+    }
+  };
+
+  //! A vertex sorted by position, used for welding.
+  struct PositionKey
+  {
+    fvec3 mPosition;
+    int mIndex;
+
+    bool operator<(const PositionKey& other) const
+    {
+      if (mPosition != other.mPosition)
+        return mPosition < other.mPosition;
+      else
+        return mIndex < other.mIndex;
+    }
+  };
+
+  class ReadPositionsTask: public ParallelForTask
+  {
+  public:
+    ReadPositionsTask(const ArrayAbstract* positions, std::vector<PositionKey>& keys): mPositions(positions), mKeys(keys) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      for(int i=begin; i<end; ++i)
+      {
+        mKeys[i].mPosition = (fvec3)mPositions->getAsVec3(i);
+        mKeys[i].mIndex = i;
+      }
+    }
+
+  private:
+    const ArrayAbstract* mPositions;
+    std::vector<PositionKey>& mKeys;
+  };
+
+  class HalfEdgeKeysTask: public ParallelForTask
+  {
+  public:
+    HalfEdgeKeysTask(const std::vector<u32>& triangles, const std::vector<int>& vertex_ids, std::vector<HalfEdgeKey>& keys):
+      mTriangles(triangles), mVertexIds(vertex_ids), mKeys(keys) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      for(int h=begin; h<end; ++h)
+      {
+        int tri = h / 3;
+        unsigned long long a = (unsigned long long)mVertexIds[ mTriangles[h] ];
+        unsigned long long b = (unsigned long long)mVertexIds[ mTriangles[tri*3 + (h+1)%3] ];
+        // degenerate half-edges go at the end
+        mKeys[h].mKey = a == b ? ~0ULL : a < b ? (a << 32) | b : (b << 32) | a;
+        mKeys[h].mHalfEdge = h;
+      }
+    }
+
+  private:
+    const std::vector<u32>& mTriangles;
+    const std::vector<int>& mVertexIds;
+    std::vector<HalfEdgeKey>& mKeys;
+  };
+
+  class TriangleNormalsTask: public ParallelForTask
+  {
+  public:
+    TriangleNormalsTask(const MeshAdjacency* adjacency, const ArrayAbstract* positions, std::vector<fvec3>& normals):
+      mAdjacency(adjacency), mPositions(positions), mNormals(normals) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      for(int tri=begin; tri<end; ++tri)
+        mNormals[tri] = mAdjacency->triangleNormal(mPositions, tri).normalize();
+    }
+
+  private:
+    const MeshAdjacency* mAdjacency;
+    const ArrayAbstract* mPositions;
+    std::vector<fvec3>& mNormals;
+  };
+}
+//-----------------------------------------------------------------------------
+bool MeshAdjacency::build(const Geometry* geom, bool weld_vertices)
+{
+  const ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
+  if (!posarr)
+  {
+    reset();
+    Log::error("MeshAdjacency::build(): no position array found.\n");
+    return false;
+  }
+
+  std::vector<u32> triangles;
+  for(int i=0; i<geom->drawCalls().size(); ++i)
+  {
+    for(TriangleIterator trit = geom->drawCalls().at(i)->triangleIterator(); trit.hasNext(); trit.next())
+    {
+      triangles.push_back( trit.a() );
+      triangles.push_back( trit.b() );
+      triangles.push_back( trit.c() );
+    }
+  }
+
+  build(posarr, triangles, weld_vertices);
+
+  mSourceDrawCalls.resize( geom->drawCalls().size() );
+  for(int i=0; i<geom->drawCalls().size(); ++i)
+    mSourceDrawCalls[i] = const_cast<DrawCall*>( geom->drawCalls().at(i) );
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool MeshAdjacency::isUpToDate(const Geometry* geom, bool weld_vertices) const
+{
+  const ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(vl::VA_Position) ? geom->vertexAttribArray(vl::VA_Position)->data() : NULL;
+  if ( !posarr || mWeldVertices != weld_vertices || mSourcePositions != posarr || sourceVertexCount() != (int)posarr->size() )
+    return false;
+
+  if ( (int)mSourceDrawCalls.size() != geom->drawCalls().size() )
+    return false;
+
+  for(int i=0; i<geom->drawCalls().size(); ++i)
+    if ( mSourceDrawCalls[i] != geom->drawCalls().at(i) )
+      return false;
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+void MeshAdjacency::build(const ArrayAbstract* positions, const std::vector<u32>& triangles, bool weld_vertices)
+{
+  reset();
+  mTriangles = triangles;
+  mWeldVertices = weld_vertices;
+  mSourcePositions = const_cast<ArrayAbstract*>(positions);
+
+  int vertex_count = (int)positions->size();
+  mVertexIds.resize( vertex_count );
+
+  if (weld_vertices)
+  {
+    // sort the vertices by position and give the same id to the equal ones
+    std::vector<PositionKey> keys( vertex_count );
+    ReadPositionsTask read_task(positions, keys);
+    parallelFor(0, vertex_count, &read_task);
+    parallelSort(keys);
+    int id = -1;
+    for(int i=0; i<vertex_count; ++i)
+    {
+      if (i == 0 || keys[i].mPosition != keys[i-1].mPosition)
+        ++id;
+      mVertexIds[ keys[i].mIndex ] = id;
+    }
+    vertex_count = id + 1;
+  }
+  else
+  {
+    for(int i=0; i<vertex_count; ++i)
+      mVertexIds[i] = i;
+  }
+
+  buildTopology(vertex_count);
+}
+//-----------------------------------------------------------------------------
+void MeshAdjacency::build(int vertex_count, const std::vector<u32>& triangles)
+{
+  reset();
+  mTriangles = triangles;
+  mVertexIds.resize( vertex_count );
+  for(int i=0; i<vertex_count; ++i)
+    mVertexIds[i] = i;
+  buildTopology(vertex_count);
+}
+//-----------------------------------------------------------------------------
+void MeshAdjacency::reset()
+{
+  std::vector<u32>().swap(mTriangles);
+  std::vector<int>().swap(mVertexIds);
+  std::vector<int>().swap(mHalfEdgeEdges);
+  std::vector<int>().swap(mEdgeVertices);
+  std::vector<int>().swap(mEdgeOffsets);
+  std::vector<int>().swap(mEdgeHalfEdges);
+  std::vector<int>().swap(mVertexTriangleOffsets);
+  std::vector<int>().swap(mVertexTriangles);
+  std::vector<int>().swap(mVertexEdgeOffsets);
+  std::vector<int>().swap(mVertexEdges);
+  mSourcePositions = NULL;
+  std::vector< ref<DrawCall> >().swap(mSourceDrawCalls);
+  mWeldVertices = false;
+}
+//-----------------------------------------------------------------------------
+void MeshAdjacency::buildTopology(int vertex_count)
+{
+  const int half_edge_count = (int)mTriangles.size();
+  const int triangle_count = half_edge_count / 3;
+
+  // edges: sort the half-edges by their undirected vertex pair
+
+  std::vector<HalfEdgeKey> keys( half_edge_count );
+  HalfEdgeKeysTask keys_task(mTriangles, mVertexIds, keys);
+  parallelFor(0, half_edge_count, &keys_task);
+  parallelSort(keys);
+
+  mHalfEdgeEdges.assign( half_edge_count, -1 );
+  mEdgeHalfEdges.reserve( half_edge_count );
+  for(int i=0; i<half_edge_count && keys[i].mKey != ~0ULL; ++i)
+  {
+    if (i == 0 || keys[i].mKey != keys[i-1].mKey)
+    {
+      mEdgeOffsets.push_back( (int)mEdgeHalfEdges.size() );
+      mEdgeVertices.push_back( (int)(keys[i].mKey >> 32) );
+      mEdgeVertices.push_back( (int)(keys[i].mKey & 0xFFFFFFFF) );
+    }
+    mHalfEdgeEdges[ keys[i].mHalfEdge ] = (int)mEdgeOffsets.size() - 1;
+    mEdgeHalfEdges.push_back( keys[i].mHalfEdge );
+  }
+  mEdgeOffsets.push_back( (int)mEdgeHalfEdges.size() );
+  std::vector<HalfEdgeKey>().swap(keys);
+
+  // vertex -> triangles, each triangle is listed once per vertex even if degenerate
+
+  mVertexTriangleOffsets.assign( vertex_count + 1, 0 );
+  for(int tri=0; tri<triangle_count; ++tri)
+  {
+    int a = triangleVertex(tri, 0), b = triangleVertex(tri, 1), c = triangleVertex(tri, 2);
+    ++mVertexTriangleOffsets[a+1];
+    if (b != a)
+      ++mVertexTriangleOffsets[b+1];
+    if (c != a && c != b)
+      ++mVertexTriangleOffsets[c+1];
+  }
+  for(int v=0; v<vertex_count; ++v)
+    mVertexTriangleOffsets[v+1] += mVertexTriangleOffsets[v];
+  mVertexTriangles.resize( mVertexTriangleOffsets.back() );
+  std::vector<int> cursor( mVertexTriangleOffsets.begin(), mVertexTriangleOffsets.end() - 1 );
+  for(int tri=0; tri<triangle_count; ++tri)
+  {
+    int a = triangleVertex(tri, 0), b = triangleVertex(tri, 1), c = triangleVertex(tri, 2);
+    mVertexTriangles[ cursor[a]++ ] = tri;
+    if (b != a)
+      mVertexTriangles[ cursor[b]++ ] = tri;
+    if (c != a && c != b)
+      mVertexTriangles[ cursor[c]++ ] = tri;
+  }
+
+  // vertex -> edges
+
+  mVertexEdgeOffsets.assign( vertex_count + 1, 0 );
+  for(int e=0; e<edgeCount(); ++e)
+  {
+    ++mVertexEdgeOffsets[ mEdgeVertices[e*2+0] + 1 ];
+    ++mVertexEdgeOffsets[ mEdgeVertices[e*2+1] + 1 ];
+  }
+  for(int v=0; v<vertex_count; ++v)
+    mVertexEdgeOffsets[v+1] += mVertexEdgeOffsets[v];
+  mVertexEdges.resize( mVertexEdgeOffsets.back() );
+  cursor.assign( mVertexEdgeOffsets.begin(), mVertexEdgeOffsets.end() - 1 );
+  for(int e=0; e<edgeCount(); ++e)
+  {
+    mVertexEdges[ cursor[ mEdgeVertices[e*2+0] ]++ ] = e;
+    mVertexEdges[ cursor[ mEdgeVertices[e*2+1] ]++ ] = e;
+  }
+}
+//-----------------------------------------------------------------------------
+void MeshAdjacency::vertexOneRing(int v, std::vector<int>& ring) const
+{
+  ring.resize( vertexEdgeCount(v) );
+  for(int i=0; i<(int)ring.size(); ++i)
+    ring[i] = vertexNeighbor(v, i);
+}
+//-----------------------------------------------------------------------------
+void MeshAdjacency::boundaryLoops(std::vector< std::vector<int> >& loops) const
+{
+  loops.clear();
+  std::vector<bool> visited( edgeCount(), false );
+  for(int e0=0; e0<edgeCount(); ++e0)
+  {
+    if (!isBoundaryEdge(e0) || visited[e0])
+      continue;
+
+    // follow the boundary in the direction of the half-edges
+    std::vector<int> loop;
+    int h = edgeHalfEdge(e0, 0);
+    int start = triangleVertex(h/3, h%3);
+    int vert = triangleVertex(h/3, (h%3+1)%3);
+    visited[e0] = true;
+    loop.push_back(start);
+    while(vert != start)
+    {
+      loop.push_back(vert);
+      int next = -1;
+      for(int i=0; i<vertexEdgeCount(vert); ++i)
+      {
+        int e = vertexEdge(vert, i);
+        if (!isBoundaryEdge(e) || visited[e])
+          continue;
+        int he = edgeHalfEdge(e, 0);
+        // prefer the consistently oriented continuation
+        if (next == -1 || triangleVertex(he/3, he%3) == vert)
+          next = e;
+      }
+      if (next == -1)
+        break;
+      visited[next] = true;
+      vert = edgeVertex1(next) == vert ? edgeVertex2(next) : edgeVertex1(next);
+    }
+    loops.push_back(loop);
+  }
+}
+//-----------------------------------------------------------------------------
+bool MeshAdjacency::isClosedManifold() const
+{
+  for(int e=0; e<edgeCount(); ++e)
+    if (edgeTriangleCount(e) != 2)
+      return false;
+  return edgeCount() > 0;
+}
+//-----------------------------------------------------------------------------
+fvec3 MeshAdjacency::triangleNormal(const ArrayAbstract* positions, int tri) const
+{
+  fvec3 p0 = (fvec3)positions->getAsVec3( mTriangles[tri*3+0] );
+  fvec3 p1 = (fvec3)positions->getAsVec3( mTriangles[tri*3+1] );
+  fvec3 p2 = (fvec3)positions->getAsVec3( mTriangles[tri*3+2] );
+  return cross(p1 - p0, p2 - p0);
+}
+//-----------------------------------------------------------------------------
+void MeshAdjacency::triangleNormals(const ArrayAbstract* positions, std::vector<fvec3>& normals) const
+{
+  normals.resize( triangleCount() );
+  TriangleNormalsTask task(this, positions, normals);
+  parallelFor(0, triangleCount(), &task);
+}
+//-----------------------------------------------------------------------------
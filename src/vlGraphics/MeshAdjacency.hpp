@@ -0,0 +1,221 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef MeshAdjacency_INCLUDE_ONCE
+#define MeshAdjacency_INCLUDE_ONCE
+
+#include <vlCore/Object.hpp>
+#include <vlCore/Vector3.hpp>
+#include <vlGraphics/link_config.hpp>
+#include <vlGraphics/DrawCall.hpp>
+#include <vector>
+
+namespace vl
+{
+  class Geometry;
+  class ArrayAbstract;
+
+  //-----------------------------------------------------------------------------
+  // MeshAdjacency
+  //-----------------------------------------------------------------------------
+  /** Edge and vertex connectivity of the triangles of a mesh, stored in flat arrays.
+
+  The triangles are numbered in the order in which they are returned by the TriangleIterator of each DrawCall.
+  The half-edge \p h goes from the vertex \p h%3 to the vertex \p (h+1)%3 of the triangle \p h/3.
+  Half-edges connecting the same two vertices (in any direction) are grouped into a single edge:
+  an edge with one triangle is a boundary edge, an edge with more than two triangles is non-manifold.
+
+  If vertex welding is enabled the vertices with the same position are treated as a single vertex even if they have
+  different indices, for example because they have different normals or texture coordinates. The connectivity queries
+  always work on vertex ids, i.e. the indices of the welded vertices, see vertexId().
+
+  The structure is built using sorting and parallelFor(). Geometry::meshAdjacency() returns a cached instance.
+  */
+  class VLGRAPHICS_EXPORT MeshAdjacency: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::MeshAdjacency, Object)
+
+  public:
+    MeshAdjacency(): mWeldVertices(false)
+    {
+      VL_DEBUG_SET_OBJECT_NAME()
+    }
+
+    //! Builds the adjacency of all the triangles of the given Geometry.
+    //! Returns false if the Geometry has no position array.
+    bool build(const Geometry* geom, bool weld_vertices);
+
+    //! Builds the adjacency of the given triangle list.
+    //! \param positions The vertex positions, used for welding and by triangleNormal().
+    //! \param triangles Three vertex indices per triangle.
+    //! \param weld_vertices Whether the vertices with the same position are treated as one.
+    void build(const ArrayAbstract* positions, const std::vector<u32>& triangles, bool weld_vertices);
+
+    //! Builds the adjacency of the given triangle list, with no vertex welding.
+    //! \param vertex_count The number of vertices referenced by \p triangles.
+    //! \param triangles Three vertex indices per triangle.
+    void build(int vertex_count, const std::vector<u32>& triangles);
+
+    //! Releases all the memory.
+    void reset();
+
+    //! Whether the vertices with the same position have been welded.
+    bool weldVertices() const { return mWeldVertices; }
+
+    // --- triangles ---
+
+    int triangleCount() const { return (int)mTriangles.size() / 3; }
+
+    //! Three original vertex indices per triangle.
+    const std::vector<u32>& triangles() const { return mTriangles; }
+
+    //! The vertex id of the given corner (0..2) of a triangle.
+    int triangleVertex(int tri, int corner) const { return mVertexIds[ mTriangles[tri*3+corner] ]; }
+
+    //! The triangle sharing the given side (0..2, from corner \p side to corner \p side+1) with \p tri, or -1
+    //! if the side is a boundary or if the edge is shared by more than two triangles.
+    int triangleNeighbor(int tri, int side) const
+    {
+      int e = mHalfEdgeEdges[tri*3+side];
+      if (e < 0 || edgeTriangleCount(e) != 2)
+        return -1;
+      int h = mEdgeHalfEdges[ mEdgeOffsets[e] ] == tri*3+side ? mEdgeHalfEdges[ mEdgeOffsets[e]+1 ] : mEdgeHalfEdges[ mEdgeOffsets[e] ];
+      return h / 3;
+    }
+
+    // --- vertices ---
+
+    //! The number of (welded) vertices.
+    int vertexCount() const { return (int)mVertexTriangleOffsets.size() - 1; }
+
+    //! The vertex id of the given original vertex index.
+    int vertexId(int index) const { return mVertexIds[index]; }
+
+    //! The vertex id of each original vertex index, if welding is disabled this is the identity.
+    const std::vector<int>& vertexIds() const { return mVertexIds; }
+
+    //! The number of triangles using the given vertex.
+    int vertexTriangleCount(int v) const { return mVertexTriangleOffsets[v+1] - mVertexTriangleOffsets[v]; }
+
+    //! The \p i-th triangle using the given vertex.
+    int vertexTriangle(int v, int i) const { return mVertexTriangles[ mVertexTriangleOffsets[v] + i ]; }
+
+    //! The number of edges starting or ending at the given vertex, i.e. the size of its one-ring.
+    int vertexEdgeCount(int v) const { return mVertexEdgeOffsets[v+1] - mVertexEdgeOffsets[v]; }
+
+    //! The \p i-th edge starting or ending at the given vertex.
+    int vertexEdge(int v, int i) const { return mVertexEdges[ mVertexEdgeOffsets[v] + i ]; }
+
+    //! The vertex at the other end of the \p i-th edge of \p v.
+    int vertexNeighbor(int v, int i) const
+    {
+      int e = vertexEdge(v, i);
+      return mEdgeVertices[e*2] == v ? mEdgeVertices[e*2+1] : mEdgeVertices[e*2];
+    }
+
+    //! Fills \p ring with the vertex ids adjacent to \p v.
+    void vertexOneRing(int v, std::vector<int>& ring) const;
+
+    // --- edges ---
+
+    int edgeCount() const { return (int)mEdgeOffsets.size() - 1; }
+
+    //! The first vertex id of an edge, always smaller than edgeVertex2().
+    int edgeVertex1(int e) const { return mEdgeVertices[e*2+0]; }
+
+    //! The second vertex id of an edge, always greater than edgeVertex1().
+    int edgeVertex2(int e) const { return mEdgeVertices[e*2+1]; }
+
+    //! The number of triangles sharing an edge.
+    int edgeTriangleCount(int e) const { return mEdgeOffsets[e+1] - mEdgeOffsets[e]; }
+
+    //! The \p i-th half-edge of an edge.
+    int edgeHalfEdge(int e, int i) const { return mEdgeHalfEdges[ mEdgeOffsets[e] + i ]; }
+
+    //! The \p i-th triangle sharing an edge.
+    int edgeTriangle(int e, int i) const { return edgeHalfEdge(e, i) / 3; }
+
+    bool isBoundaryEdge(int e) const { return edgeTriangleCount(e) == 1; }
+
+    bool isManifoldEdge(int e) const { return edgeTriangleCount(e) <= 2; }
+
+    //! The edge of a half-edge or -1 if the half-edge is degenerate (i.e. both its vertices have the same id).
+    int halfEdgeEdge(int h) const { return mHalfEdgeEdges[h]; }
+
+    //! The edge of the given side (0..2) of a triangle or -1 if degenerate.
+    int triangleEdge(int tri, int side) const { return mHalfEdgeEdges[tri*3+side]; }
+
+    //! Returns the closed loops formed by the boundary edges as lists of vertex ids.
+    //! Boundary vertices shared by more than two boundary edges are visited once per loop passing through them.
+    void boundaryLoops(std::vector< std::vector<int> >& loops) const;
+
+    //! True if the mesh has no boundary and no non-manifold edges.
+    bool isClosedManifold() const;
+
+    //! The unnormalized normal of a triangle, i.e. its area times two, computed using \p positions.
+    fvec3 triangleNormal(const ArrayAbstract* positions, int tri) const;
+
+    //! Computes in parallel the normalized normal of every triangle using \p positions, degenerate triangles get a null normal.
+    void triangleNormals(const ArrayAbstract* positions, std::vector<fvec3>& normals) const;
+
+    // --- cache validation used by Geometry ---
+
+    //! Returns true if the adjacency has been built by build(const Geometry*, bool) with the same welding mode,
+    //! position array, vertex count and draw calls that \p geom currently has.
+    bool isUpToDate(const Geometry* geom, bool weld_vertices) const;
+
+    //! The position array used to build the adjacency, if any.
+    const ArrayAbstract* sourcePositions() const { return mSourcePositions.get(); }
+
+    //! The number of original vertices.
+    int sourceVertexCount() const { return (int)mVertexIds.size(); }
+
+  protected:
+    void buildTopology(int vertex_count);
+
+  protected:
+    std::vector<u32> mTriangles;
+    std::vector<int> mVertexIds;
+    std::vector<int> mHalfEdgeEdges;
+    std::vector<int> mEdgeVertices;
+    std::vector<int> mEdgeOffsets;
+    std::vector<int> mEdgeHalfEdges;
+    std::vector<int> mVertexTriangleOffsets;
+    std::vector<int> mVertexTriangles;
+    std::vector<int> mVertexEdgeOffsets;
+    std::vector<int> mVertexEdges;
+    ref<ArrayAbstract> mSourcePositions;
+    std::vector< ref<DrawCall> > mSourceDrawCalls;
+    bool mWeldVertices;
+  };
+}
+
+#endif
@@ -200,6 +200,11 @@ namespace vl
       indexBuffer()->bufferObject()->deleteBufferObject();
     }
 
+    virtual BufferObject* indexBufferObject()
+    {
+      return indexBuffer()->bufferObject();
+    }
+
     virtual void render(bool use_bo) const
     {
       VL_CHECK_OGL()
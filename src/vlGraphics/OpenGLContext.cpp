@@ -1270,6 +1270,7 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
         mVertexAttrib[i].mEnabled = false; // not used
         mVertexAttrib[i].mPtr = 0;
         mVertexAttrib[i].mBufferObject = 0;
+        mVertexAttrib[i].mStride = 0;
         mVertexAttrib[i].mState = 0;
       }
 
@@ -1278,32 +1279,38 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
         mTexCoordArray[i].mEnabled = false; // not used
         mTexCoordArray[i].mPtr = 0;
         mTexCoordArray[i].mBufferObject = 0;
+        mTexCoordArray[i].mStride = 0;
         mTexCoordArray[i].mState = 0;
       }
 
       mVertexArray.mEnabled = false;
       mVertexArray.mPtr = 0;
       mVertexArray.mBufferObject = 0;
+      mVertexArray.mStride = 0;
       mVertexArray.mState = 0; // not used
 
       mNormalArray.mEnabled = false;
       mNormalArray.mPtr = 0;
       mNormalArray.mBufferObject = 0;
+      mNormalArray.mStride = 0;
       mNormalArray.mState = 0; // not used
 
       mColorArray.mEnabled = false;
       mColorArray.mPtr = 0;
       mColorArray.mBufferObject = 0;
+      mColorArray.mStride = 0;
       mColorArray.mState = 0; // not used
 
       mSecondaryColorArray.mEnabled = false;
       mSecondaryColorArray.mPtr = 0;
       mSecondaryColorArray.mBufferObject = 0;
+      mSecondaryColorArray.mStride = 0;
       mSecondaryColorArray.mState = 0; // not used
 
       mFogArray.mEnabled = false;
       mFogArray.mPtr = 0;
       mFogArray.mBufferObject = 0;
+      mFogArray.mStride = 0;
       mFogArray.mState = 0; // not used
 
       // reset all gl states
@@ -1341,6 +1348,7 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
     {
       int buf_obj = 0;
       const unsigned char* ptr = 0;
+      GLsizei stride = 0;
       bool enabled = false;
 
       if(Has_Fixed_Function_Pipeline)
@@ -1363,7 +1371,9 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
               buf_obj = 0;
               ptr = vas->vertexArray()->bufferObject()->ptr();
             }
-            if ( mVertexArray.mPtr != ptr || mVertexArray.mBufferObject != buf_obj )
+            ptr += vas->vertexArray()->offset();
+            stride = (GLsizei)vas->vertexArray()->stride();
+            if ( mVertexArray.mPtr != ptr || mVertexArray.mBufferObject != buf_obj || mVertexArray.mStride != stride )
             {
               if (!mVertexArray.mEnabled)
               {
@@ -1374,9 +1384,10 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
               // In the future we'll want to eliminate all direct calls to glBindBuffer and similar an
               // go through the OpenGLContext that will lazily do everything.
               VL_glBindBuffer(GL_ARRAY_BUFFER, buf_obj); VL_CHECK_OGL();
-              glVertexPointer((int)vas->vertexArray()->glSize(), vas->vertexArray()->glType(), /*stride*/0, ptr); VL_CHECK_OGL();
+              glVertexPointer((int)vas->vertexArray()->glSize(), vas->vertexArray()->glType(), (GLsizei)vas->vertexArray()->stride(), ptr); VL_CHECK_OGL();
               mVertexArray.mPtr = ptr;
               mVertexArray.mBufferObject = buf_obj;
+              mVertexArray.mStride = stride;
             }
           }
           else
@@ -1384,6 +1395,7 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
             glDisableClientState(GL_VERTEX_ARRAY); VL_CHECK_OGL();
             mVertexArray.mPtr = 0;
             mVertexArray.mBufferObject = 0;
+            mVertexArray.mStride = 0;
           }
           mVertexArray.mEnabled = enabled;
         }
@@ -1405,16 +1417,19 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
               buf_obj = 0;
               ptr = vas->normalArray()->bufferObject()->ptr();
             }
-            if ( mNormalArray.mPtr != ptr || mNormalArray.mBufferObject != buf_obj )
+            ptr += vas->normalArray()->offset();
+            stride = (GLsizei)vas->normalArray()->stride();
+            if ( mNormalArray.mPtr != ptr || mNormalArray.mBufferObject != buf_obj || mNormalArray.mStride != stride )
             {
               if (!mNormalArray.mEnabled)
               {
                 glEnableClientState(GL_NORMAL_ARRAY); VL_CHECK_OGL();
               }
               VL_glBindBuffer(GL_ARRAY_BUFFER, buf_obj); VL_CHECK_OGL(); 
-              glNormalPointer(vas->normalArray()->glType(), /*stride*/0, ptr); VL_CHECK_OGL();
+              glNormalPointer(vas->normalArray()->glType(), (GLsizei)vas->normalArray()->stride(), ptr); VL_CHECK_OGL();
               mNormalArray.mPtr = ptr;
               mNormalArray.mBufferObject = buf_obj;
+              mNormalArray.mStride = stride;
             }
           }
           else
@@ -1426,6 +1441,7 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
 
             mNormalArray.mPtr = 0;
             mNormalArray.mBufferObject = 0;
+            mNormalArray.mStride = 0;
           }
           mNormalArray.mEnabled = enabled;
         }
@@ -1447,16 +1463,19 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
               buf_obj = 0;
               ptr = vas->colorArray()->bufferObject()->ptr();
             }
-            if ( mColorArray.mPtr != ptr || mColorArray.mBufferObject != buf_obj )
+            ptr += vas->colorArray()->offset();
+            stride = (GLsizei)vas->colorArray()->stride();
+            if ( mColorArray.mPtr != ptr || mColorArray.mBufferObject != buf_obj || mColorArray.mStride != stride )
             {
               if (!mColorArray.mEnabled)
               {
                 glEnableClientState(GL_COLOR_ARRAY); VL_CHECK_OGL();
               }
               VL_glBindBuffer(GL_ARRAY_BUFFER, buf_obj); VL_CHECK_OGL();
-              glColorPointer((int)vas->colorArray()->glSize(), vas->colorArray()->glType(), /*stride*/0, ptr); VL_CHECK_OGL();
+              glColorPointer((int)vas->colorArray()->glSize(), vas->colorArray()->glType(), (GLsizei)vas->colorArray()->stride(), ptr); VL_CHECK_OGL();
               mColorArray.mPtr = ptr;
               mColorArray.mBufferObject = buf_obj;
+              mColorArray.mStride = stride;
             }
           }
           else
@@ -1468,6 +1487,7 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
 
             mColorArray.mPtr = 0;
             mColorArray.mBufferObject = 0;
+            mColorArray.mStride = 0;
           }
           mColorArray.mEnabled = enabled;
         }
@@ -1489,16 +1509,19 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
               buf_obj = 0;
               ptr = vas->secondaryColorArray()->bufferObject()->ptr();
             }
-            if ( mSecondaryColorArray.mPtr != ptr || mSecondaryColorArray.mBufferObject != buf_obj )
+            ptr += vas->secondaryColorArray()->offset();
+            stride = (GLsizei)vas->secondaryColorArray()->stride();
+            if ( mSecondaryColorArray.mPtr != ptr || mSecondaryColorArray.mBufferObject != buf_obj || mSecondaryColorArray.mStride != stride )
             {
               if (!mSecondaryColorArray.mEnabled)
               {
                 glEnableClientState(GL_SECONDARY_COLOR_ARRAY); VL_CHECK_OGL();
               }
               VL_glBindBuffer(GL_ARRAY_BUFFER, buf_obj); VL_CHECK_OGL();
-              glSecondaryColorPointer((int)vas->secondaryColorArray()->glSize(), vas->secondaryColorArray()->glType(), /*stride*/0, ptr); VL_CHECK_OGL();
+              glSecondaryColorPointer((int)vas->secondaryColorArray()->glSize(), vas->secondaryColorArray()->glType(), (GLsizei)vas->secondaryColorArray()->stride(), ptr); VL_CHECK_OGL();
               mSecondaryColorArray.mPtr = ptr;
               mSecondaryColorArray.mBufferObject = buf_obj;
+              mSecondaryColorArray.mStride = stride;
             }
           }
           else
@@ -1510,6 +1533,7 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
 
             mSecondaryColorArray.mPtr = 0;
             mSecondaryColorArray.mBufferObject = 0;
+            mSecondaryColorArray.mStride = 0;
           }
           mSecondaryColorArray.mEnabled = enabled;
         }
@@ -1531,16 +1555,19 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
               buf_obj = 0;
               ptr = vas->fogCoordArray()->bufferObject()->ptr();
             }
-            if ( mFogArray.mPtr != ptr || mFogArray.mBufferObject != buf_obj )
+            ptr += vas->fogCoordArray()->offset();
+            stride = (GLsizei)vas->fogCoordArray()->stride();
+            if ( mFogArray.mPtr != ptr || mFogArray.mBufferObject != buf_obj || mFogArray.mStride != stride )
             {
               if (!mFogArray.mEnabled)
               {
                 glEnableClientState(GL_FOG_COORD_ARRAY); VL_CHECK_OGL();
               }
               VL_glBindBuffer(GL_ARRAY_BUFFER, buf_obj); VL_CHECK_OGL();
-              glFogCoordPointer(vas->fogCoordArray()->glType(), /*stride*/0, ptr); VL_CHECK_OGL();
+              glFogCoordPointer(vas->fogCoordArray()->glType(), (GLsizei)vas->fogCoordArray()->stride(), ptr); VL_CHECK_OGL();
               mFogArray.mPtr = ptr;
               mFogArray.mBufferObject = buf_obj;
+              mFogArray.mStride = stride;
             }
           }
           else
@@ -1548,6 +1575,7 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
             glDisableClientState(GL_FOG_COORD_ARRAY); VL_CHECK_OGL();
             mFogArray.mPtr = 0;
             mFogArray.mBufferObject = 0;
+            mFogArray.mStride = 0;
           }
           mFogArray.mEnabled = enabled;
         }
@@ -1576,10 +1604,13 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
             buf_obj = 0;
             ptr = texarr->bufferObject()->ptr();
           }
-          if ( mTexCoordArray[tex_unit].mPtr != ptr || mTexCoordArray[tex_unit].mBufferObject != buf_obj )
+          ptr += texarr->offset();
+          stride = (GLsizei)texarr->stride();
+          if ( mTexCoordArray[tex_unit].mPtr != ptr || mTexCoordArray[tex_unit].mBufferObject != buf_obj || mTexCoordArray[tex_unit].mStride != stride )
           {
             mTexCoordArray[tex_unit].mPtr = ptr;
             mTexCoordArray[tex_unit].mBufferObject = buf_obj;
+            mTexCoordArray[tex_unit].mStride = stride;
 
             VL_glClientActiveTexture(GL_TEXTURE0 + tex_unit); VL_CHECK_OGL();
             VL_glBindBuffer(GL_ARRAY_BUFFER, buf_obj); VL_CHECK_OGL();
@@ -1589,7 +1620,7 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
                 Log::error("OpenGL ES does not allow 1D texture coordinates.\n"); VL_TRAP();
               }
             #endif
-            glTexCoordPointer((int)texarr->glSize(), texarr->glType(), 0/*texarr->stride()*/, ptr/*+ texarr->offset()*/); VL_CHECK_OGL();
+            glTexCoordPointer((int)texarr->glSize(), texarr->glType(), (GLsizei)texarr->stride(), ptr); VL_CHECK_OGL();
 
             // enable if not previously enabled
             if (mTexCoordArray[tex_unit].mState == 1)
@@ -1622,6 +1653,7 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
 
               mTexCoordArray[tex_unit].mPtr = 0;
               mTexCoordArray[tex_unit].mBufferObject = 0;
+              mTexCoordArray[tex_unit].mStride = 0;
             }
 
             mTexCoordArray[tex_unit].mState >>= 1; // 1 -> 0; 2 -> 1;
@@ -1651,25 +1683,31 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
           buf_obj = 0;
           ptr = info->data()->bufferObject()->ptr();
         }
-        if ( mVertexAttrib[idx].mPtr != ptr || mVertexAttrib[idx].mBufferObject != buf_obj )
+        ptr += info->data()->offset();
+        stride = (GLsizei)info->data()->stride();
+        if ( mVertexAttrib[idx].mPtr != ptr || mVertexAttrib[idx].mBufferObject != buf_obj || mVertexAttrib[idx].mStride != stride )
         {
           mVertexAttrib[idx].mPtr = ptr;
           mVertexAttrib[idx].mBufferObject = buf_obj;
+          mVertexAttrib[idx].mStride = stride;
           VL_glBindBuffer(GL_ARRAY_BUFFER, buf_obj); VL_CHECK_OGL();
 
           if ( info->interpretation() == VAI_NORMAL )
           {
-            VL_glVertexAttribPointer( idx, (int)info->data()->glSize(), info->data()->glType(), info->normalize(), /*stride*/0, ptr ); VL_CHECK_OGL();
+            // packed formats always have 4 components
+            GLenum gl_type = info->data()->glType();
+            int gl_size = gl_type == GL_INT_2_10_10_10_REV || gl_type == GL_UNSIGNED_INT_2_10_10_10_REV ? 4 : (int)info->data()->glSize();
+            VL_glVertexAttribPointer( idx, gl_size, gl_type, info->normalize(), (GLsizei)info->data()->stride(), ptr ); VL_CHECK_OGL();
           }
           else
           if ( info->interpretation() == VAI_INTEGER )
           {
-            VL_glVertexAttribIPointer( idx, (int)info->data()->glSize(), info->data()->glType(), /*stride*/0, ptr ); VL_CHECK_OGL();
+            VL_glVertexAttribIPointer( idx, (int)info->data()->glSize(), info->data()->glType(), (GLsizei)info->data()->stride(), ptr ); VL_CHECK_OGL();
           }
           else
           if ( info->interpretation() == VAI_DOUBLE )
           {
-            VL_glVertexAttribLPointer( idx, (int)info->data()->glSize(), info->data()->glType(), /*stride*/0, ptr ); VL_CHECK_OGL();
+            VL_glVertexAttribLPointer( idx, (int)info->data()->glSize(), info->data()->glType(), (GLsizei)info->data()->stride(), ptr ); VL_CHECK_OGL();
           }
 
           // enable if not previously enabled
@@ -1707,6 +1745,7 @@ void OpenGLContext::bindVAS(const IVertexAttribSet* vas, bool use_bo, bool force
 
             mVertexAttrib[idx].mPtr = 0;
             mVertexAttrib[idx].mBufferObject = 0;
+            mVertexAttrib[idx].mStride = 0;
           }
 
           mVertexAttrib[idx].mState >>= 1; // 1 -> 0; 2 -> 1;
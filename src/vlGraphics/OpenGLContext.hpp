@@ -576,9 +576,10 @@ namespace vl
   private:
     struct VertexArrayInfo
     {
-      VertexArrayInfo(): mBufferObject(0), mPtr(0), mState(0), mEnabled(false) {}
+      VertexArrayInfo(): mBufferObject(0), mPtr(0), mStride(0), mState(0), mEnabled(false) {}
       int   mBufferObject;
       const unsigned char* mPtr;
+      GLsizei mStride;
       int mState;
       bool mEnabled;
     };
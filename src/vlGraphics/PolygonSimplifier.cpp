@@ -31,6 +31,7 @@
 
 #include <vlGraphics/PolygonSimplifier.hpp>
 #include <vlGraphics/DoubleVertexRemover.hpp>
+#include <vlGraphics/MeshAdjacency.hpp>
 #include <vlCore/Time.hpp>
 #include <vlCore/Log.hpp>
 #include <vlCore/Say.hpp>
@@ -204,10 +205,6 @@ void PolygonSimplifier::simplify(const std::vector<fvec3>& in_verts, const std::
 
     // unprotect the vertex
     mSimplifiedVertices[ivert]->mProtected = false;
-
-    // reserve the memory for quicker allocation
-    mSimplifiedVertices[ivert]->mIncidentTriangles.reserve(12);
-    mSimplifiedVertices[ivert]->mAdjacentVerts.reserve(12);
   }
 
   // initialize triangles
@@ -220,19 +217,22 @@ void PolygonSimplifier::simplify(const std::vector<fvec3>& in_verts, const std::
   }
 
   // compute vertex/vertex and vertex/triangle connectivity
+  MeshAdjacency adjacency;
+  adjacency.build( (int)in_verts.size(), std::vector<u32>(in_tris.begin(), in_tris.end()) );
+  for(int ivert=0; ivert<(int)in_verts.size(); ++ivert)
+  {
+    Vertex* vert = mSimplifiedVertices[ivert];
+    vert->mIncidentTriangles.resize( adjacency.vertexTriangleCount(ivert) );
+    for(int i=0; i<adjacency.vertexTriangleCount(ivert); ++i)
+      vert->mIncidentTriangles[i] = mSimplifiedTriangles[ adjacency.vertexTriangle(ivert, i) ];
+    vert->mAdjacentVerts.resize( adjacency.vertexEdgeCount(ivert) );
+    for(int i=0; i<adjacency.vertexEdgeCount(ivert); ++i)
+      vert->mAdjacentVerts[i] = mSimplifiedVertices[ adjacency.vertexNeighbor(ivert, i) ];
+  }
+  adjacency.reset();
+
   for(int itri=0; itri<(int)mSimplifiedTriangles.size(); ++itri)
   {
-    // add this triangle to all its vertices
-    mSimplifiedTriangles[itri]->mVertices[0]->mIncidentTriangles.push_back( mSimplifiedTriangles[itri] );
-    mSimplifiedTriangles[itri]->mVertices[1]->mIncidentTriangles.push_back( mSimplifiedTriangles[itri] );
-    mSimplifiedTriangles[itri]->mVertices[2]->mIncidentTriangles.push_back( mSimplifiedTriangles[itri] );
-    // add adjacent vertices
-    mSimplifiedTriangles[itri]->mVertices[0]->addAdjacentVertex( mSimplifiedTriangles[itri]->mVertices[1] ); // vertex 0
-    mSimplifiedTriangles[itri]->mVertices[0]->addAdjacentVertex( mSimplifiedTriangles[itri]->mVertices[2] );
-    mSimplifiedTriangles[itri]->mVertices[1]->addAdjacentVertex( mSimplifiedTriangles[itri]->mVertices[0] ); // vertex 1
-    mSimplifiedTriangles[itri]->mVertices[1]->addAdjacentVertex( mSimplifiedTriangles[itri]->mVertices[2] );
-    mSimplifiedTriangles[itri]->mVertices[2]->addAdjacentVertex( mSimplifiedTriangles[itri]->mVertices[0] ); // vertex 2
-    mSimplifiedTriangles[itri]->mVertices[2]->addAdjacentVertex( mSimplifiedTriangles[itri]->mVertices[1] );
     // compute normal
     mSimplifiedTriangles[itri]->computeNormal();
     // error
@@ -227,6 +227,15 @@ const RenderQueue* Renderer::render(const RenderQueue* render_queue, Camera* cam
         }
       }
 
+      // residency: reloading a texture or buffer object disturbs the bindings tracked by the context
+
+      if ( mResidencyManager && mResidencyManager->touch( shader, tok->mRenderable, renderTick() ) )
+      {
+        opengl_context->applyRenderStates( mDummyStateSet.get(), NULL );
+        opengl_context->bindVAS( NULL, false, false );
+        cur_render_state_set = NULL;
+      }
+
       // shader's render states
 
       if ( cur_render_state_set != shader->getRenderStateSet() )
@@ -414,6 +423,10 @@ const RenderQueue* Renderer::render(const RenderQueue* render_queue, Camera* cam
   // disable all vertex arrays, note this also calls "glBindBuffer(GL_ARRAY_BUFFER, 0)"
   opengl_context->bindVAS(NULL, false, false); VL_CHECK_OGL();
 
+  // evict the resources not used recently if over budget
+  if (mResidencyManager)
+    mResidencyManager->enforceBudget( renderTick() );
+
   return render_queue;
 }
 //-----------------------------------------------------------------------------
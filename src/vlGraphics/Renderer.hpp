@@ -35,6 +35,7 @@
 #include <vlGraphics/RendererAbstract.hpp>
 #include <vlGraphics/ProjViewTransfCallback.hpp>
 #include <vlGraphics/Shader.hpp>
+#include <vlGraphics/ResidencyManager.hpp>
 #include <map>
 
 namespace vl
@@ -94,6 +95,15 @@ namespace vl
     /** The Framebuffer on which the rendering is performed. */
     Framebuffer* framebuffer() { return mFramebuffer.get(); }
 
+    /** The ResidencyManager that keeps the Textures and BufferObjects used by this renderer within a memory budget, NULL by default. */
+    void setResidencyManager(ResidencyManager* manager) { mResidencyManager = manager; }
+
+    /** The ResidencyManager that keeps the Textures and BufferObjects used by this renderer within a memory budget, NULL by default. */
+    const ResidencyManager* residencyManager() const { return mResidencyManager.get(); }
+
+    /** The ResidencyManager that keeps the Textures and BufferObjects used by this renderer within a memory budget, NULL by default. */
+    ResidencyManager* residencyManager() { return mResidencyManager.get(); }
+
   protected:
     ref<Framebuffer> mFramebuffer;
 
@@ -106,6 +116,8 @@ namespace vl
     std::vector<RenderStateSlot> mOverriddenDefaultRenderStates;
 
     ref<ProjViewTransfCallback> mProjViewTransfCallback;
+
+    ref<ResidencyManager> mResidencyManager;
   };
   //------------------------------------------------------------------------------
 }
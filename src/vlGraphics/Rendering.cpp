@@ -392,8 +392,18 @@ void Rendering::fillRenderQueue( ActorCollection* actor_list )
               VL_CHECK(tex_unit);
               if (tex_unit)
               {
-                if (tex_unit->texture() && tex_unit->texture()->setupParams())
-                  tex_unit->texture()->createTexture();
+                Texture* texture = tex_unit->texture();
+                if (texture && texture->creationPending())
+                {
+                  // prepared again after being created: destroyTexture() releases the SetupParams
+                  if (texture->handle())
+                  {
+                    ref<Texture::SetupParams> setup_params = texture->setupParams();
+                    texture->destroyTexture();
+                    texture->setSetupParams( setup_params.get() );
+                  }
+                  texture->createTexture();
+                }
               }
             }
           }
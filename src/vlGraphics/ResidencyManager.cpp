@@ -0,0 +1,546 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#include <vlGraphics/ResidencyManager.hpp>
+#include <vlGraphics/Shader.hpp>
+#include <vlGraphics/Geometry.hpp>
+#include <vlGraphics/OpenGL.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+#include <algorithm>
+
+using namespace vl;
+
+namespace
+{
+  //! Orders the resources from the least recently used, the larger first among the ones used at the same time.
+  class LessRecentlyUsed
+  {
+  public:
+    bool operator()(const ResidentResource* a, const ResidentResource* b) const
+    {
+      if (a->lastUsedTick() != b->lastUsedTick())
+        return a->lastUsedTick() < b->lastUsedTick();
+      else
+        return a->residentBytes() > b->residentBytes();
+    }
+  };
+
+#if defined(VL_OPENGL)
+  //! Returns the size in bytes of the bound texture's mipmap level.
+  long long levelBytes(GLenum target, int level)
+  {
+    GLint w = 0, h = 0, d = 0;
+    glGetTexLevelParameteriv( target, level, GL_TEXTURE_WIDTH,  &w );
+    glGetTexLevelParameteriv( target, level, GL_TEXTURE_HEIGHT, &h );
+    glGetTexLevelParameteriv( target, level, GL_TEXTURE_DEPTH,  &d );
+    if (!w)
+      return 0;
+
+    GLint compressed = GL_FALSE;
+    glGetTexLevelParameteriv( target, level, GL_TEXTURE_COMPRESSED, &compressed );
+    if (compressed)
+    {
+      GLint size = 0;
+      glGetTexLevelParameteriv( target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size );
+      return size;
+    }
+
+    const GLenum components[] = { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE };
+    GLint bits = 0;
+    for(int i=0; i<5; ++i)
+    {
+      GLint size = 0;
+      glGetTexLevelParameteriv( target, level, components[i], &size );
+      bits += size;
+    }
+    if (Has_Fixed_Function_Pipeline)
+    {
+      GLint size = 0;
+      glGetTexLevelParameteriv( target, level, GL_TEXTURE_LUMINANCE_SIZE, &size );
+      bits += size;
+      size = 0;
+      glGetTexLevelParameteriv( target, level, GL_TEXTURE_INTENSITY_SIZE, &size );
+      bits += size;
+    }
+    if (Has_GL_Version_3_0 || Has_GL_Version_4_0)
+    {
+      GLint size = 0;
+      glGetTexLevelParameteriv( target, level, GL_TEXTURE_STENCIL_SIZE, &size );
+      bits += size;
+    }
+    return (long long)w * h * std::max(1, (int)d) * ( (bits + 7) / 8 );
+  }
+
+  //! Returns the query for the texture bound to \p dimension on the active texture unit.
+  GLenum textureBinding(ETextureDimension dimension)
+  {
+    switch(dimension)
+    {
+    case TD_TEXTURE_1D:                   return GL_TEXTURE_BINDING_1D;
+    case TD_TEXTURE_2D:                   return GL_TEXTURE_BINDING_2D;
+    case TD_TEXTURE_3D:                   return GL_TEXTURE_BINDING_3D;
+    case TD_TEXTURE_CUBE_MAP:             return GL_TEXTURE_BINDING_CUBE_MAP;
+    case TD_TEXTURE_RECTANGLE:            return GL_TEXTURE_BINDING_RECTANGLE;
+    case TD_TEXTURE_1D_ARRAY:             return GL_TEXTURE_BINDING_1D_ARRAY;
+    case TD_TEXTURE_2D_ARRAY:             return GL_TEXTURE_BINDING_2D_ARRAY;
+    case TD_TEXTURE_2D_MULTISAMPLE:       return GL_TEXTURE_BINDING_2D_MULTISAMPLE;
+    case TD_TEXTURE_2D_MULTISAMPLE_ARRAY: return GL_TEXTURE_BINDING_2D_MULTISAMPLE_ARRAY;
+    default:                              return GL_NONE;
+    }
+  }
+#endif
+
+  //! Returns the number of bytes allocated by a texture, querying OpenGL where possible.
+  long long textureBytes(const Texture* tex)
+  {
+    if (!tex->handle() || tex->dimension() == TD_TEXTURE_BUFFER)
+      return 0;
+
+#if defined(VL_OPENGL)
+    GLenum target = tex->dimension() == TD_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : tex->dimension();
+    long long bytes = 0;
+    // called while rendering: the binding tracked by the TextureSampler states must be left untouched
+    GLint bound = 0;
+    if (textureBinding(tex->dimension()) != GL_NONE)
+      glGetIntegerv( textureBinding(tex->dimension()), &bound );
+    glBindTexture( tex->dimension(), tex->handle() );
+    // levels are counted until the first missing one
+    for(int level=0; level<32; ++level)
+    {
+      long long level_bytes = levelBytes(target, level);
+      if (!level_bytes)
+        break;
+      bytes += level_bytes;
+    }
+    glBindTexture( tex->dimension(), bound );
+    VL_CHECK_OGL()
+    if (tex->dimension() == TD_TEXTURE_CUBE_MAP)
+      bytes *= 6;
+    return bytes * std::max(1, tex->samples());
+#else
+    // estimate 4 bytes per texel and a full mipmap chain
+    long long texels = (long long)std::max(1, tex->width()) * std::max(1, tex->height()) * std::max(1, tex->depth());
+    if (tex->dimension() == TD_TEXTURE_CUBE_MAP)
+      texels *= 6;
+    return texels * 4 * 4 / 3;
+#endif
+  }
+}
+
+//-----------------------------------------------------------------------------
+// TextureResidency
+//-----------------------------------------------------------------------------
+TextureResidency::TextureResidency(Texture* texture): mTexture(texture), mBytes(0), mHandle(0), mWidth(0), mHeight(0)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+}
+//-----------------------------------------------------------------------------
+void TextureResidency::measure()
+{
+  mHandle = mTexture->handle();
+  mWidth  = mTexture->width();
+  mHeight = mTexture->height();
+  mBytes  = textureBytes( mTexture.get() );
+}
+//-----------------------------------------------------------------------------
+void TextureResidency::update()
+{
+  // the texture was created, recreated or destroyed by someone else
+  if ( mHandle != mTexture->handle() || mWidth != mTexture->width() || mHeight != mTexture->height() )
+    measure();
+}
+//-----------------------------------------------------------------------------
+bool TextureResidency::canReload() const
+{
+  const Texture::SetupParams* setup = mTexture->setupParams();
+  return setup && !setup->imagePath().empty();
+}
+//-----------------------------------------------------------------------------
+bool TextureResidency::evict()
+{
+  if ( !mTexture->handle() || !canReload() )
+    return false;
+
+  // destroyTexture() releases the SetupParams we need to reload the texture
+  ref<Texture::SetupParams> setup = mTexture->setupParams();
+  mTexture->destroyTexture();
+  mTexture->setSetupParams( setup.get() );
+  // reloaded by touch(), not by the Rendering
+  mTexture->setCreationPending(false);
+  measure();
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool TextureResidency::reload()
+{
+  if (!canReload())
+    return false;
+
+  if (mTexture->handle())
+  {
+    // recreated by someone else meanwhile
+    if (!downgrades())
+    {
+      measure();
+      return true;
+    }
+
+    ref<Texture::SetupParams> setup = mTexture->setupParams();
+    mTexture->destroyTexture();
+    mTexture->setSetupParams( setup.get() );
+  }
+
+  bool ok = mTexture->createTexture();
+  // the new OpenGL texture has default parameters
+  mTexture->getTexParameter()->setDirty(true);
+  measure();
+  return ok;
+}
+//-----------------------------------------------------------------------------
+bool TextureResidency::downgrade()
+{
+#if defined(VL_OPENGL)
+  if ( !mTexture->handle() || mTexture->dimension() != TD_TEXTURE_2D || mTexture->border() || mTexture->isDepthTexture() )
+    return false;
+
+  glBindTexture( GL_TEXTURE_2D, mTexture->handle() );
+
+  // only textures whose whole mipmap chain is in use are downgraded
+  GLint base_level = 0, max_level = 1000;
+  glGetTexParameteriv( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &base_level );
+  glGetTexParameteriv( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,  &max_level );
+  GLint internal_format = 0, compressed = GL_FALSE, red_type = GL_NONE;
+  glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internal_format );
+  glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed );
+  if (Has_GL_Version_3_0 || Has_GL_Version_4_0)
+    glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_RED_TYPE, &red_type );
+
+  int levels = 0;
+  for( ; levels<=max_level && levels<32; ++levels )
+  {
+    GLint w = 0;
+    glGetTexLevelParameteriv( GL_TEXTURE_2D, levels, GL_TEXTURE_WIDTH, &w );
+    if (!w)
+      break;
+  }
+
+  // integer textures cannot be read back as floats
+  if ( base_level != 0 || levels < 2 || red_type == GL_INT || red_type == GL_UNSIGNED_INT )
+  {
+    glBindTexture( GL_TEXTURE_2D, 0 );
+    VL_CHECK_OGL()
+    return false;
+  }
+
+  // read back all the levels but the largest
+  std::vector< std::vector<unsigned char> > pixels( levels - 1 );
+  std::vector<GLint> widths( levels - 1 ), heights( levels - 1 );
+  glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+  for(int i=1; i<levels; ++i)
+  {
+    glGetTexLevelParameteriv( GL_TEXTURE_2D, i, GL_TEXTURE_WIDTH,  &widths[i-1] );
+    glGetTexLevelParameteriv( GL_TEXTURE_2D, i, GL_TEXTURE_HEIGHT, &heights[i-1] );
+    if (compressed)
+    {
+      GLint size = 0;
+      glGetTexLevelParameteriv( GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size );
+      pixels[i-1].resize( size );
+      vl::glGetCompressedTexImage( GL_TEXTURE_2D, i, &pixels[i-1][0] );
+    }
+    else
+    {
+      pixels[i-1].resize( widths[i-1] * heights[i-1] * 4 * sizeof(GLfloat) );
+      glGetTexImage( GL_TEXTURE_2D, i, GL_RGBA, GL_FLOAT, &pixels[i-1][0] );
+    }
+  }
+  glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+  VL_CHECK_OGL()
+
+  // recreate the texture without its largest level
+  GLuint handle = 0;
+  glGenTextures( 1, &handle );
+  glBindTexture( GL_TEXTURE_2D, handle );
+  glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+  for(int i=0; i<levels-1; ++i)
+  {
+    if (compressed)
+      glCompressedTexImage2D( GL_TEXTURE_2D, i, internal_format, widths[i], heights[i], 0, (GLsizei)pixels[i].size(), &pixels[i][0] );
+    else
+      glTexImage2D( GL_TEXTURE_2D, i, internal_format, widths[i], heights[i], 0, GL_RGBA, GL_FLOAT, &pixels[i][0] );
+  }
+  glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 2 );
+  glBindTexture( GL_TEXTURE_2D, 0 );
+  VL_CHECK_OGL()
+
+  GLuint old_handle = mTexture->handle();
+  glDeleteTextures( 1, &old_handle );
+  mTexture->setHandle( handle );
+  mTexture->setWidth( widths[0] );
+  mTexture->setHeight( heights[0] );
+  // the new OpenGL texture has default parameters
+  mTexture->getTexParameter()->setDirty(true);
+  measure();
+  return true;
+#else
+  return false;
+#endif
+}
+//-----------------------------------------------------------------------------
+// BufferObjectResidency
+//-----------------------------------------------------------------------------
+bool BufferObjectResidency::canReload() const
+{
+#if defined(VL_OPENGL)
+  return true;
+#else
+  // the contents of the buffer object cannot be downloaded
+  return (long long)mBufferObject->bytesUsed() >= (long long)mBufferObject->byteCountBufferObject();
+#endif
+}
+//-----------------------------------------------------------------------------
+bool BufferObjectResidency::evict()
+{
+  if ( !mBufferObject->handle() || !canReload() )
+    return false;
+
+  if ( (long long)mBufferObject->bytesUsed() < (long long)mBufferObject->byteCountBufferObject() )
+    mBufferObject->downloadBufferObject();
+  mUsage = mBufferObject->usage();
+  mBufferObject->deleteBufferObject();
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool BufferObjectResidency::reload()
+{
+  if (!mBufferObject->bytesUsed())
+    return false;
+
+  mBufferObject->setBufferData( (GLsizeiptr)mBufferObject->bytesUsed(), mBufferObject->ptr(), mUsage );
+  return true;
+}
+//-----------------------------------------------------------------------------
+// ResidencyManager
+//-----------------------------------------------------------------------------
+ResidencyManager::ResidencyManager(long long budget)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mLastRenderStateSet = NULL;
+  mLastRenderable = NULL;
+  mLastTick = 0;
+  mBudget = budget;
+  mResidentBytes = 0;
+  mMinIdleTicks = 1;
+  mMaxDowngrades = 2;
+  mAutoTrack = true;
+}
+//-----------------------------------------------------------------------------
+ResidentResource* ResidencyManager::track(ResidentResource* res)
+{
+  VL_CHECK(res && res->object())
+  res->update();
+  mResidentBytes += res->residentBytes();
+  ref<ResidentResource>& slot = mResources[res->object()];
+  if (slot)
+    mResidentBytes -= slot->residentBytes();
+  slot = res;
+  return res;
+}
+//-----------------------------------------------------------------------------
+ResidentResource* ResidencyManager::track(Texture* texture)
+{
+  ResidentResource* res = resource(texture);
+  return res ? res : track( new TextureResidency(texture) );
+}
+//-----------------------------------------------------------------------------
+ResidentResource* ResidencyManager::track(BufferObject* buffer_object)
+{
+  ResidentResource* res = resource(buffer_object);
+  return res ? res : track( new BufferObjectResidency(buffer_object) );
+}
+//-----------------------------------------------------------------------------
+void ResidencyManager::untrack(const Object* obj)
+{
+  std::map< const Object*, ref<ResidentResource> >::iterator it = mResources.find(obj);
+  if (it != mResources.end())
+  {
+    mResidentBytes -= it->second->residentBytes();
+    mResources.erase(it);
+  }
+}
+//-----------------------------------------------------------------------------
+ResidentResource* ResidencyManager::resource(const Object* obj)
+{
+  std::map< const Object*, ref<ResidentResource> >::iterator it = mResources.find(obj);
+  return it != mResources.end() ? it->second.get() : NULL;
+}
+//-----------------------------------------------------------------------------
+bool ResidencyManager::touch(Object* obj, unsigned long tick)
+{
+  ResidentResource* res = resource(obj);
+  if (!res && autoTrack())
+  {
+    Texture* texture = obj->as<Texture>();
+    BufferObject* buffer_object = obj->as<BufferObject>();
+    if (texture && texture->handle())
+      res = track(texture);
+    else
+    if (buffer_object && buffer_object->handle())
+      res = track(buffer_object);
+  }
+  if (!res)
+    return false;
+
+  res->mLastUsedTick = tick;
+
+  // downgraded resources are restored only if they fit in the budget
+  bool reload = res->mEvicted;
+  if (res->mDowngrades)
+    reload = residentBytes() - res->residentBytes() + res->mFullBytes <= budget();
+  if (!reload)
+    return false;
+
+  long long bytes = res->residentBytes();
+  bool ok = res->reload();
+  mResidentBytes += res->residentBytes() - bytes;
+  if (!ok)
+  {
+    Log::error( Say("ResidencyManager::touch(): could not reload '%s'.\n") << obj->objectName() );
+    untrack(obj);
+    return true;
+  }
+  res->mEvicted = false;
+  res->mDowngrades = 0;
+  res->mFullBytes = 0;
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool ResidencyManager::touch(const Shader* shader, Renderable* renderable, unsigned long tick)
+{
+  bool reloaded = false;
+
+  // consecutive actors often share the same render states or renderable
+  const RenderStateSet* rss = shader ? shader->getRenderStateSet() : NULL;
+  if ( rss && ( rss != mLastRenderStateSet || tick != mLastTick ) )
+  {
+    const RenderStateSlot* states = rss->renderStates();
+    for( size_t i=0; i<rss->renderStatesCount(); ++i )
+    {
+      if (states[i].mRS->type() == RS_TextureSampler)
+      {
+        // the manager may need to reload the texture
+        Texture* texture = const_cast<Texture*>( static_cast<const TextureSampler*>( states[i].mRS.get() )->texture() );
+        if (texture)
+          reloaded |= touch(texture, tick);
+      }
+    }
+  }
+
+  Geometry* geom = renderable ? renderable->as<Geometry>() : NULL;
+  if ( geom && geom->isBufferObjectEnabled() && ( renderable != mLastRenderable || tick != mLastTick ) )
+  {
+    geom->collectArrays(mArrays);
+    for(size_t i=0; i<mArrays.size(); ++i)
+      if (mArrays[i]->bufferObject())
+        reloaded |= touch(mArrays[i]->bufferObject(), tick);
+    for(int i=0; i<geom->drawCalls().size(); ++i)
+      if (geom->drawCalls().at(i)->indexBufferObject())
+        reloaded |= touch(geom->drawCalls().at(i)->indexBufferObject(), tick);
+  }
+
+  mLastRenderStateSet = rss;
+  mLastRenderable = renderable;
+  mLastTick = tick;
+  return reloaded;
+}
+//-----------------------------------------------------------------------------
+long long ResidencyManager::enforceBudget(unsigned long tick)
+{
+  // refresh the sizes and release the objects nobody else uses
+  std::vector<ResidentResource*> candidates;
+  long long bytes = 0;
+  for( std::map< const Object*, ref<ResidentResource> >::iterator it = mResources.begin(); it != mResources.end(); )
+  {
+    ResidentResource* res = it->second.get();
+    if (res->object()->referenceCount() == 1)
+    {
+      mResources.erase(it++);
+      continue;
+    }
+    res->update();
+    bytes += res->residentBytes();
+    if ( !res->mEvicted && res->residentBytes() > 0 && res->lastUsedTick() + minIdleTicks() <= tick && res->canReload() )
+      candidates.push_back(res);
+    ++it;
+  }
+  mResidentBytes = bytes;
+
+  if (mResidentBytes <= budget())
+    return 0;
+
+  std::sort( candidates.begin(), candidates.end(), LessRecentlyUsed() );
+
+  long long released = 0;
+  for(size_t i=0; i<candidates.size() && mResidentBytes > budget(); ++i)
+  {
+    ResidentResource* res = candidates[i];
+    long long before = res->residentBytes();
+
+    while( res->mDowngrades < maxDowngrades() && mResidentBytes > budget() )
+    {
+      long long full_bytes = res->residentBytes();
+      if (!res->downgrade())
+        break;
+      if (!res->mDowngrades)
+        res->mFullBytes = full_bytes;
+      ++res->mDowngrades;
+      mResidentBytes += res->residentBytes() - full_bytes;
+    }
+
+    if ( mResidentBytes > budget() )
+    {
+      long long current = res->residentBytes();
+      if (res->evict())
+      {
+        res->mEvicted = true;
+        res->mDowngrades = 0;
+        res->mFullBytes = 0;
+        mResidentBytes += res->residentBytes() - current;
+      }
+    }
+
+    released += before - res->residentBytes();
+  }
+
+  return released;
+}
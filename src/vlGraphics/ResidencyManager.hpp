@@ -0,0 +1,270 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef ResidencyManager_INCLUDE_ONCE
+#define ResidencyManager_INCLUDE_ONCE
+
+#include <vlGraphics/Texture.hpp>
+#include <vlGraphics/BufferObject.hpp>
+#include <map>
+#include <vector>
+
+namespace vl
+{
+  class Shader;
+  class Renderable;
+  class RenderStateSet;
+  class ArrayAbstract;
+
+//-----------------------------------------------------------------------------
+// ResidentResource
+//-----------------------------------------------------------------------------
+  /**
+   * A resource whose memory is managed by a ResidencyManager.
+   *
+   * Subclasses implement the memory operations for a given kind of object, see TextureResidency and BufferObjectResidency.
+   * The bookkeeping (last use, evicted and downgraded state) is done by the ResidencyManager, so the eviction policy can be
+   * exercised with resources that do not touch OpenGL at all.
+   */
+  class VLGRAPHICS_EXPORT ResidentResource: public Object
+  {
+    VL_INSTRUMENT_ABSTRACT_CLASS(vl::ResidentResource, Object)
+
+    friend class ResidencyManager;
+
+  public:
+    ResidentResource(): mFullBytes(0), mLastUsedTick(0), mDowngrades(0), mEvicted(false)
+    {
+      VL_DEBUG_SET_OBJECT_NAME()
+    }
+
+    //! The object whose memory is managed.
+    virtual Object* object() = 0;
+
+    //! The number of bytes currently allocated by the resource, 0 if it is evicted.
+    virtual long long residentBytes() const = 0;
+
+    //! Called by ResidencyManager::enforceBudget() before residentBytes(), to refresh the size of the resource if it was modified.
+    virtual void update() {}
+
+    //! Whether the resource can be restored by reload() after being evicted or downgraded.
+    virtual bool canReload() const = 0;
+
+    //! Releases the memory of the resource, keeping what is needed to reload() it.
+    virtual bool evict() = 0;
+
+    //! Reduces the memory used by the resource by one step, i.e. drops its largest mipmap level. Returns false if not possible.
+    virtual bool downgrade() { return false; }
+
+    //! Restores the resource to its full size.
+    virtual bool reload() = 0;
+
+    //! The render tick of the last use of the resource.
+    unsigned long lastUsedTick() const { return mLastUsedTick; }
+
+    //! Whether the resource has been evicted.
+    bool isEvicted() const { return mEvicted; }
+
+    //! The number of times the resource has been downgraded since it was last loaded.
+    int downgrades() const { return mDowngrades; }
+
+  protected:
+    long long mFullBytes;
+    unsigned long mLastUsedTick;
+    int mDowngrades;
+    bool mEvicted;
+  };
+//-----------------------------------------------------------------------------
+// TextureResidency
+//-----------------------------------------------------------------------------
+  /**
+   * Manages the memory of a Texture.
+   *
+   * The size of the texture is measured querying every mipmap level. A texture can be reloaded if its Texture::setupParams()
+   * carry the path of its image, as is the case for the textures created from an image file or by TextureStreamer.
+   * Downgrading is supported for 2D textures with at least two mipmap levels: the smaller levels are read back and
+   * the texture is recreated without its largest level. Downgrading requires desktop OpenGL.
+   */
+  class VLGRAPHICS_EXPORT TextureResidency: public ResidentResource
+  {
+    VL_INSTRUMENT_CLASS(vl::TextureResidency, ResidentResource)
+
+  public:
+    TextureResidency(Texture* texture);
+
+    Texture* texture() { return mTexture.get(); }
+
+    virtual Object* object() { return mTexture.get(); }
+    virtual long long residentBytes() const { return mBytes; }
+    virtual void update();
+    virtual bool canReload() const;
+    virtual bool evict();
+    virtual bool downgrade();
+    virtual bool reload();
+
+  protected:
+    void measure();
+
+  protected:
+    ref<Texture> mTexture;
+    long long mBytes;
+    unsigned int mHandle;
+    int mWidth;
+    int mHeight;
+  };
+//-----------------------------------------------------------------------------
+// BufferObjectResidency
+//-----------------------------------------------------------------------------
+  /**
+   * Manages the memory of a BufferObject.
+   *
+   * Evicting a BufferObject deletes its OpenGL buffer and keeps its contents in the local storage, downloading them first
+   * if the local storage was discarded. Reloading uploads the local storage again with the same usage.
+   */
+  class VLGRAPHICS_EXPORT BufferObjectResidency: public ResidentResource
+  {
+    VL_INSTRUMENT_CLASS(vl::BufferObjectResidency, ResidentResource)
+
+  public:
+    BufferObjectResidency(BufferObject* buffer_object): mBufferObject(buffer_object), mUsage(buffer_object->usage()) {}
+
+    BufferObject* bufferObject() { return mBufferObject.get(); }
+
+    virtual Object* object() { return mBufferObject.get(); }
+    virtual long long residentBytes() const { return mBufferObject->byteCountBufferObject(); }
+    virtual bool canReload() const;
+    virtual bool evict();
+    virtual bool reload();
+
+  protected:
+    ref<BufferObject> mBufferObject;
+    EBufferObjectUsage mUsage;
+  };
+//-----------------------------------------------------------------------------
+// ResidencyManager
+//-----------------------------------------------------------------------------
+  /**
+   * Keeps the memory used by Textures and BufferObjects within a budget, evicting or downgrading the least recently used ones.
+   *
+   * Install the manager with Renderer::setResidencyManager(). The Renderer then calls touch() for the Shader and the
+   * Renderable of every rendered Actor, stamping their Textures and BufferObjects with Renderer::renderTick(), and
+   * calls enforceBudget() at the end of each rendering.
+   * - The resources used for the first time are tracked automatically, see setAutoTrack().
+   * - When the resident bytes exceed budget() the resources not used in the last minIdleTicks() ticks are shrunk in
+   *   least recently used order: each one is downgraded up to maxDowngrades() times, then evicted.
+   * - Only resources that canReload() are downgraded or evicted.
+   * - An evicted resource is reloaded by touch() as soon as it is used again. A downgraded resource is reloaded
+   *   when used, provided that its full size fits in the budget.
+   * - Tracked objects referenced only by the manager are released.
+   *
+   * The policy only relies on the ResidentResource interface, so it can be tested with custom resources
+   * added with track(ResidentResource*), without an OpenGL context.
+   * Share a manager only among Renderers whose render ticks advance together.
+   */
+  class VLGRAPHICS_EXPORT ResidencyManager: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::ResidencyManager, Object)
+
+  public:
+    ResidencyManager(long long budget=512*1024*1024);
+
+    //! The maximum number of bytes of the tracked resources, defaults to 512 MB.
+    void setBudget(long long bytes) { mBudget = bytes; }
+
+    //! The maximum number of bytes of the tracked resources, defaults to 512 MB.
+    long long budget() const { return mBudget; }
+
+    //! How many times a resource is downgraded before being evicted, defaults to 2.
+    void setMaxDowngrades(int count) { mMaxDowngrades = count; }
+
+    //! How many times a resource is downgraded before being evicted, defaults to 2.
+    int maxDowngrades() const { return mMaxDowngrades; }
+
+    //! Resources used in the last \p ticks render ticks are never evicted nor downgraded, defaults to 1, i.e. the current tick.
+    void setMinIdleTicks(unsigned long ticks) { mMinIdleTicks = ticks; }
+
+    //! Resources used in the last \p ticks render ticks are never evicted nor downgraded, defaults to 1, i.e. the current tick.
+    unsigned long minIdleTicks() const { return mMinIdleTicks; }
+
+    //! Whether the Textures and BufferObjects touched for the first time are tracked automatically, defaults to true.
+    void setAutoTrack(bool on) { mAutoTrack = on; }
+
+    //! Whether the Textures and BufferObjects touched for the first time are tracked automatically, defaults to true.
+    bool autoTrack() const { return mAutoTrack; }
+
+    //! Starts tracking a custom resource. Returns \p res.
+    ResidentResource* track(ResidentResource* res);
+
+    //! Starts tracking a Texture, if not already tracked.
+    ResidentResource* track(Texture* texture);
+
+    //! Starts tracking a BufferObject, if not already tracked.
+    ResidentResource* track(BufferObject* buffer_object);
+
+    //! Stops tracking the resource of \p obj. The object is left in its current state.
+    void untrack(const Object* obj);
+
+    //! The resource tracking \p obj, NULL if not tracked.
+    ResidentResource* resource(const Object* obj);
+
+    //! The number of tracked resources.
+    int trackedCount() const { return (int)mResources.size(); }
+
+    //! The number of bytes used by the tracked resources, as of the last enforceBudget().
+    long long residentBytes() const { return mResidentBytes; }
+
+    /** Marks \p obj as used at \p tick, reloading it if it was evicted or downgraded.
+     * Returns true if the resource was reloaded, in which case the OpenGL texture and buffer bindings may have changed. */
+    bool touch(Object* obj, unsigned long tick);
+
+    /** Touches the Textures of \p shader and the BufferObjects of \p renderable, either one can be NULL.
+     * Returns true if a resource was reloaded, see touch(Object*, unsigned long). */
+    bool touch(const Shader* shader, Renderable* renderable, unsigned long tick);
+
+    /** Downgrades and evicts the least recently used resources until residentBytes() is within budget().
+     * Returns the number of bytes released. */
+    long long enforceBudget(unsigned long tick);
+
+  protected:
+    std::map< const Object*, ref<ResidentResource> > mResources;
+    std::vector<ArrayAbstract*> mArrays;
+    const RenderStateSet* mLastRenderStateSet;
+    const Renderable* mLastRenderable;
+    unsigned long mLastTick;
+    long long mBudget;
+    long long mResidentBytes;
+    unsigned long mMinIdleTicks;
+    int mMaxDowngrades;
+    bool mAutoTrack;
+  };
+}
+
+#endif
@@ -30,9 +30,47 @@
 /**************************************************************************************/
 
 #include <vlGraphics/Tessellator.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 using namespace vl;
 
+//-----------------------------------------------------------------------------
+namespace
+{
+  struct SortByValue
+  {
+    SortByValue(const std::vector<double>& values): mValues(&values) {}
+    bool operator()(int a, int b) const { return (*mValues)[a] < (*mValues)[b]; }
+    const std::vector<double>* mValues;
+  };
+
+  inline bool pointInTriangle(double ax, double ay, double bx, double by, double cx, double cy, double px, double py)
+  {
+    return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+           (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+           (bx - px) * (cy - py) >= (cx - px) * (by - py);
+  }
+
+  inline int sign(double v) { return v > 0 ? 1 : (v < 0 ? -1 : 0); }
+
+  inline double cross2(double ax, double ay, double bx, double by) { return ax * by - ay * bx; }
+
+  //! Returns true if p lies within \p eps from the interior of the segment a-b, \p t receives its parameter along the segment.
+  bool onSegmentInterior(double ax, double ay, double bx, double by, double px, double py, double eps, double& t)
+  {
+    double dx = bx - ax, dy = by - ay;
+    double len2 = dx*dx + dy*dy;
+    if (len2 == 0)
+      return false;
+    t = ((px - ax) * dx + (py - ay) * dy) / len2;
+    if (t <= 0 || t >= 1)
+      return false;
+    double dist = ::fabs( cross2(dx, dy, px - ax, py - ay) ) / ::sqrt(len2);
+    return dist <= eps;
+  }
+}
 //-----------------------------------------------------------------------------
 Tessellator::Tessellator()
 {
@@ -42,194 +80,1226 @@ Tessellator::Tessellator()
   mTolerance = 0.0;
   mWindingRule = TW_TESS_WINDING_ODD;
   mTessellateIntoSinglePolygon = true;
+  mMinX = mMinY = mInvSize = 0;
+  mUseZOrder = false;
 }
 //-----------------------------------------------------------------------------
 Tessellator::~Tessellator()
 {
-  freeCombinedVertices();
 }
 //-----------------------------------------------------------------------------
 bool Tessellator::tessellate(bool append_tessellated_tris)
 {
   if (!append_tessellated_tris)
     mTessellatedTris.clear();
-  mFans.clear();
-  mTriStrips.clear();
   mLineLoops.clear();
-  mPrimitiveType = 0;
-  freeCombinedVertices();
   if (mContours.empty() || mContourVerts.empty())
   {
     vl::Log::error("Tessellator::tessellate(): no contours specified.\n");
     return false;
   }
 
-  GLUtesselator* tobj = gluNewTess();
-  // callbacks
-  gluTessCallback(tobj, GLU_TESS_BEGIN_DATA,   (callback_type)tessBeginData);
-  gluTessCallback(tobj, GLU_TESS_VERTEX_DATA,  (callback_type)tessVertexData);
-  gluTessCallback(tobj, GLU_TESS_COMBINE_DATA, (callback_type)tessCombineData);
-  gluTessCallback(tobj, GLU_TESS_END,     (callback_type)tessEnd);
-  gluTessCallback(tobj, GLU_TESS_ERROR,        (callback_type)tessError);
-  // normal
-   gluTessNormal( tobj, tessNormal().x(), tessNormal().y(), tessNormal().z() );
-  // properties
-   gluTessProperty(tobj, GLU_TESS_BOUNDARY_ONLY, boundaryOnly() ? GL_TRUE : GL_FALSE);
-   gluTessProperty(tobj, GLU_TESS_TOLERANCE, tolerance());
-   gluTessProperty(tobj, GLU_TESS_WINDING_RULE, windingRule());
-  // tessellation
+  int total = 0;
+  for(unsigned cont=0; cont<mContours.size(); ++cont)
+    total += mContours[cont];
+  if (total > (int)mContourVerts.size())
+  {
+    vl::Log::error("Tessellator::tessellate(): contours() refer to more vertices than available in contourVerts().\n");
+    return false;
+  }
+
+  dvec3 normal( tessNormal().x(), tessNormal().y(), tessNormal().z() );
   if (tessellateIntoSinglePolygon())
+    tessellatePolygon(0, 0, (int)mContours.size(), normal);
+  else
   {
-    gluTessBeginPolygon(tobj, this);
-    for(unsigned cont=0, idx=0; cont<mContours.size(); ++cont)
+    for(int cont=0, idx=0; cont<(int)mContours.size(); idx+=mContours[cont], ++cont)
+      tessellatePolygon(idx, cont, cont+1, normal);
+  }
+
+  mContours.clear();
+  mContourVerts.clear();
+
+  return true;
+}
+//-----------------------------------------------------------------------------
+ref<Geometry> Tessellator::tessellateGeometry(bool append_tessellated_tris)
+{
+  tessellate(append_tessellated_tris);
+
+  if (mTessellatedTris.empty())
+    return NULL;
+
+  ref<Geometry> geom = new Geometry;
+  ref<ArrayFloat3> vert_array = new ArrayFloat3;
+  
+  vert_array->initFrom(mTessellatedTris);
+
+  geom->setVertexArray(vert_array.get());
+  geom->drawCalls().push_back( new vl::DrawArrays(PT_TRIANGLES, 0, vert_array->size()) );
+  geom->computeNormals();
+  return geom;
+}
+//-----------------------------------------------------------------------------
+void Tessellator::tessellatePolygon(int first_vert, int contour_begin, int contour_end, const dvec3& tess_normal)
+{
+  // collect the vertices and the directed edges of the contours
+
+  mVerts.clear();
+  mEdges.clear();
+  mEdgeCounts.clear();
+  for(int cont=contour_begin, idx=first_vert; cont<contour_end; ++cont)
+  {
+    int first = (int)mVerts.size();
+    int count = mContours[cont];
+    for(int i=0; i<count; ++i, ++idx)
     {
-      gluTessBeginContour(tobj);
-      for(int i=0; i<mContours[cont]; ++i, ++idx)
-        gluTessVertex(tobj, mContourVerts[idx].ptr(), mContourVerts[idx].ptr());
-      gluTessEndContour(tobj);
+      Vertex v;
+      v.x = v.y = 0;
+      v.mPosition = mContourVerts[idx];
+      mVerts.push_back(v);
+      mEdges.push_back(first + i);
+      mEdges.push_back(first + (i+1) % count);
+      mEdgeCounts.push_back(1);
     }
-    gluTessEndPolygon(tobj);
   }
-  else
+  if (mVerts.size() < 3)
+    return;
+
+  // compute the normal: Newell's method gives a positive area to the contours
+
+  dvec3 normal = tess_normal;
+  if (normal.isNull())
   {
-    for(unsigned cont=0, idx=0; cont<mContours.size(); ++cont)
+    for(unsigned e=0; e<mEdgeCounts.size(); ++e)
+    {
+      const dvec3& a = mVerts[ mEdges[e*2+0] ].mPosition;
+      const dvec3& b = mVerts[ mEdges[e*2+1] ].mPosition;
+      normal.x() += (a.y() - b.y()) * (a.z() + b.z());
+      normal.y() += (a.z() - b.z()) * (a.x() + b.x());
+      normal.z() += (a.x() - b.x()) * (a.y() + b.y());
+    }
+    // the areas cancel out (for example a symmetric figure eight): use the largest triangle spanned by the vertices
+    if (normal.isNull())
     {
-      gluTessBeginPolygon(tobj, this);
-      gluTessBeginContour(tobj);
-      for(int i=0; i<mContours[cont]; ++i, ++idx)
-        gluTessVertex(tobj, mContourVerts[idx].ptr(), mContourVerts[idx].ptr());
-      gluTessEndContour(tobj);
-      gluTessEndPolygon(tobj);
+      const dvec3& v0 = mVerts[0].mPosition;
+      int far_vert = 0;
+      double max_dist = 0;
+      for(unsigned i=1; i<mVerts.size(); ++i)
+      {
+        double d = (mVerts[i].mPosition - v0).lengthSquared();
+        if (d > max_dist)
+        {
+          max_dist = d;
+          far_vert = i;
+        }
+      }
+      double max_area = 0;
+      for(unsigned i=1; i<mVerts.size(); ++i)
+      {
+        dvec3 n = cross(mVerts[far_vert].mPosition - v0, mVerts[i].mPosition - v0);
+        if (n.lengthSquared() > max_area)
+        {
+          max_area = n.lengthSquared();
+          normal = n;
+        }
+      }
     }
+    // all the vertices are collinear
+    if (normal.isNull())
+      return;
   }
-  gluDeleteTess(tobj);
+  normal.normalize();
 
-  // triangulate fans
-  for(unsigned fan=0; fan<mFans.size();    ++fan)
-  for(unsigned iv =1; iv<mFans[fan].size()-1; ++iv)
+  // project the vertices on the plane of the polygon
+
+  dvec3 axis(1,0,0);
+  if (::fabs(normal.y()) < ::fabs(normal.x()) && ::fabs(normal.y()) <= ::fabs(normal.z()))
+    axis = dvec3(0,1,0);
+  else
+  if (::fabs(normal.z()) < ::fabs(normal.x()) && ::fabs(normal.z()) < ::fabs(normal.y()))
+    axis = dvec3(0,0,1);
+  dvec3 u = cross(axis, normal).normalize();
+  dvec3 v = cross(normal, u);
+  double min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+  for(unsigned i=0; i<mVerts.size(); ++i)
   {
-    mTessellatedTris.push_back(mFans[fan][0]);
-    mTessellatedTris.push_back(mFans[fan][iv]);
-    mTessellatedTris.push_back(mFans[fan][iv+1]);
+    mVerts[i].x = dot(mVerts[i].mPosition, u);
+    mVerts[i].y = dot(mVerts[i].mPosition, v);
+    if (i == 0 || mVerts[i].x < min_x) min_x = mVerts[i].x;
+    if (i == 0 || mVerts[i].y < min_y) min_y = mVerts[i].y;
+    if (i == 0 || mVerts[i].x > max_x) max_x = mVerts[i].x;
+    if (i == 0 || mVerts[i].y > max_y) max_y = mVerts[i].y;
   }
+  double size = std::max( max_x - min_x, max_y - min_y );
+  if (size == 0)
+    return;
+  double eps = std::max( tolerance(), size * 1.0e-10 );
 
-  // triangulate strips
-  for(unsigned strip=0; strip<mTriStrips.size(); ++strip)
-  for(unsigned iv=0; iv<mTriStrips[strip].size()-2; ++iv)
+  // split the contours where they cross or touch each other
+
+  mergeVertices(eps);
+  for(int iter=0; iter<8; ++iter)
   {
-    if (iv % 2)
+    if (!splitIntersections(eps))
+      break;
+    mergeVertices(eps);
+  }
+
+  // compute the winding number of each region
+
+  buildSubdivision();
+  classifyFaces();
+
+  // generate the outlines and the triangles
+
+  extractBoundaries();
+  if (boundaryOnly())
+  {
+    for(unsigned i=0; i<mBoundaryLoops.size(); ++i)
     {
-      mTessellatedTris.push_back(mTriStrips[strip][iv+0]);
-      mTessellatedTris.push_back(mTriStrips[strip][iv+2]);
-      mTessellatedTris.push_back(mTriStrips[strip][iv+1]);
+      mLineLoops.push_back( std::vector<fvec3>() );
+      mLineLoops.back().reserve( mBoundaryLoops[i].size() );
+      for(unsigned j=0; j<mBoundaryLoops[i].size(); ++j)
+        mLineLoops.back().push_back( (fvec3)mVerts[ mBoundaryLoops[i][j] ].mPosition );
     }
-    else
+  }
+  else
+    triangulateBoundaries();
+}
+//-----------------------------------------------------------------------------
+void Tessellator::mergeVertices(double eps)
+{
+  int count = (int)mVerts.size();
+  mSortKeys.resize(count);
+  mSortOrder.resize(count);
+  for(int i=0; i<count; ++i)
+  {
+    mSortKeys[i] = mVerts[i].x;
+    mSortOrder[i] = i;
+  }
+  std::sort( mSortOrder.begin(), mSortOrder.end(), SortByValue(mSortKeys) );
+
+  // sweep along x merging the vertices closer than eps to the first vertex of their cluster
+  mMergedVerts.clear();
+  mMergedVerts.reserve(count);
+  mVertexMap.assign(count, -1);
+  for(int i=0; i<count; ++i)
+  {
+    int vi = mSortOrder[i];
+    if (mVertexMap[vi] != -1)
+      continue;
+    int idx = (int)mMergedVerts.size();
+    mMergedVerts.push_back( mVerts[vi] );
+    mVertexMap[vi] = idx;
+    for(int j=i+1; j<count && mVerts[mSortOrder[j]].x - mVerts[vi].x <= eps; ++j)
     {
-      mTessellatedTris.push_back(mTriStrips[strip][iv+0]);
-      mTessellatedTris.push_back(mTriStrips[strip][iv+1]);
-      mTessellatedTris.push_back(mTriStrips[strip][iv+2]);
+      int vj = mSortOrder[j];
+      if (mVertexMap[vj] != -1)
+        continue;
+      double dx = mVerts[vj].x - mVerts[vi].x;
+      double dy = mVerts[vj].y - mVerts[vi].y;
+      if (dx*dx + dy*dy <= eps*eps)
+        mVertexMap[vj] = idx;
     }
   }
+  mVerts.swap(mMergedVerts);
 
-  mContours.clear();
-  mContourVerts.clear();
+  // remap the edges removing the degenerate ones
+  int edge_count = 0;
+  for(unsigned e=0; e<mEdgeCounts.size(); ++e)
+  {
+    int a = mVertexMap[ mEdges[e*2+0] ];
+    int b = mVertexMap[ mEdges[e*2+1] ];
+    if (a == b)
+      continue;
+    mEdges[edge_count*2+0] = a;
+    mEdges[edge_count*2+1] = b;
+    mEdgeCounts[edge_count] = mEdgeCounts[e];
+    ++edge_count;
+  }
+  mEdges.resize(edge_count*2);
+  mEdgeCounts.resize(edge_count);
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::splitIntersections(double eps)
+{
+  int edge_count = (int)mEdgeCounts.size();
+  mSortKeys.resize(edge_count);
+  mSortOrder.resize(edge_count);
+  for(int e=0; e<edge_count; ++e)
+  {
+    mSortKeys[e] = std::min( mVerts[ mEdges[e*2+0] ].x, mVerts[ mEdges[e*2+1] ].x );
+    mSortOrder[e] = e;
+  }
+  std::sort( mSortOrder.begin(), mSortOrder.end(), SortByValue(mSortKeys) );
 
-  #if 0
-    if (tessellatedTris().empty())
+  mSplits.clear();
+  for(int i=0; i<edge_count; ++i)
+  {
+    int ei = mSortOrder[i];
+    int a = mEdges[ei*2+0], b = mEdges[ei*2+1];
+    double ax = mVerts[a].x, ay = mVerts[a].y;
+    double bx = mVerts[b].x, by = mVerts[b].y;
+    double max_x = std::max(ax, bx) + eps;
+    double min_yi = std::min(ay, by) - eps;
+    double max_yi = std::max(ay, by) + eps;
+    for(int j=i+1; j<edge_count && mSortKeys[mSortOrder[j]] <= max_x; ++j)
     {
-      vl::Log::warning("Tessellator::tessellate(): no triangles generated.\n");
-      return false;
+      int ej = mSortOrder[j];
+      int c = mEdges[ej*2+0], d = mEdges[ej*2+1];
+      double cx = mVerts[c].x, cy = mVerts[c].y;
+      double dx = mVerts[d].x, dy = mVerts[d].y;
+      if (std::max(cy, dy) < min_yi || std::min(cy, dy) > max_yi)
+        continue;
+
+      // an endpoint touching the interior of the other edge
+      bool touch = false;
+      double t = 0;
+      EdgeSplit split;
+      if (c != a && c != b && onSegmentInterior(ax, ay, bx, by, cx, cy, eps, t))
+      {
+        split.mEdge = ei; split.mT = t; split.mVertex = c; mSplits.push_back(split); touch = true;
+      }
+      if (d != a && d != b && onSegmentInterior(ax, ay, bx, by, dx, dy, eps, t))
+      {
+        split.mEdge = ei; split.mT = t; split.mVertex = d; mSplits.push_back(split); touch = true;
+      }
+      if (a != c && a != d && onSegmentInterior(cx, cy, dx, dy, ax, ay, eps, t))
+      {
+        split.mEdge = ej; split.mT = t; split.mVertex = a; mSplits.push_back(split); touch = true;
+      }
+      if (b != c && b != d && onSegmentInterior(cx, cy, dx, dy, bx, by, eps, t))
+      {
+        split.mEdge = ej; split.mT = t; split.mVertex = b; mSplits.push_back(split); touch = true;
+      }
+      if (touch || a == c || a == d || b == c || b == d)
+        continue;
+
+      // a proper crossing generates a new vertex
+      int o1 = sign( cross2(bx - ax, by - ay, cx - ax, cy - ay) );
+      int o2 = sign( cross2(bx - ax, by - ay, dx - ax, dy - ay) );
+      int o3 = sign( cross2(dx - cx, dy - cy, ax - cx, ay - cy) );
+      int o4 = sign( cross2(dx - cx, dy - cy, bx - cx, by - cy) );
+      if (o1 * o2 >= 0 || o3 * o4 >= 0)
+        continue;
+      double den = cross2(bx - ax, by - ay, dx - cx, dy - cy);
+      double ti = cross2(cx - ax, cy - ay, dx - cx, dy - cy) / den;
+      double tj = cross2(cx - ax, cy - ay, bx - ax, by - ay) / den;
+      ti = std::max( 0.0, std::min( 1.0, ti ) );
+      tj = std::max( 0.0, std::min( 1.0, tj ) );
+      Vertex vert;
+      vert.x = ax + (bx - ax) * ti;
+      vert.y = ay + (by - ay) * ti;
+      // the contours might not be exactly planar: average the points on the two edges
+      vert.mPosition = ( mVerts[a].mPosition * (1.0 - ti) + mVerts[b].mPosition * ti + 
+                         mVerts[c].mPosition * (1.0 - tj) + mVerts[d].mPosition * tj ) * 0.5;
+      int vi = (int)mVerts.size();
+      mVerts.push_back(vert);
+      split.mEdge = ei; split.mT = ti; split.mVertex = vi; mSplits.push_back(split);
+      split.mEdge = ej; split.mT = tj; split.mVertex = vi; mSplits.push_back(split);
     }
-  #endif
+  }
+
+  if (mSplits.empty())
+    return false;
 
+  // replace each split edge with the chain of its sub-edges
+  std::sort( mSplits.begin(), mSplits.end() );
+  for(unsigned s=0; s<mSplits.size(); )
+  {
+    int e = mSplits[s].mEdge;
+    int b = mEdges[e*2+1];
+    int prev = mEdges[e*2+0];
+    bool first = true;
+    for( ; s<mSplits.size() && mSplits[s].mEdge == e; ++s)
+    {
+      int vert = mSplits[s].mVertex;
+      if (vert == prev)
+        continue;
+      if (first)
+      {
+        mEdges[e*2+1] = vert;
+        first = false;
+      }
+      else
+      {
+        mEdges.push_back(prev);
+        mEdges.push_back(vert);
+        mEdgeCounts.push_back( mEdgeCounts[e] );
+      }
+      prev = vert;
+    }
+    if (prev != b)
+    {
+      mEdges.push_back(prev);
+      mEdges.push_back(b);
+      mEdgeCounts.push_back( mEdgeCounts[e] );
+    }
+  }
   return true;
 }
 //-----------------------------------------------------------------------------
-void Tessellator::freeCombinedVertices()
+void Tessellator::buildSubdivision()
 {
-  for(unsigned i=0; i<mCombinedVertices.size(); ++i)
-    delete mCombinedVertices[i];
-  mCombinedVertices.clear();
+  // combine the coincident edges summing their signed counts, edges with a null count separate regions with the same winding
+  mCountedEdges.resize( mEdgeCounts.size() );
+  for(unsigned e=0; e<mEdgeCounts.size(); ++e)
+  {
+    int a = mEdges[e*2+0];
+    int b = mEdges[e*2+1];
+    mCountedEdges[e].mA = std::min(a, b);
+    mCountedEdges[e].mB = std::max(a, b);
+    mCountedEdges[e].mCount = a < b ? mEdgeCounts[e] : -mEdgeCounts[e];
+  }
+  std::sort( mCountedEdges.begin(), mCountedEdges.end() );
+  mEdges.clear();
+  mEdgeCounts.clear();
+  for(unsigned e=0; e<mCountedEdges.size(); )
+  {
+    int count = 0;
+    unsigned f = e;
+    for( ; f<mCountedEdges.size() && mCountedEdges[f].mA == mCountedEdges[e].mA && mCountedEdges[f].mB == mCountedEdges[e].mB; ++f)
+      count += mCountedEdges[f].mCount;
+    if (count != 0)
+    {
+      mEdges.push_back( mCountedEdges[e].mA );
+      mEdges.push_back( mCountedEdges[e].mB );
+      mEdgeCounts.push_back( count );
+    }
+    e = f;
+  }
+
+  // half-edge 2*e goes from mEdges[2*e] to mEdges[2*e+1], half-edge 2*e+1 is its twin
+  int vert_count = (int)mVerts.size();
+  int half_count = (int)mEdges.size();
+  mOutgoingOffsets.assign(vert_count + 1, 0);
+  for(int h=0; h<half_count; ++h)
+    ++mOutgoingOffsets[ mEdges[h] + 1 ];
+  for(int i=0; i<vert_count; ++i)
+    mOutgoingOffsets[i+1] += mOutgoingOffsets[i];
+  mOutgoing.resize(half_count);
+  mOutgoingSlot.resize(half_count);
+  mOutgoingFill.assign( mOutgoingOffsets.begin(), mOutgoingOffsets.end() - 1 );
+  for(int h=0; h<half_count; ++h)
+    mOutgoing[ mOutgoingFill[ mEdges[h] ]++ ] = h;
+
+  // sort the outgoing half-edges of each vertex counter-clockwise
+  mSortKeys.resize(half_count);
+  for(int h=0; h<half_count; ++h)
+  {
+    const Vertex& o = mVerts[ mEdges[h] ];
+    const Vertex& d = mVerts[ mEdges[h^1] ];
+    mSortKeys[h] = ::atan2( d.y - o.y, d.x - o.x );
+  }
+  for(int i=0; i<vert_count; ++i)
+  {
+    std::sort( mOutgoing.begin() + mOutgoingOffsets[i], mOutgoing.begin() + mOutgoingOffsets[i+1], SortByValue(mSortKeys) );
+    for(int s=mOutgoingOffsets[i]; s<mOutgoingOffsets[i+1]; ++s)
+      mOutgoingSlot[ mOutgoing[s] ] = s;
+  }
+
+  // the next half-edge around the face on the left is the first one clockwise from the twin
+  mHalfEdgeNext.resize(half_count);
+  for(int h=0; h<half_count; ++h)
+  {
+    int twin = h ^ 1;
+    int vert = mEdges[twin];
+    int slot = mOutgoingSlot[twin];
+    int next_slot = slot == mOutgoingOffsets[vert] ? mOutgoingOffsets[vert+1] - 1 : slot - 1;
+    mHalfEdgeNext[h] = mOutgoing[next_slot];
+  }
+
+  // trace the faces
+  mHalfEdgeFace.assign(half_count, -1);
+  mFaceFirst.clear();
+  mFaceArea.clear();
+  for(int h=0; h<half_count; ++h)
+  {
+    if (mHalfEdgeFace[h] != -1)
+      continue;
+    int face = (int)mFaceFirst.size();
+    double area = 0;
+    int c = h;
+    do
+    {
+      mHalfEdgeFace[c] = face;
+      const Vertex& o = mVerts[ mEdges[c] ];
+      const Vertex& d = mVerts[ mEdges[c^1] ];
+      area += o.x * d.y - d.x * o.y;
+      c = mHalfEdgeNext[c];
+    } while( c != h );
+    mFaceFirst.push_back(h);
+    mFaceArea.push_back(area * 0.5);
+  }
 }
 //-----------------------------------------------------------------------------
-ref<Geometry> Tessellator::tessellateGeometry(bool append_tessellated_tris)
+void Tessellator::classifyFaces()
 {
-  tessellate(append_tessellated_tris);
+  int vert_count = (int)mVerts.size();
+  int edge_count = (int)mEdgeCounts.size();
+  int face_count = (int)mFaceFirst.size();
 
-  if (mTessellatedTris.empty())
-    return NULL;
+  // connected components of the subdivision
+  mComponent.resize(vert_count);
+  for(int i=0; i<vert_count; ++i)
+    mComponent[i] = i;
+  for(int e=0; e<edge_count; ++e)
+  {
+    int a = mEdges[e*2+0], b = mEdges[e*2+1];
+    while(mComponent[a] != a) a = mComponent[a] = mComponent[mComponent[a]];
+    while(mComponent[b] != b) b = mComponent[b] = mComponent[mComponent[b]];
+    if (a != b)
+      mComponent[std::max(a,b)] = std::min(a,b);
+  }
+  for(int i=0; i<vert_count; ++i)
+    mComponent[i] = mComponent[mComponent[i]];
 
-  ref<Geometry> geom = new Geometry;
-  ref<ArrayFloat3> vert_array = new ArrayFloat3;
-  
-  vert_array->initFrom(mTessellatedTris);
+  // the outer face of each component is the one with the most negative area
+  mOuterFace.assign(vert_count, -1);
+  for(int f=0; f<face_count; ++f)
+  {
+    int k = mComponent[ mEdges[ mFaceFirst[f] ] ];
+    if (mOuterFace[k] == -1 || mFaceArea[f] < mFaceArea[ mOuterFace[k] ])
+      mOuterFace[k] = f;
+  }
 
-  geom->setVertexArray(vert_array.get());
-  geom->drawCalls().push_back( new vl::DrawArrays(PT_TRIANGLES, 0, vert_array->size()) );
-  geom->computeNormals();
-  return geom;
+  // leftmost vertex of each component
+  mLeftmost.assign(vert_count, -1);
+  for(int h=0; h<(int)mEdges.size(); ++h)
+  {
+    int vi = mEdges[h];
+    int& l = mLeftmost[ mComponent[vi] ];
+    if (l == -1 || mVerts[vi].x < mVerts[l].x || (mVerts[vi].x == mVerts[l].x && mVerts[vi].y < mVerts[l].y))
+      l = vi;
+  }
+
+  mFaceWinding.assign(face_count, 0);
+  mVisited.assign(face_count, 0);
+  for(int k=0; k<vert_count; ++k)
+  {
+    if (mOuterFace[k] == -1)
+      continue;
+
+    // the winding around the component is found casting a ray towards -x against the other components
+    double px = mVerts[ mLeftmost[k] ].x;
+    double py = mVerts[ mLeftmost[k] ].y;
+    int winding = 0;
+    for(int e=0; e<edge_count; ++e)
+    {
+      int a = mEdges[e*2+0], b = mEdges[e*2+1];
+      if (mComponent[a] == k)
+        continue;
+      double ay = mVerts[a].y, by = mVerts[b].y;
+      if ((ay <= py) == (by <= py))
+        continue;
+      double x = mVerts[a].x + (py - ay) * (mVerts[b].x - mVerts[a].x) / (by - ay);
+      if (x < px)
+        winding += by > ay ? -mEdgeCounts[e] : mEdgeCounts[e];
+    }
+
+    // propagate the winding across the edges: the region on the left of an edge has its count added
+    int f0 = mOuterFace[k];
+    mFaceWinding[f0] = winding;
+    mVisited[f0] = 1;
+    mQueue.clear();
+    mQueue.push_back(f0);
+    for(unsigned q=0; q<mQueue.size(); ++q)
+    {
+      int f = mQueue[q];
+      int h = mFaceFirst[f];
+      do
+      {
+        int g = mHalfEdgeFace[h^1];
+        if (!mVisited[g])
+        {
+          int count = h & 1 ? -mEdgeCounts[h>>1] : mEdgeCounts[h>>1];
+          mFaceWinding[g] = mFaceWinding[f] - count;
+          mVisited[g] = 1;
+          mQueue.push_back(g);
+        }
+        h = mHalfEdgeNext[h];
+      } while( h != mFaceFirst[f] );
+    }
+  }
+
+  // apply the winding rule
+  for(int f=0; f<face_count; ++f)
+  {
+    int w = mFaceWinding[f];
+    bool inside = false;
+    switch(windingRule())
+    {
+    case TW_TESS_WINDING_ODD:         inside = (w & 1) != 0; break;
+    case TW_TESS_WINDING_NONZERO:     inside = w != 0; break;
+    case TW_TESS_WINDING_POSITIVE:    inside = w > 0; break;
+    case TW_TESS_WINDING_NEGATIVE:    inside = w < 0; break;
+    case TW_TESS_WINDING_ABS_GEQ_TWO: inside = w >= 2 || w <= -2; break;
+    }
+    // from now on mFaceWinding only stores whether the face is inside
+    mFaceWinding[f] = inside ? 1 : 0;
+  }
+}
+//-----------------------------------------------------------------------------
+void Tessellator::extractBoundaries()
+{
+  mBoundaryLoops.clear();
+  int half_count = (int)mEdges.size();
+  mVisited.assign(half_count, 0);
+  for(int h=0; h<half_count; ++h)
+  {
+    if (mVisited[h] || !mFaceWinding[ mHalfEdgeFace[h] ] || mFaceWinding[ mHalfEdgeFace[h^1] ])
+      continue;
+    // the boundary half-edges have the interior on their left: outer loops are counter-clockwise, holes clockwise
+    mBoundaryLoops.push_back( std::vector<int>() );
+    std::vector<int>& loop = mBoundaryLoops.back();
+    int c = h;
+    do
+    {
+      mVisited[c] = 1;
+      loop.push_back( mEdges[c] );
+      // rotate clockwise around the destination vertex until the next boundary half-edge
+      c = mHalfEdgeNext[c];
+      while( mFaceWinding[ mHalfEdgeFace[c^1] ] )
+        c = mHalfEdgeNext[c^1];
+    } while( c != h );
+  }
+}
+//-----------------------------------------------------------------------------
+void Tessellator::triangulateBoundaries()
+{
+  int loop_count = (int)mBoundaryLoops.size();
+  mLoopAreas.resize(loop_count);
+  mLoopBounds.resize(loop_count);
+  mOuterLoops.clear();
+  mHoleLoops.clear();
+  for(int i=0; i<loop_count; ++i)
+  {
+    const std::vector<int>& loop = mBoundaryLoops[i];
+    double area = 0;
+    dvec4 bb( mVerts[loop[0]].x, mVerts[loop[0]].y, mVerts[loop[0]].x, mVerts[loop[0]].y );
+    for(unsigned j=0, k=loop.size()-1; j<loop.size(); k=j++)
+    {
+      const Vertex& a = mVerts[ loop[k] ];
+      const Vertex& b = mVerts[ loop[j] ];
+      area += a.x * b.y - b.x * a.y;
+      bb.x() = std::min(bb.x(), b.x);
+      bb.y() = std::min(bb.y(), b.y);
+      bb.z() = std::max(bb.z(), b.x);
+      bb.w() = std::max(bb.w(), b.y);
+    }
+    mLoopAreas[i] = area * 0.5;
+    mLoopBounds[i] = bb;
+    if (mLoopAreas[i] > 0)
+      mOuterLoops.push_back(i);
+    else
+    if (mLoopAreas[i] < 0)
+      mHoleLoops.push_back(i);
+  }
+  if (mOuterLoops.empty())
+    return;
+  std::sort( mOuterLoops.begin(), mOuterLoops.end(), SortByValue(mLoopAreas) );
+
+  // assign each hole to the smallest outer loop containing it
+  // the inner vectors are cleared rather than destroyed to keep their memory
+  if ((int)mOuterHoles.size() < loop_count)
+    mOuterHoles.resize(loop_count);
+  for(int i=0; i<loop_count; ++i)
+    mOuterHoles[i].clear();
+  mVertexStamp.assign(mVerts.size(), -1);
+  for(unsigned ih=0; ih<mHoleLoops.size(); ++ih)
+  {
+    const std::vector<int>& hole = mBoundaryLoops[ mHoleLoops[ih] ];
+    const dvec4& hb = mLoopBounds[ mHoleLoops[ih] ];
+    for(unsigned io=0; io<mOuterLoops.size(); ++io)
+    {
+      int oi = mOuterLoops[io];
+      const dvec4& ob = mLoopBounds[oi];
+      if (hb.x() < ob.x() || hb.y() < ob.y() || hb.z() > ob.z() || hb.w() > ob.w())
+        continue;
+      const std::vector<int>& outer = mBoundaryLoops[oi];
+      for(unsigned j=0; j<outer.size(); ++j)
+        mVertexStamp[ outer[j] ] = oi;
+      // test a vertex of the hole which is not shared with the outer loop, or the middle of its first edge
+      double px = (mVerts[hole[0]].x + mVerts[hole[1 % hole.size()]].x) * 0.5;
+      double py = (mVerts[hole[0]].y + mVerts[hole[1 % hole.size()]].y) * 0.5;
+      for(unsigned j=0; j<hole.size(); ++j)
+      {
+        if (mVertexStamp[ hole[j] ] != oi)
+        {
+          px = mVerts[ hole[j] ].x;
+          py = mVerts[ hole[j] ].y;
+          break;
+        }
+      }
+      bool inside = false;
+      for(unsigned j=0, k=outer.size()-1; j<outer.size(); k=j++)
+      {
+        const Vertex& a = mVerts[ outer[k] ];
+        const Vertex& b = mVerts[ outer[j] ];
+        if ( (a.y > py) != (b.y > py) && px < (b.x - a.x) * (py - a.y) / (b.y - a.y) + a.x )
+          inside = !inside;
+      }
+      if (inside)
+      {
+        mOuterHoles[oi].push_back( mHoleLoops[ih] );
+        break;
+      }
+    }
+  }
+
+  // ear clipping of each outer loop with its holes
+  for(unsigned io=0; io<mOuterLoops.size(); ++io)
+  {
+    int oi = mOuterLoops[io];
+    mNodes.clear();
+    int outer_node = linkedList(mBoundaryLoops[oi], true);
+    if (outer_node == -1 || mNodes[outer_node].mNext == mNodes[outer_node].mPrev)
+      continue;
+    if (!mOuterHoles[oi].empty())
+      outer_node = eliminateHoles(mOuterHoles[oi], outer_node);
+
+    // z-order hashing of the nodes speeds up the ear test of large polygons
+    mUseZOrder = false;
+    if (mNodes.size() > 80)
+    {
+      double max_x = mNodes[0].x, max_y = mNodes[0].y;
+      mMinX = max_x;
+      mMinY = max_y;
+      for(unsigned i=1; i<mNodes.size(); ++i)
+      {
+        mMinX = std::min(mMinX, mNodes[i].x);
+        mMinY = std::min(mMinY, mNodes[i].y);
+        max_x = std::max(max_x, mNodes[i].x);
+        max_y = std::max(max_y, mNodes[i].y);
+      }
+      mInvSize = std::max(max_x - mMinX, max_y - mMinY);
+      mInvSize = mInvSize != 0 ? 32767.0 / mInvSize : 0;
+      mUseZOrder = mInvSize != 0;
+    }
+
+    earcutLinked(outer_node, 0);
+  }
 }
 //-----------------------------------------------------------------------------
-// Tessellation callbacks
+// Ear clipping, after the algorithm used by Mapbox's earcut library.
 //-----------------------------------------------------------------------------
-void CALLBACK Tessellator::tessBeginData( GLenum type, Tessellator* tessellator )
+int Tessellator::insertNode(int vertex, int last)
 {
-  tessellator->mPrimitiveType = type;
-  if(type == GL_TRIANGLES)
+  Node node;
+  node.mVertex = vertex;
+  node.x = mVerts[vertex].x;
+  node.y = mVerts[vertex].y;
+  node.mPrevZ = node.mNextZ = -1;
+  node.mZ = 0;
+  node.mSteiner = false;
+  int p = (int)mNodes.size();
+  if (last == -1)
   {
-    // do nothing
+    node.mPrev = node.mNext = p;
+    mNodes.push_back(node);
   }
   else
-  if(type == GL_TRIANGLE_FAN)
-    tessellator->mFans.resize( tessellator->mFans.size() + 1 );
-  else
-  if(type == GL_TRIANGLE_STRIP)
-    tessellator->mTriStrips.resize( tessellator->mTriStrips.size() + 1 );
-  else
-  if(type == GL_LINE_LOOP)
-    tessellator->mLineLoops.resize( tessellator->mLineLoops.size() + 1 );
-  else
   {
-    Log::error("Tessellator::beginData() unknown primitive.\n");
+    node.mNext = mNodes[last].mNext;
+    node.mPrev = last;
+    mNodes.push_back(node);
+    mNodes[ mNodes[last].mNext ].mPrev = p;
+    mNodes[last].mNext = p;
   }
+  return p;
 }
 //-----------------------------------------------------------------------------
-void CALLBACK Tessellator::tessVertexData( dvec3* vec, Tessellator* tessellator )
+void Tessellator::removeNode(int p)
 {
-  if(tessellator->mPrimitiveType == GL_TRIANGLES)
-    tessellator->mTessellatedTris.push_back( (fvec3)(*vec) );
-  else
-  if(tessellator->mPrimitiveType == GL_TRIANGLE_FAN)
-    tessellator->mFans.back().push_back( (fvec3)(*vec) );
-  else
-  if(tessellator->mPrimitiveType == GL_TRIANGLE_STRIP)
-    tessellator->mTriStrips.back().push_back( (fvec3)(*vec) );
-  else
-  if(tessellator->mPrimitiveType == GL_LINE_LOOP)
-    tessellator->mLineLoops.back().push_back( (fvec3)(*vec) );
+  Node& n = mNodes[p];
+  mNodes[n.mNext].mPrev = n.mPrev;
+  mNodes[n.mPrev].mNext = n.mNext;
+  if (n.mPrevZ != -1)
+    mNodes[n.mPrevZ].mNextZ = n.mNextZ;
+  if (n.mNextZ != -1)
+    mNodes[n.mNextZ].mPrevZ = n.mPrevZ;
+}
+//-----------------------------------------------------------------------------
+int Tessellator::linkedList(const std::vector<int>& loop, bool ccw)
+{
+  double area = 0;
+  for(unsigned j=0, k=loop.size()-1; j<loop.size(); k=j++)
+    area += mVerts[loop[k]].x * mVerts[loop[j]].y - mVerts[loop[j]].x * mVerts[loop[k]].y;
+  int last = -1;
+  if (ccw == (area > 0))
+  {
+    for(unsigned i=0; i<loop.size(); ++i)
+      last = insertNode(loop[i], last);
+  }
   else
   {
-    Log::error("Tessellator::vertexData() unknown primitive.\n");
+    for(int i=(int)loop.size()-1; i>=0; --i)
+      last = insertNode(loop[i], last);
+  }
+  if (last != -1 && equals(last, mNodes[last].mNext))
+  {
+    int next = mNodes[last].mNext;
+    removeNode(last);
+    last = next;
+  }
+  return last;
+}
+//-----------------------------------------------------------------------------
+int Tessellator::filterPoints(int start, int end)
+{
+  if (start == -1)
+    return start;
+  if (end == -1)
+    end = start;
+  int p = start;
+  bool again;
+  do
+  {
+    again = false;
+    if (!mNodes[p].mSteiner && (equals(p, mNodes[p].mNext) || area(mNodes[p].mPrev, p, mNodes[p].mNext) == 0))
+    {
+      removeNode(p);
+      p = end = mNodes[p].mPrev;
+      if (p == mNodes[p].mNext)
+        break;
+      again = true;
+    }
+    else
+      p = mNodes[p].mNext;
+  } while(again || p != end);
+  return end;
+}
+//-----------------------------------------------------------------------------
+void Tessellator::earcutLinked(int ear, int pass)
+{
+  if (ear == -1)
+    return;
+  if (!pass && mUseZOrder)
+    indexCurve(ear);
+
+  int stop = ear;
+  while( mNodes[ear].mPrev != mNodes[ear].mNext )
+  {
+    int prev = mNodes[ear].mPrev;
+    int next = mNodes[ear].mNext;
+    if (mUseZOrder ? isEarHashed(ear) : isEar(ear))
+    {
+      mTessellatedTris.push_back( (fvec3)mVerts[ mNodes[prev].mVertex ].mPosition );
+      mTessellatedTris.push_back( (fvec3)mVerts[ mNodes[ear ].mVertex ].mPosition );
+      mTessellatedTris.push_back( (fvec3)mVerts[ mNodes[next].mVertex ].mPosition );
+      removeNode(ear);
+      // skipping the next vertex leads to less sliver triangles
+      ear = mNodes[next].mNext;
+      stop = ear;
+      continue;
+    }
+    ear = next;
+    // looped through the whole remaining polygon without finding an ear
+    if (ear == stop)
+    {
+      if (pass == 0)
+        // remove the collinear and duplicate points and try again
+        earcutLinked(filterPoints(ear, -1), 1);
+      else
+      if (pass == 1)
+      {
+        // cut the small local self-intersections and try again
+        ear = cureLocalIntersections(filterPoints(ear, -1));
+        earcutLinked(ear, 2);
+      }
+      else
+      if (pass == 2)
+        // split the polygon in two and triangulate them
+        splitEarcut(ear);
+      break;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::isEar(int ear) const
+{
+  const Node& a = mNodes[ mNodes[ear].mPrev ];
+  const Node& b = mNodes[ear];
+  const Node& c = mNodes[ mNodes[ear].mNext ];
+  if (area(b.mPrev, ear, b.mNext) >= 0)
+    return false; // reflex
+
+  double x0 = std::min(a.x, std::min(b.x, c.x)), y0 = std::min(a.y, std::min(b.y, c.y));
+  double x1 = std::max(a.x, std::max(b.x, c.x)), y1 = std::max(a.y, std::max(b.y, c.y));
+  // no other point lies inside the ear
+  for(int p = c.mNext; p != b.mPrev; p = mNodes[p].mNext)
+  {
+    const Node& n = mNodes[p];
+    if (n.x >= x0 && n.x <= x1 && n.y >= y0 && n.y <= y1 &&
+        pointInTriangle(a.x, a.y, b.x, b.y, c.x, c.y, n.x, n.y) && area(n.mPrev, p, n.mNext) >= 0)
+      return false;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::isEarHashed(int ear) const
+{
+  int ia = mNodes[ear].mPrev;
+  int ic = mNodes[ear].mNext;
+  const Node& a = mNodes[ia];
+  const Node& b = mNodes[ear];
+  const Node& c = mNodes[ic];
+  if (area(ia, ear, ic) >= 0)
+    return false; // reflex
+
+  double x0 = std::min(a.x, std::min(b.x, c.x)), y0 = std::min(a.y, std::min(b.y, c.y));
+  double x1 = std::max(a.x, std::max(b.x, c.x)), y1 = std::max(a.y, std::max(b.y, c.y));
+  int min_z = zOrder(x0, y0);
+  int max_z = zOrder(x1, y1);
+
+  // look for points inside the triangle in both directions of the z-order curve
+  int p = b.mPrevZ;
+  int n = b.mNextZ;
+  while( p != -1 && mNodes[p].mZ >= min_z && n != -1 && mNodes[n].mZ <= max_z )
+  {
+    const Node& np = mNodes[p];
+    if (np.x >= x0 && np.x <= x1 && np.y >= y0 && np.y <= y1 && p != ia && p != ic &&
+        pointInTriangle(a.x, a.y, b.x, b.y, c.x, c.y, np.x, np.y) && area(np.mPrev, p, np.mNext) >= 0)
+      return false;
+    p = np.mPrevZ;
+    const Node& nn = mNodes[n];
+    if (nn.x >= x0 && nn.x <= x1 && nn.y >= y0 && nn.y <= y1 && n != ia && n != ic &&
+        pointInTriangle(a.x, a.y, b.x, b.y, c.x, c.y, nn.x, nn.y) && area(nn.mPrev, n, nn.mNext) >= 0)
+      return false;
+    n = nn.mNextZ;
+  }
+  while( p != -1 && mNodes[p].mZ >= min_z )
+  {
+    const Node& np = mNodes[p];
+    if (np.x >= x0 && np.x <= x1 && np.y >= y0 && np.y <= y1 && p != ia && p != ic &&
+        pointInTriangle(a.x, a.y, b.x, b.y, c.x, c.y, np.x, np.y) && area(np.mPrev, p, np.mNext) >= 0)
+      return false;
+    p = np.mPrevZ;
+  }
+  while( n != -1 && mNodes[n].mZ <= max_z )
+  {
+    const Node& nn = mNodes[n];
+    if (nn.x >= x0 && nn.x <= x1 && nn.y >= y0 && nn.y <= y1 && n != ia && n != ic &&
+        pointInTriangle(a.x, a.y, b.x, b.y, c.x, c.y, nn.x, nn.y) && area(nn.mPrev, n, nn.mNext) >= 0)
+      return false;
+    n = nn.mNextZ;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+int Tessellator::cureLocalIntersections(int start)
+{
+  int p = start;
+  do
+  {
+    int a = mNodes[p].mPrev;
+    int b = mNodes[ mNodes[p].mNext ].mNext;
+    if (!equals(a, b) && intersects(a, p, mNodes[p].mNext, b) && locallyInside(a, b) && locallyInside(b, a))
+    {
+      mTessellatedTris.push_back( (fvec3)mVerts[ mNodes[a].mVertex ].mPosition );
+      mTessellatedTris.push_back( (fvec3)mVerts[ mNodes[p].mVertex ].mPosition );
+      mTessellatedTris.push_back( (fvec3)mVerts[ mNodes[b].mVertex ].mPosition );
+      int next = mNodes[p].mNext;
+      removeNode(p);
+      removeNode(next);
+      p = start = b;
+    }
+    p = mNodes[p].mNext;
+  } while( p != start );
+  return filterPoints(p, -1);
+}
+//-----------------------------------------------------------------------------
+void Tessellator::splitEarcut(int start)
+{
+  // look for a valid diagonal that divides the polygon into two
+  int a = start;
+  do
+  {
+    int b = mNodes[ mNodes[a].mNext ].mNext;
+    while( b != mNodes[a].mPrev )
+    {
+      if (mNodes[a].mVertex != mNodes[b].mVertex && isValidDiagonal(a, b))
+      {
+        int c = splitPolygon(a, b);
+        a = filterPoints(a, mNodes[a].mNext);
+        c = filterPoints(c, mNodes[c].mNext);
+        earcutLinked(a, 0);
+        earcutLinked(c, 0);
+        return;
+      }
+      b = mNodes[b].mNext;
+    }
+    a = mNodes[a].mNext;
+  } while( a != start );
+}
+//-----------------------------------------------------------------------------
+int Tessellator::eliminateHoles(const std::vector<int>& holes, int outer)
+{
+  mHoleLefts.clear();
+  mHoleX.clear();
+  for(unsigned i=0; i<holes.size(); ++i)
+  {
+    int list = linkedList(mBoundaryLoops[ holes[i] ], false);
+    if (list == -1)
+      continue;
+    if (list == mNodes[list].mNext)
+      mNodes[list].mSteiner = true;
+    int left = getLeftmost(list);
+    mHoleLefts.push_back( left );
+    mHoleX.push_back( mNodes[left].x );
   }
+  // process the holes from left to right
+  mHoleOrder.resize( mHoleLefts.size() );
+  for(unsigned i=0; i<mHoleOrder.size(); ++i)
+    mHoleOrder[i] = i;
+  std::sort( mHoleOrder.begin(), mHoleOrder.end(), SortByValue(mHoleX) );
+  for(unsigned i=0; i<mHoleOrder.size(); ++i)
+    outer = eliminateHole( mHoleLefts[ mHoleOrder[i] ], outer );
+  return outer;
+}
+//-----------------------------------------------------------------------------
+int Tessellator::eliminateHole(int hole, int outer)
+{
+  int bridge = findHoleBridge(hole, outer);
+  if (bridge == -1)
+    return outer;
+  // connect the hole to the outer loop with a pair of coincident edges
+  int bridge_reverse = splitPolygon(bridge, hole);
+  filterPoints(bridge_reverse, mNodes[bridge_reverse].mNext);
+  return filterPoints(bridge, mNodes[bridge].mNext);
 }
 //-----------------------------------------------------------------------------
-void CALLBACK Tessellator::tessCombineData( GLdouble coords[3], dvec3*[4], GLfloat[4], dvec3 **dataOut, Tessellator* tessellator )
+int Tessellator::findHoleBridge(int hole, int outer) const
 {
-  dvec3 *vec = new dvec3;
-  vec->x() = coords[0];
-  vec->y() = coords[1];
-  vec->z() = coords[2];
-  *dataOut = vec;
-  tessellator->mCombinedVertices.push_back( vec );
+  // find the segment of the outer loop closest to the hole's leftmost point along a ray towards -x
+  int p = outer;
+  double hx = mNodes[hole].x;
+  double hy = mNodes[hole].y;
+  double qx = -std::numeric_limits<double>::max();
+  int m = -1;
+  do
+  {
+    const Node& np = mNodes[p];
+    const Node& nn = mNodes[np.mNext];
+    if (hy <= np.y && hy >= nn.y && nn.y != np.y)
+    {
+      double x = np.x + (hy - np.y) * (nn.x - np.x) / (nn.y - np.y);
+      if (x <= hx && x > qx)
+      {
+        qx = x;
+        m = np.x < nn.x ? p : np.mNext;
+        if (x == hx)
+          return m; // the hole touches the outer segment: pick its leftmost endpoint
+      }
+    }
+    p = np.mNext;
+  } while( p != outer );
+  if (m == -1)
+    return -1;
+
+  // look for the point of the outer loop inside the triangle (hole point, segment intersection, segment endpoint)
+  // with the minimum angle with the ray, which is the one to connect to
+  int stop = m;
+  double mx = mNodes[m].x;
+  double my = mNodes[m].y;
+  double tan_min = std::numeric_limits<double>::max();
+  p = m;
+  do
+  {
+    const Node& np = mNodes[p];
+    if (hx >= np.x && np.x >= mx && hx != np.x &&
+        pointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, np.x, np.y))
+    {
+      double tan = ::fabs(hy - np.y) / (hx - np.x);
+      if (locallyInside(p, hole) &&
+          (tan < tan_min || (tan == tan_min && (np.x > mNodes[m].x || (np.x == mNodes[m].x && sectorContainsSector(m, p))))))
+      {
+        m = p;
+        tan_min = tan;
+      }
+    }
+    p = np.mNext;
+  } while( p != stop );
+  return m;
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::sectorContainsSector(int m, int p) const
+{
+  return area(mNodes[m].mPrev, m, mNodes[p].mPrev) < 0 && area(mNodes[p].mNext, m, mNodes[m].mNext) < 0;
+}
+//-----------------------------------------------------------------------------
+void Tessellator::indexCurve(int start)
+{
+  mSortOrder.clear();
+  int p = start;
+  do
+  {
+    if (mNodes[p].mZ == 0)
+      mNodes[p].mZ = zOrder(mNodes[p].x, mNodes[p].y);
+    mSortOrder.push_back(p);
+    p = mNodes[p].mNext;
+  } while( p != start );
+
+  // link the nodes sorted by z-order
+  mSortKeys.resize( mNodes.size() );
+  for(unsigned i=0; i<mSortOrder.size(); ++i)
+    mSortKeys[ mSortOrder[i] ] = mNodes[ mSortOrder[i] ].mZ;
+  std::stable_sort( mSortOrder.begin(), mSortOrder.end(), SortByValue(mSortKeys) );
+  for(unsigned i=0; i<mSortOrder.size(); ++i)
+  {
+    mNodes[ mSortOrder[i] ].mPrevZ = i > 0 ? mSortOrder[i-1] : -1;
+    mNodes[ mSortOrder[i] ].mNextZ = i+1 < mSortOrder.size() ? mSortOrder[i+1] : -1;
+  }
+}
+//-----------------------------------------------------------------------------
+int Tessellator::getLeftmost(int start) const
+{
+  int p = start;
+  int leftmost = start;
+  do
+  {
+    if (mNodes[p].x < mNodes[leftmost].x || (mNodes[p].x == mNodes[leftmost].x && mNodes[p].y < mNodes[leftmost].y))
+      leftmost = p;
+    p = mNodes[p].mNext;
+  } while( p != start );
+  return leftmost;
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::isValidDiagonal(int a, int b) const
+{
+  const Node& na = mNodes[a];
+  const Node& nb = mNodes[b];
+  return mNodes[na.mNext].mVertex != nb.mVertex && mNodes[na.mPrev].mVertex != nb.mVertex && !intersectsPolygon(a, b) &&
+         ( ( locallyInside(a, b) && locallyInside(b, a) && middleInside(a, b) &&
+             ( area(na.mPrev, a, nb.mPrev) != 0 || area(a, nb.mPrev, b) != 0 ) ) || // does not create opposite-facing sectors
+           ( equals(a, b) && area(na.mPrev, a, na.mNext) > 0 && area(nb.mPrev, b, nb.mNext) > 0 ) ); // zero-length case
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::intersects(int p1, int q1, int p2, int q2) const
+{
+  int o1 = sign( area(p1, q1, p2) );
+  int o2 = sign( area(p1, q1, q2) );
+  int o3 = sign( area(p2, q2, p1) );
+  int o4 = sign( area(p2, q2, q1) );
+  if (o1 != o2 && o3 != o4)
+    return true;
+  if (o1 == 0 && onSegment(p1, p2, q1)) return true; // p1, q1 and p2 are collinear and p2 lies on p1-q1
+  if (o2 == 0 && onSegment(p1, q2, q1)) return true; // p1, q1 and q2 are collinear and q2 lies on p1-q1
+  if (o3 == 0 && onSegment(p2, p1, q2)) return true; // p2, q2 and p1 are collinear and p1 lies on p2-q2
+  if (o4 == 0 && onSegment(p2, q1, q2)) return true; // p2, q2 and q1 are collinear and q1 lies on p2-q2
+  return false;
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::onSegment(int p, int q, int r) const
+{
+  const Node& np = mNodes[p];
+  const Node& nq = mNodes[q];
+  const Node& nr = mNodes[r];
+  return nq.x <= std::max(np.x, nr.x) && nq.x >= std::min(np.x, nr.x) && nq.y <= std::max(np.y, nr.y) && nq.y >= std::min(np.y, nr.y);
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::intersectsPolygon(int a, int b) const
+{
+  int va = mNodes[a].mVertex;
+  int vb = mNodes[b].mVertex;
+  int p = a;
+  do
+  {
+    int next = mNodes[p].mNext;
+    int vp = mNodes[p].mVertex;
+    int vn = mNodes[next].mVertex;
+    if (vp != va && vn != va && vp != vb && vn != vb && intersects(p, next, a, b))
+      return true;
+    p = next;
+  } while( p != a );
+  return false;
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::locallyInside(int a, int b) const
+{
+  const Node& na = mNodes[a];
+  return area(na.mPrev, a, na.mNext) < 0 ?
+         area(a, b, na.mNext) >= 0 && area(a, na.mPrev, b) >= 0 :
+         area(a, b, na.mPrev) < 0 || area(a, na.mNext, b) < 0;
+}
+//-----------------------------------------------------------------------------
+bool Tessellator::middleInside(int a, int b) const
+{
+  int p = a;
+  bool inside = false;
+  double px = (mNodes[a].x + mNodes[b].x) / 2;
+  double py = (mNodes[a].y + mNodes[b].y) / 2;
+  do
+  {
+    const Node& np = mNodes[p];
+    const Node& nn = mNodes[np.mNext];
+    if ( (np.y > py) != (nn.y > py) && nn.y != np.y && (px < (nn.x - np.x) * (py - np.y) / (nn.y - np.y) + np.x) )
+      inside = !inside;
+    p = np.mNext;
+  } while( p != a );
+  return inside;
+}
+//-----------------------------------------------------------------------------
+int Tessellator::splitPolygon(int a, int b)
+{
+  // a2 and b2 are copies of a and b linked so that a-b and b2-a2 close the two resulting polygons
+  Node na = mNodes[a];
+  Node nb = mNodes[b];
+  na.mPrevZ = na.mNextZ = nb.mPrevZ = nb.mNextZ = -1;
+  na.mZ = nb.mZ = 0;
+  na.mSteiner = nb.mSteiner = false;
+  int a2 = (int)mNodes.size();
+  mNodes.push_back(na);
+  int b2 = (int)mNodes.size();
+  mNodes.push_back(nb);
+  int an = mNodes[a].mNext;
+  int bp = mNodes[b].mPrev;
+
+  mNodes[a].mNext = b;
+  mNodes[b].mPrev = a;
+
+  mNodes[a2].mNext = an;
+  mNodes[an].mPrev = a2;
+
+  mNodes[b2].mNext = a2;
+  mNodes[a2].mPrev = b2;
+
+  mNodes[bp].mNext = b2;
+  mNodes[b2].mPrev = bp;
+
+  return b2;
+}
+//-----------------------------------------------------------------------------
+int Tessellator::zOrder(double x, double y) const
+{
+  // interleave the bits of the coordinates mapped to 15 bits
+  unsigned int ix = (unsigned int)( (x - mMinX) * mInvSize );
+  unsigned int iy = (unsigned int)( (y - mMinY) * mInvSize );
+
+  ix = (ix | (ix << 8)) & 0x00FF00FF;
+  ix = (ix | (ix << 4)) & 0x0F0F0F0F;
+  ix = (ix | (ix << 2)) & 0x33333333;
+  ix = (ix | (ix << 1)) & 0x55555555;
+
+  iy = (iy | (iy << 8)) & 0x00FF00FF;
+  iy = (iy | (iy << 4)) & 0x0F0F0F0F;
+  iy = (iy | (iy << 2)) & 0x33333333;
+  iy = (iy | (iy << 1)) & 0x55555555;
+
+  return (int)(ix | (iy << 1));
 }
 //-----------------------------------------------------------------------------
-void CALLBACK Tessellator::tessEnd(void)
+double Tessellator::area(int p, int q, int r) const
 {
+  const Node& np = mNodes[p];
+  const Node& nq = mNodes[q];
+  const Node& nr = mNodes[r];
+  return (nq.y - np.y) * (nr.x - nq.x) - (nq.x - np.x) * (nr.y - nq.y);
 }
 //-----------------------------------------------------------------------------
-void CALLBACK Tessellator::tessError( GLenum errno )
+bool Tessellator::equals(int p, int q) const
 {
-  const GLubyte* estring = gluErrorString(errno);
-  Log::error( Say("Tessellator error: %s.\n") << estring );
+  return mNodes[p].x == mNodes[q].x && mNodes[p].y == mNodes[q].y;
 }
 //-----------------------------------------------------------------------------
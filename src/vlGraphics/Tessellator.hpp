@@ -32,26 +32,27 @@
 #ifndef Tessellator_INCLUDE_ONCE
 #define Tessellator_INCLUDE_ONCE
 
-#include <vlGraphics/OpenGL.hpp>
 #include <vlGraphics/Geometry.hpp>
 #include <vlCore/Vector3.hpp>
 #include <vector>
 
-#ifndef CALLBACK
-#define CALLBACK
-#endif
-
 namespace vl
 {
   /**
    * Tessellates a complex polygon defined by a set of outlines into a set of triangles that can be rendered by Visualization Library.
-   * For more information see the OpenGL Programmer's Guide chapter #11 "Tessellators and Quadrics".
+   *
+   * The polygon can be concave, self-intersecting and can contain holes; the interior is defined by the windingRule() like in the 
+   * GLU tessellator (see the OpenGL Programmer's Guide chapter #11 "Tessellators and Quadrics"), whose options are supported as well.
+   *
+   * The tessellation is computed natively: the contours are projected on their plane, split at their intersections, the 
+   * regions of the resulting planar subdivision are classified using their winding number and the boundary of the interior 
+   * is triangulated by ear clipping. All the intermediate data is kept in buffers owned by the Tessellator which are reused by
+   * the following calls, and no global state is used, so different Tessellator objects can safely be used from different threads.
    */
   class VLGRAPHICS_EXPORT Tessellator: public Object
   {
     VL_INSTRUMENT_CLASS(vl::Tessellator, Object)
 
-    typedef void (CALLBACK *callback_type)(void);
   public:
 
     //! Constructor.
@@ -78,28 +79,36 @@ namespace vl
     //! A set of triangles representing the tessellated polygon.
     std::vector<fvec3>& tessellatedTris() { return mTessellatedTris; }
 
-    //! See gluTessNormal documentation.
+    //! The closed outlines separating the interior from the exterior of the polygon, generated when boundaryOnly() is \p true.
+    //! Outer outlines are counter-clockwise and holes are clockwise with respect to the tessellation normal.
+    const std::vector< std::vector<fvec3> >& lineLoops() const { return mLineLoops; }
+
+    //! The closed outlines separating the interior from the exterior of the polygon, generated when boundaryOnly() is \p true.
+    std::vector< std::vector<fvec3> >& lineLoops() { return mLineLoops; }
+
+    //! The normal of the plane of the polygon, the generated triangles are counter-clockwise with respect to it.
+    //! If null (default) the normal is computed from the contours so that their area is positive. See also gluTessNormal().
     void setTessNormal(const fvec3& normal) { mTessNormal = normal; }
     
-    //! See gluTessNormal documentation.
+    //! See setTessNormal().
     const fvec3& tessNormal() const { return mTessNormal; }
 
-    //! See gluTessProperty documentation (GLU_TESS_BOUNDARY_ONLY)
+    //! If \p true lineLoops() are generated instead of tessellatedTris(), see GLU_TESS_BOUNDARY_ONLY.
     void setBoundaryOnly(bool on) { mBoundaryOnly = on; }
     
-    //! See gluTessProperty documentation (GLU_TESS_BOUNDARY_ONLY)
+    //! If \p true lineLoops() are generated instead of tessellatedTris(), see GLU_TESS_BOUNDARY_ONLY.
     bool boundaryOnly() const { return mBoundaryOnly; }
 
-    //! See gluTessProperty documentation (GLU_TESS_TOLERANCE)
+    //! Vertices closer than this distance are merged, see GLU_TESS_TOLERANCE.
     double tolerance() const { return mTolerance; }
     
-    //! See gluTessProperty documentation (GLU_TESS_TOLERANCE)
+    //! Vertices closer than this distance are merged, see GLU_TESS_TOLERANCE.
     void setTolerance(double tolerance) { mTolerance = tolerance; }
 
-    //! See gluTessProperty documentation (GLU_TESS_WINDING_RULE)
+    //! The rule used to determine which regions are inside the polygon, see GLU_TESS_WINDING_RULE.
     ETessellationWinding windingRule() const { return mWindingRule; }
     
-    //! See gluTessProperty documentation (GLU_TESS_WINDING_RULE)
+    //! The rule used to determine which regions are inside the polygon, see GLU_TESS_WINDING_RULE.
     void setWindingRule(ETessellationWinding rule) { mWindingRule = rule; }
 
     /* 
@@ -120,12 +129,86 @@ namespace vl
     bool tessellateIntoSinglePolygon() const { return mTessellateIntoSinglePolygon; }
     
   protected:
-    static void CALLBACK tessBeginData( GLenum type, Tessellator* tessellator );
-    static void CALLBACK tessVertexData( dvec3* vec, Tessellator* tessellator );
-    static void CALLBACK tessCombineData( GLdouble coords[3], dvec3 *d[4], GLfloat w[4], dvec3 **dataOut, Tessellator* tessellator );
-    static void CALLBACK tessEnd(void);
-    static void CALLBACK tessError( GLenum errno );
-    void freeCombinedVertices();
+    //! A vertex of the planar subdivision.
+    struct Vertex
+    {
+      double x, y;
+      dvec3 mPosition;
+    };
+
+    //! A point splitting an edge at parameter mT, see splitIntersections().
+    struct EdgeSplit
+    {
+      int mEdge;
+      double mT;
+      int mVertex;
+
+      bool operator<(const EdgeSplit& other) const
+      {
+        if (mEdge != other.mEdge)
+          return mEdge < other.mEdge;
+        return mT < other.mT;
+      }
+    };
+
+    //! An edge with its signed winding count, see buildSubdivision().
+    struct CountedEdge
+    {
+      int mA, mB, mCount;
+
+      bool operator<(const CountedEdge& other) const
+      {
+        if (mA != other.mA)
+          return mA < other.mA;
+        return mB < other.mB;
+      }
+    };
+
+    //! A node of the circular lists used by the ear clipping.
+    struct Node
+    {
+      int mVertex;
+      double x, y;
+      int mPrev, mNext;
+      int mPrevZ, mNextZ;
+      int mZ;
+      bool mSteiner;
+    };
+
+    void tessellatePolygon(int first_vert, int contour_begin, int contour_end, const dvec3& tess_normal);
+    void mergeVertices(double eps);
+    bool splitIntersections(double eps);
+    void buildSubdivision();
+    void classifyFaces();
+    void extractBoundaries();
+    void triangulateBoundaries();
+
+    // ear clipping
+    int insertNode(int vertex, int last);
+    void removeNode(int n);
+    int linkedList(const std::vector<int>& loop, bool ccw);
+    int filterPoints(int start, int end);
+    void earcutLinked(int ear, int pass);
+    bool isEar(int ear) const;
+    bool isEarHashed(int ear) const;
+    int cureLocalIntersections(int start);
+    void splitEarcut(int start);
+    int eliminateHoles(const std::vector<int>& holes, int outer);
+    int eliminateHole(int hole, int outer);
+    int findHoleBridge(int hole, int outer) const;
+    bool sectorContainsSector(int m, int p) const;
+    void indexCurve(int start);
+    int getLeftmost(int start) const;
+    bool isValidDiagonal(int a, int b) const;
+    bool intersects(int p1, int q1, int p2, int q2) const;
+    bool onSegment(int p, int q, int r) const;
+    bool intersectsPolygon(int a, int b) const;
+    bool locallyInside(int a, int b) const;
+    bool middleInside(int a, int b) const;
+    int splitPolygon(int a, int b);
+    int zOrder(double x, double y) const;
+    double area(int p, int q, int r) const;
+    bool equals(int p, int q) const;
 
   protected:
     // input
@@ -133,12 +216,45 @@ namespace vl
     std::vector<dvec3> mContourVerts;
     // output
     std::vector<fvec3> mTessellatedTris;
-    // intermediate data
-    std::vector< std::vector<fvec3> > mFans;
-    std::vector< std::vector<fvec3> > mTriStrips;
     std::vector< std::vector<fvec3> > mLineLoops;
-    std::vector< dvec3* > mCombinedVertices;
-    GLenum mPrimitiveType;
+    // intermediate data, kept to reuse the memory
+    std::vector<Vertex> mVerts;
+    std::vector<int> mVertexMap;
+    std::vector<int> mEdges;
+    std::vector<int> mEdgeCounts;
+    std::vector<int> mHalfEdgeNext;
+    std::vector<int> mHalfEdgeFace;
+    std::vector<int> mOutgoingOffsets;
+    std::vector<int> mOutgoing;
+    std::vector<int> mOutgoingSlot;
+    std::vector<int> mFaceFirst;
+    std::vector<double> mFaceArea;
+    std::vector<int> mFaceWinding;
+    std::vector< std::vector<int> > mBoundaryLoops;
+    std::vector<Node> mNodes;
+    // scratch buffers of the single steps, kept to reuse the memory
+    std::vector<double> mSortKeys;
+    std::vector<int> mSortOrder;
+    std::vector<Vertex> mMergedVerts;
+    std::vector<EdgeSplit> mSplits;
+    std::vector<CountedEdge> mCountedEdges;
+    std::vector<int> mOutgoingFill;
+    std::vector<int> mComponent;
+    std::vector<int> mOuterFace;
+    std::vector<int> mLeftmost;
+    std::vector<char> mVisited;
+    std::vector<int> mQueue;
+    std::vector<double> mLoopAreas;
+    std::vector<dvec4> mLoopBounds;
+    std::vector<int> mOuterLoops;
+    std::vector<int> mHoleLoops;
+    std::vector< std::vector<int> > mOuterHoles;
+    std::vector<int> mVertexStamp;
+    std::vector<int> mHoleLefts;
+    std::vector<double> mHoleX;
+    std::vector<int> mHoleOrder;
+    double mMinX, mMinY, mInvSize;
+    bool mUseZOrder;
     // see gluTessNorml()
     fvec3 mTessNormal;
     // see GLU_TESS_BOUNDARY_ONLY
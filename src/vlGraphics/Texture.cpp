@@ -382,6 +382,7 @@ void Texture::reset()
   mBufferObject = NULL;
   mSamples = 0;
   mFixedSamplesLocation = true;
+  mCreationPending = false;
 }
 //-----------------------------------------------------------------------------
 Texture::Texture(int width, ETextureFormat format, bool border)
@@ -741,7 +742,10 @@ bool Texture::createTexture(ETextureDimension tex_dimension, ETextureFormat tex_
       return false;
     }
 
+    // the SetupParams are kept, see SetupParams
+    ref<SetupParams> setup_params = mSetupParams;
     reset();
+    mSetupParams = setup_params;
 
     glGenTextures( 1, &mHandle ); VL_CHECK_OGL();
 
@@ -1089,6 +1093,9 @@ bool Texture::createTexture()
   if (!setupParams())
     return false;
 
+  // a failed creation is not retried by the Rendering
+  mCreationPending = false;
+
   class InOutCondition
   {
     Texture* mTex;
@@ -1201,6 +1208,7 @@ void Texture::clone(const Texture& other)
   mSamples       = other.mSamples;
   mBorder        = other.mBorder;
   mFixedSamplesLocation = other.mFixedSamplesLocation;
+  mCreationPending = other.mCreationPending;
 }
 //-----------------------------------------------------------------------------
 bool Texture::isDepthTexture() const
@@ -1257,6 +1265,9 @@ bool Texture::isCompressedFormat(int format)
     TF_COMPRESSED_RED_GREEN_RGTC2_EXT,
     TF_COMPRESSED_SIGNED_RED_GREEN_RGTC2_EXT,
 
+    // ARB_texture_compression_bptc
+    TF_COMPRESSED_RGBA_BPTC_UNORM,
+
     0
   };
 
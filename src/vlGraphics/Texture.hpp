@@ -309,6 +309,7 @@ namespace vl
     void prepareTexture1D(const Image* image, ETextureFormat format, bool mipmaps=true, bool border=false)
     {
       mSetupParams = new SetupParams;
+      mCreationPending = true;
       mSetupParams->setImage(image);
       mSetupParams->setDimension(TD_TEXTURE_1D);
       mSetupParams->setFormat(format);
@@ -356,6 +357,7 @@ namespace vl
     void prepareTexture2D(const Image* image, ETextureFormat format, bool mipmaps=true, bool border=false)
     {
       mSetupParams = new SetupParams;
+      mCreationPending = true;
       mSetupParams->setImage(image);
       mSetupParams->setDimension(TD_TEXTURE_2D);
       mSetupParams->setFormat(format);
@@ -404,6 +406,7 @@ namespace vl
     void prepareTexture3D(const Image* image, ETextureFormat format, bool mipmaps=true, bool border=false)
     {
       mSetupParams = new SetupParams;
+      mCreationPending = true;
       mSetupParams->setImage(image);
       mSetupParams->setDimension(TD_TEXTURE_3D);
       mSetupParams->setFormat(format);
@@ -451,6 +454,7 @@ namespace vl
     void prepareTextureCubemap(const Image* image, ETextureFormat format, bool mipmaps=true, bool border=false)
     {
       mSetupParams = new SetupParams;
+      mCreationPending = true;
       mSetupParams->setImage(image);
       mSetupParams->setDimension(TD_TEXTURE_CUBE_MAP);
       mSetupParams->setFormat(format);
@@ -498,6 +502,7 @@ namespace vl
     void prepareTexture1DArray(const Image* image, ETextureFormat format, bool mipmaps=true)
     {
       mSetupParams = new SetupParams;
+      mCreationPending = true;
       mSetupParams->setImage(image);
       mSetupParams->setDimension(TD_TEXTURE_1D_ARRAY);
       mSetupParams->setFormat(format);
@@ -546,6 +551,7 @@ namespace vl
     void prepareTexture2DArray(const Image* image, ETextureFormat format, bool mipmaps=true)
     {
       mSetupParams = new SetupParams;
+      mCreationPending = true;
       mSetupParams->setImage(image);
       mSetupParams->setDimension(TD_TEXTURE_2D_ARRAY);
       mSetupParams->setFormat(format);
@@ -593,6 +599,7 @@ namespace vl
     void prepareTextureRectangle(const Image* image, ETextureFormat format)
     {
       mSetupParams = new SetupParams;
+      mCreationPending = true;
       mSetupParams->setImage(image);
       mSetupParams->setDimension(TD_TEXTURE_RECTANGLE);
       mSetupParams->setFormat(format);
@@ -611,6 +618,7 @@ namespace vl
     void prepareTextureBuffer(vl::ETextureFormat format, BufferObject* bo)
     {
       mSetupParams = new SetupParams;
+      mCreationPending = true;
       mSetupParams->setDimension(TD_TEXTURE_BUFFER);
       mSetupParams->setFormat(format);
       mSetupParams->setBufferObject(bo);
@@ -629,6 +637,7 @@ namespace vl
     void prepareTexture2DMultisample(int width, int height, vl::ETextureFormat format, int samples, bool fixedsamplelocations)
     {
       mSetupParams = new SetupParams;
+      mCreationPending = true;
       mSetupParams->setDimension(TD_TEXTURE_2D_MULTISAMPLE);
       mSetupParams->setWidth(width);
       mSetupParams->setHeight(height);
@@ -650,6 +659,7 @@ namespace vl
     void prepareTexture2DMultisampleArray(int width, int height, int depth, vl::ETextureFormat format, int samples, bool fixedsamplelocations)
     {
       mSetupParams = new SetupParams;
+      mCreationPending = true;
       mSetupParams->setDimension(TD_TEXTURE_2D_MULTISAMPLE_ARRAY);
       mSetupParams->setWidth(width);
       mSetupParams->setHeight(height);
@@ -713,8 +723,8 @@ namespace vl
     /** Whether the samples location is fixed for a a multisample texture. */
     bool fixedSamplesLocation() const { return mFixedSamplesLocation; }
 
-    /** See SetupParams */
-    void setSetupParams(SetupParams* setup_params) { mSetupParams = setup_params; }
+    /** See SetupParams. Also marks the texture for creation if \p setup_params is not NULL, see creationPending(). */
+    void setSetupParams(SetupParams* setup_params) { mSetupParams = setup_params; mCreationPending = setup_params != NULL; }
 
     /** See SetupParams */
     const SetupParams* setupParams() const { return mSetupParams.get(); }
@@ -722,6 +732,15 @@ namespace vl
     /** See SetupParams */
     SetupParams* setupParams() { return mSetupParams.get(); }
 
+    /** Whether the texture must be created from its setupParams() before being used: set by the \p prepareTexture*()
+    functions and by setSetupParams(), cleared by createTexture() and destroyTexture().
+    The Rendering creates the textures with a creation pending when it finds them in the Shader of an Actor,
+    destroying first the ones that already exist. */
+    void setCreationPending(bool pending) { mCreationPending = pending; }
+
+    /** Whether the texture must be created from its setupParams() before being used, see setCreationPending(). */
+    bool creationPending() const { return mCreationPending; }
+
     /** Returns \p true if the current texture configuration seems valid. */
     bool isValid() const;
 
@@ -757,6 +776,7 @@ namespace vl
     int mSamples;
     bool mBorder;
     bool mFixedSamplesLocation;
+    bool mCreationPending;
   };
 }
 
@@ -0,0 +1,455 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/TextureStreamer.hpp>
+#include <vlGraphics/OpenGL.hpp>
+#include <vlCore/FileSystem.hpp>
+#include <vlCore/DiskDirectory.hpp>
+#include <vlCore/ScopedMutex.hpp>
+#include <vlCore/Time.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+#include <climits>
+
+using namespace vl;
+
+namespace
+{
+  //! Installed as Log::logMutex() if the user did not install one.
+  Mutex gLogMutex;
+
+  inline bool hasBaseLevel()
+  {
+    return Has_GL_Version_1_2 || Has_GL_Version_3_0 || Has_GL_Version_4_0;
+  }
+}
+//-----------------------------------------------------------------------------
+// TextureStreamer::Request
+//-----------------------------------------------------------------------------
+class TextureStreamer::Request: public Object
+{
+public:
+  Request(): mFormat(TF_UNKNOWN), mLevel(-1), mRow(0), mHandle(0), mMipmaps(true), mGenerateMipmaps(false) {}
+
+  //! Does not share its data with the caller's strings: String is copy-on-write and its reference count is not atomic.
+  String mPath;
+  ref<Texture> mTexture;
+  ETextureFormat mFormat;
+  //! The decoded levels from the largest to the smallest, empty if the image could not be loaded.
+  std::vector< ref<Image> > mLevels;
+  //! The level being uploaded, -1 when the upload is complete.
+  int mLevel;
+  //! The first row of mLevel not yet uploaded.
+  int mRow;
+  //! The texture name, handed to mTexture as soon as a level is complete.
+  unsigned int mHandle;
+  bool mMipmaps;
+  //! No mipmaps were decoded or computed: generate them after uploading the base level.
+  bool mGenerateMipmaps;
+};
+//-----------------------------------------------------------------------------
+// TextureStreamer::Worker
+//-----------------------------------------------------------------------------
+class TextureStreamer::Worker: public Thread
+{
+public:
+  Worker(TextureStreamer* streamer): mActive(false), mStreamer(streamer) {}
+  virtual void run() { mStreamer->work(this); }
+
+  //! Guarded by TextureStreamer::mMutex.
+  bool mActive;
+
+private:
+  TextureStreamer* mStreamer;
+};
+//-----------------------------------------------------------------------------
+// TextureStreamer
+//-----------------------------------------------------------------------------
+TextureStreamer::TextureStreamer(int thread_count): mDecoding(0), mUploadBudget(4*1024*1024), mUsePixelBufferObject(true)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  if (thread_count <= 0)
+    thread_count = parallelThreadCount();
+  for(int i=0; i<thread_count; ++i)
+    mWorkers.push_back( new Worker(this) );
+  mPBO = new BufferObject;
+}
+//-----------------------------------------------------------------------------
+TextureStreamer::~TextureStreamer()
+{
+  {
+    ScopedMutex lock(&mMutex);
+    mDecodeQueue.clear();
+  }
+  for(size_t i=0; i<mWorkers.size(); ++i)
+    mWorkers[i]->join();
+
+  // the textures being uploaded get their name back and delete it on destruction
+  mUploading.insert( mUploading.end(), mDecoded.begin(), mDecoded.end() );
+  for(size_t i=0; i<mUploading.size(); ++i)
+    if ( mUploading[i]->mHandle && !mUploading[i]->mTexture->handle() )
+      mUploading[i]->mTexture->setHandle( mUploading[i]->mHandle );
+}
+//-----------------------------------------------------------------------------
+ref<Texture> TextureStreamer::streamTexture(const String& path, ETextureFormat format, bool mipmaps)
+{
+  ref<Request> req = new Request;
+  // deep copy made on the calling thread, the decoding thread is the only one using it
+  req->mPath = String(path.ptr());
+  req->mTexture = new Texture;
+  req->mTexture->setObjectName( path.toStdString().c_str() );
+  req->mFormat = format;
+  req->mMipmaps = mipmaps;
+  ref<Texture> texture = req->mTexture;
+
+  if (!Log::logMutex())
+    Log::setLogMutex(&gLogMutex);
+
+  // the files handed out by non-disk directories share their data: decode one image at a time
+  int max_workers = (int)mWorkers.size();
+  const std::vector< ref<VirtualDirectory> >& dirs = defFileSystem()->directories();
+  for(size_t i=0; i<dirs.size(); ++i)
+    if (!dirs[i]->as<DiskDirectory>())
+      max_workers = std::min(max_workers, 1);
+
+  bool started = false;
+  {
+    ScopedMutex lock(&mMutex);
+    mDecodeQueue.push_back(req);
+    req = NULL;
+
+    int active = 0;
+    for(size_t i=0; i<mWorkers.size(); ++i)
+      active += mWorkers[i]->mActive ? 1 : 0;
+    started = active > 0;
+
+    // wake up an idle worker if the active ones are all busy
+    if ( active < max_workers && active < (int)mDecodeQueue.size() + mDecoding )
+    {
+      for(size_t i=0; i<mWorkers.size(); ++i)
+      {
+        if (mWorkers[i]->mActive)
+          continue;
+        // the worker has left work() and is about to terminate
+        mWorkers[i]->join();
+        mWorkers[i]->mActive = mWorkers[i]->start();
+        started |= mWorkers[i]->mActive;
+        break;
+      }
+    }
+  }
+
+  // decode on the calling thread if no thread could be started
+  if (!started)
+    work(NULL);
+
+  return texture;
+}
+//-----------------------------------------------------------------------------
+void TextureStreamer::work(Worker* worker)
+{
+  for(;;)
+  {
+    ref<Request> req;
+    {
+      ScopedMutex lock(&mMutex);
+      if (mDecodeQueue.empty())
+      {
+        if (worker)
+          worker->mActive = false;
+        return;
+      }
+      req = mDecodeQueue.front();
+      mDecodeQueue.pop_front();
+      ++mDecoding;
+    }
+
+    // only this thread references the request until it is handed to mDecoded
+    decode(req.get());
+
+    ScopedMutex lock(&mMutex);
+    mDecoded.push_back(req);
+    req = NULL;
+    --mDecoding;
+  }
+}
+//-----------------------------------------------------------------------------
+void TextureStreamer::decode(Request* req)
+{
+  ref<Image> img = loadImage(req->mPath);
+  if (!img || !img->isValid())
+  {
+    Log::error( Say("TextureStreamer: could not load image '%s'.\n") << req->mPath );
+    return;
+  }
+
+  req->mLevels.push_back(img);
+
+  // 1D, 3D and cubemap images are uploaded at once together with their mipmaps
+  if (img->dimension() == ID_2D)
+  {
+    if (req->mMipmaps)
+    {
+      if (!img->mipmaps().empty())
+        req->mLevels.insert( req->mLevels.end(), img->mipmaps().begin(), img->mipmaps().end() );
+      else
+      if ( ( img->type() == IT_UNSIGNED_BYTE || img->type() == IT_UNSIGNED_SHORT || img->type() == IT_FLOAT ) && img->generateMipmaps(RF_Box) )
+        req->mLevels.insert( req->mLevels.end(), img->mipmaps().begin(), img->mipmaps().end() );
+      else
+        req->mGenerateMipmaps = !Texture::isCompressedFormat(img->format());
+    }
+    img->mipmaps().clear();
+  }
+
+  // block-compressed formats are encoded here rather than by the driver on the rendering thread.
+  // All the levels are compressed or none: on failure the driver compresses the original ones.
+  if ( Image::isCompressedFormat((EImageFormat)req->mFormat) && !Image::isCompressedFormat(img->format()) )
+  {
+    std::vector< ref<Image> > compressed;
+    for(size_t i=0; i<req->mLevels.size(); ++i)
+    {
+      ref<Image> level = req->mLevels[i]->compress((EImageFormat)req->mFormat);
+      if (!level)
+        break;
+      compressed.push_back(level);
+    }
+    if (compressed.size() == req->mLevels.size())
+      req->mLevels.swap(compressed);
+    else
+      Log::warning( Say("TextureStreamer: could not compress image '%s', the driver will compress it.\n") << req->mPath );
+  }
+
+  req->mLevel = (int)req->mLevels.size() - 1;
+}
+//-----------------------------------------------------------------------------
+int TextureStreamer::update()
+{
+  {
+    ScopedMutex lock(&mMutex);
+    mUploading.insert( mUploading.end(), mDecoded.begin(), mDecoded.end() );
+    mDecoded.clear();
+  }
+
+  int uploaded = 0;
+  while( uploaded < mUploadBudget || uploaded == 0 )
+  {
+    // pick the smallest pending level: the mipmap tails of all the textures come first
+    int next = -1;
+    int next_bytes = 0;
+    for(int i=0; i<(int)mUploading.size(); ++i)
+    {
+      Request* req = mUploading[i].get();
+      // the image could not be loaded or the texture is referenced only by the streamer
+      if ( req->mLevel < 0 || req->mTexture->referenceCount() == 1 )
+      {
+        if ( req->mHandle && !req->mTexture->handle() )
+          req->mTexture->setHandle(req->mHandle);
+        mUploading.erase( mUploading.begin() + i-- );
+        continue;
+      }
+      int bytes = req->mLevels[req->mLevel]->requiredMemory();
+      if (next < 0 || bytes < next_bytes)
+      {
+        next = i;
+        next_bytes = bytes;
+      }
+    }
+    if (next < 0)
+      break;
+
+    uploaded += upload( mUploading[next].get(), mUploadBudget - uploaded );
+    if (mUploading[next]->mLevel < 0)
+      mUploading.erase( mUploading.begin() + next );
+  }
+
+  return uploaded;
+}
+//-----------------------------------------------------------------------------
+void TextureStreamer::flush()
+{
+  int budget = mUploadBudget;
+  mUploadBudget = INT_MAX;
+  while( pendingCount() )
+  {
+    if ( !update() )
+      Time::sleep(1);
+  }
+  mUploadBudget = budget;
+}
+//-----------------------------------------------------------------------------
+int TextureStreamer::pendingCount() const
+{
+  ScopedMutex lock(&mMutex);
+  return (int)( mDecodeQueue.size() + mDecoded.size() + mUploading.size() ) + mDecoding;
+}
+//-----------------------------------------------------------------------------
+bool TextureStreamer::createTexture(Request* req)
+{
+  const Image* img = req->mLevels[0].get();
+  Texture* tex = req->mTexture.get();
+  ETextureFormat format = req->mFormat != TF_UNKNOWN ? req->mFormat : (ETextureFormat)img->format();
+
+  if (img->dimension() != ID_2D)
+  {
+    switch(img->dimension())
+    {
+#if defined(VL_OPENGL)
+    case ID_1D:      tex->prepareTexture1D(img, format, req->mMipmaps); break;
+#else
+    case ID_1D:      tex->prepareTexture2D(img, format, req->mMipmaps); break;
+#endif
+    case ID_3D:      tex->prepareTexture3D(img, format, req->mMipmaps); break;
+    case ID_Cubemap: tex->prepareTextureCubemap(img, format, req->mMipmaps); break;
+    default:
+      break;
+    }
+    return tex->createTexture();
+  }
+
+  if ( !tex->createTexture(TD_TEXTURE_2D, format, img->width(), img->height(), 0, false, NULL, 0, false) )
+    return false;
+
+  // keep the texture unbound until its first level is complete
+  req->mHandle = tex->handle();
+  tex->setHandle(0);
+
+  // allocate the whole mipmap chain up front
+  int last = (int)req->mLevels.size() - 1;
+  glBindTexture( GL_TEXTURE_2D, req->mHandle ); VL_CHECK_OGL()
+  for(int i=1; i<=last; ++i)
+  {
+    const Image* mip = req->mLevels[i].get();
+    if ( mip->format() == (int)format && Texture::isCompressedFormat(format) )
+      glCompressedTexImage2D( GL_TEXTURE_2D, i, format, mip->width(), mip->height(), 0, mip->requiredMemory(), NULL );
+    else
+      glTexImage2D( GL_TEXTURE_2D, i, format, mip->width(), mip->height(), 0, mip->format(), mip->type(), NULL );
+    VL_CHECK_OGL()
+  }
+  if (hasBaseLevel())
+  {
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, last ); VL_CHECK_OGL()
+    if ( !req->mGenerateMipmaps || !Has_glGenerateMipmaps )
+    {
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last ); VL_CHECK_OGL()
+    }
+  }
+  glBindTexture( GL_TEXTURE_2D, 0 ); VL_CHECK_OGL()
+  return true;
+}
+//-----------------------------------------------------------------------------
+int TextureStreamer::upload(Request* req, int budget)
+{
+  if ( !req->mHandle && !req->mTexture->handle() )
+  {
+    bool ok = createTexture(req);
+    if ( !ok || req->mLevels[0]->dimension() != ID_2D )
+    {
+      int bytes = req->mLevels[0]->requiredMemory();
+      req->mLevels.clear();
+      req->mLevel = -1;
+      return ok ? bytes : 0;
+    }
+  }
+
+  const Image* img = req->mLevels[req->mLevel].get();
+  int format = req->mTexture->internalFormat();
+  bool compressed = img->format() == format && Texture::isCompressedFormat(format);
+
+  // compressed images are uploaded in bands of 4x4 blocks
+  int band_height = compressed ? 4 : 1;
+  int band_bytes  = compressed ? img->requiredMemory() / ( (img->height() + 3) / 4 ) : img->pitch();
+  int bands = std::min( budget / std::max(1, band_bytes), (img->height() + band_height - 1) / band_height );
+  bands = std::max( 1, bands );
+  int y = req->mRow;
+  int h = std::min( img->height() - y, bands * band_height );
+  int bytes = (h + band_height - 1) / band_height * band_bytes;
+  const unsigned char* data = img->pixels() + y / band_height * band_bytes;
+
+  glBindTexture( GL_TEXTURE_2D, req->mHandle ); VL_CHECK_OGL()
+  glPixelStorei( GL_UNPACK_ALIGNMENT, img->byteAlignment() ); VL_CHECK_OGL()
+
+  bool use_pbo = usePixelBufferObject() && Has_PBO;
+  if (use_pbo)
+  {
+    // respecifying the storage lets the driver orphan the buffer still in use by the previous transfer
+    mPBO->setBufferData( bytes, data, BU_STREAM_DRAW );
+    VL_glBindBuffer( GL_PIXEL_UNPACK_BUFFER, mPBO->handle() ); VL_CHECK_OGL()
+    data = NULL;
+  }
+
+  if (compressed)
+    glCompressedTexSubImage2D( GL_TEXTURE_2D, req->mLevel, 0, y, img->width(), h, format, bytes, data );
+  else
+    glTexSubImage2D( GL_TEXTURE_2D, req->mLevel, 0, y, img->width(), h, img->format(), img->type(), data );
+  VL_CHECK_OGL()
+
+  if (use_pbo)
+  {
+    VL_glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 ); VL_CHECK_OGL()
+  }
+
+  req->mRow += h;
+  if (req->mRow >= img->height())
+  {
+    // the level is complete: make it the new base level and release its pixels
+    if ( req->mGenerateMipmaps && Has_glGenerateMipmaps )
+    {
+      glGenerateMipmap( GL_TEXTURE_2D ); VL_CHECK_OGL()
+    }
+    if (hasBaseLevel())
+    {
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, req->mLevel ); VL_CHECK_OGL()
+    }
+    req->mLevels[req->mLevel] = NULL;
+    req->mRow = 0;
+    --req->mLevel;
+    if ( !req->mTexture->handle() && ( hasBaseLevel() || req->mLevel < 0 ) )
+      req->mTexture->setHandle(req->mHandle);
+
+    // once complete the texture can be recreated from its file, see ResidencyManager
+    if (req->mLevel < 0)
+    {
+      ref<Texture::SetupParams> setup_params = new Texture::SetupParams;
+      setup_params->setImagePath( req->mPath );
+      setup_params->setFormat( req->mFormat );
+      setup_params->setDimension( TD_TEXTURE_2D );
+      setup_params->setGenMipmaps( req->mMipmaps );
+      req->mTexture->setSetupParams( setup_params.get() );
+      req->mTexture->setCreationPending(false);
+    }
+  }
+
+  glPixelStorei( GL_UNPACK_ALIGNMENT, 4 ); VL_CHECK_OGL()
+  glBindTexture( GL_TEXTURE_2D, 0 ); VL_CHECK_OGL()
+
+  return bytes;
+}
+//-----------------------------------------------------------------------------
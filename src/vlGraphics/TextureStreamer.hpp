@@ -0,0 +1,153 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef TextureStreamer_INCLUDE_ONCE
+#define TextureStreamer_INCLUDE_ONCE
+
+#include <vlGraphics/Texture.hpp>
+#include <vlGraphics/BufferObject.hpp>
+#include <vlGraphics/RenderEventCallback.hpp>
+#include <vlCore/Thread.hpp>
+#include <deque>
+
+namespace vl
+{
+//-----------------------------------------------------------------------------
+// TextureStreamer
+//-----------------------------------------------------------------------------
+  /**
+   * Creates textures progressively: images are decoded in the background and uploaded a few at a time, smallest mipmap first.
+   *
+   * streamTexture() returns at once a Texture that can be bound to an Effect right away. Until its first mipmap level is
+   * uploaded the texture has no handle and TextureSampler leaves it unbound.
+   * - The image is loaded by loadImage() on a worker thread, which also computes the mipmap levels the image
+   *   does not provide with Image::generateMipmaps() and a box filter (8 bit, 16 bit and float images).
+   * - update() uploads the decoded levels from the smallest to the largest, through a Pixel Buffer Object when available,
+   *   and uploads at most uploadBudget() bytes per call. Large levels are uploaded in horizontal bands over several calls.
+   * - After each level is complete GL_TEXTURE_BASE_LEVEL is lowered, so the texture gets sharper as the levels arrive.
+   *   The whole mipmap chain is allocated when the texture is created, so no reallocation takes place afterwards.
+   *
+   * The mipmap tails of all the pending textures are uploaded before their larger levels, so that new content appears
+   * quickly and at a low resolution. Only 2D images are streamed level by level: 1D, 3D and cubemap images are decoded
+   * in the background and then uploaded at once.
+   *
+   * Install the streamer as a RenderEventCallback of the Rendering to call update() at the start of each frame,
+   * or call update() yourself when the OpenGL context is current.
+   *
+   * \note
+   * - streamTexture(), update() and flush() must be called from the same thread, usually the rendering thread.
+   * - The threading rules of ResourceLoadJob apply to the decoding threads: the image loaders and defFileSystem()
+   *   must not be modified while images are being decoded. The path given to streamTexture() is copied, the decoding
+   *   threads do not share any String with the caller.
+   * - Without GL_TEXTURE_BASE_LEVEL (OpenGL ES 1.x/2.0) a texture is incomplete until all its levels have been uploaded.
+   * - Textures only referenced by the streamer are dropped without being uploaded.
+   */
+  class VLGRAPHICS_EXPORT TextureStreamer: public RenderEventCallback
+  {
+    VL_INSTRUMENT_CLASS(vl::TextureStreamer, RenderEventCallback)
+
+  public:
+    //! Decodes the images with up to \p thread_count threads, parallelThreadCount() if \p thread_count <= 0.
+    TextureStreamer(int thread_count=0);
+
+    //! Stops decoding and waits for the worker threads.
+    ~TextureStreamer();
+
+    /** Returns a Texture that will be filled with the image \p path.
+     * \param path The image file, loaded with loadImage().
+     * \param format The texture internal format, if TF_UNKNOWN the image format is used. The formats supported by
+     * Image::compress() are encoded by the decoding threads.
+     * \param mipmaps If false only the base level is uploaded. */
+    ref<Texture> streamTexture(const String& path, ETextureFormat format=TF_UNKNOWN, bool mipmaps=true);
+
+    /** Uploads up to uploadBudget() bytes of the decoded images. Must be called with the OpenGL context current.
+     * At least one band of pixels is uploaded per call. Returns the number of bytes uploaded. */
+    int update();
+
+    //! Waits for all the images to be decoded and uploads them completely, regardless of uploadBudget().
+    void flush();
+
+    //! The number of textures not yet completely uploaded.
+    int pendingCount() const;
+
+    //! The maximum number of bytes uploaded by update(), defaults to 4 MB.
+    void setUploadBudget(int bytes) { mUploadBudget = bytes; }
+
+    //! The maximum number of bytes uploaded by update(), defaults to 4 MB.
+    int uploadBudget() const { return mUploadBudget; }
+
+    //! Whether the pixels are transferred through a Pixel Buffer Object when supported, defaults to true.
+    void setUsePixelBufferObject(bool use) { mUsePixelBufferObject = use; }
+
+    //! Whether the pixels are transferred through a Pixel Buffer Object when supported, defaults to true.
+    bool usePixelBufferObject() const { return mUsePixelBufferObject; }
+
+    //! The number of threads decoding the images.
+    int threadCount() const { return (int)mWorkers.size(); }
+
+    // --- RenderEventCallback ---
+
+    virtual bool onRenderingStarted(const RenderingAbstract*)
+    {
+      update();
+      return true;
+    }
+
+    virtual bool onRenderingFinished(const RenderingAbstract*) { return false; }
+
+    virtual bool onRendererStarted(const RendererAbstract*) { return false; }
+
+    virtual bool onRendererFinished(const RendererAbstract*) { return false; }
+
+  protected:
+    class Request;
+    class Worker;
+    friend class Worker;
+
+    void work(Worker* worker);
+    void decode(Request* req);
+    int upload(Request* req, int budget);
+    bool createTexture(Request* req);
+
+  protected:
+    std::vector< ref<Worker> > mWorkers;
+    std::deque< ref<Request> > mDecodeQueue;  // guarded by mMutex
+    std::vector< ref<Request> > mDecoded;     // guarded by mMutex
+    std::vector< ref<Request> > mUploading;   // rendering thread only
+    ref<BufferObject> mPBO;
+    mutable Mutex mMutex;
+    int mDecoding;                            // guarded by mMutex
+    int mUploadBudget;
+    bool mUsePixelBufferObject;
+  };
+}
+
+#endif
@@ -400,10 +400,13 @@ namespace vl
       {
         vlx_array->value().resize( arr->size() * arr->glSize() );
         typename T_VLXArray::scalar_type* dst = &vlx_array->value()[0];
-        const typename T_Array::scalar_type* src = (const typename T_Array::scalar_type*)arr->begin();
-        const typename T_Array::scalar_type* end = (const typename T_Array::scalar_type*)arr->end();
-        for(; src<end; ++src, ++dst)
-          *dst = (typename T_VLXArray::scalar_type)*src;
+        // go through at() to support interleaved arrays
+        for(size_t i=0; i<arr->size(); ++i)
+        {
+          const typename T_Array::scalar_type* src = (const typename T_Array::scalar_type*)&arr->at(i);
+          for(size_t j=0; j<arr->glSize(); ++j, ++dst)
+            *dst = (typename T_VLXArray::scalar_type)src[j];
+        }
       }
       st->value().push_back( VLXStructure::Value("Value", vlx_array.get() ) );
       return st;
@@ -0,0 +1,260 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#include <vlGraphics/VertexQuantizer.hpp>
+#include <cmath>
+
+using namespace vl;
+
+namespace
+{
+  inline int roundToInt(float v) { return (int)floor(v + 0.5f); }
+
+  inline float clampUnit(float v) { return v < -1.0f ? -1.0f : v > 1.0f ? 1.0f : v; }
+
+  inline bool isFloatingPoint(const ArrayAbstract* data) { return data->glType() == GL_FLOAT || data->glType() == GL_DOUBLE; }
+}
+//-----------------------------------------------------------------------------
+GLint VertexQuantizer::packInt_2_10_10_10(const fvec3& n)
+{
+  GLint x = roundToInt(clampUnit(n.x()) * 511.0f) & 0x3FF;
+  GLint y = roundToInt(clampUnit(n.y()) * 511.0f) & 0x3FF;
+  GLint z = roundToInt(clampUnit(n.z()) * 511.0f) & 0x3FF;
+  return x | (y << 10) | (z << 20);
+}
+//-----------------------------------------------------------------------------
+fvec3 VertexQuantizer::unpackInt_2_10_10_10(GLint v)
+{
+  // sign extend the 10 bits components
+  int x = (v << 22) >> 22;
+  int y = (v << 12) >> 22;
+  int z = (v <<  2) >> 22;
+  return fvec3( x < -511 ? -1.0f : x / 511.0f, y < -511 ? -1.0f : y / 511.0f, z < -511 ? -1.0f : z / 511.0f );
+}
+//-----------------------------------------------------------------------------
+svec2 VertexQuantizer::encodeOctahedral(const fvec3& n)
+{
+  float l1 = fabs(n.x()) + fabs(n.y()) + fabs(n.z());
+  if (l1 == 0)
+    return svec2(0, 0);
+  float x = n.x() / l1;
+  float y = n.y() / l1;
+  if (n.z() < 0)
+  {
+    float ox = x;
+    x = (1.0f - fabs(y))  * (ox >= 0 ? 1.0f : -1.0f);
+    y = (1.0f - fabs(ox)) * (y  >= 0 ? 1.0f : -1.0f);
+  }
+  return svec2( (GLshort)roundToInt(clampUnit(x) * 32767.0f), (GLshort)roundToInt(clampUnit(y) * 32767.0f) );
+}
+//-----------------------------------------------------------------------------
+fvec3 VertexQuantizer::decodeOctahedral(const svec2& e)
+{
+  float x = e.x() < -32767 ? -1.0f : e.x() / 32767.0f;
+  float y = e.y() < -32767 ? -1.0f : e.y() / 32767.0f;
+  fvec3 n( x, y, 1.0f - fabs(x) - fabs(y) );
+  if (n.z() < 0)
+  {
+    n.x() = (1.0f - fabs(y)) * (x >= 0 ? 1.0f : -1.0f);
+    n.y() = (1.0f - fabs(x)) * (y >= 0 ? 1.0f : -1.0f);
+  }
+  return n.normalize();
+}
+//-----------------------------------------------------------------------------
+ref<ArrayAbstract> VertexQuantizer::quantizePositions(const ArrayAbstract* data, const AABB& aabb)
+{
+  vec3 center = aabb.center();
+  vec3 extent = (aabb.maxCorner() - aabb.minCorner()) * (real)0.5;
+  for(int i=0; i<3; ++i)
+    extent[i] = extent[i] > 0 ? extent[i] : 1;
+
+  mPositionDequantizationMatrix = mat4::getTranslation(center) * mat4::getScaling(extent / (real)32767);
+
+  ref<ArrayShort4> quant = new ArrayShort4;
+  quant->resize( data->size() );
+  for(size_t i=0; i<data->size(); ++i)
+  {
+    vec3 v = (data->getAsVec3(i) - center) / extent;
+    quant->at(i) = svec4( (GLshort)roundToInt(clampUnit((float)v.x()) * 32767.0f),
+                          (GLshort)roundToInt(clampUnit((float)v.y()) * 32767.0f),
+                          (GLshort)roundToInt(clampUnit((float)v.z()) * 32767.0f), 1 );
+  }
+  return quant;
+}
+//-----------------------------------------------------------------------------
+ref<ArrayAbstract> VertexQuantizer::quantizeNormals(const ArrayAbstract* data, bool octahedral)
+{
+  if (octahedral)
+  {
+    ref<ArrayShort2> quant = new ArrayShort2;
+    quant->resize( data->size() );
+    for(size_t i=0; i<data->size(); ++i)
+      quant->at(i) = encodeOctahedral( ((fvec3)data->getAsVec3(i)).normalize() );
+    return quant;
+  }
+  else
+  {
+    ref<ArrayInt_2_10_10_10_REV1> quant = new ArrayInt_2_10_10_10_REV1;
+    quant->resize( data->size() );
+    for(size_t i=0; i<data->size(); ++i)
+      quant->at(i) = packInt_2_10_10_10( ((fvec3)data->getAsVec3(i)).normalize() );
+    return quant;
+  }
+}
+//-----------------------------------------------------------------------------
+ref<ArrayAbstract> VertexQuantizer::quantizeColors(const ArrayAbstract* data)
+{
+  ref<ArrayUByte4> quant = new ArrayUByte4;
+  quant->resize( data->size() );
+  for(size_t i=0; i<data->size(); ++i)
+  {
+    fvec4 c = (fvec4)data->getAsVec4(i);
+    if (data->glSize() < 4)
+      c.a() = 1.0f;
+    c = clamp(c, 0.0f, 1.0f);
+    quant->at(i) = ubvec4( (GLubyte)roundToInt(c.r() * 255.0f), (GLubyte)roundToInt(c.g() * 255.0f),
+                           (GLubyte)roundToInt(c.b() * 255.0f), (GLubyte)roundToInt(c.a() * 255.0f) );
+  }
+  return quant;
+}
+//-----------------------------------------------------------------------------
+ref<ArrayAbstract> VertexQuantizer::quantizeTexCoords(const ArrayAbstract* data)
+{
+  ref<ArrayAbstract> quant;
+  switch(data->glSize())
+  {
+  case 1: quant = new ArrayHFloat1; break;
+  case 2: quant = new ArrayHFloat2; break;
+  case 3: quant = new ArrayHFloat3; break;
+  case 4: quant = new ArrayHFloat4; break;
+  default:
+    return NULL;
+  }
+  size_t comps = data->glSize();
+  quant->bufferObject()->resize( data->size() * comps * sizeof(half) );
+  half* ptr = (half*)quant->ptr();
+  for(size_t i=0; i<data->size(); ++i)
+  {
+    vec4 v = data->getAsVec4(i);
+    for(size_t j=0; j<comps; ++j)
+      *ptr++ = half((float)v[j]);
+  }
+  return quant;
+}
+//-----------------------------------------------------------------------------
+bool VertexQuantizer::quantize(Geometry* geom)
+{
+  bool done = false;
+  mPositionDequantizationMatrix.setIdentity();
+
+  // positions
+  if (quantizePositions())
+  {
+    ArrayAbstract* posarr = geom->vertexArray() ? geom->vertexArray() : geom->vertexAttribArray(VA_Position) ? geom->vertexAttribArray(VA_Position)->data() : NULL;
+    if (posarr && isFloatingPoint(posarr) && posarr->size())
+    {
+      ref<ArrayAbstract> quant = quantizePositions( posarr, posarr->computeBoundingBox() );
+      if (geom->vertexArray())
+        geom->setVertexArray( quant.get() );
+      else
+        geom->setVertexAttribArray( VA_Position, quant.get(), false );
+      done = true;
+    }
+  }
+
+  // normals
+  if (normalQuantization() != NQ_None)
+  {
+    if (geom->normalArray() && isFloatingPoint(geom->normalArray()))
+    {
+      if (normalQuantization() == NQ_Octahedral16)
+        Log::warning("VertexQuantizer::quantize(): octahedral normals require generic vertex attributes, using NQ_Int_2_10_10_10.\n");
+      geom->setNormalArray( quantizeNormals(geom->normalArray(), false).get() );
+      done = true;
+    }
+    else
+    if (geom->vertexAttribArray(VA_Normal) && isFloatingPoint(geom->vertexAttribArray(VA_Normal)->data()))
+    {
+      VertexAttribInfo* info = geom->vertexAttribArray(VA_Normal);
+      geom->setVertexAttribArray( VA_Normal, quantizeNormals(info->data(), normalQuantization() == NQ_Octahedral16).get(), true, VAI_NORMAL );
+      done = true;
+    }
+  }
+
+  // colors
+  if (quantizeColors())
+  {
+    if (geom->colorArray() && isFloatingPoint(geom->colorArray()))
+    {
+      geom->setColorArray( quantizeColors(geom->colorArray()).get() );
+      done = true;
+    }
+    else
+    if (geom->vertexAttribArray(VA_Color) && isFloatingPoint(geom->vertexAttribArray(VA_Color)->data()))
+    {
+      geom->setVertexAttribArray( VA_Color, quantizeColors(geom->vertexAttribArray(VA_Color)->data()).get(), true, VAI_NORMAL );
+      done = true;
+    }
+  }
+
+  // texture coordinates
+  if (quantizeTexCoords())
+  {
+    for(int i=0; i<geom->texCoordArrayCount(); ++i)
+    {
+      int tex_unit = 0;
+      const ArrayAbstract* texarr = NULL;
+      geom->getTexCoordArrayAt(i, tex_unit, texarr);
+      if (isFloatingPoint(texarr))
+      {
+        ref<ArrayAbstract> quant = quantizeTexCoords(texarr);
+        if (quant)
+        {
+          geom->setTexCoordArray( tex_unit, quant.get() );
+          done = true;
+        }
+      }
+    }
+
+    if (geom->vertexAttribArray(VA_TexCoord0) && isFloatingPoint(geom->vertexAttribArray(VA_TexCoord0)->data()))
+    {
+      ref<ArrayAbstract> quant = quantizeTexCoords(geom->vertexAttribArray(VA_TexCoord0)->data());
+      if (quant)
+      {
+        geom->setVertexAttribArray( VA_TexCoord0, quant.get(), false, VAI_NORMAL );
+        done = true;
+      }
+    }
+  }
+
+  return done;
+}
+//-----------------------------------------------------------------------------
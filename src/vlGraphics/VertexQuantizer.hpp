@@ -0,0 +1,141 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+#ifndef VertexQuantizer_INCLUDE_ONCE
+#define VertexQuantizer_INCLUDE_ONCE
+
+#include <vlGraphics/Geometry.hpp>
+
+namespace vl
+{
+  //-----------------------------------------------------------------------------
+  // VertexQuantizer
+  //-----------------------------------------------------------------------------
+  /**
+   * Converts the vertex attributes of a Geometry into compact packed formats, typically reducing the vertex memory by a factor of 2-3.
+   *
+   * - Positions are converted to 16 bits signed integers (ArrayShort4 with w = 1) relative to the bounding box of the Geometry.
+   *   The original positions are obtained applying positionDequantizationMatrix(), which you should concatenate to the Transform
+   *   of the Actor(s) using the Geometry. Position quantization is disabled by default.
+   * - Normals are converted either to ArrayInt_2_10_10_10_REV1 (usable with both the fixed function pipeline and GLSL) or to
+   *   the octahedral encoding stored in a normalized ArrayShort2. The octahedral encoding requires a GLSL vertex shader to
+   *   decode the normal, see decodeOctahedral() for the reference implementation, and is applied only to generic vertex attributes.
+   * - Colors are converted to normalized ArrayUByte4.
+   * - Texture coordinates are converted to half floats (ArrayHFloat1..4).
+   *
+   * Both the conventional arrays and the generic vertex attributes bound to VA_Position, VA_Normal, VA_Color and VA_TexCoord0
+   * are supported. The normalization flag of the generic vertex attributes is set up according to the generated format.
+   *
+   * \note GL_INT_2_10_10_10_REV requires OpenGL 3.3 or GL_ARB_vertex_type_2_10_10_10_rev, half float vertex attributes require
+   * OpenGL 3.0 or GL_ARB_half_float_vertex.
+   */
+  class VLGRAPHICS_EXPORT VertexQuantizer: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::VertexQuantizer, Object)
+
+  public:
+    typedef enum
+    {
+      NQ_None,           //!< Normals are left untouched.
+      NQ_Int_2_10_10_10, //!< Normals are packed in a single ArrayInt_2_10_10_10_REV1 element.
+      NQ_Octahedral16    //!< Normals are stored using the octahedral encoding in a normalized ArrayShort2.
+    } ENormalQuantization;
+
+  public:
+    VertexQuantizer(): mNormalQuantization(NQ_Int_2_10_10_10), mQuantizePositions(false), mQuantizeColors(true), mQuantizeTexCoords(true)
+    {
+      VL_DEBUG_SET_OBJECT_NAME()
+    }
+
+    //! Quantizes the vertex attributes of the given Geometry according to the current settings.
+    //! Returns false if no vertex attribute was quantized.
+    bool quantize(Geometry* geom);
+
+    //! The matrix transforming the quantized positions back into the original ones, valid after calling quantize() with position quantization enabled.
+    const mat4& positionDequantizationMatrix() const { return mPositionDequantizationMatrix; }
+
+    //! How normals are quantized, default is NQ_Int_2_10_10_10.
+    void setNormalQuantization(ENormalQuantization nq) { mNormalQuantization = nq; }
+    //! How normals are quantized, default is NQ_Int_2_10_10_10.
+    ENormalQuantization normalQuantization() const { return mNormalQuantization; }
+
+    //! Enables/disables the 16 bits position quantization, disabled by default.
+    void setQuantizePositions(bool enable) { mQuantizePositions = enable; }
+    //! Enables/disables the 16 bits position quantization, disabled by default.
+    bool quantizePositions() const { return mQuantizePositions; }
+
+    //! Enables/disables the conversion of colors to unsigned bytes, enabled by default.
+    void setQuantizeColors(bool enable) { mQuantizeColors = enable; }
+    //! Enables/disables the conversion of colors to unsigned bytes, enabled by default.
+    bool quantizeColors() const { return mQuantizeColors; }
+
+    //! Enables/disables the conversion of texture coordinates to half floats, enabled by default.
+    void setQuantizeTexCoords(bool enable) { mQuantizeTexCoords = enable; }
+    //! Enables/disables the conversion of texture coordinates to half floats, enabled by default.
+    bool quantizeTexCoords() const { return mQuantizeTexCoords; }
+
+    //! Packs a normalized vector in a signed GL_INT_2_10_10_10_REV value.
+    static GLint packInt_2_10_10_10(const fvec3& n);
+
+    //! Unpacks a signed GL_INT_2_10_10_10_REV value.
+    static fvec3 unpackInt_2_10_10_10(GLint v);
+
+    //! Encodes a normalized vector using the octahedral encoding.
+    static svec2 encodeOctahedral(const fvec3& n);
+
+    //! Decodes an octahedral encoded normal. The equivalent GLSL code is:
+    //! \code
+    //! vec3 decodeOctahedral(vec2 e)
+    //! {
+    //!   vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    //!   if (n.z < 0.0)
+    //!     n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    //!   return normalize(n);
+    //! }
+    //! \endcode
+    static fvec3 decodeOctahedral(const svec2& e);
+
+  protected:
+    ref<ArrayAbstract> quantizePositions(const ArrayAbstract* data, const AABB& aabb);
+    ref<ArrayAbstract> quantizeNormals(const ArrayAbstract* data, bool octahedral);
+    ref<ArrayAbstract> quantizeColors(const ArrayAbstract* data);
+    ref<ArrayAbstract> quantizeTexCoords(const ArrayAbstract* data);
+
+  protected:
+    mat4 mPositionDequantizationMatrix;
+    ENormalQuantization mNormalQuantization;
+    bool mQuantizePositions;
+    bool mQuantizeColors;
+    bool mQuantizeTexCoords;
+  };
+}
+
+#endif
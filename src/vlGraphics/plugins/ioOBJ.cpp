@@ -39,6 +39,8 @@
 #include <vlCore/LoadWriterManager.hpp>
 #include <vlGraphics/Effect.hpp>
 #include <vlGraphics/Actor.hpp>
+#include <vlCore/Thread.hpp>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <stdio.h>
@@ -47,15 +49,539 @@ using namespace vl;
 
 namespace 
 {
+  //-----------------------------------------------------------------------------
+  // the characters skipped by sscanf()
+  inline bool isSpace(char ch)
+  {
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\v' || ch == '\f' || ch == '\r';
+  }
+  //-----------------------------------------------------------------------------
+  // the characters removed by String::trimStdString()
+  inline bool isTrimmed(char ch)
+  {
+    return isSpace(ch) || ch == '\b' || ch == '\a';
+  }
+  //-----------------------------------------------------------------------------
+  inline bool isEndOfLine(char ch)
+  {
+    return ch == '\r' || ch == '\n';
+  }
+  //-----------------------------------------------------------------------------
+  inline bool isDigit(char ch)
+  {
+    return ch >= '0' && ch <= '9';
+  }
+  //-----------------------------------------------------------------------------
+  // Same as TextStream::readLine(): a line is terminated by CR, LF, CR/LF, LF/CR, CR/CR or LF/LF.
+  inline bool nextLine(const char*& ptr, const char* end, const char*& line_begin, const char*& line_end)
+  {
+    if (ptr >= end)
+      return false;
+    line_begin = ptr;
+    while( ptr < end && !isEndOfLine(*ptr) )
+      ++ptr;
+    line_end = ptr;
+    if (ptr < end)
+    {
+      ++ptr;
+      if (ptr < end && isEndOfLine(*ptr))
+        ++ptr;
+    }
+    return true;
+  }
+  //-----------------------------------------------------------------------------
+  // Same as String::trimStdString(), which also truncates the text at the first null character.
+  inline void trimLine(const char*& begin, const char*& end)
+  {
+    while( begin < end && isTrimmed(*begin) )
+      ++begin;
+    const char* null_char = (const char*)memchr(begin, 0, end - begin);
+    if (null_char)
+      end = null_char;
+    while( end > begin && isTrimmed(end[-1]) )
+      --end;
+  }
+  //-----------------------------------------------------------------------------
+  float parseFloatSlow(const char* begin, const char* end)
+  {
+    std::string token(begin, end);
+    float value = 0;
+    sscanf(token.c_str(), "%f", &value);
+    return value;
+  }
+  //-----------------------------------------------------------------------------
+  /*
+   * Parses a number returning exactly the same value as sscanf("%f"). Returns false if the text is not a plain decimal
+   * number followed by a space or by the end of the line, in which case the caller falls back to sscanf().
+   * The common case is computed in double precision, which is exact when both the mantissa and the power of ten are
+   * exactly representable, and then rounded to float unless the double lies exactly halfway between two floats.
+   */
+  bool parseFloat(const char*& ptr, const char* end, float& value)
+  {
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char* p = ptr;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-'))
+      negative = *p++ == '-';
+
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool has_digits = false;
+    bool exact = true;
+    for( ; p < end && isDigit(*p); ++p )
+    {
+      has_digits = true;
+      if (digits < 19)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        digits += mantissa != 0;
+      }
+      else
+        exact = false;
+    }
+    if (p < end && *p == '.')
+    {
+      for( ++p; p < end && isDigit(*p); ++p )
+      {
+        has_digits = true;
+        if (digits < 19)
+        {
+          mantissa = mantissa * 10 + (*p - '0');
+          digits += mantissa != 0;
+          --exponent;
+        }
+        else
+          exact = false;
+      }
+    }
+    if (!has_digits)
+      return false;
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+      ++p;
+      bool negative_exp = false;
+      if (p < end && (*p == '+' || *p == '-'))
+        negative_exp = *p++ == '-';
+      if (p == end || !isDigit(*p))
+        return false;
+      int exp = 0;
+      for( ; p < end && isDigit(*p); ++p )
+        if (exp < 100000)
+          exp = exp * 10 + (*p - '0');
+      exponent += negative_exp ? -exp : exp;
+    }
+    if (p < end && !isSpace(*p))
+      return false;
+
+    if (mantissa == 0 && exact)
+      value = negative ? -0.0f : 0.0f;
+    else
+    if ( !exact || mantissa >= (1ULL << 53) || exponent < -22 || exponent > 22 )
+      value = parseFloatSlow(ptr, p);
+    else
+    {
+      double d = (double)mantissa;
+      d = exponent < 0 ? d / pow10[-exponent] : d * pow10[exponent];
+      unsigned long long bits = 0;
+      memcpy(&bits, &d, sizeof(bits));
+      if ( (bits & 0x1FFFFFFFULL) == 0x10000000ULL )
+        value = parseFloatSlow(ptr, p);
+      else
+        value = (float)(negative ? -d : d);
+    }
+    ptr = p;
+    return true;
+  }
+  //-----------------------------------------------------------------------------
+  /*
+   * Parses an integer the same way sscanf("%d") does. Returns 1 on success, 0 if sscanf() would fail to match
+   * and -1 if the number has too many digits to be parsed here, in which case the caller falls back to sscanf().
+   */
+  int parseInt(const char*& ptr, const char* end, int& value)
+  {
+    const char* p = ptr;
+    while( p < end && isSpace(*p) )
+      ++p;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-'))
+      negative = *p++ == '-';
+    if (p == end || !isDigit(*p))
+      return 0;
+    int v = 0;
+    for( int digits = 0; p < end && isDigit(*p); ++p, ++digits )
+    {
+      if (digits == 9)
+        return -1;
+      v = v * 10 + (*p - '0');
+    }
+    value = negative ? -v : v;
+    ptr = p;
+    return 1;
+  }
+  //-----------------------------------------------------------------------------
+  /*
+   * Detects the vertex format of a face line:
+   * 0 = f v       v       v
+   * 1 = f v/vt    v/vt    v/vt
+   * 2 = f v//vn   v//vn   v//vn
+   * 3 = f v/vt/vn v/vt/vn v/vt/vn
+   */
+  int faceFormat(const char* line, int size)
+  {
+    int i=1;
+    while( i < size && (line[i] == ' ' || line[i] == '\t') ) ++i;
+    int slash1 = 0;
+    int slash2 = 0;
+    while( i < size && line[i] != ' ' && line[i] != '\t' ) 
+    {
+      if (line[i] == '/')
+      {
+        if (!slash1)
+          slash1 = i;
+        else
+        if (!slash2)
+        {
+          slash2 = i;
+          break;
+        }
+      }
+      ++i;
+    }
+    if (!slash1 && !slash2)
+      return 0;
+    else
+    if (slash1 && !slash2)
+      return 1;
+    else
+    {
+      VL_CHECK(slash1)
+      VL_CHECK(slash2)
+      if (slash2 == slash1+1)
+        return 2;
+      else
+        return 3;
+    }
+  }
+  //-----------------------------------------------------------------------------
+  /*
+   * Parses the vertices of a face line using sscanf() and converts the OBJ indices into array indices, given the
+   * number of coordinates, texture coordinates and normals defined before the face.
+   */
+  void parseFaceSlow(const std::string& line, int f_format_type, int coords_size, int texcoords_size, int normals_size, ObjMesh* cur_mesh)
+  {
+    int face_type = 0;
+    // divide into tokens
+    for(size_t i=0; i < line.size(); ++i)
+    {
+      if (line[i] == ' ')
+      {
+        ++face_type;
+
+        // eat all the spaces
+        while( line[i] == ' ' ) 
+          ++i;
+
+        if (line[i] == 0)
+          break;
+
+        int iv=-1,ivt=-1,ivn=-1;
+        switch(f_format_type)
+        {
+        case 0:
+          sscanf(line.c_str()+i, "%d", &iv); 
+          if (iv>0)  --iv; else  iv  = coords_size    - iv;
+          cur_mesh->facePositionIndex().push_back(iv);
+          break;
+        case 1:
+          sscanf(line.c_str()+i, "%d/%d", &iv,&ivt); 
+          if (iv>0)  --iv; else  iv  = coords_size    - iv;
+          if (ivt>0) --ivt; else ivt = texcoords_size - ivt;
+          cur_mesh->facePositionIndex().push_back(iv);
+          cur_mesh->faceTexCoordIndex().push_back(ivt);
+          break;
+        case 2:
+          sscanf(line.c_str()+i, "%d//%d", &iv,&ivn); 
+          if (iv>0)  --iv; else  iv  = coords_size    - iv;
+          if (ivn>0) --ivn; else ivn = normals_size   - ivn;
+          cur_mesh->facePositionIndex().push_back(iv);
+          cur_mesh->faceNormalIndex().push_back(ivn);
+          break;
+        case 3:
+          sscanf(line.c_str()+i, "%d/%d/%d", &iv,&ivt,&ivn); 
+          if (iv>0)  --iv; else  iv  = coords_size    - iv;
+          if (ivt>0) --ivt; else ivt = texcoords_size - ivt;
+          if (ivn>0) --ivn; else ivn = normals_size   - ivn;
+          cur_mesh->facePositionIndex().push_back(iv);
+          cur_mesh->faceTexCoordIndex().push_back(ivt);
+          cur_mesh->faceNormalIndex().push_back(ivn);
+          break;
+        default:
+          break;
+        }
+      }
+    }
+    VL_CHECK(face_type > 2)
+    // track the face type in order to triangulate it later
+    cur_mesh->face_type().push_back(face_type);
+  }
+  //-----------------------------------------------------------------------------
+  //! A face parsed by ObjChunk, its vertex indices are the ones found in the file.
+  struct ObjFace
+  {
+    //! Offset of the line in the file or in ObjChunk::mJoinedLines
+    long long mText;
+    int mLength;
+    //! Number of vertices as counted by the separators and number of vertices actually parsed
+    int mCount, mCorners;
+    //! Number of coordinates, texture coordinates and normals defined by the chunk before the face
+    int mCoords, mTexCoords, mNormals;
+    //! The vertex format of the face, see faceFormat()
+    char mFormat;
+    //! The line has been assembled from several lines ending with '\'
+    bool mJoined;
+    //! The vertices could not be parsed without sscanf()
+    bool mSlow;
+  };
+  //-----------------------------------------------------------------------------
+  //! A command changing the current mesh or material, which must be processed in order with the faces.
+  struct ObjCommand
+  {
+    ObjCommand(int face, const std::string& line): mFace(face), mLine(line) {}
+    //! Index of the first face following the command
+    int mFace;
+    std::string mLine;
+  };
+  //-----------------------------------------------------------------------------
+  //! A range of lines of an OBJ file parsed independently from the others.
+  class ObjChunk
+  {
+  public:
+    void parse(const char* file_begin, const char* begin, const char* end)
+    {
+      mFileBegin = file_begin;
+      const char* ptr = begin;
+      const char* line_begin = NULL;
+      const char* line_end = NULL;
+      while( nextLine(ptr, end, line_begin, line_end) )
+      {
+        trimLine(line_begin, line_end);
+        if (line_begin == line_end || line_begin[0] == '#')
+          continue;
+
+        if (line_end[-1] != '\\')
+        {
+          parseLine(line_begin, line_end, false);
+          continue;
+        }
+
+        // note: comments cannot be multiline
+        std::string line(line_begin, line_end);
+        std::string next_line;
+        while( line[line.length()-1] == '\\' && nextLine(ptr, end, line_begin, line_end) )
+        {
+          next_line.assign(line_begin, line_end);
+          // remove "\"
+          line[line.length()-1] = ' ';
+          // remove spaces before \ and insert a single ' ' space
+          line = String::trimStdString(line) + ' ';
+          // appends new line
+          line += String::trimStdString(next_line);
+        }
+        size_t offset = mJoinedLines.size();
+        mJoinedLines += line;
+        parseLine(mJoinedLines.c_str() + offset, mJoinedLines.c_str() + mJoinedLines.size(), true);
+      }
+    }
+
+    const char* text(const ObjFace& face) const
+    {
+      return face.mJoined ? mJoinedLines.c_str() + face.mText : mFileBegin + face.mText;
+    }
+
+  protected:
+    void parseLine(const char* begin, const char* end, bool joined)
+    {
+      // same as sscanf("%s")
+      const char* cmd_end = begin;
+      while( cmd_end < end && !isSpace(*cmd_end) )
+        ++cmd_end;
+      int cmd_size = (int)(cmd_end - begin);
+
+      if (cmd_size == 1 && begin[0] == 'v') // Geometric vertices
+      {
+        fvec3 v(0,0,0);
+        parseFloats(begin, end, 2, v);
+        mCoords.push_back(fvec4(v, 1.0f));
+      }
+      else
+      if (cmd_size == 2 && begin[0] == 'v' && begin[1] == 't') // Texture vertices
+      {
+        fvec3 v(0,0,0);
+        parseFloats(begin, end, 3, v);
+        mTexCoords.push_back(v);
+      }
+      else
+      if (cmd_size == 2 && begin[0] == 'v' && begin[1] == 'n') // Vertex normals
+      {
+        fvec3 v(0,0,0);
+        parseFloats(begin, end, 3, v);
+        mNormals.push_back(v);
+      }
+      else
+      if (cmd_size == 1 && begin[0] == 'f') // Face
+        parseFace(begin, end, joined);
+      else
+      if ( (cmd_size == 1 && begin[0] == 'o') || (cmd_size == 6 && (memcmp(begin, "usemtl", 6) == 0 || memcmp(begin, "mtllib", 6) == 0)) )
+        mCommands.push_back( ObjCommand((int)mFaces.size(), std::string(begin, end)) );
+    }
+
+    //! Same as sscanf(line + offset, "%f %f %f")
+    void parseFloats(const char* begin, const char* end, int offset, fvec3& v)
+    {
+      const char* ptr = begin + offset < end ? begin + offset : end;
+      for(int i=0; i<3; ++i)
+      {
+        while( ptr < end && isSpace(*ptr) )
+          ++ptr;
+        if (ptr == end)
+          return;
+        if (!parseFloat(ptr, end, v[i]))
+        {
+          std::string line(begin, end);
+          float x=0,y=0,z=0;
+          sscanf(line.c_str()+offset,"%f %f %f", &x, &y, &z);
+          v = fvec3(x,y,z);
+          return;
+        }
+      }
+    }
+
+    void parseFace(const char* line, const char* end, bool joined)
+    {
+      ObjFace face;
+      face.mText      = joined ? line - mJoinedLines.c_str() : line - mFileBegin;
+      face.mLength    = (int)(end - line);
+      face.mCount     = 0;
+      face.mCorners   = 0;
+      face.mCoords    = (int)mCoords.size();
+      face.mTexCoords = (int)mTexCoords.size();
+      face.mNormals   = (int)mNormals.size();
+      face.mFormat    = (char)faceFormat(line, face.mLength);
+      face.mJoined    = joined;
+      face.mSlow      = false;
+
+      // same tokenization and sscanf() patterns as parseFaceSlow()
+      for(int i=0; i < face.mLength; ++i)
+      {
+        if (line[i] == ' ')
+        {
+          ++face.mCount;
+          while( i < face.mLength && line[i] == ' ' )
+            ++i;
+          if (i == face.mLength)
+            break;
+
+          int iv=-1,ivt=-1,ivn=-1;
+          const char* ptr = line + i;
+          int ok = parseInt(ptr, end, iv);
+          if (ok == 1 && face.mFormat != 0 && ptr < end && *ptr == '/')
+          {
+            ++ptr;
+            if (face.mFormat == 2)
+            {
+              if (ptr < end && *ptr == '/')
+              {
+                ++ptr;
+                ok = parseInt(ptr, end, ivn);
+              }
+            }
+            else
+            {
+              ok = parseInt(ptr, end, ivt);
+              if (ok == 1 && face.mFormat == 3 && ptr < end && *ptr == '/')
+              {
+                ++ptr;
+                ok = parseInt(ptr, end, ivn);
+              }
+            }
+          }
+          face.mSlow |= ok < 0;
+          ++face.mCorners;
+
+          mPositionIndex.push_back(iv);
+          if (face.mFormat == 1 || face.mFormat == 3)
+            mTexCoordIndex.push_back(ivt);
+          if (face.mFormat == 2 || face.mFormat == 3)
+            mNormalIndex.push_back(ivn);
+        }
+      }
+      mFaces.push_back(face);
+    }
+
+  public:
+    const char* mFileBegin;
+    std::string mJoinedLines;
+    std::vector<fvec4> mCoords;
+    std::vector<fvec3> mNormals;
+    std::vector<fvec3> mTexCoords;
+    std::vector<ObjFace> mFaces;
+    std::vector<int> mPositionIndex;
+    std::vector<int> mTexCoordIndex;
+    std::vector<int> mNormalIndex;
+    std::vector<ObjCommand> mCommands;
+  };
+  //-----------------------------------------------------------------------------
+  class ObjChunkTask: public ParallelForTask
+  {
+  public:
+    ObjChunkTask(const char* text, const std::vector<size_t>& bounds, std::vector<ObjChunk>& chunks): mText(text), mBounds(bounds), mChunks(chunks) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      for(int i=begin; i<end; ++i)
+        mChunks[i].parse(mText, mText + mBounds[i], mText + mBounds[i+1]);
+    }
+
+  protected:
+    const char* mText;
+    const std::vector<size_t>& mBounds;
+    std::vector<ObjChunk>& mChunks;
+  };
+  //-----------------------------------------------------------------------------
   /*
-   * Utility function
+   * Splits the file in about \p count ranges of lines. A range can only start after a run of line terminators,
+   * which always starts a new line, which does not follow a line ending with '\'.
    */
-  template <class T>
-  void append(std::vector<T>& vec, const T& data, const int& alloc_step = 1024*10)
+  void splitLines(const char* text, size_t size, int count, std::vector<size_t>& bounds)
   {
-    if (vec.size() == vec.capacity())
-      vec.reserve( vec.size() + alloc_step );
-    vec.push_back(data);
+    bounds.clear();
+    bounds.push_back(0);
+    for(int i=1; i<count; ++i)
+    {
+      size_t pos = std::max( size * i / count, bounds.back() + 1 );
+      for( ; pos < size; ++pos )
+      {
+        if ( !isEndOfLine(text[pos-1]) || isEndOfLine(text[pos]) )
+          continue;
+        size_t line_end = pos;
+        while( line_end > 0 && isEndOfLine(text[line_end-1]) )
+          --line_end;
+        size_t line_begin = line_end;
+        while( line_begin > 0 && !isEndOfLine(text[line_begin-1]) )
+          --line_begin;
+        const char* b = text + line_begin;
+        const char* e = text + line_end;
+        trimLine(b, e);
+        if (b == e || e[-1] != '\\')
+          break;
+      }
+      if (pos >= size)
+        break;
+      bounds.push_back(pos);
+    }
+    bounds.push_back(size);
   }
 }
 //-----------------------------------------------------------------------------
@@ -307,99 +833,131 @@ ref<ResourceDatabase> ObjLoader::loadOBJ( VirtualFile* file )
     Log::error("loadOBJ() called with NULL argument.\n");
     return NULL;
   }
-  ref<TextStream> stream = new TextStream(file);
-  if ( !stream->inputFile()->open(OM_ReadOnly) )
+  if ( !file->open(OM_ReadOnly) )
   {
     Log::error( Say("loadOBJ(): could not open source file.\n") );
     return NULL;
   }
 
+  // parse mapped files in place, otherwise read the whole file at once, keeping on reading in case size() is not accurate (for example for compressed files)
+  const char* text = (const char*)file->mappedData();
+  size_t text_size = text ? (size_t)file->size() : 0;
+  std::vector<char> buffer;
+  if (!text)
+  {
+    buffer.resize( file->size() > 0 ? (size_t)file->size() : 0 );
+    long long bytes = buffer.empty() ? 0 : file->read(&buffer[0], buffer.size());
+    buffer.resize( bytes > 0 ? (size_t)bytes : 0 );
+    std::vector<char> block(64*1024);
+    while( (bytes = file->read(&block[0], block.size())) > 0 )
+      buffer.insert(buffer.end(), block.begin(), block.begin() + (size_t)bytes);
+    text = buffer.empty() ? NULL : &buffer[0];
+    text_size = buffer.size();
+  }
+
   mCoords.clear();
   // std::vector<float> mNormals;
   // std::vector<float> mTexCoords;
   std::map< std::string, ref<ObjMaterial> > mMaterials;
   std::vector< ref<ObjMesh> > mMeshes;
 
+  // parse the lines in chunks of at least 1MB using multiple threads
+  std::vector<size_t> bounds;
+  splitLines(text, text_size, (int)std::min( (size_t)parallelThreadCount() * 4, text_size / (1024*1024) + 1 ), bounds);
+  std::vector<ObjChunk> chunks(bounds.size() - 1);
+  if (text_size)
+  {
+    ObjChunkTask task(text, bounds, chunks);
+    parallelFor(0, (int)chunks.size(), &task, 1);
+  }
+
+  // concatenate the vertex data of the chunks
+  std::vector<int> coords_base(chunks.size());
+  std::vector<int> texcoords_base(chunks.size());
+  std::vector<int> normals_base(chunks.size());
+  size_t coords_count    = mCoords.size();
+  size_t texcoords_count = mTexCoords.size();
+  size_t normals_count   = mNormals.size();
+  for(size_t i=0; i<chunks.size(); ++i)
+  {
+    coords_base[i]    = (int)coords_count;
+    texcoords_base[i] = (int)texcoords_count;
+    normals_base[i]   = (int)normals_count;
+    coords_count    += chunks[i].mCoords.size();
+    texcoords_count += chunks[i].mTexCoords.size();
+    normals_count   += chunks[i].mNormals.size();
+  }
+  mCoords.reserve(coords_count);
+  mTexCoords.reserve(texcoords_count);
+  mNormals.reserve(normals_count);
+  for(size_t i=0; i<chunks.size(); ++i)
+  {
+    mCoords.insert(mCoords.end(), chunks[i].mCoords.begin(), chunks[i].mCoords.end());
+    mTexCoords.insert(mTexCoords.end(), chunks[i].mTexCoords.begin(), chunks[i].mTexCoords.end());
+    mNormals.insert(mNormals.end(), chunks[i].mNormals.begin(), chunks[i].mNormals.end());
+    std::vector<fvec4>().swap(chunks[i].mCoords);
+    std::vector<fvec3>().swap(chunks[i].mTexCoords);
+    std::vector<fvec3>().swap(chunks[i].mNormals);
+  }
+
   ref<ObjMaterial> cur_material;
   ref<ObjMesh> cur_mesh;
 
-  const int BUF_SIZE = 1024;
-  char cmd[BUF_SIZE];
-
-  int line_count = 0;
   int f_format_type = 0;
   std::string object_name;
   bool starts_new_geom = true;
-  #if 0
-    bool smoothing_group = false;
-  #endif
 
-  std::string stdstr_line;
-  while( stream->readLine(stdstr_line) )
+  // process the faces and the commands in file order
+  for(size_t ichunk=0; ichunk<chunks.size(); ++ichunk)
   {
-    ++line_count;
-    std::string line = String::trimStdString(stdstr_line);
-    if (line.empty() || line[0] == '#')
-      continue;
-
-    // note: comments cannot be multiline
-    while( line[line.length()-1] == '\\' && stream->readLine(stdstr_line) )
+    const ObjChunk& chunk = chunks[ichunk];
+    size_t icmd = 0;
+    size_t ipos = 0;
+    size_t itex = 0;
+    size_t inorm = 0;
+    for(size_t iface=0; iface<=chunk.mFaces.size(); ++iface)
     {
-      ++line_count;
-      // remove "\"
-      line[line.length()-1] = ' ';
-      // remove spaces before \ and insert a single ' ' space
-      line = String::trimStdString(line) + ' ';
-      // appends new line
-      line += String::trimStdString(stdstr_line);
-    }
+      for( ; icmd < chunk.mCommands.size() && chunk.mCommands[icmd].mFace == (int)iface; ++icmd )
+      {
+        const std::string& line = chunk.mCommands[icmd].mLine;
+        if (line[0] == 'o') // Object name
+        {
+          starts_new_geom = true;
+          object_name = String::trimStdString(line.c_str()+1);
+        }
+        else
+        if (line[0] == 'u') // Material name
+        {
+          starts_new_geom = true;
+          std::string mat_name = String(line.c_str()+6).trim().toStdString();
+          // can also become NULL
+          cur_material = mMaterials[mat_name];
+        }
+        else // Material library
+        {
+          // creates the path for the mtl
+          String path = file->path().extractPath() + String(line.c_str()+7).trim();
+          ref<VirtualFile> vfile = defFileSystem()->locateFile(path, file->path().extractPath());
+          if (vfile)
+          {
+            // reads the material
+            std::vector<ObjMaterial> mats;
+            loadObjMaterials(vfile.get(), mats);
+            // updates the material library
+            for(size_t i=0; i < mats.size(); ++i)
+              mMaterials[mats[i].objectName()] = new ObjMaterial(mats[i]);
+          }
+          else
+          {
+            Log::error( Say("Could not find OBJ material file '%s'.\n") << path );
+          }
+        }
+      }
+      if (iface == chunk.mFaces.size())
+        break;
+
+      const ObjFace& face = chunk.mFaces[iface];
 
-    cmd[0] = 0;
-    sscanf(line.c_str(), "%s ", cmd);
-    if ( !cmd[0] )
-      continue;
-// ----------------------------------------------------------------------------
-    // Vertex data:
-    if (strcmp(cmd,"v") == 0) // Geometric vertices
-    {
-      float x=0,y=0,z=0,w=1.0f;
-      sscanf(line.c_str()+2,"%f %f %f", &x, &y, &z);
-      append(mCoords,fvec4(x,y,z,w));
-      /*append(mCoords,x);
-      append(mCoords,y);
-      append(mCoords,z);
-      append(mCoords,w);*/
-    }
-    else
-    if (strcmp(cmd,"vt") == 0) // Texture vertices
-    {
-      // note, this might have less than 3 mCoords
-      float x=0,y=0,z=0;
-      sscanf(line.c_str()+3,"%f %f %f", &x, &y, &z);
-      append(mTexCoords,fvec3(x,y,z));
-      /*append(mTexCoords,x);
-      append(mTexCoords,y);
-      append(mTexCoords,z);*/
-    }
-    else
-    if (strcmp(cmd,"vn") == 0) // Vertex mNormals
-    {
-      float x=0,y=0,z=0;
-      sscanf(line.c_str()+3,"%f %f %f", &x, &y, &z);
-      append(mNormals,fvec3(x,y,z));
-      /*append(mNormals,x);
-      append(mNormals,y);
-      append(mNormals,z);*/
-    }
-    else
-    /*if (strcmp(cmd,"vp") == 0) // Parameter space vertices
-    {
-    }
-    else*/
-// ----------------------------------------------------------------------------
-    // Elements:
-    if (strcmp(cmd,"f") == 0) // Face
-    {
       // starts new geometry if necessary
       if (starts_new_geom)
       {
@@ -408,264 +966,54 @@ ref<ResourceDatabase> ObjLoader::loadOBJ( VirtualFile* file )
         mMeshes.push_back( cur_mesh );
         starts_new_geom = false;
         cur_mesh->setMaterial(cur_material.get());
+        f_format_type = face.mFormat;
+      }
 
-        // detect vertex format
+      int coords_size    = coords_base[ichunk]    + face.mCoords;
+      int texcoords_size = texcoords_base[ichunk] + face.mTexCoords;
+      int normals_size   = normals_base[ichunk]   + face.mNormals;
+      bool has_texcoords = face.mFormat == 1 || face.mFormat == 3;
+      bool has_normals   = face.mFormat == 2 || face.mFormat == 3;
 
-        int i=1;
-        while( line[i] == ' ' || line[i] == '\t' ) ++i;
-        int slash1 = 0;
-        int slash2 = 0;
-        while( i < (int)line.size() && line[i] != ' ' && line[i] != '\t' ) 
+      // the faces whose format differs from the one of the mesh are parsed again as sscanf() would do
+      if (face.mFormat == f_format_type && !face.mSlow)
+      {
+        for(int i=0; i<face.mCorners; ++i)
         {
-          if (line[i] == '/')
+          int iv = chunk.mPositionIndex[ipos+i];
+          if (iv>0) --iv; else iv = coords_size - iv;
+          cur_mesh->facePositionIndex().push_back(iv);
+          if (has_texcoords)
           {
-            if (!slash1)
-              slash1 = i;
-            else
-            if (!slash2)
-            {
-              slash2 = i;
-              break;
-            }
+            int ivt = chunk.mTexCoordIndex[itex+i];
+            if (ivt>0) --ivt; else ivt = texcoords_size - ivt;
+            cur_mesh->faceTexCoordIndex().push_back(ivt);
           }
-          ++i;
-        }
-        if (!slash1 && !slash2)
-          f_format_type = 0;
-        else
-        if (slash1 && !slash2)
-          f_format_type = 1;
-        else
-        {
-          VL_CHECK(slash1)
-          VL_CHECK(slash2)
-          if (slash2 == slash1+1)
-            f_format_type = 2;
-          else
-            f_format_type = 3;
-        }
-      }
-
-      int face_type = 0;
-      // divide into tokens
-      for(size_t i=0; i < line.size(); ++i)
-      {
-        if (line[i] == ' ')
-        {
-          ++face_type;
-
-          // eat all the spaces
-          while( line[i] == ' ' ) 
-            ++i;
-
-          if (line[i] == 0)
-            break;
-
-          int iv=-1,ivt=-1,ivn=-1;
-          // 0 = f v       v       v
-          // 1 = f v/vt    v/vt    v/vt
-          // 2 = f v//vn   v//vn   v//vn
-          // 3 = f v/vt/vn v/vt/vn v/vt/vn
-          switch(f_format_type)
+          if (has_normals)
           {
-          case 0:
-            sscanf(line.c_str()+i, "%d", &iv); 
-            if (iv>0)  --iv; else  iv  = (int)mCoords.size()    - iv;
-            append(cur_mesh->facePositionIndex(), iv);
-            break;
-          case 1:
-            sscanf(line.c_str()+i, "%d/%d", &iv,&ivt); 
-            if (iv>0)  --iv; else  iv  = (int)mCoords.size()    - iv;
-            if (ivt>0) --ivt; else ivt = (int)mTexCoords.size() - ivt;
-            append(cur_mesh->facePositionIndex(), iv);
-            append(cur_mesh->faceTexCoordIndex(), ivt);
-            break;
-          case 2:
-            sscanf(line.c_str()+i, "%d//%d", &iv,&ivn); 
-            if (iv>0)  --iv; else  iv  = (int)mCoords.size()    - iv;
-            if (ivn>0) --ivn; else ivn = (int)mNormals.size()   - ivn;
-            append(cur_mesh->facePositionIndex(), iv);
-            append(cur_mesh->faceNormalIndex(), ivn);
-            break;
-          case 3:
-            sscanf(line.c_str()+i, "%d/%d/%d", &iv,&ivt,&ivn); 
-            if (iv>0)  --iv; else  iv  = (int)mCoords.size()    - iv;
-            if (ivt>0) --ivt; else ivt = (int)mTexCoords.size() - ivt;
-            if (ivn>0) --ivn; else ivn = (int)mNormals.size()   - ivn;
-            append(cur_mesh->facePositionIndex(), iv);
-            append(cur_mesh->faceTexCoordIndex(), ivt);
-            append(cur_mesh->faceNormalIndex(), ivn);
-            break;
-          default:
-            break;
+            int ivn = chunk.mNormalIndex[inorm+i];
+            if (ivn>0) --ivn; else ivn = normals_size - ivn;
+            cur_mesh->faceNormalIndex().push_back(ivn);
           }
         }
-      }
-      VL_CHECK(face_type > 2)
-      // track the face type in order to triangulate it later
-      append(cur_mesh->face_type(), face_type);
-    }
-    else
-    /*if (strcmp(cmd,"p") == 0) // Point 
-    {
-    }
-    else
-    if (strcmp(cmd,"l") == 0) // Line
-    {
-    }
-    else
-    if (strcmp(cmd,"curv") == 0) // Curve
-    {
-    }
-    else
-    if (strcmp(cmd,"curv2") == 0) // 2D Curve
-    {
-    }
-    else
-    if (strcmp(cmd,"surf") == 0) // Surface
-    {
-    }
-    else
-// ----------------------------------------------------------------------------
-    // Free-form curve/surface attributes:
-    if (strcmp(cmd,"deg") == 0) // Degree
-    {
-    }
-    else
-    if (strcmp(cmd,"bmat") == 0) // Basis matrix
-    {
-    }
-    else
-    if (strcmp(cmd,"step") == 0) // Step size
-    {
-    }
-    else
-    if (strcmp(cmd,"cstype") == 0) // Curve or surface type
-    {
-    }
-    else
-// ----------------------------------------------------------------------------
-    // Free-form curve/surface body statements:
-    if (strcmp(cmd,"parm") == 0) // Parameter values
-    {
-    }
-    else
-    if (strcmp(cmd,"trim") == 0) // Outer trimming loop
-    {
-    }
-    else
-    if (strcmp(cmd,"hole") == 0) // Inner trimming loop
-    {
-    }
-    else
-    if (strcmp(cmd,"scrv") == 0) // Special curve
-    {
-    }
-    else
-    if (strcmp(cmd,"sp") == 0) // Special point
-    {
-    }
-    else
-    if (strcmp(cmd,"end") == 0) // End statement
-    {
-    }
-    else
-// ----------------------------------------------------------------------------
-    // Connectivity between free-form surfaces:
-    if (strcmp(cmd,"con") == 0) // Connect
-    {
-    }
-    else
-    // Grouping:
-    if (strcmp(cmd,"g") == 0) // Group name
-    {
-    }
-    else*/
-    if (strcmp(cmd,"s") == 0) // Smoothing group
-    {
-      // not used
-      #if 0
-        if(String::trim(line+1) == "off" || String::trim(line+1) == "0")
-          smoothing_group = false;
-        else
-          smoothing_group = true;
-      #endif
-    }
-    else
-    /*if (strcmp(cmd,"mg") == 0) // Merging group
-    {
-    }
-    else*/
-    if (strcmp(cmd,"o") == 0) // Object name
-    {
-      starts_new_geom = true;
-      object_name = String::trimStdString(line.c_str()+1);
-    }
-    else
-// ----------------------------------------------------------------------------
-    // Display/render attributes:
-    /*if (strcmp(cmd,"bevel") == 0) // Bevel interpolation
-    {
-    }
-    else
-    if (strcmp(cmd,"c_interp") == 0) // Color interpolation
-    {
-    }
-    else
-    if (strcmp(cmd,"d_interp") == 0) // Dissolve interpolation
-    {
-    }
-    else
-    if (strcmp(cmd,"lod") == 0) // Level of detail
-    {
-    }
-    else*/
-    if (strcmp(cmd,"usemtl") == 0) // Material name
-    {
-      starts_new_geom = true;
-      std::string mat_name = String(line.c_str()+6).trim().toStdString();
-      // can also become NULL
-      cur_material = mMaterials[mat_name];
-    }
-    else
-    if (strcmp(cmd,"mtllib") == 0) // Material library
-    {
-      // creates the path for the mtl
-      String path = file->path().extractPath() + String(line.c_str()+7).trim();
-      ref<VirtualFile> vfile = defFileSystem()->locateFile(path, file->path().extractPath());
-      std::string str_file = file->path().toStdString();
-      std::string str_path = path.toStdString();
-      if (vfile)
-      {
-        // reads the material
-        std::vector<ObjMaterial> mats;
-        loadObjMaterials(vfile.get(), mats);
-        // updates the material library
-        for(size_t i=0; i < mats.size(); ++i)
-          mMaterials[mats[i].objectName()] = new ObjMaterial(mats[i]);
+        VL_CHECK(face.mCount > 2)
+        // track the face type in order to triangulate it later
+        cur_mesh->face_type().push_back(face.mCount);
       }
       else
-      {
-        Log::error( Say("Could not find OBJ material file '%s'.\n") << path );
-      }
-    }
-    /*else
-    if (strcmp(cmd,"shadow_obj") == 0) // Shadow casting
-    {
-    }
-    else
-    if (strcmp(cmd,"trace_obj") == 0) // Ray tracing
-    {
-    }
-    else
-    if (strcmp(cmd,"ctech") == 0) // Curve approximation technique
-    {
+        parseFaceSlow( std::string(chunk.text(face), face.mLength), f_format_type, coords_size, texcoords_size, normals_size, cur_mesh.get() );
+
+      ipos += face.mCorners;
+      if (has_texcoords)
+        itex += face.mCorners;
+      if (has_normals)
+        inorm += face.mCorners;
     }
-    else
-    if (strcmp(cmd,"stech") == 0) // Surface approximation technique
-    {
-    }*/
   }
+  chunks.clear();
+  // the faces do not refer to the text anymore
+  file->close();
+  buffer.clear();
 
   ref<ResourceDatabase> res_db = new ResourceDatabase;
 
@@ -918,14 +1266,12 @@ ref<ResourceDatabase> ObjLoader::loadOBJ( VirtualFile* file )
     actor->setEffect(effect.get());
   }
 
-  stream->inputFile()->close();
-
   return res_db;
 }
 //-----------------------------------------------------------------------------
 ref<ResourceDatabase> vl::loadOBJ( const String& path )
 {
-  ref<VirtualFile> file = defFileSystem()->locateFile( path );
+  ref<VirtualFile> file = defFileSystem()->locateMappedFile( path );
   if (file)
     return loadOBJ( file.get() );
   else
@@ -41,10 +41,90 @@
 #include <vlCore/LoadWriterManager.hpp>
 
 using namespace vl;
+
+namespace
+{
+  bool littleEndianCPU()
+  {
+    unsigned short bet = 0x00FF;
+    return ((unsigned char*)&bet)[0] == 0xFF;
+  }
+
+  //! Returns the size in bytes of a PLY scalar type.
+  int typeSize(PlyLoader::EType type)
+  {
+    switch(type)
+    {
+      case PlyLoader::PlyChar:   return sizeof(char);
+      case PlyLoader::PlyUChar:  return sizeof(unsigned char);
+      case PlyLoader::PlyShort:  return sizeof(short);
+      case PlyLoader::PlyUShort: return sizeof(unsigned short);
+      case PlyLoader::PlyInt:    return sizeof(int);
+      case PlyLoader::PlyUInt:   return sizeof(unsigned int);
+      case PlyLoader::PlyFloat:  return sizeof(float);
+      case PlyLoader::PlyDouble: return sizeof(double);
+      default:
+        return 0;
+    }
+  }
+
+  // conversions equivalent to PlyScalar::getAsFloat() and PlyScalar::getAsInt()
+  struct ToFloat { template<typename T> float operator()(T v) const { return (float)v; } };
+  struct ToInt   { template<typename T> int operator()(T v) const { return (int)v; } };
+  struct ToUByte { template<typename T> unsigned char operator()(T v) const { return (unsigned char)(int)v; } };
+
+  /*
+   * Converts \p count scalars of type \p T located every \p stride bytes, writing one every \p out_stride elements of \p out.
+   * The type and the endianness are resolved once for the whole block so that the inner loops stay tight.
+   */
+  template<typename T, typename TConv, typename TOut>
+  void decodeScalars(const unsigned char* data, size_t stride, int count, bool swap, TOut* out, int out_stride)
+  {
+    TConv conv;
+    T value;
+    if (swap)
+    {
+      unsigned char bytes[sizeof(T)];
+      for(int i=0; i<count; ++i, data += stride, out += out_stride)
+      {
+        for(size_t k=0; k<sizeof(T); ++k)
+          bytes[k] = data[sizeof(T)-1-k];
+        memcpy(&value, bytes, sizeof(T));
+        *out = conv(value);
+      }
+    }
+    else
+    {
+      for(int i=0; i<count; ++i, data += stride, out += out_stride)
+      {
+        memcpy(&value, data, sizeof(T));
+        *out = conv(value);
+      }
+    }
+  }
+
+  template<typename TConv, typename TOut>
+  void decodeScalars(PlyLoader::EType type, const unsigned char* data, size_t stride, int count, bool swap, TOut* out, int out_stride)
+  {
+    switch(type)
+    {
+      case PlyLoader::PlyChar:   decodeScalars<char,           TConv>(data, stride, count, swap, out, out_stride); break;
+      case PlyLoader::PlyUChar:  decodeScalars<unsigned char,  TConv>(data, stride, count, swap, out, out_stride); break;
+      case PlyLoader::PlyShort:  decodeScalars<short,          TConv>(data, stride, count, swap, out, out_stride); break;
+      case PlyLoader::PlyUShort: decodeScalars<unsigned short, TConv>(data, stride, count, swap, out, out_stride); break;
+      case PlyLoader::PlyInt:    decodeScalars<int,            TConv>(data, stride, count, swap, out, out_stride); break;
+      case PlyLoader::PlyUInt:   decodeScalars<unsigned int,   TConv>(data, stride, count, swap, out, out_stride); break;
+      case PlyLoader::PlyFloat:  decodeScalars<float,          TConv>(data, stride, count, swap, out, out_stride); break;
+      case PlyLoader::PlyDouble: decodeScalars<double,         TConv>(data, stride, count, swap, out, out_stride); break;
+      default:
+        Log::error("PlyLoader: scalar read error.\n");
+    }
+  }
+}
 //-----------------------------------------------------------------------------
 ref<ResourceDatabase> vl::loadPLY(const String& path)
 {
-  ref<VirtualFile> file = defFileSystem()->locateFile(path);
+  ref<VirtualFile> file = defFileSystem()->locateMappedFile(path);
 
   if (file)
     return loadPLY( file.get() );
@@ -177,28 +257,176 @@ void PlyLoader::PlyElement::analyze()
 }
 void PlyLoader::readElements(VirtualFile* file)
 {
-  // reposition to the correct location
-  file->seekSet(0);
-  std::string str;
-  do
+  // mapped files are decoded in place, the others are read at once
+  const unsigned char* data = file->mappedData();
+  size_t size = data ? (size_t)file->size() : 0;
+  std::vector<unsigned char> buffer;
+  if (!data)
   {
-    unsigned char ch = file->readUInt8();
-    if (ch == '\n' && str == "end_header")
+    file->seekSet(0);
+    buffer.resize( file->size() > 0 ? (size_t)file->size() : 0 );
+    long long bytes = buffer.empty() ? 0 : file->read(&buffer[0], buffer.size());
+    buffer.resize( bytes > 0 ? (size_t)bytes : 0 );
+    data = buffer.empty() ? NULL : &buffer[0];
+    size = buffer.size();
+  }
+
+  // the elements start after the "end_header" line
+  const char* end_header = "end_header\n";
+  size_t pos = 0;
+  for( ; pos + 11 <= size; ++pos )
+  {
+    if ( (pos == 0 || data[pos-1] == '\n') && memcmp(data + pos, end_header, 11) == 0 )
       break;
-    if (ch == '\n')
+  }
+  if (pos + 11 > size)
+  {
+    Log::error("PlyLoader: 'end_header' not found.\n");
+    return;
+  }
+  pos += 11;
+
+  decodeElements(data + pos, size - pos);
+}
+bool PlyLoader::decodeElements(const unsigned char* data, size_t size)
+{
+  const bool swap = littleEndian() != littleEndianCPU();
+  const unsigned char* begin = data;
+  const unsigned char* end = data + size;
+  std::vector<size_t> offsets;
+  std::vector<int> list;
+  for(unsigned i=0; i<mElements.size(); ++i)
+  {
+    PlyElement* el = mElements[i].get();
+    const bool is_vertex = el->name() == "vertex";
+    const bool is_face   = el->name() == "face";
+
+    // elements made only of scalars have a fixed size and are decoded as a whole
+    offsets.resize(el->properties().size());
+    size_t stride = 0;
+    bool fixed_size = true;
+    for(unsigned j=0; j<el->properties().size(); ++j)
+    {
+      PlyScalar* scalar = cast<PlyScalar>(el->properties()[j].get());
+      offsets[j] = stride;
+      if (scalar)
+        stride += typeSize(scalar->scalarType());
+      else
+        fixed_size = false;
+    }
+
+    if (fixed_size)
     {
-      str.clear();
+      if ( stride && (size_t)(end - data) / stride < (size_t)el->elemCount() )
+      {
+        Log::error("PlyLoader: unexpected end of file.\n");
+        return false;
+      }
+      if (is_vertex)
+        decodeVertices(el, data, offsets, stride, el->elemCount());
+      data += stride * el->elemCount();
       continue;
     }
-    str.push_back( ch );
-  } while(true);
 
-  for(unsigned i=0; i<mElements.size(); ++i)
-    for(int j=0; j<mElements[i]->elemCount(); ++j)
+    if (is_face)
+      mIndices.reserve( mIndices.size() + el->elemCount() * 3 );
+    for(int k=0; k<el->elemCount(); ++k)
     {
-      mElements[i]->read(file, littleEndian());
-      newElement(mElements[i].get());
+      for(unsigned j=0; j<el->properties().size(); ++j)
+      {
+        offsets[j] = data - begin;
+        PlyPropertyAbstract* prop = el->properties()[j].get();
+        PlyScalar* scalar = cast<PlyScalar>(prop);
+        PlyScalarList* scalar_list = scalar ? NULL : cast<PlyScalarList>(prop);
+        int count_size = scalar ? typeSize(scalar->scalarType()) : typeSize(scalar_list->countType());
+        if ( !count_size || end - data < count_size )
+        {
+          Log::error("PlyLoader: unexpected end of file.\n");
+          return false;
+        }
+        if (scalar)
+        {
+          data += count_size;
+          continue;
+        }
+        int count = 0;
+        decodeScalars<ToInt>(scalar_list->countType(), data, 0, 1, swap, &count, 1);
+        data += count_size;
+        int scalar_size = typeSize(scalar_list->scalarType());
+        if ( count < 0 || !scalar_size || (size_t)(end - data) / scalar_size < (size_t)count )
+        {
+          Log::error("PlyLoader: unexpected end of file.\n");
+          return false;
+        }
+        if ( is_face && scalar_list->name() == "vertex_indices" && count > 2 )
+        {
+          list.resize(count);
+          decodeScalars<ToInt>(scalar_list->scalarType(), data, scalar_size, count, swap, &list[0], 1);
+          for(int t=1; t<count-1; ++t)
+          {
+            mIndices.push_back( list[0] );
+            mIndices.push_back( list[t] );
+            mIndices.push_back( list[t+1] );
+          }
+        }
+        data += count * scalar_size;
+      }
+      // vertices with list properties are decoded one by one
+      if (is_vertex)
+        decodeVertices(el, begin, offsets, 0, 1);
     }
+  }
+  return true;
+}
+void PlyLoader::decodeVertices(PlyElement* el, const unsigned char* data, const std::vector<size_t>& offsets, size_t stride, int count)
+{
+  const bool swap = littleEndian() != littleEndianCPU();
+  const int first = mVertexIndex;
+  mVertexIndex += count;
+  if (count <= 0)
+    return;
+  if ( (mVerts && (int)mVerts->size() < mVertexIndex) || (mNormals && (int)mNormals->size() < mVertexIndex) || (mColors && (int)mColors->size() < mVertexIndex) )
+  {
+    Log::error("PlyLoader: too many vertices.\n");
+    return;
+  }
+  // missing color components are 0
+  if (mColors)
+    memset(mColors->ptr() + first * sizeof(ubvec4), 0, count * sizeof(ubvec4));
+  for(unsigned j=0; j<el->properties().size(); ++j)
+  {
+    const PlyScalar* scalar = cast<PlyScalar>(el->properties()[j].get());
+    if (!scalar)
+      continue;
+    const String& name = scalar->name();
+    const unsigned char* ptr = data + offsets[j];
+    float* fout = NULL;
+    unsigned char* ubout = NULL;
+    if (mVerts)
+    {
+      if (name == "x") fout = mVerts->at(first).ptr() + 0; else
+      if (name == "y") fout = mVerts->at(first).ptr() + 1; else
+      if (name == "z") fout = mVerts->at(first).ptr() + 2;
+    }
+    if (mNormals)
+    {
+      if (name == "nx") fout = mNormals->at(first).ptr() + 0; else
+      if (name == "ny") fout = mNormals->at(first).ptr() + 1; else
+      if (name == "nz") fout = mNormals->at(first).ptr() + 2;
+    }
+    if (mColors)
+    {
+      if (name == "red")   ubout = mColors->at(first).ptr() + 0; else
+      if (name == "green") ubout = mColors->at(first).ptr() + 1; else
+      if (name == "blue")  ubout = mColors->at(first).ptr() + 2; else
+      if (name == "alpha") ubout = mColors->at(first).ptr() + 3;
+    }
+    if (fout)
+      decodeScalars<ToFloat>(scalar->scalarType(), ptr, stride, count, swap, fout, 3);
+    else
+    if (ubout)
+      decodeScalars<ToUByte>(scalar->scalarType(), ptr, stride, count, swap, ubout, 4);
+  }
 }
 void PlyLoader::readElements(TextStream* text)
 {
@@ -106,6 +106,8 @@ namespace vl
     //! Used by PlyLoader
     class PlyPropertyAbstract: public Object
     {
+      VL_INSTRUMENT_ABSTRACT_CLASS(vl::PlyLoader::PlyPropertyAbstract, Object)
+
     public:
       const String& name() const { return mName; }
       void setName(const String& name) { mName = name; }
@@ -117,6 +119,8 @@ namespace vl
     //! Used by PlyLoader
     class PlyScalar: public PlyPropertyAbstract
     {
+      VL_INSTRUMENT_CLASS(vl::PlyLoader::PlyScalar, PlyPropertyAbstract)
+
     public:
       PlyScalar(): mScalarType(PlyError) { mData.mDouble = 0; }
       void setScalarType(EType type) { mScalarType = type; }
@@ -142,6 +146,8 @@ namespace vl
     //! Used by PlyLoader
     class PlyScalarList: public PlyPropertyAbstract
     {
+      VL_INSTRUMENT_CLASS(vl::PlyLoader::PlyScalarList, PlyPropertyAbstract)
+
     public:
       PlyScalarList(): mScalarType(PlyError), mCountType(PlyError) {}
       void setCountType(EType type) { mCountType = type; }
@@ -245,6 +251,10 @@ namespace vl
     bool littleEndian() const { return mLittleEndian; }
     void readElements(VirtualFile* file);
     void readElements(TextStream* text);
+    //! Decodes the binary elements stored in the given memory block, one whole block of vertices at a time.
+    bool decodeElements(const unsigned char* data, size_t size);
+    //! Decodes \p count vertices whose properties are located at \p data + \p offsets[i] + k * \p stride.
+    void decodeVertices(PlyElement* el, const unsigned char* data, const std::vector<size_t>& offsets, size_t stride, int count);
     void newElement(PlyElement*el);
     EType translateType(const String& type);
     void analyzeHeader();
@@ -42,10 +42,47 @@
 #include <stdio.h>
 
 using namespace vl;
+
+namespace
+{
+  //! Size in bytes of a triangle record of a binary STL: normal, 3 vertices and a 2 bytes attribute.
+  const int STL_TRIANGLE_SIZE = 50;
+  //! Number of triangles read at once from files which are not mapped in memory.
+  const unsigned int STL_BLOCK_TRIANGLES = 16*1024;
+
+  /*
+   * Decodes \p count little endian triangle records into the normal and vertex arrays.
+   * Each normal is replicated for the 3 vertices of its triangle.
+   */
+  void decodeTriangles(const unsigned char* data, unsigned int count, fvec3* normals, fvec3* verts)
+  {
+    unsigned short bet = 0x00FF;
+    bool little_endian_cpu = ((unsigned char*)&bet)[0] == 0xFF;
+    float f[12];
+    for(unsigned int i=0; i<count; ++i, data += STL_TRIANGLE_SIZE, normals += 3, verts += 3)
+    {
+      memcpy(f, data, sizeof(f));
+      if (!little_endian_cpu)
+      {
+        unsigned char* bytes = (unsigned char*)f;
+        for(int j=0; j<12; ++j, bytes += 4)
+        {
+          unsigned char tmp;
+          tmp = bytes[0]; bytes[0] = bytes[3]; bytes[3] = tmp;
+          tmp = bytes[1]; bytes[1] = bytes[2]; bytes[2] = tmp;
+        }
+      }
+      normals[0] = normals[1] = normals[2] = fvec3(f[0], f[1], f[2]);
+      verts[0] = fvec3(f[3], f[4],  f[5]);
+      verts[1] = fvec3(f[6], f[7],  f[8]);
+      verts[2] = fvec3(f[9], f[10], f[11]);
+    }
+  }
+}
 //-----------------------------------------------------------------------------
 ref<ResourceDatabase> vl::loadSTL(const String& path)
 {
-  ref<VirtualFile> file = defFileSystem()->locateFile(path);
+  ref<VirtualFile> file = defFileSystem()->locateMappedFile(path);
 
   if (file)
     return loadSTL( file.get() );
@@ -70,42 +107,54 @@ ref<ResourceDatabase> STLLoader::loadBinary(VirtualFile* file)
   file->read(header,80);
   unsigned int tri_count = file->readUInt32();
 
+  // never trust the header: only the triangles actually present in the file are allocated
+  long long available = (file->size() - 84) / STL_TRIANGLE_SIZE;
+  unsigned int decode_count = available < (long long)tri_count ? (unsigned int)(available > 0 ? available : 0) : tri_count;
+  if (decode_count < tri_count)
+    Log::error( Say("STLLoader: file '%s' is truncated, %n triangles out of %n found.\n") << file->path() << decode_count << tri_count );
+
   ref<ArrayFloat3>  verts   = new ArrayFloat3;
   ref<ArrayFloat3>  normals = new ArrayFloat3;
-  verts->resize(tri_count*3);
-  normals->resize(tri_count*3);
-  ref<DrawArrays> de = new DrawArrays(PT_TRIANGLES,0,tri_count*3);
+  verts->resize(decode_count*3);
+  normals->resize(decode_count*3);
+
+  // read triangles: mapped files are decoded in place, the others are read in blocks of triangles
+  const unsigned char* mapped = file->mappedData();
+  unsigned int decoded = 0;
+  if (mapped)
+  {
+    decodeTriangles(mapped + 84, decode_count, normals->begin(), verts->begin());
+    decoded = decode_count;
+  }
+  else
+  {
+    std::vector<unsigned char> block( STL_BLOCK_TRIANGLES * STL_TRIANGLE_SIZE );
+    for( ; decoded<decode_count; )
+    {
+      unsigned int count = decode_count - decoded < STL_BLOCK_TRIANGLES ? decode_count - decoded : STL_BLOCK_TRIANGLES;
+      if ( file->read(&block[0], count * STL_TRIANGLE_SIZE) != count * STL_TRIANGLE_SIZE )
+      {
+        Log::error( Say("STLLoader: error reading file '%s'.\n") << file->path() );
+        break;
+      }
+      decodeTriangles(&block[0], count, normals->begin() + decoded*3, verts->begin() + decoded*3);
+      decoded += count;
+    }
+  }
+
+  // drop the triangles that could not be read
+  if (decoded < decode_count)
+  {
+    verts->resize(decoded*3);
+    normals->resize(decoded*3);
+  }
+
+  ref<DrawArrays> de = new DrawArrays(PT_TRIANGLES,0,decoded*3);
   ref<Geometry> geom = new Geometry;
   geom->drawCalls().push_back(de.get());
   geom->setVertexArray(verts.get());
   geom->setNormalArray(normals.get());
 
-  // read triangles
-  for(unsigned int i=0; i<tri_count; ++i)
-  {
-    fvec3 n,v1,v2,v0;
-    n.x() = file->readFloat();
-    n.y() = file->readFloat();
-    n.z() = file->readFloat();
-    v0.x() = file->readFloat();
-    v0.y() = file->readFloat();
-    v0.z() = file->readFloat();
-    v1.x() = file->readFloat();
-    v1.y() = file->readFloat();
-    v1.z() = file->readFloat();
-    v2.x() = file->readFloat();
-    v2.y() = file->readFloat();
-    v2.z() = file->readFloat();
-    // skip the 2 bytes
-    file->readUInt16();
-    normals->at(i*3+0) = n;
-    verts->at(i*3+0) = v0;
-    normals->at(i*3+1) = n;
-    verts->at(i*3+1) = v1;
-    normals->at(i*3+2) = n;
-    verts->at(i*3+2) = v2;
-  }
-
   ref<ResourceDatabase> res_db = new ResourceDatabase;
   ref<Effect> effect = new Effect;
   res_db->resources().push_back( geom );
@@ -0,0 +1,572 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#include <vlVolume/BrickedVolume.hpp>
+#include <vlGraphics/OpenGL.hpp>
+#include <vlCore/TextStream.hpp>
+#include <vlCore/FileSystem.hpp>
+#include <algorithm>
+#include <queue>
+#include <cmath>
+
+using namespace vl;
+
+namespace
+{
+  inline int clampCoord(int v, int size) { return v < 0 ? 0 : v >= size ? size-1 : v; }
+
+  //! Sorts the bricks from the coarsest to the finest.
+  struct CoarserFirst
+  {
+    bool operator()(const ivec4& a, const ivec4& b) const { return a.w() > b.w(); }
+  };
+}
+//------------------------------------------------------------------------------
+// BrickSourceRAW
+//------------------------------------------------------------------------------
+BrickSourceRAW::BrickSourceRAW(VirtualFile* file, long long file_offset, const ivec3& dimensions, EImageFormat format, EImageType type)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mFile = file;
+  mFileOffset = file_offset;
+  mDimensions = dimensions;
+  mFormat = format;
+  mType = type;
+}
+//------------------------------------------------------------------------------
+ref<BrickSourceRAW> BrickSourceRAW::fromDAT(VirtualFile* dat_file)
+{
+  if (!dat_file->open(OM_ReadOnly))
+  {
+    Log::error( Say("BrickSourceRAW::fromDAT(): could not open DAT file '%s'.\n") << dat_file->path() );
+    return NULL;
+  }
+
+  ref<TextStream> stream = new TextStream(dat_file);
+  std::string line;
+  char buffer[1024];
+  char filename[1024];
+  char typ[1024];
+  char fmt[1024];
+  float a=0,b=0,c=0;
+  int width=0, height=0, depth=0;
+  bool ok = stream->readLine(line) && sscanf(line.c_str(), "%1023s %1023s", buffer, filename) == 2 &&
+            stream->readLine(line) && sscanf(line.c_str(), "%1023s %d %d %d", buffer, &width, &height, &depth) == 4 &&
+            stream->readLine(line) && sscanf(line.c_str(), "%1023s %f %f %f", buffer, &a, &b, &c) == 4 &&
+            stream->readLine(line) && sscanf(line.c_str(), "%1023s %1023s", buffer, typ) == 2 &&
+            stream->readLine(line) && sscanf(line.c_str(), "%1023s %1023s", buffer, fmt) == 2;
+  dat_file->close();
+  if (!ok)
+  {
+    Log::error( Say("BrickSourceRAW::fromDAT(): '%s' is not a valid DAT file.\n") << dat_file->path() );
+    return NULL;
+  }
+
+  // strip quotes
+  String raw_name = String(filename).trim('\'').trim('"');
+
+  EImageType type;
+  if (String(typ) == "UCHAR")
+    type = IT_UNSIGNED_BYTE;
+  else
+  if (String(typ) == "USHORT")
+    type = IT_UNSIGNED_SHORT;
+  else
+  {
+    Log::error( Say("BrickSourceRAW::fromDAT('%s'): type '%s' not supported.\n") << dat_file->path() << typ );
+    return NULL;
+  }
+
+  EImageFormat format;
+  if (String(fmt) == "LUMINANCE")
+    format = IF_LUMINANCE;
+  else
+  if (String(fmt) == "LUMINANCE_ALPHA")
+    format = IF_LUMINANCE_ALPHA;
+  else
+  if (String(fmt) == "RGB")
+    format = IF_RGB;
+  else
+  if (String(fmt) == "RGBA")
+    format = IF_RGBA;
+  else
+  {
+    Log::error( Say("BrickSourceRAW::fromDAT('%s'): format '%s' not supported.\n") << dat_file->path() << fmt );
+    return NULL;
+  }
+
+  String raw_path = dat_file->path().extractPath() + raw_name;
+  ref<VirtualFile> raw_file = defFileSystem()->locateMappedFile(raw_path);
+  if (!raw_file)
+  {
+    Log::error( Say("BrickSourceRAW::fromDAT('%s'): could not find RAW file '%s'.\n") << dat_file->path() << raw_path );
+    return NULL;
+  }
+
+  return new BrickSourceRAW(raw_file.get(), 0, ivec3(width, height, depth), format, type);
+}
+//------------------------------------------------------------------------------
+bool BrickSourceRAW::readRegion(const ivec3& origin, const ivec3& size, int step, void* out)
+{
+  if ( !mFile->isOpen() && !mFile->open(OM_ReadOnly) )
+  {
+    Log::error( Say("BrickSourceRAW::readRegion(): could not open file '%s'.\n") << mFile->path() );
+    return false;
+  }
+
+  // each row of the region is read with a single access and then decimated, mapped files are accessed in place
+  const int voxel_size = voxelSize();
+  const int x0 = clampCoord(origin.x(), mDimensions.x());
+  const int x1 = clampCoord(origin.x() + (size.x()-1) * step, mDimensions.x());
+  const long long row_size = (x1 - x0 + 1) * voxel_size;
+  const unsigned char* mapped = mFile->mappedData();
+  if (!mapped)
+    mRow.resize( (size_t)row_size );
+  unsigned char* dst = (unsigned char*)out;
+  for(int z=0; z<size.z(); ++z)
+  {
+    long long sz = clampCoord(origin.z() + z * step, mDimensions.z());
+    for(int y=0; y<size.y(); ++y)
+    {
+      long long sy = clampCoord(origin.y() + y * step, mDimensions.y());
+      long long offset = mFileOffset + ((sz * mDimensions.y() + sy) * mDimensions.x() + x0) * voxel_size;
+      const unsigned char* row = NULL;
+      if (mapped)
+        row = offset + row_size <= mFile->size() ? mapped + offset : NULL;
+      else
+      if ( mFile->seekSet(offset) && mFile->read(&mRow[0], row_size) == row_size )
+        row = &mRow[0];
+      if (!row)
+      {
+        Log::error( Say("BrickSourceRAW::readRegion(): error reading file '%s'.\n") << mFile->path() );
+        return false;
+      }
+      for(int x=0; x<size.x(); ++x, dst += voxel_size)
+        memcpy( dst, row + (clampCoord(origin.x() + x * step, mDimensions.x()) - x0) * voxel_size, voxel_size );
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// BrickSourceImageSeries
+//------------------------------------------------------------------------------
+BrickSourceImageSeries::BrickSourceImageSeries(const std::vector<String>& slice_paths)
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mSlicePaths = slice_paths;
+  mSliceCacheSize = 64;
+  mDimensions = ivec3(0,0,0);
+  const Image* first = mSlicePaths.empty() ? NULL : slice(0);
+  if (first)
+  {
+    mDimensions = ivec3( first->width(), first->height(), (int)mSlicePaths.size() );
+    mFormat = first->format();
+    mType = first->type();
+  }
+}
+//------------------------------------------------------------------------------
+const Image* BrickSourceImageSeries::slice(int z)
+{
+  std::map< int, ref<Image> >::iterator it = mSlices.find(z);
+  if (it != mSlices.end())
+  {
+    mSliceLRU.remove(z);
+    mSliceLRU.push_front(z);
+    return it->second.get();
+  }
+
+  ref<Image> img = loadImage(mSlicePaths[z]);
+  if (!img)
+    return NULL;
+  if ( z > 0 && (img->width() != mDimensions.x() || img->height() != mDimensions.y() || img->format() != mFormat || img->type() != mType) )
+  {
+    Log::error( Say("BrickSourceImageSeries: slice '%s' does not match the first slice of the series.\n") << mSlicePaths[z] );
+    return NULL;
+  }
+
+  while( !mSliceLRU.empty() && (int)mSliceLRU.size() >= mSliceCacheSize )
+  {
+    mSlices.erase( mSliceLRU.back() );
+    mSliceLRU.pop_back();
+  }
+  mSlices[z] = img;
+  mSliceLRU.push_front(z);
+  return img.get();
+}
+//------------------------------------------------------------------------------
+bool BrickSourceImageSeries::readRegion(const ivec3& origin, const ivec3& size, int step, void* out)
+{
+  const int voxel_size = voxelSize();
+  unsigned char* dst = (unsigned char*)out;
+  for(int z=0; z<size.z(); ++z)
+  {
+    const Image* img = slice( clampCoord(origin.z() + z * step, mDimensions.z()) );
+    if (!img)
+      return false;
+    for(int y=0; y<size.y(); ++y)
+    {
+      const unsigned char* row = img->pixels() + img->pitch() * clampCoord(origin.y() + y * step, mDimensions.y());
+      for(int x=0; x<size.x(); ++x, dst += voxel_size)
+        memcpy( dst, row + clampCoord(origin.x() + x * step, mDimensions.x()) * voxel_size, voxel_size );
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// BrickedVolume
+//------------------------------------------------------------------------------
+BrickedVolume::BrickedVolume()
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mBrickSize = 0;
+  mPageTableDirty = false;
+  mAtlasFormat = TF_LUMINANCE;
+  mFrame = 0;
+  mMaxVoxelScreenSize = 1.0f;
+  mMaxBrickLoads = 16;
+}
+//------------------------------------------------------------------------------
+void BrickedVolume::setup(BrickSource* source, int brick_size, long long memory_budget)
+{
+  VL_CHECK(source)
+  VL_CHECK(brick_size > 0)
+  mSource = source;
+  mBrickSize = brick_size;
+
+  // levels of detail
+  mLevelSize.clear();
+  const ivec3& dims = source->dimensions();
+  for(int lod=0; ; ++lod)
+  {
+    int span = brick_size << lod;
+    ivec3 size( (dims.x() + span-1) / span, (dims.y() + span-1) / span, (dims.z() + span-1) / span );
+    mLevelSize.push_back(size);
+    if (size.x() <= 1 && size.y() <= 1 && size.z() <= 1)
+      break;
+  }
+
+  // the slots of the cache are arranged in a box as close as possible to a cube,
+  // at most 255 slots per side since they are stored in the 8 bits of the page table
+  int slot_count = (int)(memory_budget / (long long)slotBytes());
+  if (slot_count < 1)
+  {
+    Log::error( Say("BrickedVolume::setup(): memory budget too small, at least %n bytes are required.\n") << (long long)slotBytes() );
+    slot_count = 1;
+  }
+  int side = std::max( 1, std::min( 255, (int)std::floor( std::pow((double)slot_count, 1.0/3.0) + 1e-6 ) ) );
+  mAtlasSlots = ivec3( side, side, std::min( 255, slot_count / (side*side) ) );
+
+  mSlots.clear();
+  mSlots.resize( mAtlasSlots.x() * mAtlasSlots.y() * mAtlasSlots.z() );
+  mSlotData.clear();
+  mSlotData.resize( mSlots.size() * slotBytes() );
+  mResident.clear();
+  mLRU.clear();
+  for(int i=0; i<(int)mSlots.size(); ++i)
+    mSlots[i].mLRU = mLRU.insert(mLRU.end(), i);
+
+  mPageTable = new Image( mLevelSize[0].x(), mLevelSize[0].y(), mLevelSize[0].z(), 1, IF_RGBA, IT_UNSIGNED_BYTE );
+  for(int i=0; i<mPageTable->requiredMemory(); i+=4)
+  {
+    mPageTable->pixels()[i+0] = 0;
+    mPageTable->pixels()[i+1] = 0;
+    mPageTable->pixels()[i+2] = 0;
+    mPageTable->pixels()[i+3] = 255;
+  }
+  mPageTableDirty = true;
+
+  // the textures are created by the renderer the first time they are used, so that they can be bound to the shader right away
+  const int slot_side = mBrickSize + 2;
+  mAtlasTexture = new Texture;
+  mAtlasTexture->prepareTexture3D( mAtlasSlots.x() * slot_side, mAtlasSlots.y() * slot_side, mAtlasSlots.z() * slot_side, mAtlasFormat );
+  mAtlasTexture->getTexParameter()->setMinFilter(TPF_LINEAR);
+  mAtlasTexture->getTexParameter()->setMagFilter(TPF_LINEAR);
+  mAtlasTexture->getTexParameter()->setWrapS(TPW_CLAMP_TO_EDGE);
+  mAtlasTexture->getTexParameter()->setWrapT(TPW_CLAMP_TO_EDGE);
+  mAtlasTexture->getTexParameter()->setWrapR(TPW_CLAMP_TO_EDGE);
+
+  mPageTableTexture = new Texture;
+  mPageTableTexture->prepareTexture3D( mPageTable->width(), mPageTable->height(), mPageTable->depth(), TF_RGBA );
+  mPageTableTexture->getTexParameter()->setMinFilter(TPF_NEAREST);
+  mPageTableTexture->getTexParameter()->setMagFilter(TPF_NEAREST);
+  mPageTableTexture->getTexParameter()->setWrapS(TPW_CLAMP_TO_EDGE);
+  mPageTableTexture->getTexParameter()->setWrapT(TPW_CLAMP_TO_EDGE);
+  mPageTableTexture->getTexParameter()->setWrapR(TPW_CLAMP_TO_EDGE);
+
+  mFrame = 0;
+}
+//------------------------------------------------------------------------------
+int BrickedVolume::brickSlot(const ivec4& brick) const
+{
+  std::map<ivec4, int>::const_iterator it = mResident.find(brick);
+  return it != mResident.end() ? it->second : -1;
+}
+//------------------------------------------------------------------------------
+void BrickedVolume::selectBricks(const AABB& box, const mat4& matrix, const vec3& eye, const Frustum* frustum, real pixel_scale, std::vector<ivec4>& bricks) const
+{
+  bricks.clear();
+  if (!mSource || mLevelSize.empty())
+    return;
+
+  const ivec3& dims = mSource->dimensions();
+  const vec3 voxel( box.width() / dims.x(), box.height() / dims.y(), box.depth() / dims.z() );
+  const int max_bricks = std::max( 1, slotCount() / 2 );
+
+  // refine first the bricks whose voxels are the biggest on the screen
+  std::priority_queue< std::pair<real, ivec4> > queue;
+  int count = 0;
+  std::vector<ivec4> children;
+  children.push_back( ivec4(0, 0, 0, levelCount()-1) );
+  while( !children.empty() )
+  {
+    for(size_t i=0; i<children.size(); ++i)
+    {
+      const ivec4& brick = children[i];
+      int span = mBrickSize << brick.w();
+      ivec3 v0 = brick.xyz() * span;
+      ivec3 v1( std::min(v0.x() + span, dims.x()), std::min(v0.y() + span, dims.y()), std::min(v0.z() + span, dims.z()) );
+      vec3 min_corner = box.minCorner() + voxel * vec3( (real)v0.x(), (real)v0.y(), (real)v0.z() );
+      vec3 max_corner = box.minCorner() + voxel * vec3( (real)v1.x(), (real)v1.y(), (real)v1.z() );
+      AABB world_aabb = AABB(min_corner, max_corner).transformed(matrix);
+      if (frustum && frustum->cull(world_aabb))
+        continue;
+      // the size of a voxel of the brick on the screen
+      vec3 closest = eye;
+      for(int j=0; j<3; ++j)
+        closest[j] = std::max( world_aabb.minCorner()[j], std::min( world_aabb.maxCorner()[j], eye[j] ) );
+      real distance = (closest - eye).length();
+      real voxel_size = world_aabb.longestSideLength() / std::max( 1, (std::max(v1.x()-v0.x(), std::max(v1.y()-v0.y(), v1.z()-v0.z())) + (1<<brick.w())-1) >> brick.w() );
+      real error = distance > 0 ? voxel_size * pixel_scale / distance : std::numeric_limits<real>::max();
+      queue.push( std::make_pair(error, brick) );
+      ++count;
+    }
+    children.clear();
+
+    while( !queue.empty() )
+    {
+      ivec4 brick = queue.top().second;
+      real error = queue.top().first;
+      queue.pop();
+      if (brick.w() == 0 || error <= mMaxVoxelScreenSize)
+      {
+        bricks.push_back(brick);
+        continue;
+      }
+      const ivec3& child_size = mLevelSize[brick.w()-1];
+      for(int z = brick.z()*2; z < brick.z()*2+2 && z < child_size.z(); ++z)
+        for(int y = brick.y()*2; y < brick.y()*2+2 && y < child_size.y(); ++y)
+          for(int x = brick.x()*2; x < brick.x()*2+2 && x < child_size.x(); ++x)
+            children.push_back( ivec4(x, y, z, brick.w()-1) );
+      // keep the brick if refining it exceeds the budget
+      if (count - 1 + (int)children.size() > max_bricks)
+      {
+        children.clear();
+        bricks.push_back(brick);
+        continue;
+      }
+      --count;
+      break;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+void BrickedVolume::touch(int slot)
+{
+  mSlots[slot].mFrame = mFrame;
+  mLRU.splice(mLRU.begin(), mLRU, mSlots[slot].mLRU);
+}
+//------------------------------------------------------------------------------
+void BrickedVolume::loadBrick(const ivec4& brick, int slot)
+{
+  // the brick is read together with a border of 1 voxel
+  const int step = 1 << brick.w();
+  ivec3 origin = (brick.xyz() * mBrickSize - ivec3(1,1,1)) * step;
+  unsigned char* data = &mSlotData[0] + (size_t)slot * slotBytes();
+  if ( !mSource->readRegion(origin, ivec3(mBrickSize+2, mBrickSize+2, mBrickSize+2), step, data) )
+    memset(data, 0, slotBytes());
+  mSlots[slot].mDirty = true;
+}
+//------------------------------------------------------------------------------
+int BrickedVolume::streamBricks(const std::vector<ivec4>& bricks)
+{
+  if (!mSource || mSlots.empty())
+    return (int)bricks.size();
+
+  ++mFrame;
+
+  // pin the resident bricks and, for the missing ones, their finest resident ancestor
+  std::vector<ivec4> missing;
+  for(size_t i=0; i<bricks.size(); ++i)
+  {
+    int slot = brickSlot(bricks[i]);
+    if (slot >= 0)
+    {
+      touch(slot);
+      continue;
+    }
+    missing.push_back(bricks[i]);
+    for(ivec4 a = bricks[i]; a.w() < levelCount()-1; )
+    {
+      a = ivec4(a.x()/2, a.y()/2, a.z()/2, a.w()+1);
+      int ancestor_slot = brickSlot(a);
+      if (ancestor_slot >= 0)
+      {
+        touch(ancestor_slot);
+        break;
+      }
+    }
+  }
+
+  // load the coarsest bricks first so that they can be used by the finer ones until these are loaded
+  std::stable_sort(missing.begin(), missing.end(), CoarserFirst());
+  int loaded = 0;
+  for(; loaded < (int)missing.size() && loaded < mMaxBrickLoads; ++loaded)
+  {
+    int slot = mLRU.back();
+    // all the slots are used by the current frame
+    if (mSlots[slot].mFrame == mFrame)
+      break;
+    if (mSlots[slot].mBrick.w() >= 0)
+      mResident.erase(mSlots[slot].mBrick);
+    loadBrick(missing[loaded], slot);
+    mSlots[slot].mBrick = missing[loaded];
+    mResident[missing[loaded]] = slot;
+    touch(slot);
+  }
+
+  updatePageTable(bricks);
+  return (int)missing.size() - loaded;
+}
+//------------------------------------------------------------------------------
+void BrickedVolume::updatePageTable(const std::vector<ivec4>& bricks)
+{
+  const ivec3& size = mLevelSize[0];
+  std::vector<unsigned char> table(size.x() * size.y() * size.z() * 4, 0);
+  for(size_t i=3; i<table.size(); i+=4)
+    table[i] = 255;
+
+  for(size_t i=0; i<bricks.size(); ++i)
+  {
+    // the brick itself or its finest resident ancestor
+    ivec4 brick = bricks[i];
+    int slot = brickSlot(brick);
+    while( slot < 0 && brick.w() < levelCount()-1 )
+    {
+      brick = ivec4(brick.x()/2, brick.y()/2, brick.z()/2, brick.w()+1);
+      slot = brickSlot(brick);
+    }
+    if (slot < 0)
+      continue;
+    unsigned char entry[] = 
+    {
+      (unsigned char)(slot % mAtlasSlots.x()), 
+      (unsigned char)((slot / mAtlasSlots.x()) % mAtlasSlots.y()), 
+      (unsigned char)(slot / (mAtlasSlots.x() * mAtlasSlots.y())), 
+      (unsigned char)brick.w()
+    };
+    // the cells of the finest level covered by the selected brick
+    int span = 1 << bricks[i].w();
+    for(int z = bricks[i].z()*span; z < (bricks[i].z()+1)*span && z < size.z(); ++z)
+      for(int y = bricks[i].y()*span; y < (bricks[i].y()+1)*span && y < size.y(); ++y)
+        for(int x = bricks[i].x()*span; x < (bricks[i].x()+1)*span && x < size.x(); ++x)
+          memcpy( &table[ (x + size.x()*(y + size.y()*z)) * 4 ], entry, 4 );
+  }
+
+  if ( memcmp(&table[0], mPageTable->pixels(), table.size()) != 0 )
+  {
+    memcpy(mPageTable->pixels(), &table[0], table.size());
+    mPageTableDirty = true;
+  }
+}
+//------------------------------------------------------------------------------
+void BrickedVolume::uploadTextures()
+{
+  const int slot_side = mBrickSize + 2;
+
+  // the textures are not bound to the shader being rendered yet: the dirty slots and page table are uploaded later
+  if (!mAtlasTexture->handle() || !mPageTableTexture->handle())
+    return;
+
+  // restore the previous state so that the renderer's texture unit tracking is not affected
+  GLint prev_texture = 0;
+  GLint prev_alignment = 4;
+  glGetIntegerv(GL_TEXTURE_BINDING_3D, &prev_texture); VL_CHECK_OGL()
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &prev_alignment); VL_CHECK_OGL()
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1); VL_CHECK_OGL()
+
+  glBindTexture(GL_TEXTURE_3D, mAtlasTexture->handle()); VL_CHECK_OGL()
+  for(int i=0; i<(int)mSlots.size(); ++i)
+  {
+    if (!mSlots[i].mDirty)
+      continue;
+    mSlots[i].mDirty = false;
+    int x = i % mAtlasSlots.x();
+    int y = (i / mAtlasSlots.x()) % mAtlasSlots.y();
+    int z = i / (mAtlasSlots.x() * mAtlasSlots.y());
+    VL_glTexSubImage3D( GL_TEXTURE_3D, 0, x*slot_side, y*slot_side, z*slot_side, slot_side, slot_side, slot_side, mSource->format(), mSource->type(), slotData(i) ); VL_CHECK_OGL()
+  }
+
+  if (mPageTableDirty)
+  {
+    mPageTableDirty = false;
+    glBindTexture(GL_TEXTURE_3D, mPageTableTexture->handle()); VL_CHECK_OGL()
+    VL_glTexSubImage3D( GL_TEXTURE_3D, 0, 0, 0, 0, mPageTable->width(), mPageTable->height(), mPageTable->depth(), GL_RGBA, GL_UNSIGNED_BYTE, mPageTable->pixels() ); VL_CHECK_OGL()
+  }
+
+  glBindTexture(GL_TEXTURE_3D, prev_texture); VL_CHECK_OGL()
+  glPixelStorei(GL_UNPACK_ALIGNMENT, prev_alignment); VL_CHECK_OGL()
+}
+//------------------------------------------------------------------------------
+void BrickedVolume::update(Actor* actor, const Camera* camera, const AABB& box)
+{
+  if (!mSource || mSlots.empty())
+    return;
+
+  mat4 matrix;
+  if (actor->transform())
+    matrix = actor->transform()->worldMatrix();
+  vec3 eye = camera->modelingMatrix().getT();
+  real pixel_scale = 1;
+  if (camera->viewport())
+    pixel_scale = camera->projectionMatrix().e(1,1) * camera->viewport()->height() * 0.5f;
+
+  selectBricks(box, matrix, eye, &camera->frustum(), pixel_scale, mSelected);
+  streamBricks(mSelected);
+  uploadTextures();
+
+  const ivec3& dims = mSource->dimensions();
+  actor->gocUniform("volume_size")->setUniform( fvec3( (float)dims.x(), (float)dims.y(), (float)dims.z() ) );
+  actor->gocUniform("page_table_size")->setUniform( fvec3( (float)mLevelSize[0].x(), (float)mLevelSize[0].y(), (float)mLevelSize[0].z() ) );
+  actor->gocUniform("brick_atlas_slots")->setUniform( fvec3( (float)mAtlasSlots.x(), (float)mAtlasSlots.y(), (float)mAtlasSlots.z() ) );
+  actor->gocUniform("brick_size")->setUniformF( (float)mBrickSize );
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,278 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#ifndef BrickedVolume_INCLUDE_ONCE
+#define BrickedVolume_INCLUDE_ONCE
+
+#include <vlVolume/link_config.hpp>
+#include <vlGraphics/Actor.hpp>
+#include <vlGraphics/Camera.hpp>
+#include <vlGraphics/Texture.hpp>
+#include <vlCore/VirtualFile.hpp>
+#include <vlCore/Image.hpp>
+#include <list>
+#include <map>
+
+namespace vl
+{
+  //------------------------------------------------------------------------------
+  // BrickSource
+  //------------------------------------------------------------------------------
+  /**
+   * Provides the voxels of a BrickedVolume, reading them on demand from disk or any other storage.
+   */
+  class VLVOLUME_EXPORT BrickSource: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::BrickSource, Object)
+
+  public:
+    BrickSource(): mFormat(IF_LUMINANCE), mType(IT_UNSIGNED_BYTE) {}
+
+    //! The size in voxels of the volume at full resolution.
+    const ivec3& dimensions() const { return mDimensions; }
+
+    EImageFormat format() const { return mFormat; }
+
+    EImageType type() const { return mType; }
+
+    //! The size in bytes of a single voxel.
+    int voxelSize() const { return Image::bitsPerPixel(type(), format()) / 8; }
+
+    /** Reads \p size.x() * \p size.y() * \p size.z() voxels into \p out taking one voxel every \p step voxels 
+        along each axis starting from \p origin. The coordinates falling outside the volume are clamped to its border. */
+    virtual bool readRegion(const ivec3& origin, const ivec3& size, int step, void* out) = 0;
+
+  protected:
+    ivec3 mDimensions;
+    EImageFormat mFormat;
+    EImageType mType;
+  };
+  //------------------------------------------------------------------------------
+  // BrickSourceRAW
+  //------------------------------------------------------------------------------
+  /**
+   * Reads the voxels from a RAW file, the volume is never loaded as a whole. See also loadRAW().
+   */
+  class VLVOLUME_EXPORT BrickSourceRAW: public BrickSource
+  {
+    VL_INSTRUMENT_CLASS(vl::BrickSourceRAW, BrickSource)
+
+  public:
+    BrickSourceRAW(VirtualFile* file, long long file_offset, const ivec3& dimensions, EImageFormat format, EImageType type);
+
+    //! Creates a BrickSourceRAW reading the RAW file described by the given DAT file, see also loadDAT().
+    static ref<BrickSourceRAW> fromDAT(VirtualFile* dat_file);
+
+    virtual bool readRegion(const ivec3& origin, const ivec3& size, int step, void* out);
+
+    VirtualFile* file() { return mFile.get(); }
+
+    long long fileOffset() const { return mFileOffset; }
+
+  protected:
+    ref<VirtualFile> mFile;
+    long long mFileOffset;
+    std::vector<unsigned char> mRow;
+  };
+  //------------------------------------------------------------------------------
+  // BrickSourceImageSeries
+  //------------------------------------------------------------------------------
+  /**
+   * Reads the voxels from a series of 2D images, one per slice, like a DICOM series. The slices are loaded on demand 
+   * using loadImage() and the most recently used ones are kept in memory, see setSliceCacheSize().
+   */
+  class VLVOLUME_EXPORT BrickSourceImageSeries: public BrickSource
+  {
+    VL_INSTRUMENT_CLASS(vl::BrickSourceImageSeries, BrickSource)
+
+  public:
+    //! The size, format and type of the volume are taken from the first slice.
+    BrickSourceImageSeries(const std::vector<String>& slice_paths);
+
+    virtual bool readRegion(const ivec3& origin, const ivec3& size, int step, void* out);
+
+    //! The maximum number of slices kept in memory (default is 64).
+    void setSliceCacheSize(int count) { mSliceCacheSize = count; }
+    //! The maximum number of slices kept in memory (default is 64).
+    int sliceCacheSize() const { return mSliceCacheSize; }
+
+  protected:
+    const Image* slice(int z);
+
+  protected:
+    std::vector<String> mSlicePaths;
+    std::map< int, ref<Image> > mSlices;
+    std::list<int> mSliceLRU;
+    int mSliceCacheSize;
+  };
+  //------------------------------------------------------------------------------
+  // BrickedVolume
+  //------------------------------------------------------------------------------
+  /**
+   * An out-of-core volume split in bricks which are streamed from a BrickSource on demand, based on the view and on the 
+   * level of detail, into a brick cache with a fixed memory budget.
+   *
+   * The level of detail \a lod of a brick is such that a brick of level \a lod covers brickSize() * 2^lod voxels of the 
+   * full resolution volume along each axis, taking one voxel every 2^lod. Each brick is stored with a 1 voxel border
+   * so that it can be sampled using trilinear filtering. A brick is identified by the ivec4(x, y, z, lod) of its 
+   * position in the brick grid of its level.
+   *
+   * The cache is a 3D texture atlas of slots of (brickSize()+2)^3 voxels. When the cache is full the least recently 
+   * used bricks are evicted, the bricks used by the current frame are never evicted. The page table is a 3D RGBA 
+   * image with one texel for each brick of the finest level: the RGB components contain the slot of the atlas holding
+   * the brick covering it (the selected brick or, until it is loaded, its finest resident ancestor) and the alpha 
+   * component its level of detail, 255 if none.
+   *
+   * Use RaycastVolume::setBrickedVolume() or SlicedVolume::setBrickedVolume() to render a BrickedVolume with 
+   * a shader sampling the volume through the page table like \p "/glsl/volume_raycast_bricked.fs" or 
+   * \p "/glsl/volume_luminance_bricked.fs" respectively.
+   */
+  class VLVOLUME_EXPORT BrickedVolume: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::BrickedVolume, Object)
+
+    struct Slot
+    {
+      Slot(): mBrick(-1,-1,-1,-1), mFrame(0), mDirty(false) {}
+      ivec4 mBrick;
+      unsigned int mFrame;
+      bool mDirty;
+      std::list<int>::iterator mLRU;
+    };
+
+  public:
+    BrickedVolume();
+
+    //! Setups the brick grid and the cache, discarding all the loaded bricks, and creates a new atlasTexture() and pageTableTexture().
+    void setup(BrickSource* source, int brick_size, long long memory_budget);
+
+    BrickSource* source() { return mSource.get(); }
+    const BrickSource* source() const { return mSource.get(); }
+
+    //! The size in voxels of the side of a brick, excluding the border.
+    int brickSize() const { return mBrickSize; }
+
+    //! The number of levels of detail, the coarsest level is made of a single brick.
+    int levelCount() const { return (int)mLevelSize.size(); }
+
+    //! The number of bricks along x, y and z at the given level of detail.
+    const ivec3& levelSize(int lod) const { return mLevelSize[lod]; }
+
+    //! The number of slots of the cache.
+    int slotCount() const { return (int)mSlots.size(); }
+
+    //! The number of slots of the cache along x, y and z.
+    const ivec3& atlasSlots() const { return mAtlasSlots; }
+
+    //! The maximum size in pixels of a voxel on the screen, bricks whose voxels are bigger are refined (default is 1).
+    void setMaxVoxelScreenSize(float pixels) { mMaxVoxelScreenSize = pixels; }
+    //! The maximum size in pixels of a voxel on the screen, bricks whose voxels are bigger are refined (default is 1).
+    float maxVoxelScreenSize() const { return mMaxVoxelScreenSize; }
+
+    //! The maximum number of bricks loaded by each call to streamBricks() so that the frame rate stays interactive (default is 16).
+    void setMaxBrickLoads(int count) { mMaxBrickLoads = count; }
+    //! The maximum number of bricks loaded by each call to streamBricks() so that the frame rate stays interactive (default is 16).
+    int maxBrickLoads() const { return mMaxBrickLoads; }
+
+    /** Selects the bricks which cover the volume, mapped to \p box in object space and to world space by \p matrix, 
+        at the level of detail required by the given view. The bricks outside \p frustum (if not NULL) are discarded. 
+        \p pixel_scale is the size in pixels of an object of unit size at unit distance from \p eye. The bricks are 
+        refined starting from the ones with the biggest voxels on the screen, up to half the number of slots of the 
+        cache, so that the ancestors of the bricks being loaded can be kept resident. */
+    void selectBricks(const AABB& box, const mat4& matrix, const vec3& eye, const Frustum* frustum, real pixel_scale, std::vector<ivec4>& bricks) const;
+
+    /** Loads the given bricks which are not resident yet, starting from the coarsest ones and up to maxBrickLoads(), 
+        evicting the least recently used bricks if necessary, and updates the page table.
+        Returns the number of bricks which are still to be loaded. */
+    int streamBricks(const std::vector<ivec4>& bricks);
+
+    /** Selects and streams the bricks required to render the volume bound to \p actor, mapped to \p box in object space,
+        from the given camera. Then uploads the loaded bricks and the page table to the textures and updates the 
+        uniforms \p "volume_size", \p "page_table_size", \p "brick_atlas_slots" and \p "brick_size" of \p actor.
+        Nothing is uploaded until the textures have been created by the renderer, i.e. until they are bound to the Shader 
+        being rendered. Requires an active OpenGL context. */
+    void update(Actor* actor, const Camera* camera, const AABB& box);
+
+    //! Returns true if the given brick is in the cache.
+    bool isResident(const ivec4& brick) const { return mResident.find(brick) != mResident.end(); }
+
+    //! The slot of the cache containing the given brick or -1.
+    int brickSlot(const ivec4& brick) const;
+
+    //! The voxels of the given slot, including the border.
+    const unsigned char* slotData(int slot) const { return &mSlotData[0] + (size_t)slot * slotBytes(); }
+
+    //! The page table, see the class description.
+    const Image* pageTable() const { return mPageTable.get(); }
+
+    //! The 3D texture atlas used as brick cache, to be bound to the \p "brick_atlas_texunit" sampler. 
+    //! A new one is created by every setup(), the OpenGL texture is created by the renderer the first time it is used.
+    Texture* atlasTexture() { return mAtlasTexture.get(); }
+
+    //! The 3D texture containing the page table, to be bound to the \p "page_table_texunit" sampler.
+    //! A new one is created by every setup(), the OpenGL texture is created by the renderer the first time it is used.
+    Texture* pageTableTexture() { return mPageTableTexture.get(); }
+
+    //! The internal format of atlasTexture() (default is TF_LUMINANCE), must be set before calling setup().
+    void setAtlasFormat(ETextureFormat format) { mAtlasFormat = format; }
+    //! The internal format of atlasTexture() (default is TF_LUMINANCE).
+    ETextureFormat atlasFormat() const { return mAtlasFormat; }
+
+  protected:
+    size_t slotBytes() const { return (size_t)(mBrickSize+2) * (mBrickSize+2) * (mBrickSize+2) * mSource->voxelSize(); }
+    void loadBrick(const ivec4& brick, int slot);
+    void touch(int slot);
+    void updatePageTable(const std::vector<ivec4>& bricks);
+    void uploadTextures();
+
+  protected:
+    ref<BrickSource> mSource;
+    int mBrickSize;
+    std::vector<ivec3> mLevelSize;
+    ivec3 mAtlasSlots;
+    std::vector<Slot> mSlots;
+    std::vector<unsigned char> mSlotData;
+    std::map<ivec4, int> mResident;
+    std::list<int> mLRU;
+    std::vector<ivec4> mSelected;
+    ref<Image> mPageTable;
+    bool mPageTableDirty;
+    ref<Texture> mAtlasTexture;
+    ref<Texture> mPageTableTexture;
+    ETextureFormat mAtlasFormat;
+    unsigned int mFrame;
+    float mMaxVoxelScreenSize;
+    int mMaxBrickLoads;
+  };
+}
+
+#endif
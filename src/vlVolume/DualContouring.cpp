@@ -0,0 +1,760 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+/* The octree contouring tables are from T. Ju's Dual Contouring implementation. */
+
+#include <vlVolume/DualContouring.hpp>
+#include <vlCore/Thread.hpp>
+#include <cmath>
+
+using namespace vl;
+
+namespace
+{
+  //------------------------------------------------------------------------------
+  // gradient of the volume at the given sample in cube units, central differences, one sided on the borders
+  inline fvec3 sampleGradient(const Volume* vol, int x, int y, int z)
+  {
+    const ivec3& n = vol->slices();
+    int xn = x > 0 ? x-1 : x, xp = x < n.x()-1 ? x+1 : x;
+    int yn = y > 0 ? y-1 : y, yp = y < n.y()-1 ? y+1 : y;
+    int zn = z > 0 ? z-1 : z, zp = z < n.z()-1 ? z+1 : z;
+    return fvec3( xp != xn ? (vol->value(xp,y,z) - vol->value(xn,y,z)) / (xp - xn) : 0,
+                  yp != yn ? (vol->value(x,yp,z) - vol->value(x,yn,z)) / (yp - yn) : 0,
+                  zp != zn ? (vol->value(x,y,zp) - vol->value(x,y,zn)) / (zp - zn) : 0 );
+  }
+  //------------------------------------------------------------------------------
+  inline bool insideBox(const fvec3& p, const fvec3& lo, const fvec3& hi)
+  {
+    return p.x() >= lo.x() && p.y() >= lo.y() && p.z() >= lo.z() && p.x() <= hi.x() && p.y() <= hi.y() && p.z() <= hi.z();
+  }
+  //------------------------------------------------------------------------------
+  // eigen decomposition of a symmetric 3x3 matrix using Jacobi rotations, the eigenvectors are the columns of v
+  void symmetricEigen(double a[3][3], double v[3][3], double d[3])
+  {
+    for(int i=0; i<3; ++i)
+      for(int j=0; j<3; ++j)
+        v[i][j] = i == j ? 1.0 : 0.0;
+
+    for(int sweep=0; sweep<16; ++sweep)
+    {
+      double off = a[0][1]*a[0][1] + a[0][2]*a[0][2] + a[1][2]*a[1][2];
+      if (off < 1e-24)
+        break;
+      for(int p=0; p<2; ++p)
+      {
+        for(int q=p+1; q<3; ++q)
+        {
+          if (a[p][q] == 0)
+            continue;
+          double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+          double t = (theta >= 0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta*theta + 1.0));
+          double c = 1.0 / sqrt(t*t + 1.0);
+          double s = t * c;
+          for(int k=0; k<3; ++k)
+          {
+            double akp = a[k][p], akq = a[k][q];
+            a[k][p] = c*akp - s*akq;
+            a[k][q] = s*akp + c*akq;
+          }
+          for(int k=0; k<3; ++k)
+          {
+            double apk = a[p][k], aqk = a[q][k];
+            a[p][k] = c*apk - s*aqk;
+            a[q][k] = s*apk + c*aqk;
+          }
+          for(int k=0; k<3; ++k)
+          {
+            double vkp = v[k][p], vkq = v[k][q];
+            v[k][p] = c*vkp - s*vkq;
+            v[k][q] = s*vkp + c*vkq;
+          }
+        }
+      }
+    }
+
+    for(int i=0; i<3; ++i)
+      d[i] = a[i][i];
+  }
+}
+
+/** \class vl::DualContouring
+ * \sa MarchingCubes, Volume, VolumeInfo
+ */
+
+//------------------------------------------------------------------------------
+// DualContouring::QEF
+//------------------------------------------------------------------------------
+DualContouring::QEF::QEF()
+{
+  memset(mATA, 0, sizeof(mATA));
+  memset(mATb, 0, sizeof(mATb));
+  memset(mMassPoint, 0, sizeof(mMassPoint));
+  mBtB = 0;
+  mPointCount = 0;
+}
+//------------------------------------------------------------------------------
+void DualContouring::QEF::addPlane(const fvec3& p, const fvec3& n)
+{
+  double d = (double)n.x()*p.x() + (double)n.y()*p.y() + (double)n.z()*p.z();
+  mATA[0] += (double)n.x()*n.x();
+  mATA[1] += (double)n.x()*n.y();
+  mATA[2] += (double)n.x()*n.z();
+  mATA[3] += (double)n.y()*n.y();
+  mATA[4] += (double)n.y()*n.z();
+  mATA[5] += (double)n.z()*n.z();
+  mATb[0] += n.x()*d;
+  mATb[1] += n.y()*d;
+  mATb[2] += n.z()*d;
+  mBtB += d*d;
+  addPoint(p);
+}
+//------------------------------------------------------------------------------
+void DualContouring::QEF::addPoint(const fvec3& p)
+{
+  mMassPoint[0] += p.x();
+  mMassPoint[1] += p.y();
+  mMassPoint[2] += p.z();
+  ++mPointCount;
+}
+//------------------------------------------------------------------------------
+void DualContouring::QEF::add(const QEF& other)
+{
+  for(int i=0; i<6; ++i)
+    mATA[i] += other.mATA[i];
+  for(int i=0; i<3; ++i)
+  {
+    mATb[i] += other.mATb[i];
+    mMassPoint[i] += other.mMassPoint[i];
+  }
+  mBtB += other.mBtB;
+  mPointCount += other.mPointCount;
+}
+//------------------------------------------------------------------------------
+fvec3 DualContouring::QEF::massPoint() const
+{
+  if (!mPointCount)
+    return fvec3(0,0,0);
+  return fvec3( (float)(mMassPoint[0] / mPointCount), (float)(mMassPoint[1] / mPointCount), (float)(mMassPoint[2] / mPointCount) );
+}
+//------------------------------------------------------------------------------
+float DualContouring::QEF::solve(fvec3& x) const
+{
+  if (!mPointCount)
+  {
+    x = fvec3(0,0,0);
+    return 0;
+  }
+
+  double m[3] = { mMassPoint[0] / mPointCount, mMassPoint[1] / mPointCount, mMassPoint[2] / mPointCount };
+  double a[3][3] = {
+    { mATA[0], mATA[1], mATA[2] },
+    { mATA[1], mATA[3], mATA[4] },
+    { mATA[2], mATA[4], mATA[5] }
+  };
+
+  // solve A (x - m) = b - A m using the pseudo inverse of A, so that the directions not constrained by the planes keep the mass point
+  double r[3];
+  for(int i=0; i<3; ++i)
+    r[i] = mATb[i] - (a[i][0]*m[0] + a[i][1]*m[1] + a[i][2]*m[2]);
+
+  double v[3][3], d[3];
+  symmetricEigen(a, v, d);
+  double dmax = std::max( std::max(fabs(d[0]), fabs(d[1])), fabs(d[2]) );
+
+  double p[3] = { m[0], m[1], m[2] };
+  for(int i=0; i<3; ++i)
+  {
+    if (d[i] <= 0.1 * dmax || d[i] <= 0)
+      continue;
+    double k = (v[0][i]*r[0] + v[1][i]*r[1] + v[2][i]*r[2]) / d[i];
+    for(int j=0; j<3; ++j)
+      p[j] += k * v[j][i];
+  }
+  x = fvec3( (float)p[0], (float)p[1], (float)p[2] );
+
+  // error = p^T A p - 2 p^T b + b^T b
+  double pap = mATA[0]*p[0]*p[0] + mATA[3]*p[1]*p[1] + mATA[5]*p[2]*p[2] + 2.0*(mATA[1]*p[0]*p[1] + mATA[2]*p[0]*p[2] + mATA[4]*p[1]*p[2]);
+  double error = pap - 2.0*(p[0]*mATb[0] + p[1]*mATb[1] + p[2]*mATb[2]) + mBtB;
+  return error > 0 ? (float)error : 0;
+}
+//------------------------------------------------------------------------------
+// DualContouring
+//------------------------------------------------------------------------------
+DualContouring::DualContouring()
+{
+  mVertsArray = new ArrayFloat3;
+  mNormsArray = new ArrayFloat3;
+  mColorArray = new ArrayFloat4;
+
+  // OpenGL ES does not support DrawElementsUInt
+#if defined(VL_OPENGL)
+  mDrawElements = new DrawElementsUInt(PT_TRIANGLES);
+#else
+  mDrawElements = new DrawElementsUShort(PT_TRIANGLES);
+#endif
+  mVolumeInfo.setAutomaticDelete(false);
+  mErrorTolerance = 0.01f;
+  mMaxCellSize = 64;
+  mMultithreaded = true;
+}
+//------------------------------------------------------------------------------
+void DualContouring::reset()
+{
+  mVertsArray->clear();
+  mNormsArray->clear();
+  mColorArray->clear();
+  mDrawElements->indexBuffer()->clear();
+  mVerts.clear();
+  mNorms.clear();
+  mColors.clear();
+  mIndices.clear();
+  mActiveBlockList.clear();
+  mBlockRoots.clear();
+  mBlockNodes.clear();
+  mNodes.clear();
+  mVolumeInfo.clear();
+}
+//------------------------------------------------------------------------------
+struct DualContouring::BlocksTask: public ParallelForTask
+{
+  BlocksTask(DualContouring* dc, const Volume* vol, float threshold): mDC(dc), mVolume(vol), mThreshold(threshold) {}
+
+  virtual void runRange(int begin, int end)
+  {
+    for(int i=begin; i<end; ++i)
+    {
+      int block = mDC->mActiveBlockList[i];
+      mDC->mBlockRoots[block] = mDC->buildBlock(mVolume, mThreshold, block, mDC->mBlockNodes[i]);
+    }
+  }
+
+  DualContouring* mDC;
+  const Volume* mVolume;
+  float mThreshold;
+};
+//------------------------------------------------------------------------------
+void DualContouring::run(bool generate_colors)
+{
+  mVerts.clear();
+  mNorms.clear();
+  mColors.clear();
+  mIndices.clear();
+
+  for(int ivol=0; ivol<mVolumeInfo.size(); ++ivol)
+  {
+    Volume* vol     = mVolumeInfo.at(ivol)->volume();
+    float threshold = mVolumeInfo.at(ivol)->threshold();
+    int start       = (int)mVerts.size();
+
+    vol->updateInternalData();
+
+    // build the octree of each block containing the isosurface
+    vol->findActiveBlocks(threshold, mActiveBlockList);
+    const ivec3& block_count = vol->blockCount();
+    mBlockRoots.assign(block_count.x() * block_count.y() * block_count.z(), NULL);
+    mBlockNodes.resize(mActiveBlockList.size());
+    BlocksTask blocks_task(this, vol, threshold);
+    if (multithreaded())
+      parallelFor(0, (int)mActiveBlockList.size(), &blocks_task, 1);
+    else
+      blocks_task.runRange(0, (int)mActiveBlockList.size());
+
+    // merge the blocks into a single octree, each level has at most one node per active block
+    int root_size = Volume::BlockSize;
+    int level_count = 1;
+    while( root_size < vol->slices().x()-1 || root_size < vol->slices().y()-1 || root_size < vol->slices().z()-1 )
+    {
+      root_size *= 2;
+      ++level_count;
+    }
+    mNodes.clear();
+    mNodes.reserve(mActiveBlockList.size() * level_count + 1);
+    Node* root = buildTree(vol, threshold, ivec3(0,0,0), root_size);
+
+    if (root)
+    {
+      generateVertices(vol, root);
+      contourCell(root);
+    }
+
+    int count = (int)mVerts.size() - start;
+    mVolumeInfo.at(ivol)->setVert0(start);
+    mVolumeInfo.at(ivol)->setVertC(count);
+
+    // fill color array
+    if (generate_colors)
+    {
+      mColors.resize( mVerts.size() );
+      for(int i=start; i<start+count; ++i)
+        mColors[i] = mVolumeInfo.at(ivol)->color();
+    }
+  }
+
+  updateArrays(generate_colors);
+}
+//------------------------------------------------------------------------------
+/** Builds the octree of a block of the min/max pyramid of the volume. The nodes are stored in \p nodes, whose
+    capacity is reserved in advance so that the pointers to the nodes stay valid. */
+DualContouring::Node* DualContouring::buildBlock(const Volume* vol, float threshold, int block, std::vector<Node>& nodes)
+{
+  const int B = Volume::BlockSize;
+  const ivec3& block_count = vol->blockCount();
+  const ivec3 cubes = vol->slices() - 1;
+  ivec3 block_min( block % block_count.x() * B, block / block_count.x() % block_count.y() * B, block / (block_count.x() * block_count.y()) * B );
+
+  // the corner signs of the cubes crossed by the isosurface, 0 otherwise
+  unsigned char corners[B*B*B];
+  unsigned char flags[B*B*B];
+  memset(corners, 0, sizeof(corners));
+  memset(flags, 0, sizeof(flags));
+  int node_count = 0;
+  for(int z=0; z<B && block_min.z()+z < cubes.z(); ++z)
+  {
+    for(int y=0; y<B && block_min.y()+y < cubes.y(); ++y)
+    {
+      for(int x=0; x<B && block_min.x()+x < cubes.x(); ++x)
+      {
+        int cx = block_min.x()+x;
+        int cy = block_min.y()+y;
+        int cz = block_min.z()+z;
+        if (!vol->cube(cx,cy,cz).includes(threshold))
+          continue;
+        int mask = 0;
+        for(int i=0; i<8; ++i)
+          if (vol->value(cx + mCornerOffset[i][0], cy + mCornerOffset[i][1], cz + mCornerOffset[i][2]) < threshold)
+            mask |= 1 << i;
+        if (mask == 0 || mask == 0xFF)
+          continue;
+        corners[x + B*(y + B*z)] = (unsigned char)mask;
+        flags[x + B*(y + B*z)] = 1;
+        ++node_count;
+      }
+    }
+  }
+
+  // count the internal nodes, reducing the flags in place one level at a time
+  for(int n=B; n>1; n/=2)
+  {
+    int m = n/2;
+    for(int z=0; z<m; ++z)
+      for(int y=0; y<m; ++y)
+        for(int x=0; x<m; ++x)
+        {
+          unsigned char f = 0;
+          for(int i=0; i<8; ++i)
+            f |= flags[ (2*x + mCornerOffset[i][0]) + n*((2*y + mCornerOffset[i][1]) + n*(2*z + mCornerOffset[i][2])) ];
+          flags[x + m*(y + m*z)] = f;
+          node_count += f;
+        }
+  }
+
+  nodes.clear();
+  nodes.reserve(node_count);
+  Node* root = buildNode(vol, threshold, corners, block_min, block_min, B, nodes);
+  VL_CHECK((int)nodes.size() == node_count)
+  return root;
+}
+//------------------------------------------------------------------------------
+DualContouring::Node* DualContouring::buildNode(const Volume* vol, float threshold, const unsigned char* corners, const ivec3& block_min, const ivec3& min, int size, std::vector<Node>& nodes)
+{
+  const int B = Volume::BlockSize;
+  if (size == 1)
+  {
+    ivec3 c = min - block_min;
+    int mask = corners[c.x() + B*(c.y() + B*c.z())];
+    return mask ? buildLeaf(vol, threshold, min, mask, nodes) : NULL;
+  }
+
+  int half = size / 2;
+  Node* children[8];
+  bool empty = true;
+  for(int i=0; i<8; ++i)
+  {
+    children[i] = buildNode(vol, threshold, corners, block_min, min + ivec3(mCornerOffset[i][0], mCornerOffset[i][1], mCornerOffset[i][2]) * half, half, nodes);
+    empty &= children[i] == NULL;
+  }
+  if (empty)
+    return NULL;
+
+  nodes.push_back(Node());
+  Node* node = &nodes.back();
+  node->mMin = min;
+  node->mSize = size;
+  memcpy(node->mChildren, children, sizeof(children));
+  collapse(vol, threshold, node);
+  return node;
+}
+//------------------------------------------------------------------------------
+DualContouring::Node* DualContouring::buildLeaf(const Volume* vol, float threshold, const ivec3& min, int corners, std::vector<Node>& nodes)
+{
+  nodes.push_back(Node());
+  Node* node = &nodes.back();
+  node->mType = NT_Leaf;
+  node->mMin = min;
+  node->mSize = 1;
+  node->mCorners = corners;
+
+  // intersect the isosurface with the edges of the cube, the normals point towards the lower values as in MarchingCubes
+  const fvec3& cell = vol->cellSize();
+  for(int i=0; i<12; ++i)
+  {
+    int c0 = mEdgeCorners[i][0];
+    int c1 = mEdgeCorners[i][1];
+    if ( ((corners >> c0) & 1) == ((corners >> c1) & 1) )
+      continue;
+    ivec3 p0 = min + ivec3(mCornerOffset[c0][0], mCornerOffset[c0][1], mCornerOffset[c0][2]);
+    ivec3 p1 = min + ivec3(mCornerOffset[c1][0], mCornerOffset[c1][1], mCornerOffset[c1][2]);
+    float v0 = vol->value(p0.x(), p0.y(), p0.z());
+    float v1 = vol->value(p1.x(), p1.y(), p1.z());
+    float t = (threshold - v0) / (v1 - v0);
+    fvec3 p = fvec3(p0) * (1.0f-t) + fvec3(p1) * t;
+    fvec3 g = sampleGradient(vol, p0.x(), p0.y(), p0.z()) * (1.0f-t) + sampleGradient(vol, p1.x(), p1.y(), p1.z()) * t;
+    if (g.lengthSquared() > 0)
+    {
+      node->mQEF.addPlane(p, -fvec3(g).normalize());
+      node->mNormal += -fvec3(g.x() / cell.x(), g.y() / cell.y(), g.z() / cell.z()).normalize();
+    }
+    else
+      node->mQEF.addPoint(p);
+  }
+
+  fvec3 x;
+  node->mQEF.solve(x);
+  fvec3 lo = fvec3(min);
+  fvec3 hi = lo + fvec3(1,1,1);
+  node->mPosition = insideBox(x, lo, hi) ? x : node->mQEF.massPoint();
+  return node;
+}
+//------------------------------------------------------------------------------
+/** Merges the children of \p node into a single vertex if they are all leaves or merged cells, the QEF error of the
+    merged vertex is within errorTolerance() and the merge does not change the topology of the isosurface, that is the
+    sign at the center of each edge, face and of the cell itself matches the sign of at least one of their corners. */
+void DualContouring::collapse(const Volume* vol, float threshold, Node* node)
+{
+  if (node->mSize > mMaxCellSize)
+    return;
+  const ivec3& min = node->mMin;
+  const int size = node->mSize;
+  if (min.x() + size >= vol->slices().x() || min.y() + size >= vol->slices().y() || min.z() + size >= vol->slices().z())
+    return;
+
+  QEF qef;
+  fvec3 normal;
+  for(int i=0; i<8; ++i)
+  {
+    const Node* child = node->mChildren[i];
+    if (!child)
+      continue;
+    if (child->mType == NT_Internal)
+      return;
+    qef.add(child->mQEF);
+    normal += child->mNormal;
+  }
+  fvec3 x;
+  if (qef.solve(x) > mErrorTolerance)
+    return;
+
+  // signs on the 3x3x3 lattice of the corners of the children
+  const int half = size / 2;
+  int signs[27];
+  for(int i=0; i<3; ++i)
+    for(int j=0; j<3; ++j)
+      for(int k=0; k<3; ++k)
+        signs[9*i + 3*j + k] = vol->value(min.x() + i*half, min.y() + j*half, min.z() + k*half) < threshold;
+
+  for(int i=0; i<3; ++i)
+  {
+    for(int j=0; j<3; ++j)
+    {
+      for(int k=0; k<3; ++k)
+      {
+        if (i != 1 && j != 1 && k != 1)
+          continue;
+        bool safe = false;
+        for(int a = i == 1 ? 0 : i; a <= (i == 1 ? 2 : i); a += 2)
+          for(int b = j == 1 ? 0 : j; b <= (j == 1 ? 2 : j); b += 2)
+            for(int c = k == 1 ? 0 : k; c <= (k == 1 ? 2 : k); c += 2)
+              safe |= signs[9*a + 3*b + c] == signs[9*i + 3*j + k];
+        if (!safe)
+          return;
+      }
+    }
+  }
+
+  int corners = 0;
+  for(int i=0; i<8; ++i)
+    if (signs[18*mCornerOffset[i][0] + 6*mCornerOffset[i][1] + 2*mCornerOffset[i][2]])
+      corners |= 1 << i;
+  // keep the children if the isosurface does not cross the edges of the cell
+  if (corners == 0 || corners == 0xFF)
+    return;
+
+  node->mType = NT_Collapsed;
+  node->mCorners = corners;
+  node->mQEF = qef;
+  node->mNormal = normal;
+  fvec3 lo = fvec3(min);
+  fvec3 hi = lo + fvec3((float)size, (float)size, (float)size);
+  node->mPosition = insideBox(x, lo, hi) ? x : qef.massPoint();
+}
+//------------------------------------------------------------------------------
+//! Builds the upper levels of the octree on top of the blocks built by buildBlock().
+DualContouring::Node* DualContouring::buildTree(const Volume* vol, float threshold, const ivec3& min, int size)
+{
+  const int B = Volume::BlockSize;
+  const ivec3& block_count = vol->blockCount();
+  if (min.x() >= block_count.x()*B || min.y() >= block_count.y()*B || min.z() >= block_count.z()*B)
+    return NULL;
+  if (size == B)
+    return mBlockRoots[ min.x()/B + block_count.x()*(min.y()/B + block_count.y()*(min.z()/B)) ];
+
+  int half = size / 2;
+  Node* children[8];
+  bool empty = true;
+  for(int i=0; i<8; ++i)
+  {
+    children[i] = buildTree(vol, threshold, min + ivec3(mCornerOffset[i][0], mCornerOffset[i][1], mCornerOffset[i][2]) * half, half);
+    empty &= children[i] == NULL;
+  }
+  if (empty)
+    return NULL;
+
+  VL_CHECK(mNodes.size() < mNodes.capacity())
+  mNodes.push_back(Node());
+  Node* node = &mNodes.back();
+  node->mMin = min;
+  node->mSize = size;
+  memcpy(node->mChildren, children, sizeof(children));
+  collapse(vol, threshold, node);
+  return node;
+}
+//------------------------------------------------------------------------------
+void DualContouring::generateVertices(const Volume* vol, Node* node)
+{
+  if (!node)
+    return;
+  if (node->mType == NT_Internal)
+  {
+    for(int i=0; i<8; ++i)
+      generateVertices(vol, node->mChildren[i]);
+    return;
+  }
+
+  node->mIndex = (int)mVerts.size();
+  const fvec3& bl = vol->bottomLeft();
+  const fvec3& cell = vol->cellSize();
+  mVerts.push_back( fvec3(bl.x() + cell.x()*node->mPosition.x(), bl.y() + cell.y()*node->mPosition.y(), bl.z() + cell.z()*node->mPosition.z()) );
+  fvec3 n = node->mNormal;
+  if (n.lengthSquared() > 0)
+    n.normalize();
+  mNorms.push_back(n);
+}
+//------------------------------------------------------------------------------
+void DualContouring::contourCell(const Node* node)
+{
+  if (!node || node->mType != NT_Internal)
+    return;
+
+  for(int i=0; i<8; ++i)
+    contourCell(node->mChildren[i]);
+
+  for(int i=0; i<12; ++i)
+    contourFace(node->mChildren[ mCellProcFaceMask[i][0] ], node->mChildren[ mCellProcFaceMask[i][1] ], mCellProcFaceMask[i][2]);
+
+  for(int i=0; i<6; ++i)
+  {
+    const Node* edge_nodes[4];
+    for(int j=0; j<4; ++j)
+      edge_nodes[j] = node->mChildren[ mCellProcEdgeMask[i][j] ];
+    contourEdge(edge_nodes, mCellProcEdgeMask[i][4]);
+  }
+}
+//------------------------------------------------------------------------------
+void DualContouring::contourFace(const Node* node0, const Node* node1, int dir)
+{
+  if (!node0 || !node1)
+    return;
+  if (node0->mType != NT_Internal && node1->mType != NT_Internal)
+    return;
+
+  const Node* node[2] = { node0, node1 };
+  for(int i=0; i<4; ++i)
+  {
+    const Node* face_nodes[2];
+    for(int j=0; j<2; ++j)
+      face_nodes[j] = node[j]->mType != NT_Internal ? node[j] : node[j]->mChildren[ mFaceProcFaceMask[dir][i][j] ];
+    contourFace(face_nodes[0], face_nodes[1], mFaceProcFaceMask[dir][i][2]);
+  }
+
+  static const int orders[2][4] = { { 0, 0, 1, 1 }, { 0, 1, 0, 1 } };
+  for(int i=0; i<4; ++i)
+  {
+    const int* order = orders[ mFaceProcEdgeMask[dir][i][0] ];
+    const Node* edge_nodes[4];
+    for(int j=0; j<4; ++j)
+    {
+      const Node* n = node[order[j]];
+      edge_nodes[j] = n->mType != NT_Internal ? n : n->mChildren[ mFaceProcEdgeMask[dir][i][1+j] ];
+    }
+    contourEdge(edge_nodes, mFaceProcEdgeMask[dir][i][5]);
+  }
+}
+//------------------------------------------------------------------------------
+void DualContouring::contourEdge(const Node* node[4], int dir)
+{
+  if (!node[0] || !node[1] || !node[2] || !node[3])
+    return;
+
+  if (node[0]->mType != NT_Internal && node[1]->mType != NT_Internal && node[2]->mType != NT_Internal && node[3]->mType != NT_Internal)
+  {
+    processEdge(node, dir);
+    return;
+  }
+
+  for(int i=0; i<2; ++i)
+  {
+    const Node* edge_nodes[4];
+    for(int j=0; j<4; ++j)
+      edge_nodes[j] = node[j]->mType != NT_Internal ? node[j] : node[j]->mChildren[ mEdgeProcEdgeMask[dir][i][j] ];
+    contourEdge(edge_nodes, mEdgeProcEdgeMask[dir][i][4]);
+  }
+}
+//------------------------------------------------------------------------------
+//! Emits the quad connecting the vertices of the four cells sharing an edge crossed by the isosurface, the edge
+//! being the one of the smallest cell.
+void DualContouring::processEdge(const Node* node[4], int dir)
+{
+  int min_size = 0;
+  bool flip = false;
+  bool sign_change = false;
+  for(int i=0; i<4; ++i)
+  {
+    int edge = mProcessEdgeMask[dir][i];
+    int s0 = (node[i]->mCorners >> mEdgeCorners[edge][0]) & 1;
+    int s1 = (node[i]->mCorners >> mEdgeCorners[edge][1]) & 1;
+    if (i == 0 || node[i]->mSize < min_size)
+    {
+      min_size = node[i]->mSize;
+      flip = s0 != 0;
+      sign_change = s0 != s1;
+    }
+  }
+  if (!sign_change)
+    return;
+
+  const int tris[2][6] = { { 0, 3, 1, 0, 2, 3 }, { 0, 1, 3, 0, 3, 2 } };
+  const int* tri = tris[flip ? 1 : 0];
+  for(int i=0; i<6; i+=3)
+  {
+    int a = node[tri[i+0]]->mIndex;
+    int b = node[tri[i+1]]->mIndex;
+    int c = node[tri[i+2]]->mIndex;
+    // merged cells can appear more than once around an edge
+    if (a == b || b == c || c == a)
+      continue;
+    mIndices.push_back((IndexType)a);
+    mIndices.push_back((IndexType)b);
+    mIndices.push_back((IndexType)c);
+  }
+}
+//------------------------------------------------------------------------------
+void DualContouring::updateArrays(bool generate_colors)
+{
+  mVertsArray->resize(mVerts.size());
+  mVertsArray->setBufferObjectDirty();
+  if (mVerts.size())
+    memcpy(mVertsArray->ptr(), &mVerts[0], sizeof(mVerts[0]) * mVerts.size());
+
+  mNormsArray->resize(mNorms.size());
+  mNormsArray->setBufferObjectDirty();
+  if (mNorms.size())
+    memcpy(mNormsArray->ptr(), &mNorms[0], sizeof(mNorms[0]) * mNorms.size());
+
+  if (generate_colors)
+  {
+    mColorArray->resize(mColors.size());
+    mColorArray->setBufferObjectDirty();
+    if (mColors.size())
+      memcpy(mColorArray->ptr(), &mColors[0], sizeof(mColors[0]) * mColors.size());
+  }
+  else
+    mColorArray->clear();
+
+  mDrawElements->indexBuffer()->resize(mIndices.size());
+  mDrawElements->indexBuffer()->setBufferObjectDirty(true);
+  if (mIndices.size())
+    memcpy(mDrawElements->indexBuffer()->ptr(), &mIndices[0], sizeof(mIndices[0]) * mIndices.size());
+}
+//------------------------------------------------------------------------------
+// tables
+//------------------------------------------------------------------------------
+const int DualContouring::mCornerOffset[8][3] = {
+  {0,0,0}, {0,0,1}, {0,1,0}, {0,1,1}, {1,0,0}, {1,0,1}, {1,1,0}, {1,1,1}
+};
+//------------------------------------------------------------------------------
+const int DualContouring::mEdgeCorners[12][2] = {
+  {0,4}, {1,5}, {2,6}, {3,7}, // x axis
+  {0,2}, {1,3}, {4,6}, {5,7}, // y axis
+  {0,1}, {2,3}, {4,5}, {6,7}  // z axis
+};
+//------------------------------------------------------------------------------
+const int DualContouring::mCellProcFaceMask[12][3] = {
+  {0,4,0}, {1,5,0}, {2,6,0}, {3,7,0}, {0,2,1}, {4,6,1}, {1,3,1}, {5,7,1}, {0,1,2}, {2,3,2}, {4,5,2}, {6,7,2}
+};
+//------------------------------------------------------------------------------
+const int DualContouring::mCellProcEdgeMask[6][5] = {
+  {0,1,2,3,0}, {4,5,6,7,0}, {0,4,1,5,1}, {2,6,3,7,1}, {0,2,4,6,2}, {1,3,5,7,2}
+};
+//------------------------------------------------------------------------------
+const int DualContouring::mFaceProcFaceMask[3][4][3] = {
+  { {4,0,0}, {5,1,0}, {6,2,0}, {7,3,0} },
+  { {2,0,1}, {6,4,1}, {3,1,1}, {7,5,1} },
+  { {1,0,2}, {3,2,2}, {5,4,2}, {7,6,2} }
+};
+//------------------------------------------------------------------------------
+const int DualContouring::mFaceProcEdgeMask[3][4][6] = {
+  { {1,4,0,5,1,1}, {1,6,2,7,3,1}, {0,4,6,0,2,2}, {0,5,7,1,3,2} },
+  { {0,2,3,0,1,0}, {0,6,7,4,5,0}, {1,2,0,6,4,2}, {1,3,1,7,5,2} },
+  { {1,1,0,3,2,0}, {1,5,4,7,6,0}, {0,1,5,0,4,1}, {0,3,7,2,6,1} }
+};
+//------------------------------------------------------------------------------
+const int DualContouring::mEdgeProcEdgeMask[3][2][5] = {
+  { {3,2,1,0,0}, {7,6,5,4,0} },
+  { {5,1,4,0,1}, {7,3,6,2,1} },
+  { {6,4,2,0,2}, {7,5,3,1,2} }
+};
+//------------------------------------------------------------------------------
+const int DualContouring::mProcessEdgeMask[3][4] = {
+  {3,2,1,0}, {7,5,6,4}, {11,10,9,8}
+};
+//------------------------------------------------------------------------------
@@ -0,0 +1,196 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#ifndef DualContouring_INCLUDE_ONCE
+#define DualContouring_INCLUDE_ONCE
+
+#include <vlVolume/MarchingCubes.hpp>
+#include <vector>
+
+namespace vl
+{
+  //------------------------------------------------------------------------------
+  // DualContouring
+  //------------------------------------------------------------------------------
+  /**
+   * Adaptive isosurface extraction using Dual Contouring over an octree, see T. Ju et al., "Dual Contouring of Hermite Data".
+   *
+   * The volumes are given using the same Volume and VolumeInfo objects used by MarchingCubes. Each cube crossed by the
+   * isosurface generates a single vertex placed by minimizing the quadratic error function (QEF) of the tangent planes
+   * at the intersections of the isosurface with the edges of the cube, which preserves sharp features. The cubes are
+   * then merged bottom-up into larger octree cells as long as the QEF error stays below errorTolerance() and the sign
+   * configuration of the cell is topologically safe, so that flat and smooth regions generate much fewer triangles than
+   * MarchingCubes, which emits a uniformly dense mesh.
+   *
+   * The blocks of the min/max pyramid of each Volume containing the isosurface are processed concurrently by up to
+   * parallelThreadCount() threads, see also Volume::findActiveBlocks(). The normals are computed from the gradient of
+   * the volume and point in the same direction as the ones generated by MarchingCubes.
+   *
+   * Example:
+   * \code
+   * DualContouring dc;
+   * dc.volumeInfo()->push_back( new VolumeInfo( volume.get(), threshold ) );
+   * dc.setErrorTolerance(0.01f);
+   * dc.run(false);
+   * geom->setVertexArray(dc.mVertsArray.get());
+   * geom->setNormalArray(dc.mNormsArray.get());
+   * geom->drawCalls().push_back(dc.mDrawElements.get());
+   * \endcode
+   */
+  class VLVOLUME_EXPORT DualContouring
+  {
+  public:
+    DualContouring();
+
+    //! Extracts the isosurfaces of all the volumes in volumeInfo() into mVertsArray, mNormsArray, mColorArray and mDrawElements.
+    void run(bool generate_colors);
+
+    void reset();
+
+    const Collection<VolumeInfo>* volumeInfo() const { return &mVolumeInfo; }
+    Collection<VolumeInfo>* volumeInfo() { return &mVolumeInfo; }
+
+    /** The maximum QEF error of a merged cell, that is the sum of the squared distances of its vertex from the tangent
+        planes of the isosurface, measured in cubes. 0 merges only the cells whose tangent planes meet exactly in a point,
+        a line or a plane, larger values generate fewer triangles. Default value: 0.01. */
+    void setErrorTolerance(float tol) { mErrorTolerance = tol; }
+    //! The maximum QEF error of a merged cell, see setErrorTolerance().
+    float errorTolerance() const { return mErrorTolerance; }
+
+    //! The maximum size in cubes of a merged cell, limits the size of the generated triangles. Default value: 64.
+    void setMaxCellSize(int size) { mMaxCellSize = size; }
+    //! The maximum size in cubes of a merged cell.
+    int maxCellSize() const { return mMaxCellSize; }
+
+    //! If \p true (default) the blocks of the volumes are processed concurrently by up to parallelThreadCount() threads.
+    //! The generated vertices and triangles are identical to the ones generated using a single thread.
+    void setMultithreaded(bool on) { mMultithreaded = on; }
+    //! If \p true (default) the blocks of the volumes are processed concurrently.
+    bool multithreaded() const { return mMultithreaded; }
+
+  public:
+    ref<ArrayFloat3> mVertsArray;
+    ref<ArrayFloat3> mNormsArray;
+    ref<ArrayFloat4> mColorArray;
+
+    // OpenGL ES does not support DrawElementsUInt
+#if defined(VL_OPENGL)
+    ref<DrawElementsUInt> mDrawElements;
+#else
+    ref<DrawElementsUShort> mDrawElements;
+#endif
+
+  private:
+#if defined(VL_OPENGL)
+    typedef unsigned int IndexType;
+#else
+    typedef unsigned short IndexType;
+#endif
+
+    //! The quadratic error function of a cell, accumulated in cube units.
+    struct QEF
+    {
+      QEF();
+      void addPlane(const fvec3& p, const fvec3& n);
+      void addPoint(const fvec3& p);
+      void add(const QEF& other);
+      //! Computes the point minimizing the error, using the mass point along the poorly constrained directions, and returns the error.
+      float solve(fvec3& x) const;
+      fvec3 massPoint() const;
+
+      double mATA[6];
+      double mATb[3];
+      double mBtB;
+      double mMassPoint[3];
+      int mPointCount;
+    };
+
+    enum ENodeType { NT_Internal, NT_Leaf, NT_Collapsed };
+
+    //! An octree cell, its corners and children are ordered as (x<<2 | y<<1 | z).
+    struct Node
+    {
+      Node(): mType(NT_Internal), mSize(0), mCorners(0), mIndex(-1) { memset(mChildren, 0, sizeof(mChildren)); }
+      Node* mChildren[8];
+      ivec3 mMin;
+      int mType;
+      int mSize;
+      //! Bit \p i is set if the value at corner \p i is below the threshold.
+      int mCorners;
+      int mIndex;
+      fvec3 mPosition;
+      fvec3 mNormal;
+      QEF mQEF;
+    };
+    struct BlocksTask;
+
+  protected:
+    Node* buildBlock(const Volume* vol, float threshold, int block, std::vector<Node>& nodes);
+    Node* buildNode(const Volume* vol, float threshold, const unsigned char* corners, const ivec3& block_min, const ivec3& min, int size, std::vector<Node>& nodes);
+    Node* buildLeaf(const Volume* vol, float threshold, const ivec3& min, int corners, std::vector<Node>& nodes);
+    Node* buildTree(const Volume* vol, float threshold, const ivec3& min, int size);
+    void collapse(const Volume* vol, float threshold, Node* node);
+    void generateVertices(const Volume* vol, Node* node);
+    void contourCell(const Node* node);
+    void contourFace(const Node* node0, const Node* node1, int dir);
+    void contourEdge(const Node* node[4], int dir);
+    void processEdge(const Node* node[4], int dir);
+    void updateArrays(bool generate_colors);
+
+  private:
+    std::vector<fvec3> mVerts;
+    std::vector<fvec3> mNorms;
+    std::vector<fvec4> mColors;
+    std::vector<IndexType> mIndices;
+    std::vector<int> mActiveBlockList;
+    std::vector<Node*> mBlockRoots;
+    std::vector< std::vector<Node> > mBlockNodes;
+    std::vector<Node> mNodes;
+    Collection<VolumeInfo> mVolumeInfo;
+    float mErrorTolerance;
+    int mMaxCellSize;
+    bool mMultithreaded;
+
+  protected:
+    static const int mCornerOffset[8][3];
+    static const int mEdgeCorners[12][2];
+    static const int mCellProcFaceMask[12][3];
+    static const int mCellProcEdgeMask[6][5];
+    static const int mFaceProcFaceMask[3][4][3];
+    static const int mFaceProcEdgeMask[3][4][6];
+    static const int mEdgeProcEdgeMask[3][2][5];
+    static const int mProcessEdgeMask[3][4];
+  };
+  //------------------------------------------------------------------------------
+}
+
+#endif
@@ -34,6 +34,10 @@
 #include <vlVolume/MarchingCubes.hpp>
 #include <vlCore/Time.hpp>
 #include <vlGraphics/DoubleVertexRemover.hpp>
+#include <vlCore/Thread.hpp>
+#include <vlCore/ScopedMutex.hpp>
+#include <limits>
+#include <algorithm>
 
 using namespace vl;
 
@@ -71,16 +75,67 @@ MarchingCubes::MarchingCubes()
 #endif
   mVolumeInfo.setAutomaticDelete(false);
   mHighQualityNormals = true;
+  mGradientNormals = false;
+  mMultithreaded = true;
+  mProgressiveThread = NULL;
+  mProgressiveLevel = 0;
+  mProgressiveColors = false;
+}
+//------------------------------------------------------------------------------
+MarchingCubes::~MarchingCubes()
+{
+  stopRefinement();
 }
 //------------------------------------------------------------------------------
 // MarchingCubes
 //------------------------------------------------------------------------------
-void MarchingCubes::computeEdges(Volume* vol, float threshold)
+int MarchingCubes::computeEdgeVertex(Volume* vol, float threshold, int x, int y, int z, int axis, std::vector<fvec3>& verts, std::vector<fvec3>& norms)
+{
+  int x1 = x + (axis == 0 ? 1 : 0);
+  int y1 = y + (axis == 1 ? 1 : 0);
+  int z1 = z + (axis == 2 ? 1 : 0);
+  float v0 = vol->value( x, y, z );
+  float v1 = vol->value( x1, y1, z1 );
+  if (v1 == v0)
+    return -1;
+  //if (t>=0 && t<=1.0f)
+  if ( !((threshold>=v0 && threshold<=v1) || (threshold>=v1 && threshold<=v0)) )
+    return -1;
+  float t = (threshold-v0)/(v1-v0);
+  VL_CHECK(t>=-0.001f && t<=1.001f)
+  // emit vertex
+  int ivert = (int)verts.size();
+  // compute vertex and normal position
+  verts.push_back( vol->coordinate(x, y, z) * (1.0f-t) + vol->coordinate(x1, y1, z1) * t );
+  if (mGradientNormals)
+  {
+    fvec3 n;
+    vol->normalFromGradient(n, x, y, z, axis, t);
+    norms.push_back(n);
+  }
+  else
+  if (mHighQualityNormals)
+  {
+    const float dx = vol->cellSize().x() * 0.25f;
+    const float dy = vol->cellSize().y() * 0.25f;
+    const float dz = vol->cellSize().z() * 0.25f;
+    fvec3 n;
+    vol->normalHQ(n, verts.back(), dx, dy, dz);
+    norms.push_back(n);
+  }
+  return ivert;
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::computeEdges(Volume* vol, float threshold, Slab& slab)
 {
-  // mEdges.clear();
-  mEdges.resize(vol->slices().x() * vol->slices().y() * vol->slices().z());
-  mCubes.clear();
-  mCubes.reserve(1024);
+  std::vector<fvec3>& verts = slab.mVerts;
+  std::vector<fvec3>& norms = slab.mNorms;
+  std::vector<usvec3>& cubes = slab.mCubes;
+  verts.clear();
+  norms.clear();
+  cubes.clear();
+  if (mActiveBlockRows.empty())
+    return;
 
   /////////////////////////////////////////////////////////////////////////////////
   // note: this funtion can generate double vertices when the 't' is 0.0 or 1.0
@@ -89,116 +144,52 @@ void MarchingCubes::computeEdges(Volume* vol, float threshold)
   // Geometry::computeNormals() which is much quicker than computing the gradient.
   /////////////////////////////////////////////////////////////////////////////////
 
-  const float dx = vol->cellSize().x() * 0.25f;
-  const float dy = vol->cellSize().y() * 0.25f;
-  const float dz = vol->cellSize().z() * 0.25f;
-  float v0, v1, v2, v3, t;
-  int iedge = 0;
   int w = vol->slices().x() -1;
   int h = vol->slices().y() -1;
   int d = vol->slices().z() -1;
-  for(unsigned short z = 0; z < vol->slices().z(); ++z)
+  const ivec3& block_count = vol->blockCount();
+  for(int z = slab.mZ0; z < slab.mZ1; ++z)
   {
-    for(unsigned short y = 0; y < vol->slices().y(); ++y)
+    // the cells on the far border of the volume belong to the last block
+    int bz = std::min( z / (int)Volume::BlockSize, block_count.z()-1 );
+    for(int y = 0; y < vol->slices().y(); ++y)
     {
-      for(unsigned short x = 0; x < vol->slices().x(); ++x, ++iedge)
+      int by = std::min( y / (int)Volume::BlockSize, block_count.y()-1 );
+      if (!mActiveBlockRows[by + block_count.y()*bz])
+        continue;
+      const unsigned char* active_blocks = &mActiveBlocks[ block_count.x() * (by + block_count.y()*bz) ];
+      for(int x = 0; x < vol->slices().x(); ++x)
       {
+        // skip the blocks which don't contain the isosurface
+        int bx = std::min( x / (int)Volume::BlockSize, block_count.x()-1 );
+        if (!active_blocks[bx])
+        {
+          x = bx == block_count.x()-1 ? vol->slices().x() : (bx+1) * Volume::BlockSize - 1;
+          continue;
+        }
+
+        int iedge = x + vol->slices().x()*y + vol->slices().x()*vol->slices().y()*z;
         if (x != w && y != h && z != d)
         {
           if (vol->cube(x,y,z).includes(threshold))
-          {
-            if (mCubes.capacity()-mCubes.size() == 0)
-              mCubes.reserve(mCubes.size()*2);
-            mCubes.push_back( usvec3(x,y,z) );
-          }
+            cubes.push_back( usvec3((unsigned short)x, (unsigned short)y, (unsigned short)z) );
           else
             continue;
         }
 
-        if (mVerts.capacity() - mVerts.size() == 0)
-        {
-          mVerts.reserve( mVerts.size() * 2 );
-          mNorms.reserve( mNorms.size() * 2 );
-        }
-
-        v0 = vol->value( x,y,z );
-        fvec3 v0_coord = vol->coordinate(x, y, z);
-
+        mEdges[iedge] = Edge();
         if (x != w)
-        {
-          v1 = vol->value( x + 1, y, z );
-          if (v1!=v0)
-          {
-            //if (t>=0 && t<=1.0f)
-            if ( (threshold>=v0 && threshold<=v1) || (threshold>=v1 && threshold<=v0) )
-            {
-              t = (threshold-v0)/(v1-v0);
-              VL_CHECK(t>=-0.001f && t<=1.001f)
-              // emit vertex
-              mEdges[iedge].mX = (int)mVerts.size();
-              // compute vertex and normal position
-              mVerts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x + 1, y, z) * t );
-              if (mHighQualityNormals)
-              {
-                fvec3 n;
-                vol->normalHQ(n, mVerts.back(), dx, dy, dz);
-                mNorms.push_back(n);
-              }
-            }
-          }
-        }
+          mEdges[iedge].mX = computeEdgeVertex(vol, threshold, x, y, z, 0, verts, norms);
         if (y != h)
-        {
-          v2 = vol->value( x, y + 1, z );
-          if (v2!=v0)
-          {
-            //if (t>=0 && t<=1.0f)
-            if ( (threshold>=v0 && threshold<=v2) || (threshold>=v2 && threshold<=v0) )
-            {
-              t = (threshold-v0)/(v2-v0);
-              VL_CHECK(t>=-0.001f && t<=1.001f)
-              // emit vertex
-              mEdges[iedge].mY = (int)mVerts.size();
-              // compute vertex and normal position
-              mVerts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x, y + 1, z) * t );
-              if (mHighQualityNormals)
-              {
-                fvec3 n;
-                vol->normalHQ(n, mVerts.back(), dx, dy, dz);
-                mNorms.push_back(n);
-              }
-            }
-          }
-        }
+          mEdges[iedge].mY = computeEdgeVertex(vol, threshold, x, y, z, 1, verts, norms);
         if (z != d)
-        {
-          v3 = vol->value( x, y, z + 1 );
-          if (v3!=v0)
-          {
-            //if (t>=0 && t<=1.0f)
-            if ( (threshold>=v0 && threshold<=v3) || (threshold>=v3 && threshold<=v0) )
-            {
-              t = (threshold-v0)/(v3-v0);
-              VL_CHECK(t>=-0.001f && t<=1.001f)
-              // emit vertex
-              mEdges[iedge].mZ = (int)mVerts.size();
-              // compute vertex and normal position
-              mVerts.push_back( v0_coord * (1.0f-t) + vol->coordinate(x, y, z + 1) * t );
-              if (mHighQualityNormals)
-              {
-                fvec3 n;
-                vol->normalHQ(n, mVerts.back(), dx, dy, dz);
-                mNorms.push_back(n);
-              }
-            }
-          }
-        }
+          mEdges[iedge].mZ = computeEdgeVertex(vol, threshold, x, y, z, 2, verts, norms);
       }
     }
   }
 }
 //------------------------------------------------------------------------------
-void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshold)
+void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshold, const Edge* edges, int stride_y, int stride_z, int vert0_z0, int vert0_z1, std::vector<IndexType>& indices)
 {
   int inner_corners = 0;
 
@@ -216,53 +207,42 @@ void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshol
   if(cut_edges == 0)
     return;
 
-  /*
-  int cell0 = x     + y * vol->slices().x()     + z * vol->slices().x()*vol->slices().y();
-  int cell1 = (x+1) + y * vol->slices().x()     + z * vol->slices().x()*vol->slices().y();
-  int cell2 = (x+1) + y * vol->slices().x()     + (z+1) * vol->slices().x()*vol->slices().y();
-  int cell3 = x     + y * vol->slices().x()     + (z+1) * vol->slices().x()*vol->slices().y();
-  int cell4 = (x+1) + (y+1) * vol->slices().x() + z * vol->slices().x()*vol->slices().y();
-  int cell5 = x     + (y+1) * vol->slices().x() + z * vol->slices().x()*vol->slices().y();
-  int cell6 = x     + (y+1) * vol->slices().x() + (z+1) * vol->slices().x()*vol->slices().y();
-  */
-
-  int z0 = z * vol->slices().x()*vol->slices().y();
-  int z1 = (z+1) * vol->slices().x()*vol->slices().y();
-  int y0 = y * vol->slices().x();
-  int y1 = (y+1) * vol->slices().x();
-
-  int cell0 = x     + y0 + z0;
-  int cell1 = (x+1) + y0 + z0;
-  int cell2 = (x+1) + y0 + z1;
-  int cell3 = x     + y0 + z1;
-  int cell4 = (x+1) + y1 + z0;
-  int cell5 = x     + y1 + z0;
-  int cell6 = x     + y1 + z1;
+  int cell0 = 0;
+  int cell1 = 1;
+  int cell2 = 1 + stride_z;
+  int cell3 = stride_z;
+  int cell4 = 1 + stride_y;
+  int cell5 = stride_y;
+  int cell6 = stride_y + stride_z;
 
   int edge_ivert[12] =
   {
-    mEdges[cell0].mX,
-    mEdges[cell1].mY,
-    mEdges[cell5].mX,
-    mEdges[cell0].mY,
+    edges[cell0].mX,
+    edges[cell1].mY,
+    edges[cell5].mX,
+    edges[cell0].mY,
 
-    mEdges[cell3].mX,
-    mEdges[cell2].mY,
-    mEdges[cell6].mX,
-    mEdges[cell3].mY,
+    edges[cell3].mX,
+    edges[cell2].mY,
+    edges[cell6].mX,
+    edges[cell3].mY,
 
-    mEdges[cell0].mZ,
-    mEdges[cell1].mZ,
-    mEdges[cell4].mZ,
-    mEdges[cell5].mZ,
+    edges[cell0].mZ,
+    edges[cell1].mZ,
+    edges[cell4].mZ,
+    edges[cell5].mZ,
   };
 
+  // convert the slab relative indices to absolute ones, the cells at z+1 might belong to the next slab
+  for(int i=0; i<12; ++i)
+  {
+    if (edge_ivert[i] >= 0)
+      edge_ivert[i] += (i >= 4 && i < 8) ? vert0_z1 : vert0_z0;
+  }
+
   int ivertex;
   for(int icorner = 0; mTriangleConnectionTable[inner_corners][icorner]>=0; icorner+=3)
   {
-    if (mIndices.capacity() - mIndices.size() == 0)
-      mIndices.reserve( mIndices.size()*2 );
-
     ivertex = mTriangleConnectionTable[inner_corners][icorner+0];
     int a = edge_ivert[ivertex];
 
@@ -288,14 +268,130 @@ void MarchingCubes::processCube(int x, int y, int z, Volume* vol, float threshol
         continue;
     #endif
 
-    mIndices.push_back((IndexType)a);
-    mIndices.push_back((IndexType)b);
-    mIndices.push_back((IndexType)c);
+    indices.push_back((IndexType)a);
+    indices.push_back((IndexType)b);
+    indices.push_back((IndexType)c);
+  }
+}
+//------------------------------------------------------------------------------
+struct MarchingCubes::EdgesTask: public ParallelForTask
+{
+  EdgesTask(MarchingCubes* mc, Volume* vol, float threshold): mMC(mc), mVolume(vol), mThreshold(threshold) {}
+
+  virtual void runRange(int begin, int end)
+  {
+    for(int i=begin; i<end; ++i)
+      mMC->computeEdges(mVolume, mThreshold, mMC->mSlabs[i]);
+  }
+
+  MarchingCubes* mMC;
+  Volume* mVolume;
+  float mThreshold;
+};
+//------------------------------------------------------------------------------
+struct MarchingCubes::CubesTask: public ParallelForTask
+{
+  CubesTask(MarchingCubes* mc, Volume* vol, float threshold): mMC(mc), mVolume(vol), mThreshold(threshold) {}
+
+  virtual void runRange(int begin, int end)
+  {
+    const int stride_y = mVolume->slices().x();
+    const int stride_z = mVolume->slices().x() * mVolume->slices().y();
+    for(int i=begin; i<end; ++i)
+    {
+      Slab& slab = mMC->mSlabs[i];
+      slab.mIndices.clear();
+      // the z->y->x order of the cubes is important in order to minimize cache misses
+      for(unsigned int j=0; j<slab.mCubes.size(); ++j)
+      {
+        const usvec3& c = slab.mCubes[j];
+        int vert0_z1 = c.z()+1 < slab.mZ1 ? slab.mVert0 : mMC->mSlabs[i+1].mVert0;
+        const Edge* edges = &mMC->mEdges[ c.x() + stride_y*c.y() + stride_z*c.z() ];
+        mMC->processCube(c.x(), c.y(), c.z(), mVolume, mThreshold, edges, stride_y, stride_z, slab.mVert0, vert0_z1, slab.mIndices);
+      }
+    }
+  }
+
+  MarchingCubes* mMC;
+  Volume* mVolume;
+  float mThreshold;
+};
+//------------------------------------------------------------------------------
+struct MarchingCubes::ChunksTask: public ParallelForTask
+{
+  ChunksTask(MarchingCubes* mc, Volume* vol, float threshold, ChunkSet& chunk_set): mMC(mc), mVolume(vol), mThreshold(threshold), mChunkSet(chunk_set) {}
+
+  virtual void runRange(int begin, int end)
+  {
+    for(int i=begin; i<end; ++i)
+    {
+      int block = mMC->mDirtyChunks[i];
+      mMC->extractBlock(mVolume, mThreshold, block, mChunkSet.mChunks[block]);
+    }
+  }
+
+  MarchingCubes* mMC;
+  Volume* mVolume;
+  float mThreshold;
+  ChunkSet& mChunkSet;
+};
+//------------------------------------------------------------------------------
+void MarchingCubes::extractBlock(Volume* vol, float threshold, int block, Chunk& chunk)
+{
+  chunk.mVerts.clear();
+  chunk.mNorms.clear();
+  chunk.mIndices.clear();
+
+  const ivec3& block_count = vol->blockCount();
+  ivec3 min_cube( block % block_count.x(), (block / block_count.x()) % block_count.y(), block / (block_count.x() * block_count.y()) );
+  min_cube *= (int)Volume::BlockSize;
+  ivec3 max_cube;
+  for(int i=0; i<3; ++i)
+    max_cube[i] = std::min( min_cube[i] + (int)Volume::BlockSize, vol->slices()[i]-1 );
+
+  // the edge table covers the cubes of the block plus the cells on its far faces, whose edges are 
+  // computed also by the adjacent blocks so that each chunk is self contained
+  const int sx = max_cube.x() - min_cube.x() + 1;
+  const int sy = max_cube.y() - min_cube.y() + 1;
+  const int sz = max_cube.z() - min_cube.z() + 1;
+  std::vector<Edge> edges(sx * sy * sz);
+  std::vector<int> cubes;
+  for(int z = min_cube.z(); z <= max_cube.z(); ++z)
+  {
+    for(int y = min_cube.y(); y <= max_cube.y(); ++y)
+    {
+      for(int x = min_cube.x(); x <= max_cube.x(); ++x)
+      {
+        int iedge = (x - min_cube.x()) + sx * (y - min_cube.y()) + sx * sy * (z - min_cube.z());
+        if (x != max_cube.x() && y != max_cube.y() && z != max_cube.z())
+        {
+          if (vol->cube(x,y,z).includes(threshold))
+            cubes.push_back(iedge);
+          else
+            continue;
+        }
+        if (x != max_cube.x())
+          edges[iedge].mX = computeEdgeVertex(vol, threshold, x, y, z, 0, chunk.mVerts, chunk.mNorms);
+        if (y != max_cube.y())
+          edges[iedge].mY = computeEdgeVertex(vol, threshold, x, y, z, 1, chunk.mVerts, chunk.mNorms);
+        if (z != max_cube.z())
+          edges[iedge].mZ = computeEdgeVertex(vol, threshold, x, y, z, 2, chunk.mVerts, chunk.mNorms);
+      }
+    }
+  }
+
+  for(unsigned i=0; i<cubes.size(); ++i)
+  {
+    int x = min_cube.x() + cubes[i] % sx;
+    int y = min_cube.y() + (cubes[i] / sx) % sy;
+    int z = min_cube.z() + cubes[i] / (sx * sy);
+    processCube(x, y, z, vol, threshold, &edges[cubes[i]], sx, sx * sy, 0, 0, chunk.mIndices);
   }
 }
 //------------------------------------------------------------------------------
 void MarchingCubes::reset()
 {
+  stopRefinement();
   mVertsArray->clear();
   mNormsArray->clear();
   mColorArray->clear();
@@ -304,13 +400,20 @@ void MarchingCubes::reset()
   mVerts.clear();
   mNorms.clear();
   mColors.clear();
-  mCubes.clear();
+  mSlabs.clear();
   mEdges.clear();
+  mActiveBlockList.clear();
+  mActiveBlocks.clear();
+  mActiveBlockRows.clear();
+  mChunkSets.clear();
+  mDirtyChunks.clear();
   mVolumeInfo.clear();
 }
 //------------------------------------------------------------------------------
 void MarchingCubes::run(bool generate_colors)
 {
+  stopRefinement();
+  mProgressiveLevel = 0;
   mVerts.clear();
   mNorms.clear();
   mIndices.clear();
@@ -327,22 +430,147 @@ void MarchingCubes::run(bool generate_colors)
     float threshold = mVolumeInfo.at(ivol)->threshold();
     int start       = (int)mVerts.size();
 
-    if (vol->dataIsDirty())
-      vol->setupInternalData();
+    vol->updateInternalData();
+    if (mGradientNormals && vol->gradientIsDirty())
+      vol->setupGradient();
+
+    // flag the blocks containing the isosurface
+    vol->findActiveBlocks(threshold, mActiveBlockList);
+    const ivec3& block_count = vol->blockCount();
+    mActiveBlocks.assign(block_count.x() * block_count.y() * block_count.z(), 0);
+    mActiveBlockRows.assign(block_count.y() * block_count.z(), 0);
+    for(unsigned i=0; i<mActiveBlockList.size(); ++i)
+    {
+      mActiveBlocks[ mActiveBlockList[i] ] = 1;
+      mActiveBlockRows[ mActiveBlockList[i] / block_count.x() ] = 1;
+    }
+
+    // split the volume in slabs along z, each slab computes the edges and the cubes of its own slices
+    int slab_count = 1;
+    if (multithreaded() && parallelThreadCount() > 1)
+      slab_count = std::min( vol->slices().z(), parallelThreadCount() * 4 );
+    mSlabs.resize(slab_count);
+    for(int i=0; i<slab_count; ++i)
+    {
+      mSlabs[i].mZ0 = vol->slices().z() * i / slab_count;
+      mSlabs[i].mZ1 = vol->slices().z() * (i+1) / slab_count;
+    }
+    mEdges.resize(vol->slices().x() * vol->slices().y() * vol->slices().z());
 
     // note: this function takes the 90% of the time
-    computeEdges(vol, threshold);
+    EdgesTask edges_task(this, vol, threshold);
+    parallelFor(0, slab_count, &edges_task, 1);
+
+    // the vertices of the slabs are stitched in order, so that the result is the same as processing the volume in one go
+    int vert_count = start;
+    for(int i=0; i<slab_count; ++i)
+    {
+      mSlabs[i].mVert0 = vert_count;
+      vert_count += (int)mSlabs[i].mVerts.size();
+    }
 
     // note: this loop takes the remaining 10% of the time
-    //// the z->y->x order is important in order to minimize cache misses
-    //for(int z = 0; z < mVolume->slices().z()-1; ++z)
-    //  for(int y = 0; y < mVolume->slices().y()-1; ++y)
-    //    for(int x = 0; x < mVolume->slices().x()-1; ++x)
-    //      if(vol->cube(x,y,z).includes(threshold))
-    //        processCube(x, y, z, vol, threshold);
+    CubesTask cubes_task(this, vol, threshold);
+    parallelFor(0, slab_count, &cubes_task, 1);
+
+    mVerts.resize(vert_count);
+    if (mHighQualityNormals || mGradientNormals)
+      mNorms.resize(vert_count);
+    size_t index_count = mIndices.size();
+    for(int i=0; i<slab_count; ++i)
+      index_count += mSlabs[i].mIndices.size();
+    mIndices.reserve(index_count);
+    for(int i=0; i<slab_count; ++i)
+    {
+      const Slab& slab = mSlabs[i];
+      std::copy(slab.mVerts.begin(), slab.mVerts.end(), mVerts.begin() + slab.mVert0);
+      std::copy(slab.mNorms.begin(), slab.mNorms.end(), mNorms.begin() + slab.mVert0);
+      mIndices.insert(mIndices.end(), slab.mIndices.begin(), slab.mIndices.end());
+    }
+
+    int count = (int)mVerts.size() - start;
+    mVolumeInfo.at(ivol)->setVert0(start);
+    mVolumeInfo.at(ivol)->setVertC(count);
+
+    // fill color array
+    if (generate_colors)
+    {
+      mColors.resize( mVerts.size() );
+      for(int i=start; i<start+count; ++i)
+        mColors[i] = mVolumeInfo.at(ivol)->color();
+    }
+  }
+
+  updateArrays(generate_colors);
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::update(bool generate_colors)
+{
+  stopRefinement();
+  mProgressiveLevel = 0;
+  mVerts.clear();
+  mNorms.clear();
+  mIndices.clear();
+  mChunkSets.resize(mVolumeInfo.size());
+
+  for(int ivol=0; ivol<mVolumeInfo.size(); ++ivol)
+  {
+    Volume* vol     = mVolumeInfo.at(ivol)->volume();
+    float threshold = mVolumeInfo.at(ivol)->threshold();
+    int start       = (int)mVerts.size();
+
+    vol->updateInternalData();
+    if (mGradientNormals && vol->gradientIsDirty())
+      vol->setupGradient();
+
+    // start from scratch if the chunks were extracted with different parameters
+    ChunkSet& chunk_set = mChunkSets[ivol];
+    const ivec3& block_count = vol->blockCount();
+    if ( chunk_set.mVolume.get() != vol || chunk_set.mThreshold != threshold || chunk_set.mBlockCount != block_count || 
+         chunk_set.mHighQualityNormals != mHighQualityNormals || chunk_set.mGradientNormals != mGradientNormals )
+    {
+      chunk_set.mVolume = vol;
+      chunk_set.mThreshold = threshold;
+      chunk_set.mBlockCount = block_count;
+      chunk_set.mHighQualityNormals = mHighQualityNormals;
+      chunk_set.mGradientNormals = mGradientNormals;
+      chunk_set.mChunks.clear();
+      chunk_set.mChunks.resize( block_count.x() * block_count.y() * block_count.z() );
+    }
+
+    // re-extract the blocks marked dirty since the last update
+    mDirtyChunks.clear();
+    for(int i=0; i<(int)chunk_set.mChunks.size(); ++i)
+    {
+      Chunk& chunk = chunk_set.mChunks[i];
+      if (chunk.mStamp == vol->blockStamp(i))
+        continue;
+      chunk.mStamp = vol->blockStamp(i);
+      if (vol->block(i).includes(threshold))
+        mDirtyChunks.push_back(i);
+      else
+      {
+        chunk.mVerts.clear();
+        chunk.mNorms.clear();
+        chunk.mIndices.clear();
+      }
+    }
+    ChunksTask chunks_task(this, vol, threshold, chunk_set);
+    if (multithreaded())
+      parallelFor(0, (int)mDirtyChunks.size(), &chunks_task, 1);
+    else
+      chunks_task.runRange(0, (int)mDirtyChunks.size());
 
-    for(unsigned int i=0; i<mCubes.size(); ++i)
-      processCube(mCubes[i].x(), mCubes[i].y(), mCubes[i].z(), vol, threshold);
+    // stitch the chunks
+    for(unsigned i=0; i<chunk_set.mChunks.size(); ++i)
+    {
+      const Chunk& chunk = chunk_set.mChunks[i];
+      int vert0 = (int)mVerts.size();
+      mVerts.insert(mVerts.end(), chunk.mVerts.begin(), chunk.mVerts.end());
+      mNorms.insert(mNorms.end(), chunk.mNorms.begin(), chunk.mNorms.end());
+      for(unsigned j=0; j<chunk.mIndices.size(); ++j)
+        mIndices.push_back( (IndexType)(chunk.mIndices[j] + vert0) );
+    }
 
     int count = (int)mVerts.size() - start;
     mVolumeInfo.at(ivol)->setVert0(start);
@@ -357,6 +585,11 @@ void MarchingCubes::run(bool generate_colors)
     }
   }
 
+  updateArrays(generate_colors);
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::updateArrays(bool generate_colors)
+{
   mVertsArray->resize(mVerts.size());
   mVertsArray->setBufferObjectDirty();
   if (mVerts.size())
@@ -382,7 +615,7 @@ void MarchingCubes::run(bool generate_colors)
   if (mIndices.size())
     memcpy(mDrawElements->indexBuffer()->ptr(), &mIndices[0], sizeof(mIndices[0]) * mIndices.size());
 
-  if (!mHighQualityNormals)
+  if (!mHighQualityNormals && !mGradientNormals)
   {
     ref<Geometry> geom = new Geometry;
     geom->setVertexArray(mVertsArray.get());
@@ -395,6 +628,164 @@ void MarchingCubes::run(bool generate_colors)
   }
 }
 //------------------------------------------------------------------------------
+//! Extracts the levels of runProgressive() from the finest but one to the full resolution.
+//! All the objects are created and destroyed by the thread calling runProgressive(), since reference counting is not thread safe.
+struct MarchingCubes::ProgressiveThread: public Thread
+{
+  ProgressiveThread(): mReadyLevel(-1), mCancel(false) {}
+
+  ~ProgressiveThread()
+  {
+    mCancel = true;
+    join();
+    for(size_t i=0; i<mLevels.size(); ++i)
+      delete mLevels[i];
+  }
+
+  virtual void run()
+  {
+    for(int level=(int)mLevels.size()-2; level>=0 && !mCancel; --level)
+    {
+      mLevels[level]->run(mGenerateColors);
+      ScopedMutex lock(&mMutex);
+      mReadyLevel = level;
+    }
+  }
+
+  int readyLevel()
+  {
+    ScopedMutex lock(&mMutex);
+    return mReadyLevel;
+  }
+
+  std::vector<MarchingCubes*> mLevels;
+  std::vector< ref<Volume> > mVolumes;
+  std::vector< ref<VolumeInfo> > mVolumeInfo;
+  Mutex mMutex;
+  int mReadyLevel;
+  volatile bool mCancel;
+  bool mGenerateColors;
+};
+//------------------------------------------------------------------------------
+void MarchingCubes::runProgressive(bool generate_colors, int level_count)
+{
+  stopRefinement();
+  if (level_count < 1)
+    level_count = 1;
+
+  ProgressiveThread* thread = new ProgressiveThread;
+  thread->mGenerateColors = generate_colors;
+  thread->mLevels.resize(level_count);
+  for(int level=0; level<level_count; ++level)
+  {
+    MarchingCubes* mc = new MarchingCubes;
+    mc->setHighQualityNormals(mHighQualityNormals);
+    mc->setGradientNormals(mGradientNormals);
+    mc->setMultithreaded(mMultithreaded);
+    thread->mLevels[level] = mc;
+  }
+
+  // the volumes with fewer levels repeat their coarsest one
+  for(int ivol=0; ivol<mVolumeInfo.size(); ++ivol)
+  {
+    VolumeInfo* info = mVolumeInfo.at(ivol);
+    std::vector< ref<Volume> > pyramid;
+    info->volume()->downsamplePyramid(level_count-1, pyramid);
+    thread->mVolumes.insert(thread->mVolumes.end(), pyramid.begin(), pyramid.end());
+    for(int level=0; level<level_count; ++level)
+    {
+      int i = std::min(level, (int)pyramid.size());
+      ref<VolumeInfo> level_info = new VolumeInfo(i ? pyramid[i-1].get() : info->volume(), info->threshold(), info->color());
+      thread->mLevels[level]->volumeInfo()->push_back(level_info.get());
+      thread->mVolumeInfo.push_back(level_info);
+    }
+  }
+
+  // the preview
+  thread->mLevels.back()->run(generate_colors);
+  copyArrays(*thread->mLevels.back(), generate_colors);
+  mProgressiveLevel = level_count-1;
+  mProgressiveColors = generate_colors;
+
+  if (level_count == 1)
+  {
+    delete thread;
+    return;
+  }
+
+  mProgressiveThread = thread;
+  if (!thread->start())
+  {
+    // refine synchronously if the thread could not be started
+    thread->run();
+    updateProgressive();
+  }
+}
+//------------------------------------------------------------------------------
+bool MarchingCubes::updateProgressive()
+{
+  if (!mProgressiveThread)
+    return false;
+
+  int level = mProgressiveThread->readyLevel();
+  if (level < 0 || level >= mProgressiveLevel)
+    return false;
+
+  copyArrays(*mProgressiveThread->mLevels[level], mProgressiveColors);
+  mProgressiveLevel = level;
+
+  if (level == 0)
+    stopRefinement();
+
+  return true;
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::stopRefinement()
+{
+  delete mProgressiveThread;
+  mProgressiveThread = NULL;
+}
+//------------------------------------------------------------------------------
+void MarchingCubes::copyArrays(const MarchingCubes& mc, bool generate_colors)
+{
+  mVertsArray->resize(mc.mVertsArray->size());
+  mVertsArray->setBufferObjectDirty();
+  if (mVertsArray->size())
+    memcpy(mVertsArray->ptr(), mc.mVertsArray->ptr(), mVertsArray->bytesUsed());
+
+  mNormsArray->resize(mc.mNormsArray->size());
+  mNormsArray->setBufferObjectDirty();
+  if (mNormsArray->size())
+    memcpy(mNormsArray->ptr(), mc.mNormsArray->ptr(), mNormsArray->bytesUsed());
+
+  mDrawElements->indexBuffer()->resize(mc.mDrawElements->indexBuffer()->size());
+  mDrawElements->indexBuffer()->setBufferObjectDirty(true);
+  if (mDrawElements->indexBuffer()->size())
+    memcpy(mDrawElements->indexBuffer()->ptr(), mc.mDrawElements->indexBuffer()->ptr(), mDrawElements->indexBuffer()->bytesUsed());
+
+  for(int ivol=0; ivol<mVolumeInfo.size() && ivol<mc.mVolumeInfo.size(); ++ivol)
+  {
+    mVolumeInfo.at(ivol)->setVert0(mc.mVolumeInfo.at(ivol)->vert0());
+    mVolumeInfo.at(ivol)->setVertC(mc.mVolumeInfo.at(ivol)->vertC());
+  }
+
+  // fill color array
+  if (generate_colors)
+  {
+    mColorArray->resize(mVertsArray->size());
+    mColorArray->setBufferObjectDirty();
+    for(int ivol=0; ivol<mVolumeInfo.size(); ++ivol)
+    {
+      int start = mVolumeInfo.at(ivol)->vert0();
+      int count = mVolumeInfo.at(ivol)->vertC();
+      for(int i=start; i<start+count; ++i)
+        mColorArray->at(i) = mVolumeInfo.at(ivol)->color();
+    }
+  }
+  else
+    mColorArray->clear();
+}
+//------------------------------------------------------------------------------
 void MarchingCubes::updateColor(const fvec3& color, int volume_index)
 {
   if(volume_index>=mVolumeInfo.size())
@@ -458,9 +849,52 @@ void MarchingCubes::updateAlpha(float alpha, int volume_index)
 Volume::Volume()
 {
   VL_DEBUG_SET_OBJECT_NAME()
+  mStampCounter = 0;
   setup(NULL, false, false, fvec3(0,0,0), fvec3(1.0f,1.0f,1.0f), ivec3(50,50,50));
 }
 //------------------------------------------------------------------------------
+struct Volume::DownsampleTask: public ParallelForTask
+{
+  DownsampleTask(const Volume* src, Volume* dst): mSrc(src), mDst(dst) {}
+
+  virtual void runRange(int begin, int end)
+  {
+    const int w = mDst->slices().x();
+    const int h = mDst->slices().y();
+    // the last sample is repeated along the directions with a single slice
+    const int x_max = mSrc->slices().x()-1;
+    const int y_max = mSrc->slices().y()-1;
+    const int z_max = mSrc->slices().z()-1;
+    for(int z=begin; z<end; ++z)
+    {
+      int z1=z*2;
+      int z2=std::min(z*2+1, z_max);
+      for(int y=0; y<h; ++y)
+      {
+        int y1=y*2;
+        int y2=std::min(y*2+1, y_max);
+        for(int x=0; x<w; ++x)
+        {
+          int x1 = x*2;
+          int x2 = std::min(x*2+1, x_max);
+          float v0 = mSrc->value(x1,y1,z1);
+          float v1 = mSrc->value(x1,y1,z2);
+          float v2 = mSrc->value(x1,y2,z1);
+          float v3 = mSrc->value(x1,y2,z2);
+          float v4 = mSrc->value(x2,y1,z1);
+          float v5 = mSrc->value(x2,y1,z2);
+          float v6 = mSrc->value(x2,y2,z1);
+          float v7 = mSrc->value(x2,y2,z2);
+          mDst->value(x,y,z) = (v0+v1+v2+v3+v4+v5+v6+v7) * (1.0f/8.0f);
+        }
+      }
+    }
+  }
+
+  const Volume* mSrc;
+  Volume* mDst;
+};
+//------------------------------------------------------------------------------
 ref<Volume> Volume::downsample() const
 {
   ref<Volume> vol = new Volume;
@@ -473,34 +907,70 @@ ref<Volume> Volume::downsample() const
 
   vol->setup(NULL, false, false, bottomLeft(), topRight(), ivec3(w,h,d));
 
-  for(int z=0; z<d; ++z)
+  DownsampleTask task(this, vol.get());
+  parallelFor(0, d, &task, 1);
+
+  return vol;
+}
+//------------------------------------------------------------------------------
+void Volume::downsamplePyramid(int level_count, std::vector< ref<Volume> >& pyramid) const
+{
+  pyramid.clear();
+  const Volume* vol = this;
+  for(int i=0; i<level_count; ++i)
   {
-    int z1=z*2;
-    int z2=z*2+1;
-    for(int y=0; y<h; ++y)
+    if (vol->slices().x() < 4 || vol->slices().y() < 4 || vol->slices().z() < 4)
+      break;
+    pyramid.push_back( vol->downsample() );
+    vol = pyramid.back().get();
+  }
+}
+//------------------------------------------------------------------------------
+void Volume::computeCubeRanges(const ivec3& min_cube, const ivec3& max_cube)
+{
+  const int sx = slices().x();
+  const int sy = slices().y();
+  const int w = sx - 1;
+  const int h = sy - 1;
+  for(int z = min_cube.z(); z < max_cube.z(); ++z)
+  {
+    for(int y = min_cube.y(); y < max_cube.y(); ++y)
     {
-      int y1=y*2;
-      int y2=y*2+1;
-      for(int x=0; x<w; ++x)
+      // the four rows of samples touched by the cubes of row y
+      const float* r00 = values() + sx*y + sx*sy*z;
+      const float* r10 = r00 + sx;
+      const float* r01 = r00 + sx*sy;
+      const float* r11 = r01 + sx;
+      Cube* cubes = &mCubes[ w*y + w*h*z ];
+      for(int x = min_cube.x(); x < max_cube.x(); ++x)
       {
-        int x1 = x*2;
-        int x2 = x*2+1;
-        float v0 = value(x1,y1,z1);
-        float v1 = value(x1,y1,z2);
-        float v2 = value(x1,y2,z1);
-        float v3 = value(x1,y2,z2);
-        float v4 = value(x2,y1,z1);
-        float v5 = value(x2,y1,z2);
-        float v6 = value(x2,y2,z1);
-        float v7 = value(x2,y2,z2);
-        vol->value(x,y,z) = (v0+v1+v2+v3+v4+v5+v6+v7) * (1.0f/8.0f);
+        float v[] = { r00[x], r00[x+1], r10[x], r10[x+1], r01[x], r01[x+1], r11[x], r11[x+1] };
+        float vmin = v[0];
+        float vmax = v[0];
+        for(int i=1; i<8; ++i)
+        {
+          if (vmin > v[i]) vmin = v[i];
+          if (vmax < v[i]) vmax = v[i];
+        }
+        cubes[x].mMin = vmin;
+        cubes[x].mMax = vmax;
       }
     }
   }
-
-  return vol;
 }
 //------------------------------------------------------------------------------
+struct Volume::CubeRangesTask: public ParallelForTask
+{
+  CubeRangesTask(Volume* vol): mVolume(vol) {}
+
+  virtual void runRange(int begin, int end)
+  {
+    mVolume->computeCubeRanges( ivec3(0, 0, begin), ivec3(mVolume->slices().x()-1, mVolume->slices().y()-1, end) );
+  }
+
+  Volume* mVolume;
+};
+//------------------------------------------------------------------------------
 void Volume::setupInternalData()
 {
   mDataIsDirty = false;
@@ -508,36 +978,300 @@ void Volume::setupInternalData()
   int h = slices().y() -1;
   int d = slices().z() -1;
   mCubes.resize(w*h*d);
+  if (w>0 && h>0 && d>0)
+  {
+    CubeRangesTask task(this);
+    parallelFor(0, d, &task, 1);
+  }
+
+  // min/max pyramid: the first level stores the value range of blocks of BlockSize^3 cubes, 
+  // each following level the range of 2x2x2 blocks of the previous one
+  mBlockLevels.clear();
+  mBlockLevelSize.clear();
+  mBlockStamps.clear();
+  mDirtyBlockFlags.clear();
+  mDirtyBlocks.clear();
+  mBlockCount = ivec3(0,0,0);
+  if (w<1 || h<1 || d<1)
+    return;
+  mBlockCount = ivec3( (w + BlockSize-1) / BlockSize, (h + BlockSize-1) / BlockSize, (d + BlockSize-1) / BlockSize );
+  // all the blocks get a new stamp so that MarchingCubes::update() extracts them again
+  ++mStampCounter;
+  mBlockStamps.assign(mBlockCount.x()*mBlockCount.y()*mBlockCount.z(), mStampCounter);
+  mDirtyBlockFlags.assign(mBlockStamps.size(), 0);
+  Cube empty;
+  empty.mMin = +std::numeric_limits<float>::max();
+  empty.mMax = -std::numeric_limits<float>::max();
+  mBlockLevelSize.push_back(mBlockCount);
+  mBlockLevels.push_back( std::vector<Cube>(mBlockCount.x()*mBlockCount.y()*mBlockCount.z(), empty) );
   for(int z = 0; z < d; ++z)
   {
     for(int y = 0; y < h; ++y)
     {
+      Cube* blocks = &mBlockLevels[0][ mBlockCount.x() * (y/BlockSize + mBlockCount.y() * (z/BlockSize)) ];
+      const Cube* cubes = &mCubes[ w*y + w*h*z ];
       for(int x = 0; x < w; ++x)
       {
-        float v[] = 
+        Cube& block = blocks[x/BlockSize];
+        if (block.mMin > cubes[x].mMin) block.mMin = cubes[x].mMin;
+        if (block.mMax < cubes[x].mMax) block.mMax = cubes[x].mMax;
+      }
+    }
+  }
+  while( mBlockLevelSize.back() != ivec3(1,1,1) )
+  {
+    ivec3 prev_size = mBlockLevelSize.back();
+    ivec3 size( (prev_size.x()+1) / 2, (prev_size.y()+1) / 2, (prev_size.z()+1) / 2 );
+    mBlockLevelSize.push_back(size);
+    mBlockLevels.push_back( std::vector<Cube>(size.x()*size.y()*size.z(), empty) );
+    const std::vector<Cube>& prev = mBlockLevels[mBlockLevels.size()-2];
+    std::vector<Cube>& level = mBlockLevels.back();
+    for(int z = 0; z < prev_size.z(); ++z)
+    {
+      for(int y = 0; y < prev_size.y(); ++y)
+      {
+        for(int x = 0; x < prev_size.x(); ++x)
         {
-          value(x+0,y+0,z+0),
-          value(x+0,y+0,z+1),
-          value(x+0,y+1,z+0),
-          value(x+0,y+1,z+1),
-          value(x+1,y+0,z+0),
-          value(x+1,y+0,z+1),
-          value(x+1,y+1,z+0),
-          value(x+1,y+1,z+1)
-        };
-        int icube = x+w*y+w*h*z;
-        mCubes[icube].mMin = v[0];
-        mCubes[icube].mMax = v[0];
-        for(int i=1; i<8; ++i)
+          const Cube& child = prev[ x + prev_size.x()*(y + prev_size.y()*z) ];
+          Cube& parent = level[ x/2 + size.x()*(y/2 + size.y()*(z/2)) ];
+          if (parent.mMin > child.mMin) parent.mMin = child.mMin;
+          if (parent.mMax < child.mMax) parent.mMax = child.mMax;
+        }
+      }
+    }
+  }
+}
+//------------------------------------------------------------------------------
+void Volume::setDataDirty(const ivec3& min_sample, const ivec3& max_sample)
+{
+  if (mDataIsDirty)
+    return;
+  if (mBlockLevels.empty())
+  {
+    setDataDirty();
+    return;
+  }
+
+  // a sample affects the range of the cubes around it, the gradient of its neighbours and the vertices 
+  // of the edges up to two cells away, whose normals are computed from them
+  ivec3 min_block, max_block;
+  for(int i=0; i<3; ++i)
+  {
+    int c0 = std::max( min_sample[i] - 2, 0 );
+    int c1 = std::max( max_sample[i] + 1, 0 );
+    min_block[i] = std::min( c0 / (int)BlockSize, mBlockCount[i]-1 );
+    max_block[i] = std::min( c1 / (int)BlockSize, mBlockCount[i]-1 );
+  }
+
+  ++mStampCounter;
+  for(int z = min_block.z(); z <= max_block.z(); ++z)
+  {
+    for(int y = min_block.y(); y <= max_block.y(); ++y)
+    {
+      for(int x = min_block.x(); x <= max_block.x(); ++x)
+      {
+        int index = x + mBlockCount.x()*(y + mBlockCount.y()*z);
+        mBlockStamps[index] = mStampCounter;
+        if (!mDirtyBlockFlags[index])
         {
-          if (mCubes[icube].mMin > v[i]) mCubes[icube].mMin = v[i];
-          if (mCubes[icube].mMax < v[i]) mCubes[icube].mMax = v[i];
+          mDirtyBlockFlags[index] = 1;
+          mDirtyBlocks.push_back(index);
         }
       }
     }
   }
 }
 //------------------------------------------------------------------------------
+void Volume::updateBlock(int index)
+{
+  ivec3 min_cube( index % mBlockCount.x(), (index / mBlockCount.x()) % mBlockCount.y(), index / (mBlockCount.x() * mBlockCount.y()) );
+  min_cube *= (int)BlockSize;
+  ivec3 max_cube;
+  ivec3 max_sample;
+  for(int i=0; i<3; ++i)
+  {
+    max_cube[i] = std::min( min_cube[i] + (int)BlockSize, slices()[i]-1 );
+    // the samples on the far border of the volume belong to the last block
+    max_sample[i] = max_cube[i] == slices()[i]-1 ? slices()[i] : max_cube[i];
+  }
+
+  computeCubeRanges(min_cube, max_cube);
+
+  Cube& range = mBlockLevels[0][index];
+  range.mMin = +std::numeric_limits<float>::max();
+  range.mMax = -std::numeric_limits<float>::max();
+  for(int z = min_cube.z(); z < max_cube.z(); ++z)
+  {
+    for(int y = min_cube.y(); y < max_cube.y(); ++y)
+    {
+      for(int x = min_cube.x(); x < max_cube.x(); ++x)
+      {
+        const Cube& c = cube(x,y,z);
+        if (range.mMin > c.mMin) range.mMin = c.mMin;
+        if (range.mMax < c.mMax) range.mMax = c.mMax;
+      }
+    }
+  }
+
+  if (!mGradientIsDirty)
+    computeGradient(min_cube, max_sample);
+}
+//------------------------------------------------------------------------------
+struct Volume::DirtyBlocksTask: public ParallelForTask
+{
+  DirtyBlocksTask(Volume* vol): mVolume(vol) {}
+
+  virtual void runRange(int begin, int end)
+  {
+    for(int i=begin; i<end; ++i)
+      mVolume->updateBlock( mVolume->mDirtyBlocks[i] );
+  }
+
+  Volume* mVolume;
+};
+//------------------------------------------------------------------------------
+void Volume::updateInternalData()
+{
+  if (mDataIsDirty)
+  {
+    setupInternalData();
+    return;
+  }
+  if (mDirtyBlocks.empty())
+    return;
+
+  DirtyBlocksTask task(this);
+  parallelFor(0, (int)mDirtyBlocks.size(), &task, 1);
+
+  // propagate the new ranges up the min/max pyramid
+  std::vector<int> nodes = mDirtyBlocks;
+  for(unsigned level = 1; level < mBlockLevels.size(); ++level)
+  {
+    const ivec3& child_size = mBlockLevelSize[level-1];
+    const ivec3& size = mBlockLevelSize[level];
+    for(unsigned i=0; i<nodes.size(); ++i)
+    {
+      int x = nodes[i] % child_size.x();
+      int y = (nodes[i] / child_size.x()) % child_size.y();
+      int z = nodes[i] / (child_size.x() * child_size.y());
+      nodes[i] = x/2 + size.x()*(y/2 + size.y()*(z/2));
+    }
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase( std::unique(nodes.begin(), nodes.end()), nodes.end() );
+
+    const std::vector<Cube>& prev = mBlockLevels[level-1];
+    for(unsigned i=0; i<nodes.size(); ++i)
+    {
+      int px = nodes[i] % size.x();
+      int py = (nodes[i] / size.x()) % size.y();
+      int pz = nodes[i] / (size.x() * size.y());
+      Cube& parent = mBlockLevels[level][nodes[i]];
+      parent.mMin = +std::numeric_limits<float>::max();
+      parent.mMax = -std::numeric_limits<float>::max();
+      for(int z = pz*2; z < pz*2+2 && z < child_size.z(); ++z)
+        for(int y = py*2; y < py*2+2 && y < child_size.y(); ++y)
+          for(int x = px*2; x < px*2+2 && x < child_size.x(); ++x)
+          {
+            const Cube& child = prev[ x + child_size.x()*(y + child_size.y()*z) ];
+            if (parent.mMin > child.mMin) parent.mMin = child.mMin;
+            if (parent.mMax < child.mMax) parent.mMax = child.mMax;
+          }
+    }
+  }
+
+  for(unsigned i=0; i<mDirtyBlocks.size(); ++i)
+    mDirtyBlockFlags[ mDirtyBlocks[i] ] = 0;
+  mDirtyBlocks.clear();
+}
+//------------------------------------------------------------------------------
+void Volume::findActiveBlocks(float threshold, std::vector<int>& blocks) const
+{
+  blocks.clear();
+  if (mBlockLevels.empty())
+    return;
+  // depth first visit of the pyramid, descending only into the nodes including the threshold
+  std::vector<ivec4> stack;
+  stack.push_back( ivec4(0, 0, 0, (int)mBlockLevels.size()-1) );
+  while( !stack.empty() )
+  {
+    ivec4 node = stack.back();
+    stack.pop_back();
+    int level = node.w();
+    const ivec3& size = mBlockLevelSize[level];
+    int index = node.x() + size.x()*(node.y() + size.y()*node.z());
+    if (!mBlockLevels[level][index].includes(threshold))
+      continue;
+    if (level == 0)
+    {
+      blocks.push_back(index);
+      continue;
+    }
+    const ivec3& child_size = mBlockLevelSize[level-1];
+    for(int z = node.z()*2; z < node.z()*2+2 && z < child_size.z(); ++z)
+      for(int y = node.y()*2; y < node.y()*2+2 && y < child_size.y(); ++y)
+        for(int x = node.x()*2; x < node.x()*2+2 && x < child_size.x(); ++x)
+          stack.push_back( ivec4(x, y, z, level-1) );
+  }
+}
+//------------------------------------------------------------------------------
+void Volume::computeGradient(const ivec3& min_sample, const ivec3& max_sample)
+{
+  const int w = slices().x();
+  const int h = slices().y();
+  const int d = slices().z();
+  const fvec3& cell = cellSize();
+  for(int z = min_sample.z(); z < max_sample.z(); ++z)
+  {
+    // central differences, one sided on the borders
+    int zn = z > 0   ? z-1 : z;
+    int zp = z < d-1 ? z+1 : z;
+    float fz = zp != zn ? 1.0f / ((zp - zn) * cell.z()) : 0;
+    for(int y = min_sample.y(); y < max_sample.y(); ++y)
+    {
+      int yn = y > 0   ? y-1 : y;
+      int yp = y < h-1 ? y+1 : y;
+      float fy = yp != yn ? 1.0f / ((yp - yn) * cell.y()) : 0;
+      const float* row    = mValues + w*y  + w*h*z;
+      const float* row_yn = mValues + w*yn + w*h*z;
+      const float* row_yp = mValues + w*yp + w*h*z;
+      const float* row_zn = mValues + w*y  + w*h*zn;
+      const float* row_zp = mValues + w*y  + w*h*zp;
+      fvec3* out = &mGradient[ w*y + w*h*z ];
+      for(int x = min_sample.x(); x < max_sample.x(); ++x)
+      {
+        int xn = x > 0   ? x-1 : x;
+        int xp = x < w-1 ? x+1 : x;
+        float fx = xp != xn ? 1.0f / ((xp - xn) * cell.x()) : 0;
+        out[x].x() = (row[xp]    - row[xn])    * fx;
+        out[x].y() = (row_yp[x]  - row_yn[x])  * fy;
+        out[x].z() = (row_zp[x]  - row_zn[x])  * fz;
+      }
+    }
+  }
+}
+//------------------------------------------------------------------------------
+struct Volume::GradientTask: public ParallelForTask
+{
+  GradientTask(Volume* vol): mVolume(vol) {}
+
+  virtual void runRange(int begin, int end)
+  {
+    mVolume->computeGradient( ivec3(0, 0, begin), ivec3(mVolume->slices().x(), mVolume->slices().y(), end) );
+  }
+
+  Volume* mVolume;
+};
+//------------------------------------------------------------------------------
+void Volume::setupGradient()
+{
+  mGradientIsDirty = false;
+  mGradient.resize( slices().x() * slices().y() * slices().z() );
+  if (mGradient.empty() || !mValues)
+    return;
+  GradientTask task(this);
+  parallelFor(0, slices().z(), &task, 1);
+}
+//------------------------------------------------------------------------------
 void Volume::setup( float* data, bool use_directly, bool copy_data, const fvec3& bottom_left, const fvec3& top_right, const ivec3& slices )
 {
   fvec3 size = top_right-bottom_left;
@@ -570,6 +1304,7 @@ void Volume::setup( float* data, bool use_directly, bool copy_data, const fvec3&
   mMaximum = -1;
   mAverage = 0;
   mDataIsDirty = true;
+  mGradientIsDirty = true;
 }
 //------------------------------------------------------------------------------
 void Volume::setup(const Volume& volume)
@@ -579,6 +1314,7 @@ void Volume::setup(const Volume& volume)
   mMaximum = -1;
   mAverage = 0;
   mDataIsDirty = true;
+  mGradientIsDirty = true;
 }
 //------------------------------------------------------------------------------
 float Volume::sampleNearest(float x, float y, float z) const
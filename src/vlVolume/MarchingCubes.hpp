@@ -56,7 +56,14 @@ namespace vl
       float mMin, mMax;
       bool includes(float v) const { return v >= mMin && v <= mMax; }
     };
+    struct CubeRangesTask;
+    struct GradientTask;
+    struct DirtyBlocksTask;
+    struct DownsampleTask;
   public:
+    //! Size in cubes of the blocks of the min/max pyramid, see findActiveBlocks().
+    enum { BlockSize = 8 };
+
     Volume();
 
     //! Setup the volume data with the specified memory management.
@@ -70,9 +77,15 @@ namespace vl
 
     /** Returns a new volume which is half of the size of the original volume in each direction (thus requires up to 1/8th of the memory).
         Use this function when the volume data to be processed is too big or produces too many polygons.
+        The slices are computed concurrently using parallelFor().
      */
     ref<Volume> downsample() const;
 
+    /** Fills \p pyramid with up to \p level_count volumes, each one half of the size of the previous one, the first being
+        downsample() of this volume. Stops earlier when a volume has less than 4 slices along any direction.
+     */
+    void downsamplePyramid(int level_count, std::vector< ref<Volume> >& pyramid) const;
+
     const float* values() const { return mValues; }
 
     float* values() { return mValues; }
@@ -91,6 +104,19 @@ namespace vl
     //! Computes a low quality normal (best performances)
     void normalLQ(fvec3& normal, const fvec3& v, float dx, float dy, float dz);
 
+    //! Computes the normal of a point lying on the edge going from the sample (x,y,z) to the next sample along the given \p axis 
+    //! (0=x, 1=y, 2=z) interpolating the gradient field computed by setupGradient(). \p t is the position of the point along the edge.
+    void normalFromGradient(fvec3& normal, int x, int y, int z, int axis, float t) const
+    {
+      int i0 = x + mSlices.x()*y + mSlices.x()*mSlices.y()*z;
+      int i1 = i0 + (axis == 0 ? 1 : axis == 1 ? mSlices.x() : mSlices.x()*mSlices.y());
+      normal = mGradient[i0] * (t-1.0f) - mGradient[i1] * t;
+      normal.normalize();
+    }
+
+    //! The gradient of the volume at the given sample, computed by setupGradient() using central differences.
+    const fvec3& gradient(int x, int y, int z) const { return mGradient[x + mSlices.x()*y + mSlices.x()*mSlices.y()*z]; }
+
     //! Samples the volume using tri-linear interpolation sampling
     float sampleSmooth(float x, float y, float z) const;
 
@@ -127,6 +153,22 @@ namespace vl
       return mCubes[ x + y*(slices().x()-1) + z*(slices().x()-1)*(slices().y()-1) ]; 
     }
 
+    //! The number of blocks along x, y and z of the finest level of the min/max pyramid computed by setupInternalData().
+    //! Each block covers BlockSize^3 cubes, the blocks on the far border of the volume might be smaller.
+    const ivec3& blockCount() const { return mBlockCount; }
+
+    //! The value range of the cubes of the given block of the finest level of the min/max pyramid, see blockCount().
+    const Volume::Cube& block(int index) const { return mBlockLevels[0][index]; }
+
+    //! A value which changes every time the given block is marked dirty, see setDataDirty(const ivec3&, const ivec3&).
+    unsigned int blockStamp(int index) const { return mBlockStamps[index]; }
+
+    /** Fills \p blocks with the indices (x + y*blockCount().x() + z*blockCount().x()*blockCount().y()) of the blocks 
+        containing at least a cube whose value range includes \p threshold. Only the regions of the min/max pyramid 
+        whose value range includes the threshold are visited, so that the cost depends on the size of the isosurface
+        instead of the size of the volume. */
+    void findActiveBlocks(float threshold, std::vector<int>& blocks) const;
+
     //! Returns the x/y/z size of a cell
     const fvec3& cellSize() const { return mCellSize; }
 
@@ -134,10 +176,34 @@ namespace vl
     bool dataIsDirty() const { return mDataIsDirty; }
 
     //! Notifies that the data of a Volume has changed and that the internal acceleration structures should be recomputed.
-    void setDataDirty() { mDataIsDirty = true; }
+    void setDataDirty() { mDataIsDirty = true; mGradientIsDirty = true; }
+
+    /** Notifies that only the samples from \p min_sample to \p max_sample (included) have changed. The blocks affected 
+        by the change are updated by updateInternalData() and re-extracted by MarchingCubes::update(), the rest of the 
+        internal data is left untouched. If the whole volume is already marked dirty this function does nothing. */
+    void setDataDirty(const ivec3& min_sample, const ivec3& max_sample);
+
+    //! Returns true if some blocks have been marked dirty by setDataDirty(const ivec3&, const ivec3&) since the last update.
+    bool hasDirtyBlocks() const { return !mDirtyBlocks.empty(); }
 
     void setupInternalData();
 
+    //! Calls setupInternalData() if the whole volume is dirty, otherwise recomputes only the cube ranges, the min/max
+    //! pyramid and the gradient field (if already computed) of the blocks marked by setDataDirty(const ivec3&, const ivec3&).
+    void updateInternalData();
+
+    //! Returns true if the gradient field hasn't been computed since the last call to setDataDirty() or setup()
+    bool gradientIsDirty() const { return mGradientIsDirty; }
+
+    //! Computes the gradient field used by normalFromGradient() using multiple threads, see also parallelFor().
+    //! The gradient field requires 3 floats per sample and is computed only once, until the data is marked dirty.
+    void setupGradient();
+
+  protected:
+    void computeCubeRanges(const ivec3& min_cube, const ivec3& max_cube);
+    void computeGradient(const ivec3& min_sample, const ivec3& max_sample);
+    void updateBlock(int index);
+
   protected:
     std::vector<float> mInternalValues;
     float* mValues;
@@ -150,8 +216,19 @@ namespace vl
     float mMaximum;
     float mAverage;
     bool mDataIsDirty;
+    bool mGradientIsDirty;
 
     std::vector<Cube> mCubes;
+    std::vector<fvec3> mGradient;
+    // min/max pyramid, level 0 is the finest
+    std::vector< std::vector<Cube> > mBlockLevels;
+    std::vector<ivec3> mBlockLevelSize;
+    ivec3 mBlockCount;
+    // incremental updates
+    std::vector<unsigned int> mBlockStamps;
+    std::vector<unsigned char> mDirtyBlockFlags;
+    std::vector<int> mDirtyBlocks;
+    unsigned int mStampCounter;
   };
   //------------------------------------------------------------------------------
   // VolumeInfo
@@ -224,9 +301,41 @@ namespace vl
   {
   public:
     MarchingCubes();
+
+    ~MarchingCubes();
   
     void run(bool generate_colors);
 
+    /** Extracts the isosurfaces from a coarse version of the volumes, so that a preview is available right away, and starts a 
+        background thread extracting progressively finer versions. The volumes are downsampled \p level_count - 1 times using
+        Volume::downsamplePyramid(), the coarsest level is extracted before returning and level 0 is the full resolution.
+        Call updateProgressive() regularly, for example once per frame, to swap in the finer levels as soon as they are ready.
+        While refining, the volumes and the volumeInfo() must not be modified: call stopRefinement() first. */
+    void runProgressive(bool generate_colors, int level_count=3);
+
+    /** If the background thread started by runProgressive() has extracted a level finer than progressiveLevel() copies it
+        into mVertsArray, mNormsArray, mColorArray and mDrawElements and returns true. Must be called by the thread owning the
+        arrays, the colors are taken from volumeInfo(). */
+    bool updateProgressive();
+
+    //! The level of detail currently in mVertsArray, mNormsArray, mColorArray and mDrawElements, 0 means full resolution.
+    int progressiveLevel() const { return mProgressiveLevel; }
+
+    //! Returns true if the background thread started by runProgressive() has not delivered the full resolution level yet.
+    bool isRefining() const { return mProgressiveThread != NULL; }
+
+    //! Stops the background thread started by runProgressive() discarding the levels not swapped in yet.
+    //! Waits for the extraction of the level in progress, if any. Called by run(), update(), runProgressive() and reset().
+    void stopRefinement();
+
+    /** Updates the isosurfaces re-extracting only the blocks of the volumes modified since the last call, see 
+        Volume::setDataDirty(const ivec3&, const ivec3&). The isosurface of each block is kept in a separate chunk 
+        whose vertices lying on the faces shared with the adjacent blocks are duplicated, the chunks are then stitched 
+        together into mVertsArray, mNormsArray, mColorArray and mDrawElements. All the blocks of a volume are extracted
+        the first time and whenever its threshold, its size or the normal generation mode change.
+        With low quality normals the shading is discontinuous across the blocks, use gradientNormals() instead. */
+    void update(bool generate_colors);
+
     void reset();
 
     const Collection<VolumeInfo>* volumeInfo() const { return &mVolumeInfo; }
@@ -241,6 +350,20 @@ namespace vl
     //! Select hight quality normals for best rendering quality, select low quality normals for best performances.
     bool highQualityNormals() const { return mHighQualityNormals; }
 
+    //! If \p true the normals are interpolated from the gradient field of the volume, see Volume::setupGradient().
+    //! The gradient field is computed once per volume, which makes extracting several thresholds or re-extracting 
+    //! a modified threshold much quicker than with highQualityNormals(), over which this option takes precedence.
+    void setGradientNormals(bool on) { mGradientNormals = on; }
+    //! If \p true the normals are interpolated from the gradient field of the volume, see Volume::setupGradient().
+    bool gradientNormals() const { return mGradientNormals; }
+
+    //! If \p true (default) run() splits each volume in slabs along the z axis which are processed concurrently by 
+    //! up to parallelThreadCount() threads. The generated vertices, normals and triangles are identical to the ones
+    //! generated using a single thread.
+    void setMultithreaded(bool on) { mMultithreaded = on; }
+    //! If \p true (default) run() splits each volume in slabs along the z axis which are processed concurrently.
+    bool multithreaded() const { return mMultithreaded; }
+
   public:
     ref<ArrayFloat3> mVertsArray;
     ref<ArrayFloat3> mNormsArray;
@@ -253,31 +376,90 @@ namespace vl
     ref<DrawElementsUShort> mDrawElements;
 #endif
 
-  protected:
-    void computeEdges(Volume*, float threshold);
-    void processCube(int x, int y, int z, Volume* vol, float threshold);
-
   private:
-    std::vector<fvec3> mVerts;
-    std::vector<fvec3> mNorms;
-    std::vector<fvec4> mColors;
-    
 #if defined(VL_OPENGL)
     typedef unsigned int IndexType;
 #else
     typedef unsigned short IndexType;
 #endif
-    std::vector<IndexType> mIndices;
 
+    //! The vertices lying on the x, y and z edges starting from a cell, -1 if the edge doesn't cross the isosurface.
     struct Edge
     {
       Edge(): mX(-1), mY(-1), mZ(-1) {}
       int mX, mY, mZ;
     };
+
+    //! The range of z slices processed by a single thread and the data it generates.
+    //! The vertex indices stored in mEdges are relative to the first vertex of the slab.
+    struct Slab
+    {
+      int mZ0, mZ1;
+      int mVert0;
+      std::vector<fvec3> mVerts;
+      std::vector<fvec3> mNorms;
+      std::vector<usvec3> mCubes;
+      std::vector<IndexType> mIndices;
+    };
+    struct EdgesTask;
+    struct CubesTask;
+
+    //! The isosurface of a single block of a volume extracted by update(), the indices are relative to the chunk.
+    struct Chunk
+    {
+      Chunk(): mStamp(0) {}
+      unsigned int mStamp;
+      std::vector<fvec3> mVerts;
+      std::vector<fvec3> mNorms;
+      std::vector<IndexType> mIndices;
+    };
+    //! The chunks of a volume and the parameters used by update() to extract them.
+    struct ChunkSet
+    {
+      ChunkSet(): mThreshold(0), mHighQualityNormals(false), mGradientNormals(false) {}
+      ref<Volume> mVolume;
+      float mThreshold;
+      ivec3 mBlockCount;
+      bool mHighQualityNormals;
+      bool mGradientNormals;
+      std::vector<Chunk> mChunks;
+    };
+    struct ChunksTask;
+    struct ProgressiveThread;
+
+  protected:
+    int computeEdgeVertex(Volume* vol, float threshold, int x, int y, int z, int axis, std::vector<fvec3>& verts, std::vector<fvec3>& norms);
+    void computeEdges(Volume*, float threshold, Slab& slab);
+    //! \p edges points to the edges of the cell (x,y,z), \p stride_y and \p stride_z are the offsets of the cells (x,y+1,z) and (x,y,z+1).
+    void processCube(int x, int y, int z, Volume* vol, float threshold, const Edge* edges, int stride_y, int stride_z, int vert0_z0, int vert0_z1, std::vector<IndexType>& indices);
+    void extractBlock(Volume* vol, float threshold, int block, Chunk& chunk);
+    void updateArrays(bool generate_colors);
+    void copyArrays(const MarchingCubes& mc, bool generate_colors);
+
+  private:
+    // non copyable: the object owns the background thread started by runProgressive()
+    MarchingCubes(const MarchingCubes&);
+    MarchingCubes& operator=(const MarchingCubes&);
+
+  private:
+    std::vector<fvec3> mVerts;
+    std::vector<fvec3> mNorms;
+    std::vector<fvec4> mColors;
+    std::vector<IndexType> mIndices;
     std::vector<Edge>  mEdges;
-    std::vector<usvec3> mCubes;
+    std::vector<Slab> mSlabs;
+    std::vector<int> mActiveBlockList;
+    std::vector<unsigned char> mActiveBlocks;
+    std::vector<unsigned char> mActiveBlockRows;
+    std::vector<ChunkSet> mChunkSets;
+    std::vector<int> mDirtyChunks;
     Collection<VolumeInfo> mVolumeInfo;
     bool mHighQualityNormals;
+    bool mGradientNormals;
+    bool mMultithreaded;
+    ProgressiveThread* mProgressiveThread;
+    int mProgressiveLevel;
+    bool mProgressiveColors;
 
   protected:
     static const int mTriangleConnectionTable[256][16];
@@ -0,0 +1,261 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#include <vlVolume/OccupancyGrid.hpp>
+#include <vlGraphics/OpenGL.hpp>
+#include <vlCore/Thread.hpp>
+#include <vlCore/Log.hpp>
+#include <vlCore/Say.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace vl;
+
+namespace
+{
+  // computes the value range of the blocks of the z layers [begin, end)
+  template<typename T>
+  struct MinMaxTask: public ParallelForTask
+  {
+    MinMaxTask(const Image* data, int block_size, const ivec3& block_count, float normalizer, fvec2* ranges):
+      mData(data->pixels()), mW(data->width()), mH(data->height()), mD(data->depth()), mPitch(data->pitch()),
+      mBlockSize(block_size), mBlockCount(block_count), mNormalizer(normalizer), mRanges(ranges) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      const int bx_count = mBlockCount.x();
+      std::vector<T> row_min(mH*bx_count);
+      std::vector<T> row_max(mH*bx_count);
+      for(int bz=begin; bz<end; ++bz)
+      {
+        // the samples of a block interpolate the voxels adjacent to it too
+        int z0 = std::max(bz*mBlockSize-1, 0);
+        int z1 = std::min((bz+1)*mBlockSize, mD-1);
+
+        // reduce along z and x: one range per row and per block along x
+        for(int z=z0; z<=z1; ++z)
+        {
+          for(int y=0; y<mH; ++y)
+          {
+            const T* row = (const T*)(mData + (size_t)y*mPitch + (size_t)z*mPitch*mH);
+            for(int bx=0; bx<bx_count; ++bx)
+            {
+              int x0 = std::max(bx*mBlockSize-1, 0);
+              int x1 = std::min((bx+1)*mBlockSize, mW-1);
+              T vmin = row[x0];
+              T vmax = row[x0];
+              for(int x=x0+1; x<=x1; ++x)
+              {
+                vmin = row[x] < vmin ? row[x] : vmin;
+                vmax = row[x] > vmax ? row[x] : vmax;
+              }
+              T& rmin = row_min[y*bx_count+bx];
+              T& rmax = row_max[y*bx_count+bx];
+              if (z == z0 || vmin < rmin)
+                rmin = vmin;
+              if (z == z0 || vmax > rmax)
+                rmax = vmax;
+            }
+          }
+        }
+
+        // reduce along y
+        for(int by=0; by<mBlockCount.y(); ++by)
+        {
+          int y0 = std::max(by*mBlockSize-1, 0);
+          int y1 = std::min((by+1)*mBlockSize, mH-1);
+          for(int bx=0; bx<bx_count; ++bx)
+          {
+            T vmin = row_min[y0*bx_count+bx];
+            T vmax = row_max[y0*bx_count+bx];
+            for(int y=y0+1; y<=y1; ++y)
+            {
+              vmin = std::min(vmin, row_min[y*bx_count+bx]);
+              vmax = std::max(vmax, row_max[y*bx_count+bx]);
+            }
+            mRanges[bx + bx_count*(by + mBlockCount.y()*bz)] = fvec2(vmin*mNormalizer, vmax*mNormalizer);
+          }
+        }
+      }
+    }
+
+    const unsigned char* mData;
+    int mW, mH, mD, mPitch;
+    int mBlockSize;
+    ivec3 mBlockCount;
+    float mNormalizer;
+    fvec2* mRanges;
+  };
+}
+//------------------------------------------------------------------------------
+// OccupancyGrid
+//------------------------------------------------------------------------------
+OccupancyGrid::OccupancyGrid()
+{
+  VL_DEBUG_SET_OBJECT_NAME()
+  mBlockSize = 0;
+  mOccupiedCount = 0;
+  mTextureDirty = false;
+}
+//------------------------------------------------------------------------------
+bool OccupancyGrid::setup(const Image* data, int block_size)
+{
+  if (!data || data->dimension() != ID_3D || data->format() != IF_LUMINANCE)
+  {
+    Log::error("OccupancyGrid::setup(): the data must be a 3D IF_LUMINANCE image.\n");
+    return false;
+  }
+  if (block_size < 1)
+  {
+    Log::error( Say("OccupancyGrid::setup(): invalid block size %n.\n") << block_size );
+    return false;
+  }
+
+  float normalizer = 0;
+  switch(data->type())
+  {
+    case IT_UNSIGNED_BYTE:  normalizer = 1.0f/255.0f;   break;
+    case IT_UNSIGNED_SHORT: normalizer = 1.0f/65535.0f; break;
+    case IT_FLOAT:          normalizer = 1.0f;          break;
+    default:
+      Log::error("OccupancyGrid::setup(): the data type must be IT_UNSIGNED_BYTE, IT_UNSIGNED_SHORT or IT_FLOAT.\n");
+      return false;
+  }
+
+  mBlockSize  = block_size;
+  mVolumeSize = ivec3(data->width(), data->height(), data->depth());
+  mBlockCount = ivec3( (mVolumeSize.x() + block_size - 1) / block_size,
+                       (mVolumeSize.y() + block_size - 1) / block_size,
+                       (mVolumeSize.z() + block_size - 1) / block_size );
+  mRanges.resize(mBlockCount.x() * mBlockCount.y() * mBlockCount.z());
+
+  switch(data->type())
+  {
+    case IT_UNSIGNED_BYTE:
+    {
+      MinMaxTask<unsigned char> task(data, block_size, mBlockCount, normalizer, &mRanges[0]);
+      parallelFor(0, mBlockCount.z(), &task, 1);
+      break;
+    }
+    case IT_UNSIGNED_SHORT:
+    {
+      MinMaxTask<unsigned short> task(data, block_size, mBlockCount, normalizer, &mRanges[0]);
+      parallelFor(0, mBlockCount.z(), &task, 1);
+      break;
+    }
+    default:
+    {
+      MinMaxTask<float> task(data, block_size, mBlockCount, normalizer, &mRanges[0]);
+      parallelFor(0, mBlockCount.z(), &task, 1);
+      break;
+    }
+  }
+
+  // everything is visible until classify() is called
+  mOccupancy = new Image( mBlockCount.x(), mBlockCount.y(), mBlockCount.z(), 1, IF_LUMINANCE, IT_UNSIGNED_BYTE );
+  memset(mOccupancy->pixels(), 0xFF, mOccupancy->requiredMemory());
+  mOccupiedCount = (int)mRanges.size();
+
+  mTexture = new Texture;
+  mTexture->prepareTexture3D( mOccupancy.get(), TF_LUMINANCE8, false, false );
+  mTexture->getTexParameter()->setMinFilter(TPF_NEAREST);
+  mTexture->getTexParameter()->setMagFilter(TPF_NEAREST);
+  mTexture->getTexParameter()->setWrapS(TPW_CLAMP_TO_EDGE);
+  mTexture->getTexParameter()->setWrapT(TPW_CLAMP_TO_EDGE);
+  mTexture->getTexParameter()->setWrapR(TPW_CLAMP_TO_EDGE);
+  mTextureDirty = false;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+int OccupancyGrid::classify(const Image* trfunc, float alpha_threshold)
+{
+  if (!mOccupancy)
+  {
+    Log::error("OccupancyGrid::classify(): setup() must be called first.\n");
+    return 0;
+  }
+  if (!trfunc || trfunc->dimension() != ID_1D || trfunc->format() != IF_RGBA || trfunc->type() != IT_UNSIGNED_BYTE)
+  {
+    Log::error("OccupancyGrid::classify(): the transfer function must be a 1D IF_RGBA/IT_UNSIGNED_BYTE image.\n");
+    return 0;
+  }
+
+  // visible[i] = number of visible entries before i
+  const int w = trfunc->width();
+  const ubvec4* tf = (const ubvec4*)trfunc->pixels();
+  std::vector<int> visible(w+1, 0);
+  for(int i=0; i<w; ++i)
+    visible[i+1] = visible[i] + (tf[i].a() * (1.0f/255.0f) > alpha_threshold ? 1 : 0);
+
+  unsigned char* occupancy = mOccupancy->pixels();
+  mOccupiedCount = 0;
+  for(size_t i=0; i<mRanges.size(); ++i)
+  {
+    // the entries touched by the linear filtering of the values in range
+    int lo = clamp((int)floor(mRanges[i].x()*w - 0.5f),     0, w-1);
+    int hi = clamp((int)floor(mRanges[i].y()*w - 0.5f) + 1, 0, w-1);
+    bool occupied = visible[hi+1] - visible[lo] > 0;
+    occupancy[i] = occupied ? 0xFF : 0x00;
+    mOccupiedCount += occupied ? 1 : 0;
+  }
+
+  mTextureDirty = true;
+  return mOccupiedCount;
+}
+//------------------------------------------------------------------------------
+void OccupancyGrid::update(Actor* actor)
+{
+  if (!mOccupancy)
+    return;
+
+  // the texture is created from the current occupancy the first time it is used
+  if (mTextureDirty && mTexture->handle())
+  {
+    mTextureDirty = false;
+
+    // restore the previous state so that the renderer's texture unit tracking is not affected
+    GLint prev_texture = 0;
+    GLint prev_alignment = 4;
+    glGetIntegerv(GL_TEXTURE_BINDING_3D, &prev_texture); VL_CHECK_OGL()
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &prev_alignment); VL_CHECK_OGL()
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); VL_CHECK_OGL()
+    glBindTexture(GL_TEXTURE_3D, mTexture->handle()); VL_CHECK_OGL()
+    VL_glTexSubImage3D( GL_TEXTURE_3D, 0, 0, 0, 0, mBlockCount.x(), mBlockCount.y(), mBlockCount.z(), GL_LUMINANCE, GL_UNSIGNED_BYTE, mOccupancy->pixels() ); VL_CHECK_OGL()
+    glBindTexture(GL_TEXTURE_3D, prev_texture); VL_CHECK_OGL()
+    glPixelStorei(GL_UNPACK_ALIGNMENT, prev_alignment); VL_CHECK_OGL()
+  }
+
+  actor->gocUniform("occupancy_size")->setUniform( fvec3( (float)mBlockCount.x(), (float)mBlockCount.y(), (float)mBlockCount.z() ) );
+  actor->gocUniform("occupancy_block")->setUniform( fvec3( (float)mBlockSize / mVolumeSize.x(), (float)mBlockSize / mVolumeSize.y(), (float)mBlockSize / mVolumeSize.z() ) );
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,118 @@
+/**************************************************************************************/
+/*                                                                                    */
+/*  Visualization Library                                                             */
+/*  http://visualizationlibrary.org                                                   */
+/*                                                                                    */
+/*  Copyright (c) 2005-2010, Michele Bosi                                             */
+/*  All rights reserved.                                                              */
+/*                                                                                    */
+/*  Redistribution and use in source and binary forms, with or without modification,  */
+/*  are permitted provided that the following conditions are met:                     */
+/*                                                                                    */
+/*  - Redistributions of source code must retain the above copyright notice, this     */
+/*  list of conditions and the following disclaimer.                                  */
+/*                                                                                    */
+/*  - Redistributions in binary form must reproduce the above copyright notice, this  */
+/*  list of conditions and the following disclaimer in the documentation and/or       */
+/*  other materials provided with the distribution.                                   */
+/*                                                                                    */
+/*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND   */
+/*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED     */
+/*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE            */
+/*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR  */
+/*  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES    */
+/*  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;      */
+/*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON    */
+/*  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT           */
+/*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS     */
+/*  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                      */
+/*                                                                                    */
+/**************************************************************************************/
+
+
+#ifndef OccupancyGrid_INCLUDE_ONCE
+#define OccupancyGrid_INCLUDE_ONCE
+
+#include <vlVolume/link_config.hpp>
+#include <vlGraphics/Actor.hpp>
+#include <vlGraphics/Texture.hpp>
+#include <vlCore/Image.hpp>
+#include <vector>
+
+namespace vl
+{
+  //------------------------------------------------------------------------------
+  // OccupancyGrid
+  //------------------------------------------------------------------------------
+  /**
+   * A coarse grid of blocks telling which parts of a volume are visible with the current transfer function,
+   * used by the raycasting shaders to skip the empty space.
+   *
+   * setup() computes once the minimum and maximum value of each block of voxels. classify() marks a block as occupied
+   * if the transfer function has a non transparent entry within the block's value range: it only visits the blocks
+   * and the transfer function, so it can be called every time the transfer function changes.
+   *
+   * The grid is exposed to the shaders as an IF_LUMINANCE 3D texture, 255 meaning occupied, together with the following
+   * uniforms, see also RaycastVolume::setOccupancyGrid() and the \p volume_raycast_occupancy.fs shader:
+   * - \p "uniform vec3 occupancy_size": the number of blocks along x, y and z.
+   * - \p "uniform vec3 occupancy_block": the size of a block in volume texture coordinates.
+   */
+  class VLVOLUME_EXPORT OccupancyGrid: public Object
+  {
+    VL_INSTRUMENT_CLASS(vl::OccupancyGrid, Object)
+
+  public:
+    OccupancyGrid();
+
+    /** Computes the value range of each block of \p block_size voxels of \p data, which must be a 3D IF_LUMINANCE
+     * image of type IT_UNSIGNED_BYTE, IT_UNSIGNED_SHORT or IT_FLOAT. The blocks are initially all occupied.
+     * The ranges include the voxels adjacent to each block since they contribute to its trilinear samples. */
+    bool setup(const Image* data, int block_size=8);
+
+    /** Marks as empty the blocks whose values are all mapped to an alpha not greater than \p alpha_threshold by \p trfunc.
+     * \p trfunc must be a 1D IF_RGBA/IT_UNSIGNED_BYTE image, its texture is expected to use linear filtering
+     * and TPW_CLAMP_TO_EDGE wrapping: with TPW_REPEAT the values near 0 and 1 blend the two ends of the transfer function.
+     * Returns the number of occupied blocks. */
+    int classify(const Image* trfunc, float alpha_threshold=0.0f);
+
+    //! The size in voxels of the side of a block.
+    int blockSize() const { return mBlockSize; }
+
+    //! The number of blocks along x, y and z.
+    const ivec3& blockCount() const { return mBlockCount; }
+
+    //! The size in voxels of the volume passed to setup().
+    const ivec3& volumeSize() const { return mVolumeSize; }
+
+    //! The normalized minimum and maximum value of the given block, including the adjacent voxels.
+    const fvec2& blockRange(int x, int y, int z) const { return mRanges[x + mBlockCount.x()*(y + mBlockCount.y()*z)]; }
+
+    //! Whether the given block has been marked as occupied by the last classify().
+    bool isOccupied(int x, int y, int z) const { return mOccupancy->pixels()[x + mBlockCount.x()*(y + mBlockCount.y()*z)] != 0; }
+
+    //! The number of occupied blocks.
+    int occupiedCount() const { return mOccupiedCount; }
+
+    //! The occupancy image, one byte per block.
+    const Image* occupancy() const { return mOccupancy.get(); }
+
+    //! The occupancy texture to be bound to the \p "occupancy_texunit" sampler, a new one is created by every setup().
+    Texture* texture() { return mTexture.get(); }
+
+    /** Uploads the occupancy texture if classify() changed it and sets the \p "occupancy_size" and \p "occupancy_block"
+     * uniforms of the Actor. Called by RaycastVolume, requires an active OpenGL context. */
+    void update(Actor* actor);
+
+  protected:
+    ivec3 mVolumeSize;
+    ivec3 mBlockCount;
+    int mBlockSize;
+    int mOccupiedCount;
+    std::vector<fvec2> mRanges;
+    ref<Image> mOccupancy;
+    ref<Texture> mTexture;
+    bool mTextureDirty;
+  };
+}
+
+#endif
@@ -188,6 +188,14 @@ void RaycastVolume::onActorRenderStarted( Actor* actor, real clock, const Camera
   if ( pass>0 )
     return;
 
+  // stream the bricks visible from the camera
+  if ( mBrickedVolume )
+    mBrickedVolume->update( actor, camera, mBox );
+
+  // upload the empty space skipping data
+  if ( mOccupancyGrid )
+    mOccupancyGrid->update( actor );
+
   // setup uniform variables
 
   if ( shader->getGLSLProgram() )
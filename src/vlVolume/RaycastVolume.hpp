@@ -32,6 +32,8 @@
 #include <vlVolume/link_config.hpp>
 #include <vlGraphics/Geometry.hpp>
 #include <vlGraphics/Actor.hpp>
+#include <vlVolume/BrickedVolume.hpp>
+#include <vlVolume/OccupancyGrid.hpp>
 
 #ifndef RaycastVolume_INCLUDE_ONCE
 #define RaycastVolume_INCLUDE_ONCE
@@ -86,11 +88,30 @@ namespace vl
     //! Use this function to visualize a subset of the volume. The subset is defined by \p min_corner and \p max_corner.
     void generateTextureCoordinates(const ivec3& img_size, const ivec3& min_corner, const ivec3& max_corner);
 
+    //! Streams the bricks of the given BrickedVolume each time the volume is rendered, see BrickedVolume::update().
+    //! BrickedVolume::pageTableTexture() and BrickedVolume::atlasTexture() must be bound to the \p "page_table_texunit" and 
+    //! \p "brick_atlas_texunit" samplers of the Shader used to render the volume, usually \p "/glsl/volume_raycast_bricked.fs", 
+    //! together with the transfer function bound to \p "trfunc_texunit". Such shader casts the rays from the back faces of 
+    //! the box towards the eye so the Shader must enable EN_CULL_FACE with CullFace set to PF_FRONT.
+    void setBrickedVolume(BrickedVolume* bricked_volume) { mBrickedVolume = bricked_volume; }
+    
+    //! The BrickedVolume streamed each time the volume is rendered, if any.
+    BrickedVolume* brickedVolume() { return mBrickedVolume.get(); }
+
+    //! Uploads the given OccupancyGrid and updates its uniforms each time the volume is rendered, see OccupancyGrid::update().
+    //! OccupancyGrid::texture() must be bound to the Shader used to render the volume.
+    void setOccupancyGrid(OccupancyGrid* grid) { mOccupancyGrid = grid; }
+
+    //! The OccupancyGrid used to skip the empty space, if any.
+    OccupancyGrid* occupancyGrid() { return mOccupancyGrid.get(); }
+
   protected:
     ref<Geometry> mGeometry;
     AABB mBox;
     ref<ArrayFloat3> mTexCoord;
     ref<ArrayFloat3> mVertCoord;
+    ref<BrickedVolume> mBrickedVolume;
+    ref<OccupancyGrid> mOccupancyGrid;
   };
 }
 
@@ -170,6 +170,10 @@ void SlicedVolume::onActorRenderStarted(Actor* actor, real clock, const Camera*
   if (pass>0)
     return;
 
+  // stream the bricks visible from the camera
+  if (mBrickedVolume)
+    mBrickedVolume->update(actor, camera, mBox);
+
   // setup uniform variables
 
   if (shader->getGLSLProgram())
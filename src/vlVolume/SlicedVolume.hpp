@@ -36,6 +36,7 @@
 #include <vlGraphics/Actor.hpp>
 #include <vlGraphics/Geometry.hpp>
 #include <vlGraphics/Light.hpp>
+#include <vlVolume/BrickedVolume.hpp>
 
 namespace vl
 {
@@ -88,12 +89,22 @@ namespace vl
     //! Use this function to visualize a subset of the volume. The subset is defined by \p min_corner and \p max_corner.
     void generateTextureCoordinates(const ivec3& img_size, const ivec3& min_corner, const ivec3& max_corner);
 
+    //! Streams the bricks of the given BrickedVolume each time the volume is rendered, see BrickedVolume::update().
+    //! BrickedVolume::pageTableTexture() and BrickedVolume::atlasTexture() must be bound to the \p "page_table_texunit" and 
+    //! \p "brick_atlas_texunit" samplers of the Shader used to render the volume, usually \p "/glsl/volume_luminance_bricked.fs", 
+    //! together with the transfer function bound to \p "trfunc_texunit".
+    void setBrickedVolume(BrickedVolume* bricked_volume) { mBrickedVolume = bricked_volume; }
+    
+    //! The BrickedVolume streamed each time the volume is rendered, if any.
+    BrickedVolume* brickedVolume() { return mBrickedVolume.get(); }
+
   protected:
     int mSliceCount;
     ref<Geometry> mGeometry;
     AABB mBox;
     fmat4 mCache;
     fvec3 mTexCoord[8];
+    ref<BrickedVolume> mBrickedVolume;
   };
 }
 
@@ -35,9 +35,48 @@
 #include <vlGraphics/FontManager.hpp>
 #include <vlCore/VisualizationLibrary.hpp>
 #include <vlGraphics/GeometryPrimitives.hpp>
+#include <vlCore/Thread.hpp>
 
 using namespace vl;
 
+namespace
+{
+  //-----------------------------------------------------------------------------
+  // evaluates the function one row at a time over a range of z slices
+  class EvaluateFunctionTask: public ParallelForTask
+  {
+  public:
+    EvaluateFunctionTask(const VolumePlot::Function& func, float* scalar, const float* xs, const ivec3& size, const fvec3& min_corner, const fvec3& max_corner)
+    : mFunc(func), mScalar(scalar), mXs(xs), mSize(size), mMinCorner(min_corner), mMaxCorner(max_corner) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      int w = mSize.x();
+      int h = mSize.y();
+      int d = mSize.z();
+      for(int z=begin; z<end; ++z)
+      {
+        float tz = (float)z/(d-1);
+        float vz = mMinCorner.z()*(1.0f-tz) + mMaxCorner.z()*tz;
+        for(int y=0; y<h; ++y)
+        {
+          float ty = (float)y/(h-1);
+          float vy = mMinCorner.y()*(1.0f-ty) + mMaxCorner.y()*ty;
+          mFunc.evaluateRow(mXs, vy, vz, w, mScalar + y*w + z*w*h);
+        }
+      }
+    }
+
+  private:
+    const VolumePlot::Function& mFunc;
+    float* mScalar;
+    const float* mXs;
+    ivec3 mSize;
+    fvec3 mMinCorner;
+    fvec3 mMaxCorner;
+  };
+}
+
 /** \class vl::VolumePlot
   <img src="pics/pagGuideMarchingCubes_1.jpg">
 
@@ -84,6 +123,7 @@ VolumePlot::VolumePlot()
   mLabelFont = defFontManager()->acquireFont("/font/bitstream-vera/VeraMono.ttf", 8);
   mMinCorner = fvec3(-1,-1,-1);
   mMaxCorner = fvec3(+1,+1,+1);
+  mMultithreaded = false;
 
   // defaults
 
@@ -208,26 +248,20 @@ void VolumePlot::setupLabels(const String& format, const fvec3& min_corner, cons
 //-----------------------------------------------------------------------------
 void VolumePlot::evaluateFunction(float* scalar, const fvec3& min_corner, const fvec3& max_corner, const Function& func)
 {
-  fvec3 v;
   int w = mSamplingResolution.x();
-  int h = mSamplingResolution.y();
-  int d = mSamplingResolution.z();
-  for(int z=0; z<d; ++z)
+
+  // the x coordinates are the same for every row
+  std::vector<float> xs(w);
+  for(int x=0; x<w; ++x)
   {
-    float tz = (float)z/(d-1);
-    v.z() = min_corner.z()*(1.0f-tz) + max_corner.z()*tz;
-    for(int y=0; y<h; ++y)
-    {
-      float ty = (float)y/(h-1);
-      v.y() = min_corner.y()*(1.0f-ty) + max_corner.y()*ty;
-      for(int x=0; x<w; ++x)
-      {
-        float tx = (float)x/(w-1);
-        v.x() = min_corner.x()*(1.0f-tx) + max_corner.x()*tx;
-        // evaluate function
-        scalar[x+y*w+z*w*h] = func(v.x(),v.y(),v.z());
-      }
-    }
+    float tx = (float)x/(w-1);
+    xs[x] = min_corner.x()*(1.0f-tx) + max_corner.x()*tx;
   }
+
+  EvaluateFunctionTask task(func, scalar, &xs[0], mSamplingResolution, min_corner, max_corner);
+  if (multithreaded())
+    parallelFor(0, mSamplingResolution.z(), &task, 1);
+  else
+    task.runRange(0, mSamplingResolution.z());
 }
 //-----------------------------------------------------------------------------
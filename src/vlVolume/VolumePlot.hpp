@@ -52,11 +52,22 @@ namespace vl
     VL_INSTRUMENT_CLASS(vl::VolumePlot, Object)
 
   public:
-    //! A function to be used with VolumePlot
+    //! A function to be used with VolumePlot.
+    //! If VolumePlot::setMultithreaded(true) is called the function is evaluated concurrently by multiple threads.
     class Function
     {
     public:
+      virtual ~Function() {}
+
       virtual float operator()(float x, float y, float z) const = 0;
+
+      //! Evaluates the function at the \p count points (x[i], y, z) storing the results in \p out.
+      //! Reimplement it to evaluate a whole row at once, the default implementation calls operator() for each point.
+      virtual void evaluateRow(const float* x, float y, float z, int count, float* out) const
+      {
+        for(int i=0; i<count; ++i)
+          out[i] = (*this)(x[i], y, z);
+      }
     };
 
   public:
@@ -108,6 +119,14 @@ namespace vl
     //! Default value: ivec3(64,64,64)
     void setSamplingResolution(const ivec3& size) { mSamplingResolution = size; }
 
+    //! If \p true the function is evaluated by up to parallelThreadCount() threads, each one processing whole rows using
+    //! Function::evaluateRow(). Enable it only if Function::operator() and Function::evaluateRow() are thread-safe, i.e.
+    //! they don't modify any state shared between calls and don't use the OpenGL context. Default value: false.
+    //! The isosurface is always extracted using the multithreaded MarchingCubes, which is unaffected by this option.
+    void setMultithreaded(bool on) { mMultithreaded = on; }
+    //! If \p true the function is evaluated using multiple threads, see setMultithreaded().
+    bool multithreaded() const { return mMultithreaded; }
+
     //! Sets the format of the labels
     const String& labelFormat() const { return mLabelFormat; }
     //! Sets the format of the label to be generated, es. "(%.2n %.2n %.2n)" or "<%.3n, %.3n, %.3n>"
@@ -146,6 +165,7 @@ namespace vl
     ref<Effect> mBoxEffect;
     ref<Text> mTextTemplate;
     ref<ActorTree> mActorTreeMulti;
+    bool mMultithreaded;
   };
 }
 
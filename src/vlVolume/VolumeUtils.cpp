@@ -29,12 +29,277 @@
 /*                                                                                    */
 /**************************************************************************************/
 
+
 #include <vlVolume/VolumeUtils.hpp>
 #include <vlCore/Log.hpp>
+#include <vlCore/Thread.hpp>
 #include <vlCore/glsl_math.hpp>
+#include <vector>
 
 using namespace vl;
 
+namespace
+{
+  //-----------------------------------------------------------------------------
+  // maps a normalized data value to its transfer function color
+  inline fvec4 transferFunction(float lum, const ubvec4* trfunc, int trfunc_width)
+  {
+    float xval = lum*trfunc_width;
+    VL_CHECK(xval>=0)
+    if (xval > trfunc_width-1.001f)
+      xval = trfunc_width-1.001f;
+    int ix1 = (int)xval;
+    int ix2 = ix1+1;
+    VL_CHECK(ix2<trfunc_width)
+    float w21  = (float)fract(xval);
+    float w11  = 1.0f - w21;
+    fvec4 c11  = (fvec4)trfunc[ix1];
+    fvec4 c21  = (fvec4)trfunc[ix2];
+    return (c11*w11 + c21*w21)*(1.0f/255.0f);
+  }
+  //-----------------------------------------------------------------------------
+  inline ubvec4 packRGBA(const fvec4& rgba, float lum, bool alpha_from_data)
+  {
+    ubvec4 px;
+    px.r() = (unsigned char)(rgba.r()*255.0f);
+    px.g() = (unsigned char)(rgba.g()*255.0f);
+    px.b() = (unsigned char)(rgba.b()*255.0f);
+    if (alpha_from_data)
+      px.a() = (unsigned char)(lum*255.0f);
+    else
+      px.a() = (unsigned char)(rgba.a()*255.0f);
+    return px;
+  }
+  //-----------------------------------------------------------------------------
+  // 8 and 16 bits values are looked up in tables filled once per volume, see lutSize()
+  template<typename data_type> inline int lutSize() { return sizeof(data_type) <= 2 ? 1 << (8*sizeof(data_type)) : 0; }
+  template<> inline int lutSize<float>() { return 0; }
+  template<typename data_type> inline int lutIndex(data_type v) { return (int)v & (lutSize<data_type>()-1); }
+  template<> inline int lutIndex<float>(float) { return 0; }
+  //-----------------------------------------------------------------------------
+  // processes the z slices [begin, end) of the volume
+  template<typename data_type>
+  struct RGBAVolumeTask: public ParallelForTask
+  {
+    RGBAVolumeTask(const Image* data, const Image* trfunc, float normalizer_num, bool alpha_from_data, ubvec4* rgba_px):
+      mData(data->pixels()), mW(data->width()), mH(data->height()), mD(data->depth()), mPitch(data->pitch()),
+      mTrFunc((const ubvec4*)trfunc->pixels()), mTrFuncWidth(trfunc->width()), mNormalizerNum(normalizer_num),
+      mAlphaFromData(alpha_from_data), mLighting(false), mRGBA(rgba_px)
+    {
+      // the whole transfer function computation depends only on the value
+      mPixelLUT.resize(lutSize<data_type>());
+      for(int i=0; i<(int)mPixelLUT.size(); ++i)
+      {
+        float lum = ((data_type)i) * mNormalizerNum;
+        mPixelLUT[lutIndex((data_type)i)] = packRGBA(transferFunction(lum, mTrFunc, mTrFuncWidth), lum, mAlphaFromData);
+      }
+    }
+
+    void setLight(const fvec3& light_dir)
+    {
+      mLighting = true;
+      mLight = light_dir;
+      mLight.normalize();
+      mColorLUT.resize(lutSize<data_type>());
+      for(int i=0; i<(int)mColorLUT.size(); ++i)
+        mColorLUT[lutIndex((data_type)i)] = transferFunction(((data_type)i) * mNormalizerNum, mTrFunc, mTrFuncWidth);
+    }
+
+    const data_type* row(int y, int z) const { return (const data_type*)(mData + (size_t)y*mPitch + (size_t)z*mPitch*mH); }
+
+    virtual void runRange(int begin, int end)
+    {
+      for(int z=begin; z<end; ++z)
+      {
+        int z1 = clamp(z-1, 0, mD-1);
+        int z2 = clamp(z+1, 0, mD-1);
+        for(int y=0; y<mH; ++y)
+        {
+          int y1 = clamp(y-1, 0, mH-1);
+          int y2 = clamp(y+1, 0, mH-1);
+          const data_type* px  = row(y,  z);
+          const data_type* py1 = row(y1, z);
+          const data_type* py2 = row(y2, z);
+          const data_type* pz1 = row(y,  z1);
+          const data_type* pz2 = row(y,  z2);
+          ubvec4* rgba_px = mRGBA + (size_t)mW*y + (size_t)mW*mH*z;
+
+          if (!mLighting && !mPixelLUT.empty())
+          {
+            for(int x=0; x<mW; ++x)
+              rgba_px[x] = mPixelLUT[lutIndex(px[x])];
+            continue;
+          }
+
+          for(int x=0; x<mW; ++x)
+          {
+            // value -> transfer function
+            fvec4 rgba;
+            ubvec4 pixel;
+            if (!mPixelLUT.empty())
+            {
+              pixel = mPixelLUT[lutIndex(px[x])];
+              if (mLighting)
+                rgba = mColorLUT[lutIndex(px[x])];
+            }
+            else
+            {
+              float lum = px[x] * mNormalizerNum;
+              rgba  = transferFunction(lum, mTrFunc, mTrFuncWidth);
+              pixel = packRGBA(rgba, lum, mAlphaFromData);
+            }
+
+            if (mLighting)
+            {
+              // bake the lighting
+              int x1 = x > 0    ? x-1 : 0;
+              int x2 = x < mW-1 ? x+1 : mW-1;
+              fvec3 N1(float(px[x1]-px[x2]), float(py1[x]-py2[x]), float(pz1[x]-pz2[x]));
+              N1.normalize();
+              fvec3 N2 = -N1 * 0.15f;
+              float l1 = max(dot(N1,mLight),0.0f);
+              float l2 = max(dot(N2,mLight),0.0f); // opposite dim light to enhance 3D perception
+              rgba.r() = rgba.r()*l1 + rgba.r()*l2+0.2f; // +0.2f = ambient light
+              rgba.g() = rgba.g()*l1 + rgba.g()*l2+0.2f;
+              rgba.b() = rgba.b()*l1 + rgba.b()*l2+0.2f;
+              rgba.r() = clamp(rgba.r(), 0.0f, 1.0f);
+              rgba.g() = clamp(rgba.g(), 0.0f, 1.0f);
+              rgba.b() = clamp(rgba.b(), 0.0f, 1.0f);
+              pixel.r() = (unsigned char)(rgba.r()*255.0f);
+              pixel.g() = (unsigned char)(rgba.g()*255.0f);
+              pixel.b() = (unsigned char)(rgba.b()*255.0f);
+            }
+
+            // map pixel
+            rgba_px[x] = pixel;
+          }
+        }
+      }
+    }
+
+    const unsigned char* mData;
+    int mW, mH, mD, mPitch;
+    const ubvec4* mTrFunc;
+    int mTrFuncWidth;
+    float mNormalizerNum;
+    bool mAlphaFromData;
+    bool mLighting;
+    fvec3 mLight;
+    ubvec4* mRGBA;
+    std::vector<ubvec4> mPixelLUT;
+    std::vector<fvec4> mColorLUT;
+  };
+  //-----------------------------------------------------------------------------
+  // gradient of the first component returned by Image::sample() reading the pixels directly
+  template<typename T>
+  struct GradientNormalsTask: public ParallelForTask
+  {
+    GradientNormalsTask(const Image* img, int comp, int offset, double normalizer, fvec3* gradient_px):
+      mData(img->pixels()), mW(img->width()), mH(img->height()), mD(img->depth()), mPitch(img->pitch()),
+      mComp(comp), mOffset(offset), mNormalizer(normalizer), mGradient(gradient_px)
+    {
+      // same conversion as Image::sample()
+      mLUT.resize(lutSize<T>());
+      for(int i=0; i<(int)mLUT.size(); ++i)
+        mLUT[lutIndex((T)i)] = (float)((double)(T)i / mNormalizer);
+    }
+
+    float value(const unsigned char* row, int x) const
+    {
+      T v = ((const T*)row)[x*mComp + mOffset];
+      return mLUT.empty() ? (float)((double)v / mNormalizer) : mLUT[lutIndex(v)];
+    }
+
+    const unsigned char* row(int y, int z) const { return mData + (size_t)y*mPitch + (size_t)z*mPitch*mH; }
+
+    virtual void runRange(int begin, int end)
+    {
+      fvec3 A, B;
+      for(int z=begin; z<end; ++z)
+      {
+        int zn = z > 0    ? z-1 : 0;
+        int zp = z < mD-1 ? z+1 : mD-1;
+        for(int y=0; y<mH; ++y)
+        {
+          int yn = y > 0    ? y-1 : 0;
+          int yp = y < mH-1 ? y+1 : mH-1;
+          const unsigned char* px  = row(y,  z);
+          const unsigned char* pyn = row(yn, z);
+          const unsigned char* pyp = row(yp, z);
+          const unsigned char* pzn = row(y,  zn);
+          const unsigned char* pzp = row(y,  zp);
+          fvec3* out = mGradient + (size_t)mW*y + (size_t)mW*mH*z;
+          for(int x=0; x<mW; ++x)
+          {
+            int xn = x > 0    ? x-1 : 0;
+            int xp = x < mW-1 ? x+1 : mW-1;
+            A.x() = value(px, xn);
+            B.x() = value(px, xp);
+            A.y() = value(pyn, x);
+            B.y() = value(pyp, x);
+            A.z() = value(pzn, x);
+            B.z() = value(pzp, x);
+            // write normal packed into 0..1 format
+            out[x] = normalize(A - B) * 0.5f + 0.5f;
+          }
+        }
+      }
+    }
+
+    const unsigned char* mData;
+    int mW, mH, mD, mPitch;
+    int mComp, mOffset;
+    double mNormalizer;
+    fvec3* mGradient;
+    std::vector<float> mLUT;
+  };
+  //-----------------------------------------------------------------------------
+  // fallback for the formats whose red channel is always 0
+  struct SampledGradientNormalsTask: public ParallelForTask
+  {
+    SampledGradientNormalsTask(const Image* img, fvec3* gradient_px): mImage(img), mGradient(gradient_px) {}
+
+    virtual void runRange(int begin, int end)
+    {
+      const int w = mImage->width();
+      const int h = mImage->height();
+      const int d = mImage->depth();
+      fvec3 A, B;
+      for(int z=begin; z<end; ++z)
+      {
+        for(int y=0; y<h; ++y)
+        {
+          for(int x=0; x<w; ++x)
+          {
+            // clamped coordinates
+            int xp = x+1, xn = x-1;
+            int yp = y+1, yn = y-1;
+            int zp = z+1, zn = z-1;
+            if (xn<0) xn = 0;
+            if (yn<0) yn = 0;
+            if (zn<0) zn = 0;
+            if (xp>w-1) xp = w-1;
+            if (yp>h-1) yp = h-1;
+            if (zp>d-1) zp = d-1;
+
+            A.x() = mImage->sample(xn,y,z).r();
+            B.x() = mImage->sample(xp,y,z).r();
+            A.y() = mImage->sample(x,yn,z).r();
+            B.y() = mImage->sample(x,yp,z).r();
+            A.z() = mImage->sample(x,y,zn).r();
+            B.z() = mImage->sample(x,y,zp).r();
+
+            // write normal packed into 0..1 format
+            mGradient[x + (size_t)w*y + (size_t)w*h*z] = normalize(A - B) * 0.5f + 0.5f;
+          }
+        }
+      }
+    }
+
+    const Image* mImage;
+    fvec3* mGradient;
+  };
+}
 //-----------------------------------------------------------------------------
 ref<Image> vl::genRGBAVolume(const Image* data, const Image* trfunc, const fvec3& light_dir, bool alpha_from_data)
 {
@@ -118,81 +383,11 @@ ref<Image> vl::genRGBAVolumeT(const Image* data, const Image* trfunc, const fvec
       break;
   }
 
-  // light normalization
-  fvec3 L = light_dir;
-  L.normalize();
-  int w = data->width();
-  int h = data->height();
-  int d = data->depth();
-  int pitch = data->pitch();
-  const unsigned char* lum_px = data->pixels();
   // generated volume
-  ref<Image> volume = new Image( w, h, d, 1, IF_RGBA, IT_UNSIGNED_BYTE );
-  ubvec4* rgba_px = (ubvec4*)volume->pixels();
-  for(int z=0; z<d; ++z)
-  {
-    int z1 = z-1;
-    int z2 = z+1;
-    z1 = clamp(z1, 0, d-1);
-    z2 = clamp(z2, 0, d-1);
-    for(int y=0; y<h; ++y)
-    {
-      int y1 = y-1;
-      int y2 = y+1;
-      y1 = clamp(y1, 0, h-1);
-      y2 = clamp(y2, 0, h-1);
-      for(int x=0; x<w; ++x, ++rgba_px)
-      {
-        // value
-        float lum = (*(data_type*)(lum_px + x*sizeof(data_type) + y*pitch + z*pitch*h)) * normalizer_num;
-        // value -> transfer function
-        float xval = lum*trfunc->width();
-        VL_CHECK(xval>=0)
-        if (xval > trfunc->width()-1.001f)
-          xval = trfunc->width()-1.001f;
-        int ix1 = (int)xval;
-        int ix2 = ix1+1;
-        VL_CHECK(ix2<trfunc->width())
-        float w21  = (float)fract(xval);
-        float w11  = 1.0f - w21;
-        fvec4 c11  = (fvec4)((ubvec4*)trfunc->pixels())[ix1];
-        fvec4 c21  = (fvec4)((ubvec4*)trfunc->pixels())[ix2];
-        fvec4 rgba = (c11*w11 + c21*w21)*(1.0f/255.0f);
-
-        // bake the lighting
-        int x1 = x-1;
-        int x2 = x+1;
-        x1 = clamp(x1, 0, w-1);
-        x2 = clamp(x2, 0, w-1);
-        data_type vx1 = (*(data_type*)(lum_px + x1*sizeof(data_type) + y *pitch + z *pitch*h));
-        data_type vx2 = (*(data_type*)(lum_px + x2*sizeof(data_type) + y *pitch + z *pitch*h));
-        data_type vy1 = (*(data_type*)(lum_px + x *sizeof(data_type) + y1*pitch + z *pitch*h));
-        data_type vy2 = (*(data_type*)(lum_px + x *sizeof(data_type) + y2*pitch + z *pitch*h));
-        data_type vz1 = (*(data_type*)(lum_px + x *sizeof(data_type) + y *pitch + z1*pitch*h));
-        data_type vz2 = (*(data_type*)(lum_px + x *sizeof(data_type) + y *pitch + z2*pitch*h));
-        fvec3 N1(float(vx1-vx2), float(vy1-vy2), float(vz1-vz2));
-        N1.normalize();
-        fvec3 N2 = -N1 * 0.15f;
-        float l1 = max(dot(N1,L),0.0f);
-        float l2 = max(dot(N2,L),0.0f); // opposite dim light to enhance 3D perception
-        rgba.r() = rgba.r()*l1 + rgba.r()*l2+0.2f; // +0.2f = ambient light
-        rgba.g() = rgba.g()*l1 + rgba.g()*l2+0.2f;
-        rgba.b() = rgba.b()*l1 + rgba.b()*l2+0.2f;
-        rgba.r() = clamp(rgba.r(), 0.0f, 1.0f);
-        rgba.g() = clamp(rgba.g(), 0.0f, 1.0f);
-        rgba.b() = clamp(rgba.b(), 0.0f, 1.0f);
-
-        // map pixel
-        rgba_px->r() = (unsigned char)(rgba.r()*255.0f);
-        rgba_px->g() = (unsigned char)(rgba.g()*255.0f);
-        rgba_px->b() = (unsigned char)(rgba.b()*255.0f);
-        if (alpha_from_data)
-          rgba_px->a() = (unsigned char)(lum*255.0f);
-        else
-          rgba_px->a() = (unsigned char)(rgba.a()*255.0f);
-      }
-    }
-  }
+  ref<Image> volume = new Image( data->width(), data->height(), data->depth(), 1, IF_RGBA, IT_UNSIGNED_BYTE );
+  RGBAVolumeTask<data_type> task(data, trfunc, normalizer_num, alpha_from_data, (ubvec4*)volume->pixels());
+  task.setLight(light_dir);
+  parallelFor(0, data->depth(), &task, 1);
 
   return volume;
 }
@@ -243,95 +438,63 @@ ref<Image> vl::genRGBAVolumeT(const Image* data, const Image* trfunc, bool alpha
       break;
   }
 
-  // light normalization
-  int w = data->width();
-  int h = data->height();
-  int d = data->depth();
-  int pitch = data->pitch();
-  const unsigned char* lum_px = data->pixels();
   // generated volume
-  ref<Image> volume = new Image( w, h, d, 1, IF_RGBA, IT_UNSIGNED_BYTE );
-  ubvec4* rgba_px = (ubvec4*)volume->pixels();
-  for(int z=0; z<d; ++z)
-  {
-    int z1 = z-1;
-    int z2 = z+1;
-    z1 = clamp(z1, 0, d-1);
-    z2 = clamp(z2, 0, d-1);
-    for(int y=0; y<h; ++y)
-    {
-      int y1 = y-1;
-      int y2 = y+1;
-      y1 = clamp(y1, 0, h-1);
-      y2 = clamp(y2, 0, h-1);
-      for(int x=0; x<w; ++x, ++rgba_px)
-      {
-        // value
-        float lum = (*(data_type*)(lum_px + x*sizeof(data_type) + y*pitch + z*pitch*h)) * normalizer_num;
-        // value -> transfer function
-        float xval = lum*trfunc->width();
-        VL_CHECK(xval>=0)
-        if (xval > trfunc->width()-1.001f)
-          xval = trfunc->width()-1.001f;
-        int ix1 = (int)xval;
-        int ix2 = ix1+1;
-        VL_CHECK(ix2<trfunc->width())
-        float w21  = (float)fract(xval);
-        float w11  = 1.0f - w21;
-        fvec4 c11  = (fvec4)((ubvec4*)trfunc->pixels())[ix1];
-        fvec4 c21  = (fvec4)((ubvec4*)trfunc->pixels())[ix2];
-        fvec4 rgba = (c11*w11 + c21*w21)*(1.0f/255.0f);
-
-        // map pixel
-        rgba_px->r() = (unsigned char)(rgba.r()*255.0f);
-        rgba_px->g() = (unsigned char)(rgba.g()*255.0f);
-        rgba_px->b() = (unsigned char)(rgba.b()*255.0f);
-        if (alpha_from_data)
-          rgba_px->a() = (unsigned char)(lum*255.0f);
-        else
-          rgba_px->a() = (unsigned char)(rgba.a()*255.0f);
-      }
-    }
-  }
+  ref<Image> volume = new Image( data->width(), data->height(), data->depth(), 1, IF_RGBA, IT_UNSIGNED_BYTE );
+  RGBAVolumeTask<data_type> task(data, trfunc, normalizer_num, alpha_from_data, (ubvec4*)volume->pixels());
+  parallelFor(0, data->depth(), &task, 1);
 
   return volume;
 }
 //-----------------------------------------------------------------------------
+namespace
+{
+  template<typename T>
+  void runGradientNormals(const Image* img, int comp, int offset, double normalizer, fvec3* gradient_px)
+  {
+    GradientNormalsTask<T> task(img, comp, offset, normalizer, gradient_px);
+    parallelFor(0, img->depth(), &task, 1);
+  }
+}
+//-----------------------------------------------------------------------------
 ref<Image> vl::genGradientNormals(const Image* img)
 {
   ref<Image> gradient = new Image;
   gradient->allocate3D(img->width(), img->height(), img->depth(), 1, IF_RGB, IT_FLOAT);
   fvec3* px = (fvec3*)gradient->pixels();
-  fvec3 A, B;
-  for(int z=0; z<gradient->depth(); ++z)
+
+  // layout of the component returned by Image::sample().r()
+  int comp = 0, offset = 0;
+  switch(img->format())
   {
-    for(int y=0; y<gradient->height(); ++y)
+    case IF_RED:             comp = 1; break;
+    case IF_LUMINANCE:       comp = 1; break;
+    case IF_DEPTH_COMPONENT: comp = 1; break;
+    case IF_LUMINANCE_ALPHA: comp = 2; break;
+    case IF_RGB:             comp = 3; break;
+    case IF_RGBA:            comp = 4; break;
+    case IF_BGR:             comp = 3; offset = 2; break;
+    case IF_BGRA:            comp = 4; offset = 2; break;
+    default:
+      break;
+  }
+
+  switch(comp ? img->type() : IT_IMPLICIT_TYPE)
+  {
+    case IT_UNSIGNED_BYTE:  runGradientNormals<unsigned char> (img, comp, offset, 255.0, px); break;
+    case IT_BYTE:           runGradientNormals<char>          (img, comp, offset, 127.0, px); break;
+    case IT_UNSIGNED_SHORT: runGradientNormals<unsigned short>(img, comp, offset, 65535.0, px); break;
+    case IT_SHORT:          runGradientNormals<short>         (img, comp, offset, 32767.0, px); break;
+    case IT_UNSIGNED_INT:   runGradientNormals<unsigned int>  (img, comp, offset, 4294967295.0, px); break;
+    case IT_INT:            runGradientNormals<int>           (img, comp, offset, 2147483647.0, px); break;
+    case IT_FLOAT:          runGradientNormals<float>         (img, comp, offset, 1.0, px); break;
+    default:
     {
-      for(int x=0; x<gradient->width(); ++x)
-      {
-        // clamped coordinates
-        int xp = x+1, xn = x-1;
-        int yp = y+1, yn = y-1;
-        int zp = z+1, zn = z-1;
-        if (xn<0) xn = 0;
-        if (yn<0) yn = 0;
-        if (zn<0) zn = 0;
-        if (xp>img->width() -1) xp = img->width() -1;
-        if (yp>img->height()-1) yp = img->height()-1;
-        if (zp>img->depth() -1) zp = img->depth() -1;
-
-        A.x() = img->sample(xn,y,z).r();
-        B.x() = img->sample(xp,y,z).r();
-        A.y() = img->sample(x,yn,z).r();
-        B.y() = img->sample(x,yp,z).r();
-        A.z() = img->sample(x,y,zn).r();
-        B.z() = img->sample(x,y,zp).r();
-
-        // write normal packed into 0..1 format
-        px[x + img->width()*y + img->width()*img->height()*z] = normalize(A - B) * 0.5f + 0.5f;
-      }
+      SampledGradientNormalsTask task(img, px);
+      parallelFor(0, img->depth(), &task, 1);
+      break;
     }
   }
+
   return gradient;
 }
 //-----------------------------------------------------------------------------